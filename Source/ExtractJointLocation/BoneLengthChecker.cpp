@@ -0,0 +1,221 @@
+#include "BoneLengthChecker.h"
+#include "ReferenceSkeleton.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogBoneLengthChecker, Log, All);
+
+namespace BoneLengthChecker
+{
+	// Outlier frames listed individually in the report; later ones are only counted
+	static constexpr int32 MaxReportedFrames = 10000;
+}
+
+FBoneLengthChecker::FBoneLengthChecker(const FReferenceSkeleton& RefSkeleton, TConstArrayView<int32> KeypointBones, float InTolerance, float MinBoneLength)
+	: Tolerance(InTolerance)
+{
+	NumSkeletonBones = RefSkeleton.GetNum();
+	const TArray<FTransform>& RefBonePose = RefSkeleton.GetRefBonePose();
+
+	// Bones on the chains from the keypoints to the root; other bones (IK targets, twist and corrective bones) do
+	// not affect the streamed positions and many of them move by translation
+	TBitArray<> OnKeypointChain(false, NumSkeletonBones);
+	for (int32 BoneIndex : KeypointBones)
+	{
+		for (; BoneIndex != INDEX_NONE && BoneIndex < NumSkeletonBones && !OnKeypointChain[BoneIndex]; BoneIndex = RefSkeleton.GetParentIndex(BoneIndex))
+		{
+			OnKeypointChain[BoneIndex] = true;
+		}
+	}
+
+	// Reference pose in component space; parents always precede their children
+	TArray<FTransform> RefComponentSpace;
+	RefComponentSpace.SetNum(NumSkeletonBones);
+	for (int32 BoneIndex = 0; BoneIndex < NumSkeletonBones; ++BoneIndex)
+	{
+		const int32 ParentIndex = RefSkeleton.GetParentIndex(BoneIndex);
+		RefComponentSpace[BoneIndex] = ParentIndex == INDEX_NONE ? RefBonePose[BoneIndex] : RefBonePose[BoneIndex] * RefComponentSpace[ParentIndex];
+		// The root's children (e.g. root -> pelvis) carry the root motion and hip height, so their "length" changes
+		if (ParentIndex == INDEX_NONE || RefSkeleton.GetParentIndex(ParentIndex) == INDEX_NONE || !OnKeypointChain[BoneIndex]
+			|| RefSkeleton.GetBoneName(BoneIndex).ToString().StartsWith(TEXT("ik_")))
+		{
+			continue;
+		}
+
+		const float ReferenceLength = static_cast<float>(FVector::Dist(RefComponentSpace[BoneIndex].GetTranslation(), RefComponentSpace[ParentIndex].GetTranslation()));
+		if (ReferenceLength < MinBoneLength)
+		{
+			continue;
+		}
+
+		ChildBones.Add(BoneIndex);
+		ParentBones.Add(ParentIndex);
+		BoneNames.Add(RefSkeleton.GetBoneName(BoneIndex));
+		ReferenceLengths.Add(ReferenceLength);
+		MinLengthsSquared.Add(FMath::Square(ReferenceLength * (1.0f - Tolerance)));
+		MaxLengthsSquared.Add(FMath::Square(ReferenceLength * (1.0f + Tolerance)));
+	}
+	NumCheckedBones = ChildBones.Num();
+	BoneStats.SetNum(NumCheckedBones);
+
+	// Padding lanes compare the root with itself against bounds that can never be violated
+	while (ChildBones.Num() % 4 != 0)
+	{
+		ChildBones.Add(0);
+		ParentBones.Add(0);
+		MinLengthsSquared.Add(-1.0f);
+		MaxLengthsSquared.Add(MAX_flt);
+	}
+
+	PositionsX.SetNumZeroed(NumSkeletonBones);
+	PositionsY.SetNumZeroed(NumSkeletonBones);
+	PositionsZ.SetNumZeroed(NumSkeletonBones);
+}
+
+int32 FBoneLengthChecker::CheckFrame(int32 FrameIndex, TArrayView<const FTransform> ComponentSpaceTransforms)
+{
+	if (ComponentSpaceTransforms.Num() != NumSkeletonBones || NumSkeletonBones == 0)
+	{
+		return 0;
+	}
+
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	for (int32 BoneIndex = 0; BoneIndex < NumSkeletonBones; ++BoneIndex)
+	{
+		const FVector Position = ComponentSpaceTransforms[BoneIndex].GetTranslation();
+		PositionsX[BoneIndex] = static_cast<float>(Position.X);
+		PositionsY[BoneIndex] = static_cast<float>(Position.Y);
+		PositionsZ[BoneIndex] = static_cast<float>(Position.Z);
+	}
+
+	const float* X = PositionsX.GetData();
+	const float* Y = PositionsY.GetData();
+	const float* Z = PositionsZ.GetData();
+	const int32* Child = ChildBones.GetData();
+	const int32* Parent = ParentBones.GetData();
+
+	FOutlierFrame Outlier;
+	Outlier.FrameIndex = FrameIndex;
+	for (int32 i = 0; i < ChildBones.Num(); i += 4)
+	{
+		const VectorRegister4Float DeltaX = VectorSubtract(
+			MakeVectorRegisterFloat(X[Child[i]], X[Child[i + 1]], X[Child[i + 2]], X[Child[i + 3]]),
+			MakeVectorRegisterFloat(X[Parent[i]], X[Parent[i + 1]], X[Parent[i + 2]], X[Parent[i + 3]]));
+		const VectorRegister4Float DeltaY = VectorSubtract(
+			MakeVectorRegisterFloat(Y[Child[i]], Y[Child[i + 1]], Y[Child[i + 2]], Y[Child[i + 3]]),
+			MakeVectorRegisterFloat(Y[Parent[i]], Y[Parent[i + 1]], Y[Parent[i + 2]], Y[Parent[i + 3]]));
+		const VectorRegister4Float DeltaZ = VectorSubtract(
+			MakeVectorRegisterFloat(Z[Child[i]], Z[Child[i + 1]], Z[Child[i + 2]], Z[Child[i + 3]]),
+			MakeVectorRegisterFloat(Z[Parent[i]], Z[Parent[i + 1]], Z[Parent[i + 2]], Z[Parent[i + 3]]));
+		const VectorRegister4Float LengthSquared = VectorMultiplyAdd(DeltaX, DeltaX, VectorMultiplyAdd(DeltaY, DeltaY, VectorMultiply(DeltaZ, DeltaZ)));
+
+		const VectorRegister4Float Outside = VectorBitwiseOr(
+			VectorCompareLT(LengthSquared, VectorLoad(&MinLengthsSquared[i])),
+			VectorCompareGT(LengthSquared, VectorLoad(&MaxLengthsSquared[i])));
+		const int32 OutsideMask = VectorMaskBits(Outside);
+		if (OutsideMask == 0)
+		{
+			continue;
+		}
+
+		// Rare path: record the stretched bones
+		for (int32 Lane = 0; Lane < 4; ++Lane)
+		{
+			if ((OutsideMask & (1 << Lane)) == 0)
+			{
+				continue;
+			}
+
+			const int32 CheckedBone = i + Lane;
+			const float Length = FMath::Sqrt(FMath::Square(X[Child[CheckedBone]] - X[Parent[CheckedBone]])
+				+ FMath::Square(Y[Child[CheckedBone]] - Y[Parent[CheckedBone]]) + FMath::Square(Z[Child[CheckedBone]] - Z[Parent[CheckedBone]]));
+			const float Ratio = Length / ReferenceLengths[CheckedBone];
+
+			FBoneStats& Stats = BoneStats[CheckedBone];
+			++Stats.NumOutlierFrames;
+			Stats.MinRatio = FMath::Min(Stats.MinRatio, Ratio);
+			Stats.MaxRatio = FMath::Max(Stats.MaxRatio, Ratio);
+
+			++Outlier.NumBones;
+			if (FMath::Abs(Ratio - 1.0f) > FMath::Abs(Outlier.WorstRatio - 1.0f))
+			{
+				Outlier.WorstBone = CheckedBone;
+				Outlier.WorstRatio = Ratio;
+			}
+		}
+	}
+
+	++NumFramesChecked;
+	if (Outlier.NumBones > 0)
+	{
+		++NumOutlierFrames;
+		if (OutlierFrames.Num() < BoneLengthChecker::MaxReportedFrames)
+		{
+			OutlierFrames.Add(Outlier);
+		}
+	}
+	CheckCycles += FPlatformTime::Cycles64() - StartCycles;
+	return Outlier.NumBones;
+}
+
+double FBoneLengthChecker::GetCheckSeconds() const
+{
+	return FPlatformTime::ToSeconds64(CheckCycles);
+}
+
+bool FBoneLengthChecker::WriteReport(const FString& FilePath, const FString& Subject, const FString& MeshType) const
+{
+	TSharedPtr<FJsonObject> ReportObject = MakeShareable(new FJsonObject);
+	ReportObject->SetStringField(TEXT("Subject"), Subject);
+	ReportObject->SetStringField(TEXT("Mesh"), MeshType);
+	ReportObject->SetNumberField(TEXT("Tolerance"), Tolerance);
+	ReportObject->SetNumberField(TEXT("BonesChecked"), NumCheckedBones);
+	ReportObject->SetNumberField(TEXT("FramesChecked"), NumFramesChecked);
+	ReportObject->SetNumberField(TEXT("OutlierFrames"), NumOutlierFrames);
+	ReportObject->SetNumberField(TEXT("CheckSeconds"), GetCheckSeconds());
+	ReportObject->SetNumberField(TEXT("CheckMicrosecondsPerFrame"), NumFramesChecked > 0 ? GetCheckSeconds() * 1.0e6 / NumFramesChecked : 0.0);
+
+	TArray<TSharedPtr<FJsonValue>> BoneArray;
+	for (int32 CheckedBone = 0; CheckedBone < NumCheckedBones; ++CheckedBone)
+	{
+		const FBoneStats& Stats = BoneStats[CheckedBone];
+		if (Stats.NumOutlierFrames == 0)
+		{
+			continue;
+		}
+
+		TSharedPtr<FJsonObject> BoneObject = MakeShareable(new FJsonObject);
+		BoneObject->SetStringField(TEXT("Bone"), BoneNames[CheckedBone].ToString());
+		BoneObject->SetNumberField(TEXT("ReferenceLength"), ReferenceLengths[CheckedBone]);
+		BoneObject->SetNumberField(TEXT("OutlierFrames"), Stats.NumOutlierFrames);
+		BoneObject->SetNumberField(TEXT("MinRatio"), Stats.MinRatio);
+		BoneObject->SetNumberField(TEXT("MaxRatio"), Stats.MaxRatio);
+		BoneArray.Add(MakeShareable(new FJsonValueObject(BoneObject)));
+	}
+	ReportObject->SetArrayField(TEXT("Bones"), BoneArray);
+
+	TArray<TSharedPtr<FJsonValue>> FrameArray;
+	for (const FOutlierFrame& Outlier : OutlierFrames)
+	{
+		TSharedPtr<FJsonObject> FrameObject = MakeShareable(new FJsonObject);
+		FrameObject->SetNumberField(TEXT("Frame"), Outlier.FrameIndex);
+		FrameObject->SetNumberField(TEXT("Bones"), Outlier.NumBones);
+		FrameObject->SetStringField(TEXT("WorstBone"), BoneNames[Outlier.WorstBone].ToString());
+		FrameObject->SetNumberField(TEXT("WorstRatio"), Outlier.WorstRatio);
+		FrameArray.Add(MakeShareable(new FJsonValueObject(FrameObject)));
+	}
+	ReportObject->SetArrayField(TEXT("Frames"), FrameArray);
+
+	FString ReportContent;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&ReportContent);
+	FJsonSerializer::Serialize(ReportObject.ToSharedRef(), Writer);
+	if (!FFileHelper::SaveStringToFile(ReportContent, *FilePath))
+	{
+		UE_LOG(LogBoneLengthChecker, Error, TEXT("WriteReport: Failed to write %s"), *FilePath);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,77 @@
+// BoneLengthChecker.h
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FReferenceSkeleton;
+
+/**
+ * QA check for stretched bones: compares the length of parent-child bone pairs in a frame's component
+ * space pose with the reference pose. Only the chains from the streamed keypoints up to the root are checked, and
+ * bones animated by translation (the root's children such as the pelvis, and ik_* bones) are skipped. Lengths are compared squared, four bones at a time with SIMD, against
+ * per-bone bounds precomputed from the tolerance, so a frame costs a gather and a few vector ops per bone.
+ * Frames with outliers are collected into a report, e.g. to catch broken retargeting or LOD swaps.
+ */
+class EXTRACTJOINTLOCATION_API FBoneLengthChecker
+{
+public:
+	/**
+	 * @param KeypointBones Reference skeleton indices of the streamed keypoints; only they and their ancestors are checked.
+	 * @param Tolerance Allowed relative length change, e.g. 0.05 for 5 %.
+	 * @param MinBoneLength Bones shorter than this in the reference pose (cm) are not checked.
+	 */
+	FBoneLengthChecker(const FReferenceSkeleton& RefSkeleton, TConstArrayView<int32> KeypointBones, float Tolerance, float MinBoneLength);
+
+	/**
+	 * Checks one frame.
+	 * @param ComponentSpaceTransforms Pose of the reference skeleton's bones, e.g. USkinnedMeshComponent::GetComponentSpaceTransforms().
+	 * @return Number of bones outside the tolerance.
+	 */
+	int32 CheckFrame(int32 FrameIndex, TArrayView<const FTransform> ComponentSpaceTransforms);
+
+	/** Writes the outlier frames and the bones involved as JSON. */
+	bool WriteReport(const FString& FilePath, const FString& Subject, const FString& MeshType) const;
+
+	int32 GetNumFramesChecked() const { return NumFramesChecked; }
+	int32 GetNumOutlierFrames() const { return NumOutlierFrames; }
+	double GetCheckSeconds() const;
+
+private:
+	struct FOutlierFrame
+	{
+		int32 FrameIndex = 0;
+		int32 NumBones = 0;
+		int32 WorstBone = INDEX_NONE;
+		float WorstRatio = 1.0f;
+	};
+
+	struct FBoneStats
+	{
+		int32 NumOutlierFrames = 0;
+		float MinRatio = 1.0f;
+		float MaxRatio = 1.0f;
+	};
+
+	// Checked bones and their parents as reference skeleton indices, padded to a multiple of four
+	TArray<int32> ChildBones;
+	TArray<int32> ParentBones;
+	TArray<FName> BoneNames;
+	TArray<float> ReferenceLengths;
+	// Squared length bounds per checked bone
+	TArray<float> MinLengthsSquared;
+	TArray<float> MaxLengthsSquared;
+	int32 NumCheckedBones = 0;
+	int32 NumSkeletonBones = 0;
+	float Tolerance;
+
+	// Bone positions of the current frame, one component array each
+	TArray<float> PositionsX;
+	TArray<float> PositionsY;
+	TArray<float> PositionsZ;
+
+	int32 NumFramesChecked = 0;
+	int32 NumOutlierFrames = 0;
+	TArray<FOutlierFrame> OutlierFrames;
+	TArray<FBoneStats> BoneStats;
+	uint64 CheckCycles = 0;
+};
@@ -1,4 +1,5 @@
 #include "CameraDataComponent.h"
+#include "CameraRegistrySubsystem.h"
 
 // Core Engine/Framework Includes
 #include "Kismet/GameplayStatics.h"
@@ -29,6 +30,7 @@ UCameraDataComponent::UCameraDataComponent()
 	TargetRenderTarget = nullptr;
 	CameraDataFilename = TEXT("");
 	RenderTargetImageFilename = TEXT("");
+	OutputSubdirectory = TEXT("");
 }
 
 // Called when the game starts
@@ -36,11 +38,46 @@ void UCameraDataComponent::BeginPlay()
 {
 	Super::BeginPlay();
 
+	// The registry tracks the calibration; it exports it (see bAutoExportCalibration) only when the camera changes
+	if (UCameraRegistrySubsystem* CameraRegistry = GetWorld()->GetSubsystem<UCameraRegistrySubsystem>())
+	{
+		CameraRegistry->RegisterCamera(this);
+	}
+}
+
+void UCameraDataComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UCameraRegistrySubsystem* CameraRegistry = GetWorld() ? GetWorld()->GetSubsystem<UCameraRegistrySubsystem>() : nullptr)
+	{
+		CameraRegistry->UnregisterCamera(this);
+	}
+	Super::EndPlay(EndPlayReason);
+}
+
+bool UCameraDataComponent::ExportCameraData()
+{
+	if (!ExportCalibration())
+	{
+		return false;
+	}
+
+	if (TargetRenderTarget)
+	{
+		FString FinalRenderTargetFilename = RenderTargetImageFilename.IsEmpty() ?
+			FString::Printf(TEXT("%s_Frame.png"), *GetOwner()->GetName()) : RenderTargetImageFilename;
+
+		SaveRenderTargetToDisk(TargetRenderTarget, FinalRenderTargetFilename);
+	}
+	return true;
+}
+
+bool UCameraDataComponent::ExportCalibration()
+{
 	AActor* OwnerActor = GetOwner();
 	if (!OwnerActor)
 	{
 		UE_LOG(LogCameraData, Error, TEXT("CameraDataComponent: Owner actor is null. Cannot extract camera data."));
-		return;
+		return false;
 	}
 
 	ACineCameraActor* CineCameraActor = Cast<ACineCameraActor>(OwnerActor);
@@ -49,7 +86,7 @@ void UCameraDataComponent::BeginPlay()
 	if (!CineCameraActor && !SceneCaptureActor)
 	{
 		UE_LOG(LogCameraData, Warning, TEXT("CameraDataComponent: Component is not attached to a CineCameraActor or SceneCapture2D. Skipping data extraction."));
-		return;
+		return false;
 	}
 
 	FString CameraName = OwnerActor->GetName();
@@ -64,19 +101,12 @@ void UCameraDataComponent::BeginPlay()
 		SaveCameraDataToFile(FinalCameraDataFilename, Extrinsics, Intrinsics, CameraName);
 		SaveIntrinsicDataToJSON(FinalCameraDataFilename, Intrinsics, CameraName);
 		SaveExtrinsicDataToJSON(FinalCameraDataFilename, Extrinsics, CameraName);
-
-		if (TargetRenderTarget)
-		{
-			FString FinalRenderTargetFilename = RenderTargetImageFilename.IsEmpty() ?
-				FString::Printf(TEXT("%s_Frame.png"), *CameraName) : RenderTargetImageFilename;
-
-			SaveRenderTargetToDisk(TargetRenderTarget, FinalRenderTargetFilename);
-		}
 	}
 	else
 	{
 		UE_LOG(LogCameraData, Error, TEXT("CameraDataComponent: Failed to get camera intrinsics for %s."), *CameraName);
 	}
+	return bIntrinsicsSuccess;
 }
 
 // Called every frame - kept as false in constructor for one-time operation
@@ -162,7 +192,7 @@ bool UCameraDataComponent::GetCameraIntrinsics(FCameraIntrinsics& OutIntrinsics,
 void UCameraDataComponent::SaveIntrinsicDataToJSON(const FString& Filename, const FCameraIntrinsics& Intrinsics, const FString& CameraName) {
 
 	// Construct the directory path using CameraName
-	FString SaveDirectory = FPaths::ProjectSavedDir() + TEXT("CameraData/") + CameraName + TEXT("/");
+	FString SaveDirectory = GetOutputDirectory(TEXT("CameraData")) + CameraName + TEXT("/");
 	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
 
 	// Create the directory if it doesn't exist
@@ -228,7 +258,7 @@ void UCameraDataComponent::SaveIntrinsicDataToJSON(const FString& Filename, cons
 }
 
 void UCameraDataComponent::SaveExtrinsicDataToJSON(const FString& Filename, const FTransform& Extrinsics, const FString& CameraName) {
-	FString SaveDirectory = FPaths::ProjectSavedDir() + TEXT("CameraData/") + CameraName + TEXT("/");
+	FString SaveDirectory = GetOutputDirectory(TEXT("CameraData")) + CameraName + TEXT("/");
 	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
 
 	// Create the directory if it doesn't exist
@@ -299,7 +329,7 @@ void UCameraDataComponent::SaveExtrinsicDataToJSON(const FString& Filename, cons
 
 void UCameraDataComponent::SaveCameraDataToFile(const FString& Filename, const FTransform& Extrinsics, const FCameraIntrinsics& Intrinsics, const FString& CameraName)
 {
-	FString SaveDirectory = FPaths::ProjectSavedDir() + TEXT("CameraData/");
+	FString SaveDirectory = GetOutputDirectory(TEXT("CameraData"));
 	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
 
 	if (!PlatformFile.DirectoryExists(*SaveDirectory))
@@ -308,6 +338,20 @@ void UCameraDataComponent::SaveCameraDataToFile(const FString& Filename, const F
 	}
 
 	FString AbsoluteFilePath = SaveDirectory + Filename;
+	FString OutputContent = FormatCameraData(Extrinsics, Intrinsics, CameraName);
+
+	if (FFileHelper::SaveStringToFile(OutputContent, *AbsoluteFilePath))
+	{
+		UE_LOG(LogCameraData, Log, TEXT("Successfully saved camera data to: %s"), *AbsoluteFilePath);
+	}
+	else
+	{
+		UE_LOG(LogCameraData, Error, TEXT("Failed to save camera data to: %s"), *AbsoluteFilePath);
+	}
+}
+
+FString UCameraDataComponent::FormatCameraData(const FTransform& Extrinsics, const FCameraIntrinsics& Intrinsics, const FString& CameraName)
+{
 	FVector Location = Extrinsics.GetLocation();
 	FRotator Rotation = Extrinsics.GetRotation().Rotator();
 	FVector Scale = Extrinsics.GetScale3D();
@@ -339,21 +383,12 @@ void UCameraDataComponent::SaveCameraDataToFile(const FString& Filename, const F
 			IntrinsicMatrix.M[Row][0], IntrinsicMatrix.M[Row][1], IntrinsicMatrix.M[Row][2]);
 	}
 
-	FString OutputContent = FString::Printf(TEXT("Camera Name: %s\n\n%s\n\n%s\n\n%s\n\n%s"),
+	return FString::Printf(TEXT("Camera Name: %s\n\n%s\n\n%s\n\n%s\n\n%s"),
 		*CameraName,
 		*ExtrinsicString,
 		*ExtrinsicMatrixString,
 		*IntrinsicString,
 		*IntrinsicMatrixString);
-
-	if (FFileHelper::SaveStringToFile(OutputContent, *AbsoluteFilePath))
-	{
-		UE_LOG(LogCameraData, Log, TEXT("Successfully saved camera data to: %s"), *AbsoluteFilePath);
-	}
-	else
-	{
-		UE_LOG(LogCameraData, Error, TEXT("Failed to save camera data to: %s"), *AbsoluteFilePath);
-	}
 }
 
 void UCameraDataComponent::SaveRenderTargetToDisk(UTextureRenderTarget2D* RenderTarget, const FString& Filename)
@@ -364,7 +399,7 @@ void UCameraDataComponent::SaveRenderTargetToDisk(UTextureRenderTarget2D* Render
 		return;
 	}
 
-	FString SaveDirectory = FPaths::ProjectSavedDir() + TEXT("CameraFrames/");
+	FString SaveDirectory = GetOutputDirectory(TEXT("CameraFrames"));
 	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
 
 	if (!PlatformFile.DirectoryExists(*SaveDirectory))
@@ -391,4 +426,14 @@ FMatrix UCameraDataComponent::ConvertIntrinsicsToIntrinsicMatrix(const FCameraIn
 	K.M[1][2] = Intrinsics.PrincipalPointY;
 	K.M[2][2] = 1.0f;
 	return K;
-}
\ No newline at end of file
+}
+
+FString UCameraDataComponent::GetOutputDirectory(const TCHAR* Root) const
+{
+	FString Directory = FPaths::ProjectSavedDir() + Root + TEXT("/");
+	if (!OutputSubdirectory.IsEmpty())
+	{
+		Directory += OutputSubdirectory + TEXT("/");
+	}
+	return Directory;
+}
@@ -41,6 +41,8 @@ protected:
 	// Called when the game starts
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 public:
 	// Called every frame
 	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
@@ -66,6 +68,29 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Camera Data")
 	FString RenderTargetImageFilename;
 
+	/**
+	 * Optional: Subfolder of Saved/CameraData and Saved/CameraFrames all of this camera's files are written to,
+	 * e.g. the take name (see ATakeManager). If empty, files go straight into those folders.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Camera Data")
+	FString OutputSubdirectory;
+
+	/**
+	 * Saves the camera's matrices, JSON calibration and (if TargetRenderTarget is set) its current frame.
+	 * Reading the frame back stalls the game thread until the GPU has rendered it.
+	 * @return True if the owner is a camera and its intrinsics could be computed.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Camera Data")
+	bool ExportCameraData();
+
+	/**
+	 * Saves the camera's matrices and JSON calibration only, without reading back a frame.
+	 * Called by UCameraRegistrySubsystem::ExportChangedCalibration whenever the camera's transform or lens changes.
+	 * @return True if the owner is a camera and its intrinsics could be computed.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Camera Data")
+	bool ExportCalibration();
+
 	/**
 	 * Extracts the extrinsic properties (world transform) of the attached camera.
 	 * @return A transform representing the camera's pose in world space.
@@ -92,6 +117,9 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Camera Data")
 	void SaveCameraDataToFile(const FString& Filename, const FTransform& Extrinsics, const FCameraIntrinsics& Intrinsics, const FString& CameraName);
 
+	/** Text SaveCameraDataToFile writes, for callers that store it elsewhere (e.g. the capture container). */
+	FString FormatCameraData(const FTransform& Extrinsics, const FCameraIntrinsics& Intrinsics, const FString& CameraName);
+
 	/**
 	 * Saves a UTextureRenderTarget2D to a PNG file on disk.
 	 * @param RenderTarget The render target to save.
@@ -122,4 +150,7 @@ public:
 
 	UFUNCTION(BluePrintCallable, Category = "Camera Data")
 	void SaveIntrinsicDataToJSON(const FString& Filename, const FCameraIntrinsics& Intrinsics, const FString& CameraName);
+
+	/** Saved/<Root>/ or Saved/<Root>/<OutputSubdirectory>/ (with a trailing slash), e.g. for Root "CameraFrames". */
+	FString GetOutputDirectory(const TCHAR* Root) const;
 };
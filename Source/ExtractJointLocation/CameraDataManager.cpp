@@ -1,12 +1,26 @@
 #include "CameraDataManager.h"
-#include "Kismet/GameplayStatics.h"
 #include "CameraDataComponent.h"
+#include "CameraRegistrySubsystem.h"
+#include "LiveFrameStreamSubsystem.h"
+#include "CameraVideoOutputSubsystem.h"
+#include "SubjectCropSubsystem.h"
 #include "Engine/SceneCapture2D.h"
 #include "Components/SceneCaptureComponent2D.h"
 #include "CineCameraActor.h"
 #include "Engine/Texture2DDynamic.h"
 #include "Kismet/KismetRenderingLibrary.h"
 #include "TimerManager.h"
+#include "CaptureAtlas.h"
+#include "CaptureOutputSubsystem.h"
+#include "Async/ParallelFor.h"
+#include "Misc/Paths.h"
+#include "Misc/FileHelper.h"
+#include "RenderingThread.h"
+#include "RHICommandList.h"
+#include "TextureResource.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
 
 // Define a log category for your manager
 DEFINE_LOG_CATEGORY_STATIC(LogCameraDataManager, Log, All);
@@ -18,6 +32,7 @@ ACameraDataManager::ACameraDataManager()
 
 	// Set a reasonable default delay to allow other actors to initialize.
 	DataExtractionDelay = 1.0f;
+	AtlasRenderTarget = nullptr;
 }
 
 // Called when the game starts or when spawned
@@ -30,6 +45,22 @@ void ACameraDataManager::BeginPlay()
 	GetWorldTimerManager().SetTimer(ExtractionTimerHandle, this, &ACameraDataManager::ExtractAndSaveAllCameraData, DataExtractionDelay, false);
 }
 
+void ACameraDataManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (EncoderPool)
+	{
+		EncoderPool->Flush();
+		EncoderPool->LogStats();
+		EncoderPool.Reset();
+	}
+	// Encoders finish their videos once their input ends
+	if (UCameraVideoOutputSubsystem* VideoOutput = GetWorld() ? GetWorld()->GetSubsystem<UCameraVideoOutputSubsystem>() : nullptr)
+	{
+		VideoOutput->CloseStreams();
+	}
+	Super::EndPlay(EndPlayReason);
+}
+
 // Called every frame
 void ACameraDataManager::Tick(float DeltaTime)
 {
@@ -38,81 +69,461 @@ void ACameraDataManager::Tick(float DeltaTime)
 
 void ACameraDataManager::ExtractAndSaveAllCameraData()
 {
-	UE_LOG(LogCameraDataManager, Log, TEXT("ACameraDataManager: Starting synchronized camera data extraction."));
-
-	TArray<AActor*> FoundCameraActors;
-	// Use GetAllActorsOfClass to find all actors of a certain class.
-	UGameplayStatics::GetAllActorsOfClass(GetWorld(), ACineCameraActor::StaticClass(), FoundCameraActors);
-
-	TArray<AActor*> FoundSceneCaptureActors;
-	UGameplayStatics::GetAllActorsOfClass(GetWorld(), ASceneCapture2D::StaticClass(), FoundSceneCaptureActors);
-	FoundCameraActors.Append(FoundSceneCaptureActors);
+	if (bUseAtlasCapture)
+	{
+		ExtractAndSaveAllCameraDataAtlas();
+		return;
+	}
 
-	UE_LOG(LogCameraDataManager, Log, TEXT("ACameraDataManager: Found %d candidate camera actors."), FoundCameraActors.Num());
+	UE_LOG(LogCameraDataManager, Log, TEXT("ACameraDataManager: Starting synchronized camera data extraction."));
 
-	if (FoundCameraActors.Num() == 0)
+	UCameraRegistrySubsystem* CameraRegistry = GetWorld()->GetSubsystem<UCameraRegistrySubsystem>();
+	if (!CameraRegistry || CameraRegistry->GetCameras().Num() == 0)
 	{
-		UE_LOG(LogCameraDataManager, Warning, TEXT("No CineCameraActor or ASceneCapture2D actors found in the scene to process."));
+		UE_LOG(LogCameraDataManager, Warning, TEXT("No cameras with a CameraDataComponent registered in the scene to process."));
 		return;
 	}
+	CameraRegistry->RefreshCalibration();
+
+	UE_LOG(LogCameraDataManager, Log, TEXT("ACameraDataManager: Found %d registered cameras."), CameraRegistry->GetCameras().Num());
+	ULiveFrameStreamSubsystem* LiveStream = GetWorld()->GetSubsystem<ULiveFrameStreamSubsystem>();
+	USubjectCropSubsystem* SubjectCrops = GetWorld()->GetSubsystem<USubjectCropSubsystem>();
+	UCameraVideoOutputSubsystem* VideoOutput = GetWorld()->GetSubsystem<UCameraVideoOutputSubsystem>();
+	const bool bReadPixels = bSaveFullFrames || (LiveStream && LiveStream->IsEnabled()) || (SubjectCrops && SubjectCrops->IsEnabled())
+		|| (VideoOutput && VideoOutput->IsEnabled());
+	UCaptureOutputSubsystem* CaptureOutput = GetWorld()->GetSubsystem<UCaptureOutputSubsystem>();
 
-	for (AActor* CameraActor : FoundCameraActors)
+	// Read back frames are kept for the subject crops, which are cut from all cameras at once, and encoded after them
+	TArray<FCapturedFrame> ReadFrames;
+	ReadFrames.Reserve(CameraRegistry->GetCameras().Num());
+
+	for (const FRegisteredCamera& Camera : CameraRegistry->GetCameras())
 	{
-		if (CameraActor)
+		UCameraDataComponent* CameraDataComponent = Camera.Component.Get();
+		USceneCaptureComponent2D* SceneCaptureComp = Camera.SceneCapture.Get();
+		UTextureRenderTarget2D* RenderTarget = SceneCaptureComp ? SceneCaptureComp->TextureTarget : nullptr;
+		const FString& CameraName = Camera.Name;
+		if (!CameraDataComponent)
 		{
-			// Get the camera name once at the start of the loop
-			FString CameraName = CameraActor->GetActorLabel();
-			if (CameraName.IsEmpty())
-			{
-				CameraName = CameraActor->GetName();
-			}
+			continue;
+		}
+
+		if (RenderTarget)
+		{
+			// Set the capture source back to LDR for a standard tone-mapped image
+			// This ensures the image looks like what you see in the viewport.
+			SceneCaptureComp->CaptureSource = ESceneCaptureSource::SCS_FinalColorLDR;
 
-			// Check if the camera actor has our custom component
-			UCameraDataComponent* CameraDataComponent = CameraActor->FindComponentByClass<UCameraDataComponent>();
+			// Force an immediate render
+			SceneCaptureComp->CaptureScene();
 
-			if (CameraDataComponent)
+			if (Camera.bHasIntrinsics)
 			{
-				USceneCaptureComponent2D* SceneCaptureComp = CameraActor->FindComponentByClass<USceneCaptureComponent2D>();
-				UTextureRenderTarget2D* RenderTarget = SceneCaptureComp ? SceneCaptureComp->TextureTarget : nullptr;
+				SaveCalibration(Camera);
 
-				if (RenderTarget)
+				// The frame is read back once for the live stream, the subject crops and the encoder pool
+				if (bReadPixels)
 				{
-					// Set the capture source back to LDR for a standard tone-mapped image
-					// This ensures the image looks like what you see in the viewport.
-					SceneCaptureComp->CaptureSource = ESceneCaptureSource::SCS_FinalColorLDR;
-
-					// Force an immediate render
-					SceneCaptureComp->CaptureScene();
-
-					FTransform Extrinsics = CameraDataComponent->GetCameraExtrinsics();
-					FCameraIntrinsics Intrinsics;
-
-					if (CameraDataComponent->GetCameraIntrinsics(Intrinsics, RenderTarget))
+					FCapturedFrame& Frame = ReadFrames.AddDefaulted_GetRef();
+					FTextureRenderTargetResource* Resource = RenderTarget->GameThread_GetRenderTargetResource();
+					if (Resource && Resource->ReadPixels(Frame.Pixels))
 					{
-						FString FilenamePrefix = CameraName;
-
-						// Save camera matrices
-						CameraDataComponent->SaveCameraDataToFile(FilenamePrefix + TEXT("_Matrices.txt"), Extrinsics, Intrinsics, CameraName);
-
-						// Save rendered frame as a standard PNG
-						CameraDataComponent->SaveRenderTargetToDisk(RenderTarget, FilenamePrefix + TEXT("_Frame.png"));
-						UE_LOG(LogCameraDataManager, Log, TEXT("Saved synchronized data for: %s"), *CameraName);
+						Frame.Camera = &Camera;
+						Frame.Width = RenderTarget->SizeX;
+						Frame.Height = RenderTarget->SizeY;
+						if (LiveStream && LiveStream->IsEnabled())
+						{
+							LiveStream->PublishCameraFrame(Camera, Frame.Pixels.GetData(), Frame.Width, Frame.Height);
+						}
+						if (VideoOutput && VideoOutput->IsEnabled())
+						{
+							VideoOutput->SubmitCameraFrame(Camera, Frame.Pixels.GetData(), Frame.Width, Frame.Height);
+						}
 					}
 					else
 					{
-						UE_LOG(LogCameraDataManager, Error, TEXT("Failed to get intrinsics for actor: %s"), *CameraName);
+						ReadFrames.Pop();
+						if (bSaveFullFrames && bWriteToContainer)
+						{
+							UE_LOG(LogCameraDataManager, Error, TEXT("Failed to read back %s, its frame is missing from the container."), *CameraName);
+						}
+						else if (bSaveFullFrames)
+						{
+							// Fall back to the engine's synchronous PNG export
+							UE_LOG(LogCameraDataManager, Warning, TEXT("Failed to read back %s, exporting the render target as PNG."), *CameraName);
+							CameraDataComponent->SaveRenderTargetToDisk(RenderTarget, CameraName + TEXT("_Frame.png"));
+							if (CaptureOutput)
+							{
+								CaptureOutput->IndexFile(ECaptureIndexKind::Image, FString(), CameraName, CameraDataComponent->GetOutputDirectory(TEXT("CameraFrames")) + CameraName + TEXT("_Frame.png"));
+							}
+						}
 					}
 				}
-				else
-				{
-					UE_LOG(LogCameraDataManager, Warning, TEXT("RenderTarget is invalid for actor: %s. Skipping data save."), *CameraName);
-				}
+				UE_LOG(LogCameraDataManager, Log, TEXT("Saved synchronized data for: %s"), *CameraName);
 			}
 			else
 			{
-				UE_LOG(LogCameraDataManager, Warning, TEXT("Camera actor %s does not have a CameraDataComponent. Skipping data save."), *CameraName);
+				UE_LOG(LogCameraDataManager, Error, TEXT("Failed to get intrinsics for actor: %s"), *CameraName);
 			}
 		}
+		else
+		{
+			UE_LOG(LogCameraDataManager, Warning, TEXT("RenderTarget is invalid for actor: %s. Skipping data save."), *CameraName);
+		}
+	}
+	if (SubjectCrops && SubjectCrops->IsEnabled() && ReadFrames.Num() > 0)
+	{
+		TArray<FSubjectCropFrame> CropFrames;
+		for (const FCapturedFrame& Frame : ReadFrames)
+		{
+			CropFrames.Add({ Frame.Camera, Frame.Pixels.GetData(), Frame.Width, Frame.Height });
+		}
+		ExportSubjectCrops(*SubjectCrops, CropFrames);
+	}
+
+	if (bSaveFullFrames)
+	{
+		SaveFrames(ReadFrames);
 	}
 	UE_LOG(LogCameraDataManager, Log, TEXT("ACameraDataManager: Finished synchronized camera data extraction."));
 }
+
+
+void ACameraDataManager::ExtractAndSaveAllCameraDataAtlas()
+{
+	UE_LOG(LogCameraDataManager, Log, TEXT("ACameraDataManager: Starting atlas camera data extraction."));
+	const double StartTime = FPlatformTime::Seconds();
+
+	UCameraRegistrySubsystem* CameraRegistry = GetWorld()->GetSubsystem<UCameraRegistrySubsystem>();
+	if (!CameraRegistry)
+	{
+		return;
+	}
+	CameraRegistry->RefreshCalibration();
+
+	struct FAtlasCamera
+	{
+		const FRegisteredCamera* Camera;
+		USceneCaptureComponent2D* SceneCaptureComp;
+	};
+	TArray<FAtlasCamera> AtlasCameras;
+	FIntPoint TileSize = FIntPoint::ZeroValue;
+
+	for (const FRegisteredCamera& Camera : CameraRegistry->GetCameras())
+	{
+		USceneCaptureComponent2D* SceneCaptureComp = Camera.SceneCapture.Get();
+		UTextureRenderTarget2D* RenderTarget = SceneCaptureComp ? SceneCaptureComp->TextureTarget : nullptr;
+		if (!Camera.Component.IsValid() || !RenderTarget)
+		{
+			UE_LOG(LogCameraDataManager, Warning, TEXT("Camera actor %s has no RenderTarget. Skipping atlas capture."), *Camera.Name);
+			continue;
+		}
+
+		// The first camera decides the tile size; the atlas only holds equally sized tiles
+		const FIntPoint Size(RenderTarget->SizeX, RenderTarget->SizeY);
+		if (TileSize == FIntPoint::ZeroValue)
+		{
+			TileSize = Size;
+		}
+		else if (Size != TileSize)
+		{
+			UE_LOG(LogCameraDataManager, Warning, TEXT("RenderTarget of %s is %dx%d, atlas tiles are %dx%d. Skipping atlas capture."),
+				*Camera.Name, Size.X, Size.Y, TileSize.X, TileSize.Y);
+			continue;
+		}
+
+		if (!Camera.bHasIntrinsics)
+		{
+			UE_LOG(LogCameraDataManager, Error, TEXT("Failed to get intrinsics for actor: %s"), *Camera.Name);
+			continue;
+		}
+		AtlasCameras.Add({ &Camera, SceneCaptureComp });
+	}
+
+	if (AtlasCameras.Num() == 0)
+	{
+		UE_LOG(LogCameraDataManager, Warning, TEXT("No cameras with a CameraDataComponent and RenderTarget found for atlas capture."));
+		return;
+	}
+
+	const FCaptureAtlasLayout Layout = FCaptureAtlasLayout::Make(AtlasCameras.Num(), TileSize.X, TileSize.Y, MaxAtlasSize);
+	if (!Layout.IsValid())
+	{
+		UE_LOG(LogCameraDataManager, Error, TEXT("%d tiles of %dx%d do not fit in a %d pixel atlas. Use fewer cameras or a larger MaxAtlasSize."),
+			AtlasCameras.Num(), TileSize.X, TileSize.Y, MaxAtlasSize);
+		return;
+	}
+
+	// (Re)allocate the atlas only when the layout changes
+	if (!AtlasRenderTarget || AtlasRenderTarget->SizeX != Layout.GetAtlasWidth() || AtlasRenderTarget->SizeY != Layout.GetAtlasHeight())
+	{
+		if (AtlasRenderTarget)
+		{
+			AtlasRenderTarget->ReleaseResource();
+		}
+		AtlasRenderTarget = UKismetRenderingLibrary::CreateRenderTarget2D(this, Layout.GetAtlasWidth(), Layout.GetAtlasHeight(), RTF_RGBA8);
+	}
+	FTextureRenderTargetResource* AtlasResource = AtlasRenderTarget ? AtlasRenderTarget->GameThread_GetRenderTargetResource() : nullptr;
+	if (!AtlasResource)
+	{
+		UE_LOG(LogCameraDataManager, Error, TEXT("Failed to create the %dx%d atlas render target."), Layout.GetAtlasWidth(), Layout.GetAtlasHeight());
+		return;
+	}
+
+	// Render every camera and copy it into its tile. Captures and copies are queued in order on the
+	// render thread, so nothing waits on the GPU until the single readback below.
+	for (int32 TileIndex = 0; TileIndex < AtlasCameras.Num(); ++TileIndex)
+	{
+		USceneCaptureComponent2D* SceneCaptureComp = AtlasCameras[TileIndex].SceneCaptureComp;
+		SceneCaptureComp->CaptureSource = ESceneCaptureSource::SCS_FinalColorLDR;
+		SceneCaptureComp->CaptureScene();
+
+		FTextureRenderTargetResource* TileResource = SceneCaptureComp->TextureTarget->GameThread_GetRenderTargetResource();
+		const FIntPoint TileOrigin = Layout.GetTileRect(TileIndex).Min;
+		ENQUEUE_RENDER_COMMAND(CopyCaptureToAtlas)(
+			[TileResource, AtlasResource, TileOrigin, TileSize](FRHICommandListImmediate& RHICmdList)
+			{
+				FRHITexture* SourceTexture = TileResource->GetRenderTargetTexture();
+				FRHITexture* DestTexture = AtlasResource->GetRenderTargetTexture();
+
+				FRHICopyTextureInfo CopyInfo;
+				CopyInfo.Size = FIntVector(TileSize.X, TileSize.Y, 1);
+				CopyInfo.DestPosition = FIntVector(TileOrigin.X, TileOrigin.Y, 0);
+
+				RHICmdList.Transition({
+					FRHITransitionInfo(SourceTexture, ERHIAccess::Unknown, ERHIAccess::CopySrc),
+					FRHITransitionInfo(DestTexture, ERHIAccess::Unknown, ERHIAccess::CopyDest) });
+				RHICmdList.CopyTexture(SourceTexture, DestTexture, CopyInfo);
+				RHICmdList.Transition({
+					FRHITransitionInfo(SourceTexture, ERHIAccess::CopySrc, ERHIAccess::SRVMask),
+					FRHITransitionInfo(DestTexture, ERHIAccess::CopyDest, ERHIAccess::SRVMask) });
+			});
+	}
+
+	// One readback for the whole rig
+	TArray<FColor> AtlasPixels;
+	if (!AtlasResource->ReadPixels(AtlasPixels))
+	{
+		UE_LOG(LogCameraDataManager, Error, TEXT("Failed to read back the camera atlas."));
+		return;
+	}
+	const double ReadbackTime = FPlatformTime::Seconds();
+
+	TArray<TArray<FColor>> TilePixels;
+	if (!Layout.SplitAtlas(AtlasPixels, TilePixels))
+	{
+		UE_LOG(LogCameraDataManager, Error, TEXT("Atlas readback size does not match the %dx%d atlas layout."), Layout.GetAtlasWidth(), Layout.GetAtlasHeight());
+		return;
+	}
+
+	// Hand the tiles to a live consumer and the video encoders before spending time on encoding
+	if (ULiveFrameStreamSubsystem* LiveStream = GetWorld()->GetSubsystem<ULiveFrameStreamSubsystem>())
+	{
+		for (int32 TileIndex = 0; LiveStream->IsEnabled() && TileIndex < AtlasCameras.Num(); ++TileIndex)
+		{
+			LiveStream->PublishCameraFrame(*AtlasCameras[TileIndex].Camera, TilePixels[TileIndex].GetData(), Layout.TileWidth, Layout.TileHeight);
+		}
+	}
+	if (UCameraVideoOutputSubsystem* VideoOutput = GetWorld()->GetSubsystem<UCameraVideoOutputSubsystem>())
+	{
+		for (int32 TileIndex = 0; VideoOutput->IsEnabled() && TileIndex < AtlasCameras.Num(); ++TileIndex)
+		{
+			VideoOutput->SubmitCameraFrame(*AtlasCameras[TileIndex].Camera, TilePixels[TileIndex].GetData(), Layout.TileWidth, Layout.TileHeight);
+		}
+	}
+
+	// Subject crops are cut from the tiles before the full frames are encoded (or instead of them)
+	USubjectCropSubsystem* SubjectCrops = GetWorld()->GetSubsystem<USubjectCropSubsystem>();
+	if (SubjectCrops && SubjectCrops->IsEnabled())
+	{
+		TArray<FSubjectCropFrame> CropFrames;
+		for (int32 TileIndex = 0; TileIndex < AtlasCameras.Num(); ++TileIndex)
+		{
+			CropFrames.Add({ AtlasCameras[TileIndex].Camera, TilePixels[TileIndex].GetData(), Layout.TileWidth, Layout.TileHeight });
+		}
+		ExportSubjectCrops(*SubjectCrops, CropFrames);
+	}
+
+	if (bSaveFullFrames)
+	{
+		TArray<FCapturedFrame> Frames;
+		for (int32 TileIndex = 0; TileIndex < AtlasCameras.Num(); ++TileIndex)
+		{
+			Frames.Add({ AtlasCameras[TileIndex].Camera, MoveTemp(TilePixels[TileIndex]), Layout.TileWidth, Layout.TileHeight });
+		}
+		SaveFrames(Frames);
+	}
+
+	// Camera matrices per camera, plus an atlas manifest with tile rects and atlas-space intrinsics
+	TArray<TSharedPtr<FJsonValue>> TileArray;
+	for (int32 TileIndex = 0; TileIndex < AtlasCameras.Num(); ++TileIndex)
+	{
+		const FRegisteredCamera& Camera = *AtlasCameras[TileIndex].Camera;
+		SaveCalibration(Camera);
+
+		const FIntRect Rect = Layout.GetTileRect(TileIndex);
+		const FCameraIntrinsics AtlasIntrinsics = Layout.GetAtlasIntrinsics(Camera.Intrinsics, TileIndex);
+
+		TSharedPtr<FJsonObject> TileObj = MakeShareable(new FJsonObject());
+		TileObj->SetStringField(TEXT("CameraName"), Camera.Name);
+		TileObj->SetNumberField(TEXT("X"), Rect.Min.X);
+		TileObj->SetNumberField(TEXT("Y"), Rect.Min.Y);
+		TileObj->SetNumberField(TEXT("fx"), AtlasIntrinsics.FocalLengthX);
+		TileObj->SetNumberField(TEXT("fy"), AtlasIntrinsics.FocalLengthY);
+		TileObj->SetNumberField(TEXT("cx"), AtlasIntrinsics.PrincipalPointX);
+		TileObj->SetNumberField(TEXT("cy"), AtlasIntrinsics.PrincipalPointY);
+		TileArray.Add(MakeShareable(new FJsonValueObject(TileObj)));
+	}
+
+	TSharedPtr<FJsonObject> RootObject = MakeShareable(new FJsonObject());
+	RootObject->SetNumberField(TEXT("AtlasWidth"), Layout.GetAtlasWidth());
+	RootObject->SetNumberField(TEXT("AtlasHeight"), Layout.GetAtlasHeight());
+	RootObject->SetNumberField(TEXT("TileWidth"), Layout.TileWidth);
+	RootObject->SetNumberField(TEXT("TileHeight"), Layout.TileHeight);
+	RootObject->SetArrayField(TEXT("Tiles"), TileArray);
+
+	FString OutputString;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&OutputString);
+	FJsonSerializer::Serialize(RootObject.ToSharedRef(), Writer);
+	SaveManifest(TEXT("Atlas.json"), OutputString);
+
+	UE_LOG(LogCameraDataManager, Log, TEXT("ACameraDataManager: Finished atlas extraction of %d cameras (%dx%d atlas) in %.2f ms, readback %.2f ms."),
+		AtlasCameras.Num(), Layout.GetAtlasWidth(), Layout.GetAtlasHeight(),
+		(FPlatformTime::Seconds() - StartTime) * 1000.0, (ReadbackTime - StartTime) * 1000.0);
+}
+
+FImageEncoderPool& ACameraDataManager::GetEncoderPool()
+{
+	if (!EncoderPool)
+	{
+		EncoderPool = MakeUnique<FImageEncoderPool>();
+	}
+	return *EncoderPool;
+}
+
+void ACameraDataManager::SaveCalibration(const FRegisteredCamera& Camera)
+{
+	UCaptureOutputSubsystem* CaptureOutput = GetWorld()->GetSubsystem<UCaptureOutputSubsystem>();
+	const FString FileName = Camera.Name + TEXT("_Matrices.txt");
+
+	// Camera matrices are only rewritten when the registry saw the calibration change
+	const bool bChanged = SaveCalibrationIfChanged(Camera);
+	if (bWriteToContainer)
+	{
+		// A record per change; a frame's calibration is the latest record at or before it
+		if (bChanged && CaptureOutput)
+		{
+			CaptureOutput->WriteTextRecord(UCaptureOutputSubsystem::MakeRecordName(GetCameraOutputDirectory(Camera, TEXT("CameraData")) + FileName), Camera.Component->FormatCameraData(Camera.Extrinsics, Camera.Intrinsics, Camera.Name),
+				ECaptureIndexKind::Calibration, FString(), Camera.Name);
+		}
+		return;
+	}
+
+	if (bChanged)
+	{
+		Camera.Component->SaveCameraDataToFile(FileName, Camera.Extrinsics, Camera.Intrinsics, Camera.Name);
+	}
+	if (CaptureOutput)
+	{
+		CaptureOutput->IndexFile(ECaptureIndexKind::Calibration, FString(), Camera.Name, GetCameraOutputDirectory(Camera, TEXT("CameraData")) + FileName);
+	}
+}
+
+void ACameraDataManager::SaveFrames(TArray<FCapturedFrame>& Frames)
+{
+	UCaptureOutputSubsystem* CaptureOutput = GetWorld()->GetSubsystem<UCaptureOutputSubsystem>();
+	if (!bWriteToContainer)
+	{
+		// The pool takes the pixels and writes the frames while the next capture is rendered
+		for (FCapturedFrame& Frame : Frames)
+		{
+			const FString FrameBasePath = GetCameraOutputDirectory(*Frame.Camera, TEXT("CameraFrames")) + Frame.Camera->Name + TEXT("_Frame");
+			const FString FramePath = GetEncoderPool().EncodeToFile(MoveTemp(Frame.Pixels), Frame.Width, Frame.Height, FrameEncoding, FrameBasePath, true);
+			if (CaptureOutput)
+			{
+				CaptureOutput->IndexFile(ECaptureIndexKind::Image, FString(), Frame.Camera->Name, FramePath);
+			}
+		}
+		return;
+	}
+
+	if (!CaptureOutput)
+	{
+		return;
+	}
+
+	// Records are encoded here on worker threads, then appended on this thread; the container compresses its blocks on its own workers.
+	// Creating the pool also loads the image wrapper module the workers encode with.
+	GetEncoderPool();
+	TArray<TArray64<uint8>> EncodedFrames;
+	EncodedFrames.SetNum(Frames.Num());
+	ParallelFor(Frames.Num(), [&](int32 FrameIndex)
+	{
+		const FCapturedFrame& Frame = Frames[FrameIndex];
+		if (!FImageEncoderPool::Encode(Frame.Pixels.GetData(), Frame.Width, Frame.Height, FrameEncoding, EncodedFrames[FrameIndex], true))
+		{
+			UE_LOG(LogCameraDataManager, Error, TEXT("Failed to encode the frame of %s."), *Frame.Camera->Name);
+		}
+	});
+	for (int32 FrameIndex = 0; FrameIndex < Frames.Num(); ++FrameIndex)
+	{
+		const FString& CameraName = Frames[FrameIndex].Camera->Name;
+		if (EncodedFrames[FrameIndex].Num() > 0)
+		{
+			const FString RecordName = UCaptureOutputSubsystem::MakeRecordName(FString::Printf(TEXT("%s%s_Frame.%s"),
+				*GetCameraOutputDirectory(*Frames[FrameIndex].Camera, TEXT("CameraFrames")), *CameraName, FrameEncoding.GetExtension()));
+			CaptureOutput->WriteRecord(RecordName, TArray<uint8>(EncodedFrames[FrameIndex].GetData(), EncodedFrames[FrameIndex].Num()), ECaptureIndexKind::Image, FString(), CameraName);
+		}
+	}
+}
+
+void ACameraDataManager::ExportSubjectCrops(USubjectCropSubsystem& SubjectCrops, TArray<FSubjectCropFrame>& CropFrames)
+{
+	for (FSubjectCropFrame& CropFrame : CropFrames)
+	{
+		CropFrame.OutputDirectory = GetCameraOutputDirectory(*CropFrame.Camera, TEXT("SubjectCrops"));
+	}
+	// Container records are encoded by ExportCrops, which still needs the image wrapper module the pool loads
+	FSubjectCropOutput Output;
+	Output.Encoding = FrameEncoding;
+	Output.bWriteToContainer = bWriteToContainer;
+	Output.EncoderPool = &GetEncoderPool();
+	SubjectCrops.ExportCrops(CropFrames, Output);
+}
+
+void ACameraDataManager::SaveManifest(const FString& FileName, const FString& Content)
+{
+	FString& SavedContent = SavedManifests.FindOrAdd(FileName);
+	if (SavedContent == Content)
+	{
+		return;
+	}
+	SavedContent = Content;
+
+	if (bWriteToContainer)
+	{
+		if (UCaptureOutputSubsystem* CaptureOutput = GetWorld()->GetSubsystem<UCaptureOutputSubsystem>())
+		{
+			CaptureOutput->WriteTextRecord(TEXT("CameraFrames/") + FileName, Content, ECaptureIndexKind::Calibration, FString(), FString());
+		}
+		return;
+	}
+	FFileHelper::SaveStringToFile(Content, *(FPaths::ProjectSavedDir() + TEXT("CameraFrames/") + FileName));
+}
+
+FString ACameraDataManager::GetCameraOutputDirectory(const FRegisteredCamera& Camera, const TCHAR* Root)
+{
+	const UCameraDataComponent* Component = Camera.Component.Get();
+	return Component ? Component->GetOutputDirectory(Root) : FPaths::ProjectSavedDir() + Root + TEXT("/");
+}
+
+bool ACameraDataManager::SaveCalibrationIfChanged(const FRegisteredCamera& Camera)
+{
+	uint32& SavedVersion = SavedCalibrationVersions.FindOrAdd(Camera.Component);
+	if (SavedVersion == Camera.CalibrationVersion)
+	{
+		return false;
+	}
+	SavedVersion = Camera.CalibrationVersion;
+	return true;
+}
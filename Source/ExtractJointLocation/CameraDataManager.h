@@ -2,10 +2,15 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "ImageEncoderPool.h"
 #include "CameraDataManager.generated.h" // THIS MUST BE THE LAST INCLUDE
 
 // Forward declare your CameraDataComponent
 class UCameraDataComponent;
+class UTextureRenderTarget2D;
+class USubjectCropSubsystem;
+struct FRegisteredCamera;
+struct FSubjectCropFrame;
 
 UCLASS()
 class EXTRACTJOINTLOCATION_API ACameraDataManager : public AActor
@@ -20,6 +25,9 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	// Waits for frames still being encoded, logs the encoders' throughput and finishes the camera videos
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 public:
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
@@ -31,11 +39,84 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Camera Data Manager")
 	void ExtractAndSaveAllCameraData();
 
+	/**
+	 * Atlas variant of ExtractAndSaveAllCameraData: every camera's capture is copied into a tile of one
+	 * shared render target, which is read back once and split into per-camera images on worker threads.
+	 * All cameras must share the same render target resolution; mismatching cameras are skipped.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Camera Data Manager")
+	void ExtractAndSaveAllCameraDataAtlas();
+
 protected:
 	/** Optional: Delay before saving to ensure all actors are fully initialized. */
 	UPROPERTY(EditAnywhere, Category = "Camera Data Manager")
 	float DataExtractionDelay = 0.5f; // Small delay in seconds
 
+	/** If true, ExtractAndSaveAllCameraData renders all cameras into one atlas and reads it back once. */
+	UPROPERTY(EditAnywhere, Category = "Camera Data Manager")
+	bool bUseAtlasCapture = false;
+
+	/**
+	 * If true, frames, subject crops, camera matrices and the atlas manifest are written as records of the run's chunked container
+	 * (Saved/Capture/*.ejlc, see UCaptureOutputSubsystem) instead of files under Saved/CameraFrames, Saved/SubjectCrops and Saved/CameraData.
+	 */
+	UPROPERTY(EditAnywhere, Category = "Camera Data Manager")
+	bool bWriteToContainer = false;
+
+	/** If false, only subject crops (see USubjectCropSubsystem) are written instead of every camera's full frame. */
+	UPROPERTY(EditAnywhere, Category = "Camera Data Manager")
+	bool bSaveFullFrames = true;
+
+	/** Codec of the full frames and subject crops. QOI, RawLz4 or PNG level 2 encode several times faster than the default PNG level (level 1 writes uncompressed PNGs); compare them with -run=ImageEncoderBenchmark. */
+	UPROPERTY(EditAnywhere, Category = "Camera Data Manager")
+	FCaptureImageEncoding FrameEncoding;
+
+	/** Largest atlas dimension (pixels) on either axis. */
+	UPROPERTY(EditAnywhere, Category = "Camera Data Manager", meta = (EditCondition = "bUseAtlasCapture"))
+	int32 MaxAtlasSize = 16384;
+
 private:
+	// One camera's read back frame
+	struct FCapturedFrame
+	{
+		const FRegisteredCamera* Camera = nullptr;
+		TArray<FColor> Pixels;
+		int32 Width = 0;
+		int32 Height = 0;
+	};
+
+	// True if the camera's calibration changed since its matrices were last saved by this manager
+	bool SaveCalibrationIfChanged(const FRegisteredCamera& Camera);
+
+	// Saves the camera's matrices if they changed, to the container or CameraData/, and indexes them
+	void SaveCalibration(const FRegisteredCamera& Camera);
+
+	// Saves the frames to the container or hands them to the encoder pool, and indexes them
+	void SaveFrames(TArray<FCapturedFrame>& Frames);
+
+	// Cuts the subject crops out of the frames and writes them like the full frames, to the container or each camera's SubjectCrops/
+	void ExportSubjectCrops(USubjectCropSubsystem& SubjectCrops, TArray<FSubjectCropFrame>& CropFrames);
+
+	// Saves a manifest to the container or CameraFrames/, unless it is unchanged since it was last saved
+	void SaveManifest(const FString& FileName, const FString& Content);
+
+	// The camera component's output directory (see UCameraDataComponent::OutputSubdirectory), Saved/<Root>/ if it is gone
+	static FString GetCameraOutputDirectory(const FRegisteredCamera& Camera, const TCHAR* Root);
+
+	FImageEncoderPool& GetEncoderPool();
+
 	FTimerHandle ExtractionTimerHandle;
+
+	// Encodes and writes full frames and subject crops on worker threads, created with the first frame
+	TUniquePtr<FImageEncoderPool> EncoderPool;
+
+	// Calibration version (see FRegisteredCamera::CalibrationVersion) of every camera's saved matrices
+	TMap<TWeakObjectPtr<UCameraDataComponent>, uint32> SavedCalibrationVersions;
+
+	// Content of every manifest as last saved, by file name
+	TMap<FString, FString> SavedManifests;
+
+	// Shared render target the cameras are tiled into when bUseAtlasCapture is set
+	UPROPERTY()
+	UTextureRenderTarget2D* AtlasRenderTarget;
 };
\ No newline at end of file
@@ -0,0 +1,268 @@
+#include "CameraRegistrySubsystem.h"
+#include "CineCameraActor.h"
+#include "CineCameraComponent.h"
+#include "Components/SceneCaptureComponent2D.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogCameraRegistry, Log, All);
+
+UTextureRenderTarget2D* FRegisteredCamera::GetRenderTarget() const
+{
+	if (const UCameraDataComponent* CameraData = Component.Get())
+	{
+		if (CameraData->TargetRenderTarget)
+		{
+			return CameraData->TargetRenderTarget;
+		}
+	}
+	const USceneCaptureComponent2D* CaptureComp = SceneCapture.Get();
+	return CaptureComp ? CaptureComp->TextureTarget : nullptr;
+}
+
+UCameraRegistrySubsystem::UCameraRegistrySubsystem()
+{
+	// Keeps the per-camera calibration files on disk in sync with the rig, like the export on BeginPlay did
+	bAutoExportCalibration = true;
+}
+
+void UCameraRegistrySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UCameraRegistrySubsystem::OnWorldPostActorTick);
+}
+
+void UCameraRegistrySubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+	for (FRegisteredCamera& Camera : Cameras)
+	{
+		if (USceneComponent* Root = Camera.Root.Get())
+		{
+			Root->TransformUpdated.Remove(Camera.TransformUpdatedHandle);
+		}
+	}
+	Cameras.Reset();
+	CamerasByComponent.Reset();
+	CamerasByRoot.Reset();
+	Super::Deinitialize();
+}
+
+void UCameraRegistrySubsystem::RegisterCamera(UCameraDataComponent* CameraData)
+{
+	AActor* Owner = CameraData ? CameraData->GetOwner() : nullptr;
+	if (!Owner || CamerasByComponent.Contains(CameraData))
+	{
+		return;
+	}
+
+	FRegisteredCamera& Camera = Cameras.AddDefaulted_GetRef();
+	Camera.Component = CameraData;
+#if WITH_EDITOR
+	Camera.Name = Owner->GetActorLabel();
+#endif
+	if (Camera.Name.IsEmpty())
+	{
+		Camera.Name = Owner->GetName();
+	}
+	Camera.SceneCapture = Owner->FindComponentByClass<USceneCaptureComponent2D>();
+	Camera.Root = Owner->GetRootComponent();
+	if (USceneComponent* Root = Camera.Root.Get())
+	{
+		Camera.TransformUpdatedHandle = Root->TransformUpdated.AddUObject(this, &UCameraRegistrySubsystem::OnCameraTransformUpdated);
+		CamerasByRoot.Add(Root, Cameras.Num() - 1);
+	}
+	CamerasByComponent.Add(CameraData, Cameras.Num() - 1);
+	++Revision;
+}
+
+void UCameraRegistrySubsystem::UnregisterCamera(UCameraDataComponent* CameraData)
+{
+	int32 CameraIndex = INDEX_NONE;
+	if (!CamerasByComponent.RemoveAndCopyValue(CameraData, CameraIndex))
+	{
+		return;
+	}
+
+	FRegisteredCamera& Camera = Cameras[CameraIndex];
+	if (USceneComponent* Root = Camera.Root.Get())
+	{
+		Root->TransformUpdated.Remove(Camera.TransformUpdatedHandle);
+		CamerasByRoot.Remove(Root);
+	}
+
+	// Swap the last camera into the slot and repoint its lookups. A camera whose component was destroyed without
+	// unregistering is dropped along with its stale lookups instead of being mapped from a null component.
+	Cameras.RemoveAtSwap(CameraIndex);
+	while (Cameras.IsValidIndex(CameraIndex))
+	{
+		const int32 PreviousIndex = Cameras.Num();
+		FRegisteredCamera& Moved = Cameras[CameraIndex];
+		if (const UCameraDataComponent* MovedComponent = Moved.Component.Get())
+		{
+			CamerasByComponent.Add(MovedComponent, CameraIndex);
+			if (const USceneComponent* MovedRoot = Moved.Root.Get())
+			{
+				CamerasByRoot.Add(MovedRoot, CameraIndex);
+			}
+			break;
+		}
+
+		if (USceneComponent* MovedRoot = Moved.Root.Get())
+		{
+			MovedRoot->TransformUpdated.Remove(Moved.TransformUpdatedHandle);
+		}
+		for (auto It = CamerasByComponent.CreateIterator(); It; ++It)
+		{
+			if (It.Value() == PreviousIndex)
+			{
+				It.RemoveCurrent();
+			}
+		}
+		for (auto It = CamerasByRoot.CreateIterator(); It; ++It)
+		{
+			if (It.Value() == PreviousIndex)
+			{
+				It.RemoveCurrent();
+			}
+		}
+		Cameras.RemoveAtSwap(CameraIndex);
+	}
+	++Revision;
+}
+
+void UCameraRegistrySubsystem::MarkCameraDirty(UCameraDataComponent* CameraData)
+{
+	if (const int32* CameraIndex = CamerasByComponent.Find(CameraData))
+	{
+		Cameras[*CameraIndex].bTransformDirty = true;
+		Cameras[*CameraIndex].bExportPending = true;
+	}
+}
+
+const FRegisteredCamera* UCameraRegistrySubsystem::FindCamera(const UCameraDataComponent* CameraData) const
+{
+	const int32* CameraIndex = CamerasByComponent.Find(CameraData);
+	return CameraIndex ? &Cameras[*CameraIndex] : nullptr;
+}
+
+void UCameraRegistrySubsystem::OnCameraTransformUpdated(USceneComponent* Root, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	if (const int32* CameraIndex = CamerasByRoot.Find(Root))
+	{
+		Cameras[*CameraIndex].bTransformDirty = true;
+	}
+}
+
+void UCameraRegistrySubsystem::GetLensState(const FRegisteredCamera& Camera, FVector3f& OutLensState, FIntPoint& OutImageSize)
+{
+	OutLensState = FVector3f::ZeroVector;
+	const UTextureRenderTarget2D* RenderTarget = Camera.GetRenderTarget();
+	OutImageSize = RenderTarget ? FIntPoint(RenderTarget->SizeX, RenderTarget->SizeY) : FIntPoint::ZeroValue;
+
+	const UCameraDataComponent* CameraData = Camera.Component.Get();
+	const ACineCameraActor* CineCameraActor = CameraData ? Cast<ACineCameraActor>(CameraData->GetOwner()) : nullptr;
+	if (const UCineCameraComponent* CineCameraComp = CineCameraActor ? CineCameraActor->GetCineCameraComponent() : nullptr)
+	{
+		OutLensState = FVector3f(CineCameraComp->CurrentFocalLength, CineCameraComp->Filmback.SensorWidth, CineCameraComp->Filmback.SensorHeight);
+	}
+	else if (const USceneCaptureComponent2D* CaptureComp = Camera.SceneCapture.Get())
+	{
+		OutLensState = FVector3f(CaptureComp->FOVAngle, 0.0f, 0.0f);
+	}
+}
+
+int32 UCameraRegistrySubsystem::RefreshCalibration()
+{
+	int32 NumChanged = 0;
+	for (FRegisteredCamera& Camera : Cameras)
+	{
+		UCameraDataComponent* CameraData = Camera.Component.Get();
+		if (!CameraData)
+		{
+			continue;
+		}
+
+		FVector3f LensState;
+		FIntPoint ImageSize;
+		GetLensState(Camera, LensState, ImageSize);
+		const bool bLensChanged = Camera.CalibrationVersion == 0 || LensState != Camera.LensState || ImageSize != Camera.ImageSize;
+
+		bool bChanged = false;
+		if (bLensChanged)
+		{
+			Camera.LensState = LensState;
+			Camera.ImageSize = ImageSize;
+			FCameraIntrinsics Intrinsics = FCameraIntrinsics();
+			Camera.bHasIntrinsics = CameraData->GetCameraIntrinsics(Intrinsics, Camera.GetRenderTarget());
+			Camera.Intrinsics = Intrinsics;
+			bChanged = true;
+		}
+
+		// Transform updates without an actual change (e.g. re-attaching in place) keep the calibration
+		if (Camera.bTransformDirty)
+		{
+			Camera.bTransformDirty = false;
+			const FTransform Extrinsics = CameraData->GetCameraExtrinsics();
+			if (Camera.CalibrationVersion == 0 || !Extrinsics.Equals(Camera.Extrinsics, UE_KINDA_SMALL_NUMBER))
+			{
+				Camera.Extrinsics = Extrinsics;
+				bChanged = true;
+			}
+		}
+
+		if (bChanged)
+		{
+			++Camera.CalibrationVersion;
+			Camera.bExportPending = true;
+			++NumChanged;
+		}
+	}
+
+	if (NumChanged > 0)
+	{
+		++Revision;
+		UE_LOG(LogCameraRegistry, Verbose, TEXT("RefreshCalibration: %d of %d cameras changed."), NumChanged, Cameras.Num());
+	}
+	return NumChanged;
+}
+
+int32 UCameraRegistrySubsystem::ExportChangedCalibration()
+{
+	RefreshCalibration();
+
+	int32 NumExported = 0;
+	for (FRegisteredCamera& Camera : Cameras)
+	{
+		UCameraDataComponent* CameraData = Camera.Component.Get();
+		if (Camera.bExportPending && CameraData)
+		{
+			Camera.bExportPending = false;
+			NumExported += CameraData->ExportCalibration() ? 1 : 0;
+		}
+	}
+
+	if (NumExported > 0)
+	{
+		UE_LOG(LogCameraRegistry, Log, TEXT("ExportChangedCalibration: Exported %d of %d cameras."), NumExported, Cameras.Num());
+	}
+	return NumExported;
+}
+
+void UCameraRegistrySubsystem::OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	if (World != GetWorld())
+	{
+		return;
+	}
+
+	if (bAutoExportCalibration)
+	{
+		ExportChangedCalibration();
+	}
+	else
+	{
+		RefreshCalibration();
+	}
+}
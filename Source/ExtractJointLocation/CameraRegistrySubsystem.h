@@ -0,0 +1,104 @@
+// CameraRegistrySubsystem.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Components/SceneComponent.h"
+#include "CameraDataComponent.h"
+#include "CameraRegistrySubsystem.generated.h"
+
+class USceneCaptureComponent2D;
+
+// Calibration of one registered camera, recomputed only when its transform or lens changes
+struct FRegisteredCamera
+{
+	TWeakObjectPtr<UCameraDataComponent> Component;
+	// Actor label in the editor, actor name otherwise
+	FString Name;
+	// Capture component and render target of SceneCapture2D cameras, null for cine cameras
+	TWeakObjectPtr<USceneCaptureComponent2D> SceneCapture;
+	FTransform Extrinsics;
+	FCameraIntrinsics Intrinsics = FCameraIntrinsics();
+	bool bHasIntrinsics = false;
+	// Incremented every time Extrinsics or Intrinsics change
+	uint32 CalibrationVersion = 0;
+
+	UTextureRenderTarget2D* GetRenderTarget() const;
+
+private:
+	friend class UCameraRegistrySubsystem;
+
+	// Focal length or FOV, sensor size and image size the intrinsics were computed from
+	FVector3f LensState = FVector3f::ZeroVector;
+	FIntPoint ImageSize = FIntPoint::ZeroValue;
+	TWeakObjectPtr<USceneComponent> Root;
+	FDelegateHandle TransformUpdatedHandle;
+	bool bTransformDirty = true;
+	bool bExportPending = true;
+};
+
+/**
+ * Registry of the world's UCameraDataComponent cameras, so camera code does not search actors for them.
+ * Cameras register on BeginPlay and unregister on EndPlay. Transform changes are tracked through the cameras' root
+ * component and lens changes (focal length, filmback, FOV, render target size) are compared once per frame, so the
+ * calibration of a camera is only recomputed, and with bAutoExportCalibration only re-exported, when it changed.
+ */
+UCLASS(config = Game)
+class EXTRACTJOINTLOCATION_API UCameraRegistrySubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UCameraRegistrySubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	void RegisterCamera(UCameraDataComponent* Camera);
+	void UnregisterCamera(UCameraDataComponent* Camera);
+
+	/** Forces the camera's calibration to be recomputed and re-exported, e.g. after changing its export filename. */
+	UFUNCTION(BlueprintCallable, Category = "Camera Registry")
+	void MarkCameraDirty(UCameraDataComponent* Camera);
+
+	/**
+	 * Recomputes the calibration of the cameras whose transform or lens changed since the last call.
+	 * Cheap when nothing changed; call before reading GetCameras() mid-frame.
+	 * @return Number of cameras whose calibration changed.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Camera Registry")
+	int32 RefreshCalibration();
+
+	/**
+	 * Exports the calibration (UCameraDataComponent::ExportCalibration) of every camera that changed since its last export.
+	 * No frames are read back, see ACameraDataManager for those.
+	 * @return Number of cameras exported.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Camera Registry")
+	int32 ExportChangedCalibration();
+
+	const TArray<FRegisteredCamera>& GetCameras() const { return Cameras; }
+	const FRegisteredCamera* FindCamera(const UCameraDataComponent* Camera) const;
+
+	/** Incremented whenever a camera is added, removed or changes its calibration. */
+	uint32 GetRevision() const { return Revision; }
+
+	/**
+	 * Exports changed calibration (CameraData_<Name>.txt and the intrinsic/extrinsic JSON) at the end of every frame.
+	 * ACameraDataManager only saves the <Name>_Matrices.txt of the cameras it captures, so turn this off only when those are enough.
+	 */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Camera Registry")
+	bool bAutoExportCalibration;
+
+private:
+	void OnCameraTransformUpdated(USceneComponent* Root, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport);
+	void OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	// Current lens state of the camera, compared against the one its intrinsics were computed from
+	static void GetLensState(const FRegisteredCamera& Camera, FVector3f& OutLensState, FIntPoint& OutImageSize);
+
+	TArray<FRegisteredCamera> Cameras;
+	TMap<const UCameraDataComponent*, int32> CamerasByComponent;
+	TMap<const USceneComponent*, int32> CamerasByRoot;
+	uint32 Revision = 0;
+	FDelegateHandle PostActorTickHandle;
+};
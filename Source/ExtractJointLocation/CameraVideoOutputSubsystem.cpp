@@ -0,0 +1,183 @@
+#include "CameraVideoOutputSubsystem.h"
+#include "CameraRegistrySubsystem.h"
+#include "CaptureOutputSubsystem.h"
+#include "Engine/World.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "HAL/PlatformFileManager.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogCameraVideoOutput, Log, All);
+
+UCameraVideoOutputSubsystem::UCameraVideoOutputSubsystem()
+{
+	// Visually lossless H.264 that plays everywhere; 4 queued 1080p frames are ~33 MB per camera
+	bEnableVideoOutput = false;
+	EncoderExecutable = TEXT("ffmpeg");
+	EncoderArguments = TEXT("-hide_banner -loglevel warning -y -f rawvideo -pix_fmt bgra -s {Width}x{Height} -r {FrameRate} -i - ")
+		TEXT("-c:v libx264 -preset veryfast -crf 18 -pix_fmt yuv420p \"{Output}\"");
+	OutputExtension = TEXT("mp4");
+	FrameRate = 30.0f;
+	bPaceFrames = true;
+	MaxPacingGap = 1.0f;
+	MaxQueuedFrames = 4;
+	MaxQueueWait = 0.5f;
+	ShutdownTimeout = 10.0f;
+}
+
+void UCameraVideoOutputSubsystem::Deinitialize()
+{
+	CloseStreams();
+	Super::Deinitialize();
+}
+
+bool UCameraVideoOutputSubsystem::SubmitCameraFrame(const FRegisteredCamera& Camera, const FColor* Pixels, int32 Width, int32 Height)
+{
+	if (!bEnableVideoOutput || !Pixels || Width <= 0 || Height <= 0)
+	{
+		return false;
+	}
+
+	FStream* Stream = Streams.FindByPredicate([&Camera](const FStream& Candidate) { return Candidate.CameraName == Camera.Name; });
+	if (!Stream)
+	{
+		Stream = &Streams.AddDefaulted_GetRef();
+		Stream->CameraName = Camera.Name;
+		Stream->Pacer.FrameRate = FrameRate;
+		Stream->Pacer.MaxGap = MaxPacingGap;
+		// A camera whose encoder fails to start is not retried every frame
+		Stream->bFailed = !OpenStream(*Stream, Width, Height);
+	}
+	if (Stream->bFailed)
+	{
+		return false;
+	}
+
+	const FVideoEncoderPipeSettings& Settings = Stream->Pipe->GetSettings();
+	if (Width != Settings.Width || Height != Settings.Height)
+	{
+		UE_LOG(LogCameraVideoOutput, Warning, TEXT("%s: %dx%d frame skipped, the video is %dx%d."), *Camera.Name, Width, Height, Settings.Width, Settings.Height);
+		++Stream->NumSkippedFrames;
+		return false;
+	}
+
+	int32 NumRepeats = 0;
+	if (bPaceFrames)
+	{
+		NumRepeats = Stream->Pacer.Advance(GetWorld()->GetTimeSeconds());
+		if (NumRepeats == INDEX_NONE)
+		{
+			++Stream->NumSkippedFrames;
+			return false;
+		}
+	}
+
+	// Nothing to repeat before the first frame
+	const int32 NumPreviousRepeats = Stream->NumVideoFrames > 0 ? NumRepeats + Stream->NumCarriedRepeats : 0;
+	if (!Stream->Pipe->WriteFrame(Pixels, NumPreviousRepeats))
+	{
+		Stream->NumCarriedRepeats = bPaceFrames && Stream->NumVideoFrames > 0 ? NumPreviousRepeats + 1 : 0;
+		return false;
+	}
+	Stream->NumCarriedRepeats = 0;
+	Stream->NumVideoFrames += NumPreviousRepeats + 1;
+
+	const UCaptureOutputSubsystem* CaptureOutput = GetWorld()->GetSubsystem<UCaptureOutputSubsystem>();
+	const int32 CaptureFrameIndex = CaptureOutput ? CaptureOutput->GetCaptureFrameIndex() : static_cast<int32>(GFrameCounter);
+	Stream->FrameMap.Emplace(CaptureFrameIndex, Stream->NumVideoFrames - 1);
+	return true;
+}
+
+void UCameraVideoOutputSubsystem::CloseStreams()
+{
+	for (FStream& Stream : Streams)
+	{
+		CloseStream(Stream);
+	}
+	Streams.Reset();
+}
+
+bool UCameraVideoOutputSubsystem::OpenStream(FStream& Stream, int32 Width, int32 Height)
+{
+	const FString SaveDirectory = FPaths::ConvertRelativePathToFull(FPaths::ProjectSavedDir() + TEXT("CameraVideos/"));
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	if (!PlatformFile.DirectoryExists(*SaveDirectory))
+	{
+		PlatformFile.CreateDirectoryTree(*SaveDirectory);
+	}
+
+	// Later videos of a camera in the same world get a suffix instead of overwriting the first
+	int32& NumOpened = NumOpenedStreams.FindOrAdd(Stream.CameraName);
+	const FString BaseName = NumOpened > 0 ? FString::Printf(TEXT("%s_%d"), *Stream.CameraName, NumOpened) : Stream.CameraName;
+	++NumOpened;
+
+	// Absolute paths, as the encoder need not share the engine's working directory
+	FVideoEncoderPipeSettings Settings;
+	Settings.Executable = EncoderExecutable;
+	Settings.Arguments = EncoderArguments;
+	Settings.OutputPath = SaveDirectory + BaseName + TEXT(".") + OutputExtension;
+	Settings.LogPath = SaveDirectory + BaseName + TEXT("_Encoder.log");
+	Settings.Width = Width;
+	Settings.Height = Height;
+	Settings.FrameRate = FMath::Max(FrameRate, 1.0f);
+	Settings.MaxQueuedFrames = MaxQueuedFrames;
+	Settings.MaxQueueWait = MaxQueueWait;
+	Settings.ShutdownTimeout = ShutdownTimeout;
+
+	Stream.Pipe = MakeUnique<FVideoEncoderPipe>();
+	if (!Stream.Pipe->Start(Settings))
+	{
+		UE_LOG(LogCameraVideoOutput, Error, TEXT("Failed to start the video encoder of %s; its frames are not encoded."), *Stream.CameraName);
+		Stream.Pipe.Reset();
+		return false;
+	}
+	return true;
+}
+
+void UCameraVideoOutputSubsystem::CloseStream(FStream& Stream)
+{
+	if (!Stream.Pipe)
+	{
+		return;
+	}
+	const FVideoEncoderPipeSettings Settings = Stream.Pipe->GetSettings();
+	const int32 ExitCode = Stream.Pipe->Shutdown();
+
+	// Manifest mapping capture frames to video frames, next to the video
+	TArray<TSharedPtr<FJsonValue>> FrameArray;
+	for (const TPair<int32, int64>& Frame : Stream.FrameMap)
+	{
+		TSharedPtr<FJsonObject> FrameObj = MakeShareable(new FJsonObject());
+		FrameObj->SetNumberField(TEXT("Frame"), Frame.Key);
+		FrameObj->SetNumberField(TEXT("VideoFrame"), Frame.Value);
+		FrameArray.Add(MakeShareable(new FJsonValueObject(FrameObj)));
+	}
+
+	TSharedPtr<FJsonObject> RootObj = MakeShareable(new FJsonObject());
+	RootObj->SetStringField(TEXT("CameraName"), Stream.CameraName);
+	RootObj->SetStringField(TEXT("File"), FPaths::GetCleanFilename(Settings.OutputPath));
+	RootObj->SetNumberField(TEXT("ImageWidth"), Settings.Width);
+	RootObj->SetNumberField(TEXT("ImageHeight"), Settings.Height);
+	RootObj->SetNumberField(TEXT("FrameRate"), Settings.FrameRate);
+	RootObj->SetBoolField(TEXT("Paced"), bPaceFrames);
+	RootObj->SetNumberField(TEXT("VideoFrames"), static_cast<double>(Stream.Pipe->GetWrittenFrames()));
+	RootObj->SetNumberField(TEXT("DroppedFrames"), static_cast<double>(Stream.Pipe->GetDroppedFrames()));
+	RootObj->SetNumberField(TEXT("SkippedFrames"), Stream.NumSkippedFrames);
+	RootObj->SetNumberField(TEXT("EncoderExitCode"), ExitCode);
+	RootObj->SetArrayField(TEXT("Frames"), FrameArray);
+
+	FString OutputString;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&OutputString);
+	FJsonSerializer::Serialize(RootObj.ToSharedRef(), Writer);
+	const FString ManifestPath = FPaths::GetPath(Settings.OutputPath) / FPaths::GetBaseFilename(Settings.OutputPath) + TEXT("_Video.json");
+	if (!FFileHelper::SaveStringToFile(OutputString, *ManifestPath))
+	{
+		UE_LOG(LogCameraVideoOutput, Warning, TEXT("CloseStream: Failed to write %s"), *ManifestPath);
+	}
+
+	UE_LOG(LogCameraVideoOutput, Log, TEXT("%s: %llu video frames from %d captures, %llu dropped, %d skipped."), *Settings.OutputPath,
+		Stream.Pipe->GetWrittenFrames(), Stream.FrameMap.Num(), Stream.Pipe->GetDroppedFrames(), Stream.NumSkippedFrames);
+	Stream.Pipe.Reset();
+}
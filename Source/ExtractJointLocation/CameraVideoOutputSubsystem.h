@@ -0,0 +1,102 @@
+// CameraVideoOutputSubsystem.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "VideoEncoderPipe.h"
+#include "CameraVideoOutputSubsystem.generated.h"
+
+struct FRegisteredCamera;
+
+/**
+ * Writes one video per camera by piping every captured frame as raw BGRA into its own encoder process (ffmpeg by
+ * default, see FVideoEncoderPipe), instead of writing per-frame images that are stitched into videos afterwards.
+ * Frames are placed on a FrameRate timeline by world time (FVideoFramePacer). Videos go to
+ * Saved/CameraVideos/<Camera>.<OutputExtension> with the encoder's log next to them, and <Camera>_Video.json maps
+ * every capture frame (UCaptureOutputSubsystem::GetCaptureFrameIndex) to its video frame. Streams are finished by
+ * CloseStreams, which ACameraDataManager calls on EndPlay, or at the latest when the world is torn down.
+ */
+UCLASS(config = Game)
+class EXTRACTJOINTLOCATION_API UCameraVideoOutputSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UCameraVideoOutputSubsystem();
+
+	virtual void Deinitialize() override;
+
+	/** True if frames are encoded, i.e. callers should read back pixels for SubmitCameraFrame. */
+	bool IsEnabled() const { return bEnableVideoOutput; }
+
+	/**
+	 * Queues one camera frame for the camera's video, starting its encoder on first use.
+	 * @param Pixels Width x Height BGRA pixels, tightly packed.
+	 * @return False if the output is disabled or the frame was skipped or dropped.
+	 */
+	bool SubmitCameraFrame(const FRegisteredCamera& Camera, const FColor* Pixels, int32 Width, int32 Height);
+
+	/** Finishes every camera's video and waits for the encoders to exit. Frames submitted afterwards start new videos. */
+	UFUNCTION(BlueprintCallable, Category = "Video Output")
+	void CloseStreams();
+
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Video Output")
+	bool bEnableVideoOutput;
+
+	/** Encoder program, looked up on PATH unless it is a path. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Video Output")
+	FString EncoderExecutable;
+
+	/** Encoder arguments; {Width}, {Height}, {FrameRate} and {Output} are replaced, the frames arrive on stdin as BGRA. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Video Output")
+	FString EncoderArguments;
+
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Video Output")
+	FString OutputExtension;
+
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Video Output", meta = (ClampMin = "1"))
+	float FrameRate;
+
+	/** If true, captures are placed by world time; if false, every submitted frame is one video frame. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Video Output")
+	bool bPaceFrames;
+
+	/** Longest capture gap (s) filled by holding the last frame; longer gaps are treated as a pause and cut. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Video Output", meta = (EditCondition = "bPaceFrames"))
+	float MaxPacingGap;
+
+	/** Frames per camera waiting for its encoder. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Video Output", meta = (ClampMin = "1"))
+	int32 MaxQueuedFrames;
+
+	/** Longest wait (s) of the capture for a full encoder queue; the frame is dropped after it. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Video Output")
+	float MaxQueueWait;
+
+	/** Time (s) an encoder gets to finish its video when the streams are closed, before it is terminated. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Video Output")
+	float ShutdownTimeout;
+
+private:
+	struct FStream
+	{
+		FString CameraName;
+		TUniquePtr<FVideoEncoderPipe> Pipe;
+		FVideoFramePacer Pacer;
+		// Video frame of every submitted capture frame, written to the stream's manifest
+		TArray<TPair<int32, int64>> FrameMap;
+		// Video frames queued so far, repeats included
+		int64 NumVideoFrames = 0;
+		// Video frames of dropped captures, held by the next frame so later frames stay on the timeline
+		int32 NumCarriedRepeats = 0;
+		int32 NumSkippedFrames = 0;
+		bool bFailed = false;
+	};
+
+	bool OpenStream(FStream& Stream, int32 Width, int32 Height);
+	void CloseStream(FStream& Stream);
+
+	TArray<FStream> Streams;
+	// Videos started per camera name in this world, to name later ones <Camera>_<N>
+	TMap<FString, int32> NumOpenedStreams;
+};
@@ -0,0 +1,87 @@
+#include "CaptureAtlas.h"
+#include "Async/ParallelFor.h"
+
+FCaptureAtlasLayout FCaptureAtlasLayout::Make(int32 InNumTiles, int32 InTileWidth, int32 InTileHeight, int32 MaxAtlasSize)
+{
+	FCaptureAtlasLayout Layout;
+	if (InNumTiles <= 0 || InTileWidth <= 0 || InTileHeight <= 0)
+	{
+		return Layout;
+	}
+
+	const int32 MaxColumns = MaxAtlasSize / InTileWidth;
+	const int32 MaxRows = MaxAtlasSize / InTileHeight;
+	if (MaxColumns <= 0 || MaxRows <= 0 || MaxColumns * MaxRows < InNumTiles)
+	{
+		return Layout;
+	}
+
+	// Start from a square grid in pixels and widen/heighten until it fits within the limits
+	const float AspectRatio = static_cast<float>(InTileHeight) / InTileWidth;
+	int32 Columns = FMath::Clamp(FMath::CeilToInt(FMath::Sqrt(InNumTiles * AspectRatio)), 1, MaxColumns);
+	int32 Rows = FMath::DivideAndRoundUp(InNumTiles, Columns);
+	while (Rows > MaxRows && Columns < MaxColumns)
+	{
+		++Columns;
+		Rows = FMath::DivideAndRoundUp(InNumTiles, Columns);
+	}
+
+	Layout.NumTiles = InNumTiles;
+	Layout.TileWidth = InTileWidth;
+	Layout.TileHeight = InTileHeight;
+	Layout.Columns = Columns;
+	Layout.Rows = Rows;
+	return Layout;
+}
+
+FIntRect FCaptureAtlasLayout::GetTileRect(int32 TileIndex) const
+{
+	const FIntPoint Min((TileIndex % Columns) * TileWidth, (TileIndex / Columns) * TileHeight);
+	return FIntRect(Min, Min + FIntPoint(TileWidth, TileHeight));
+}
+
+bool FCaptureAtlasLayout::SplitAtlas(const TArray<FColor>& AtlasPixels, TArray<TArray<FColor>>& OutTiles, bool bForceOpaque) const
+{
+	if (!IsValid() || AtlasPixels.Num() != GetAtlasWidth() * GetAtlasHeight())
+	{
+		return false;
+	}
+
+	OutTiles.SetNum(NumTiles);
+	const int32 AtlasWidth = GetAtlasWidth();
+
+	ParallelFor(NumTiles, [&](int32 TileIndex)
+	{
+		const FIntRect Rect = GetTileRect(TileIndex);
+		TArray<FColor>& Tile = OutTiles[TileIndex];
+		Tile.SetNumUninitialized(TileWidth * TileHeight);
+
+		for (int32 Y = 0; Y < TileHeight; ++Y)
+		{
+			const FColor* Src = AtlasPixels.GetData() + (Rect.Min.Y + Y) * AtlasWidth + Rect.Min.X;
+			FMemory::Memcpy(Tile.GetData() + Y * TileWidth, Src, TileWidth * sizeof(FColor));
+		}
+
+		if (bForceOpaque)
+		{
+			for (FColor& Pixel : Tile)
+			{
+				Pixel.A = 255;
+			}
+		}
+	});
+
+	return true;
+}
+
+FCameraIntrinsics FCaptureAtlasLayout::GetAtlasIntrinsics(const FCameraIntrinsics& TileIntrinsics, int32 TileIndex) const
+{
+	const FIntRect Rect = GetTileRect(TileIndex);
+
+	FCameraIntrinsics AtlasIntrinsics = TileIntrinsics;
+	AtlasIntrinsics.PrincipalPointX += Rect.Min.X;
+	AtlasIntrinsics.PrincipalPointY += Rect.Min.Y;
+	AtlasIntrinsics.ImageWidth = GetAtlasWidth();
+	AtlasIntrinsics.ImageHeight = GetAtlasHeight();
+	return AtlasIntrinsics;
+}
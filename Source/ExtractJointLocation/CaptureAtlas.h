@@ -0,0 +1,47 @@
+// CaptureAtlas.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CameraDataComponent.h"
+
+/**
+ * Grid layout of equally sized camera tiles inside one atlas render target.
+ * Pure CPU logic so tiling and splitting can be exercised with synthetic buffers (no GPU needed).
+ */
+struct EXTRACTJOINTLOCATION_API FCaptureAtlasLayout
+{
+	int32 NumTiles = 0;
+	int32 TileWidth = 0;
+	int32 TileHeight = 0;
+	int32 Columns = 0;
+	int32 Rows = 0;
+
+	/**
+	 * Builds the most square grid that fits NumTiles tiles without exceeding MaxAtlasSize on either axis.
+	 * @return An invalid layout (IsValid() == false) if the tiles cannot fit.
+	 */
+	static FCaptureAtlasLayout Make(int32 InNumTiles, int32 InTileWidth, int32 InTileHeight, int32 MaxAtlasSize = 16384);
+
+	bool IsValid() const { return NumTiles > 0 && Columns > 0 && Rows > 0 && Columns * Rows >= NumTiles; }
+
+	int32 GetAtlasWidth() const { return Columns * TileWidth; }
+	int32 GetAtlasHeight() const { return Rows * TileHeight; }
+
+	/** Pixel rectangle of a tile inside the atlas (Min inclusive, Max exclusive). */
+	FIntRect GetTileRect(int32 TileIndex) const;
+
+	/**
+	 * Copies every tile out of a row-major atlas buffer into its own image, one tile per worker task.
+	 * @param AtlasPixels Atlas pixels, GetAtlasWidth() * GetAtlasHeight() entries.
+	 * @param OutTiles Resized to NumTiles images of TileWidth * TileHeight pixels.
+	 * @param bForceOpaque Scene captures leave inverse opacity in alpha; set to write A = 255 instead.
+	 * @return False if the atlas buffer does not match the layout.
+	 */
+	bool SplitAtlas(const TArray<FColor>& AtlasPixels, TArray<TArray<FColor>>& OutTiles, bool bForceOpaque = true) const;
+
+	/**
+	 * Intrinsics of a camera expressed in atlas pixel coordinates (principal point shifted by the tile origin).
+	 * The focal lengths are unchanged because each tile is rendered at the camera's native resolution.
+	 */
+	FCameraIntrinsics GetAtlasIntrinsics(const FCameraIntrinsics& TileIntrinsics, int32 TileIndex) const;
+};
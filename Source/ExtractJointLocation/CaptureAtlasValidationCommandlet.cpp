@@ -0,0 +1,187 @@
+#include "CaptureAtlasValidationCommandlet.h"
+#include "HAL/PlatformTime.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogCaptureAtlasValidation, Log, All);
+
+namespace CaptureAtlasValidation
+{
+	// Alpha a scene capture would leave behind, anything but opaque
+	static constexpr uint8 CaptureAlpha = 0;
+
+	// Pixel of a tile encoding its tile index and tile-local position; empty grid cells are left white
+	static FColor MakeTilePixel(int32 TileIndex, int32 X, int32 Y)
+	{
+		return FColor(static_cast<uint8>(X), static_cast<uint8>(Y), static_cast<uint8>(TileIndex), CaptureAlpha);
+	}
+
+	static FCameraIntrinsics MakeIntrinsics(int32 Width, int32 Height)
+	{
+		FCameraIntrinsics Intrinsics;
+		Intrinsics.FocalLengthX = Width;
+		Intrinsics.FocalLengthY = Width;
+		// Off centre, so a principal point that is not shifted by the tile origin cannot pass by accident
+		Intrinsics.PrincipalPointX = Width * 0.5f + 3.25f;
+		Intrinsics.PrincipalPointY = Height * 0.5f - 1.75f;
+		Intrinsics.ImageWidth = Width;
+		Intrinsics.ImageHeight = Height;
+		return Intrinsics;
+	}
+}
+
+UCaptureAtlasValidationCommandlet::UCaptureAtlasValidationCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UCaptureAtlasValidationCommandlet::Main(const FString& Params)
+{
+	const FCase Cases[] = {
+		{ TEXT("SingleTile"), 1, 64, 48, 16384, true },
+		{ TEXT("EmptyCells"), 7, 33, 17, 16384, true },
+		{ TEXT("PortraitTiles"), 10, 24, 80, 16384, true },
+		{ TEXT("NarrowLimit"), 12, 100, 50, 300, true },
+		{ TEXT("Rig64"), 64, 320, 180, 16384, true },
+		{ TEXT("Rig9FullHD"), 9, 1920, 1080, 16384, true },
+		{ TEXT("DoesNotFit"), 64, 1920, 1080, 8192, false },
+		{ TEXT("TileLargerThanAtlas"), 1, 20000, 10, 16384, false } };
+
+	const int32 NumCases = UE_ARRAY_COUNT(Cases) + 1;
+	int32 NumFailed = 0;
+	double SplitMilliseconds = 0.0;
+	for (const FCase& Case : Cases)
+	{
+		double CaseMilliseconds = 0.0;
+		if (!RunCase(Case, CaseMilliseconds))
+		{
+			++NumFailed;
+		}
+		SplitMilliseconds = FMath::Max(SplitMilliseconds, CaseMilliseconds);
+	}
+	if (!CheckRejectsMismatchedBuffer())
+	{
+		++NumFailed;
+	}
+
+	UE_LOG(LogCaptureAtlasValidation, Display, TEXT("%d of %d cases passed. The slowest split took %.2f ms."), NumCases - NumFailed, NumCases, SplitMilliseconds);
+	return NumFailed > 0 ? 1 : 0;
+}
+
+bool UCaptureAtlasValidationCommandlet::RunCase(const FCase& Case, double& OutSplitMilliseconds)
+{
+	using namespace CaptureAtlasValidation;
+	const FCaptureAtlasLayout Layout = FCaptureAtlasLayout::Make(Case.NumTiles, Case.TileWidth, Case.TileHeight, Case.MaxAtlasSize);
+	if (Layout.IsValid() != Case.bExpectLayout)
+	{
+		UE_LOG(LogCaptureAtlasValidation, Error, TEXT("%s: expected %s layout."), Case.Name, Case.bExpectLayout ? TEXT("a") : TEXT("no"));
+		return false;
+	}
+	if (!Layout.IsValid())
+	{
+		UE_LOG(LogCaptureAtlasValidation, Display, TEXT("%s: rejected, as expected."), Case.Name);
+		return true;
+	}
+	if (Layout.GetAtlasWidth() > Case.MaxAtlasSize || Layout.GetAtlasHeight() > Case.MaxAtlasSize)
+	{
+		UE_LOG(LogCaptureAtlasValidation, Error, TEXT("%s: %dx%d atlas exceeds %d."), Case.Name, Layout.GetAtlasWidth(), Layout.GetAtlasHeight(), Case.MaxAtlasSize);
+		return false;
+	}
+
+	// Synthetic atlas built from the grid geometry alone, independent of GetTileRect
+	const int32 AtlasWidth = Layout.GetAtlasWidth();
+	const int32 AtlasHeight = Layout.GetAtlasHeight();
+	TArray<FColor> Atlas;
+	Atlas.SetNumUninitialized(AtlasWidth * AtlasHeight);
+	for (int32 Y = 0; Y < AtlasHeight; ++Y)
+	{
+		for (int32 X = 0; X < AtlasWidth; ++X)
+		{
+			const int32 TileIndex = (Y / Case.TileHeight) * Layout.Columns + X / Case.TileWidth;
+			Atlas[Y * AtlasWidth + X] = TileIndex < Case.NumTiles ? MakeTilePixel(TileIndex, X % Case.TileWidth, Y % Case.TileHeight) : FColor::White;
+		}
+	}
+
+	TArray<TArray<FColor>> Tiles;
+	const double StartTime = FPlatformTime::Seconds();
+	const bool bSplit = Layout.SplitAtlas(Atlas, Tiles);
+	OutSplitMilliseconds = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	if (!bSplit || Tiles.Num() != Case.NumTiles)
+	{
+		UE_LOG(LogCaptureAtlasValidation, Error, TEXT("%s: split failed."), Case.Name);
+		return false;
+	}
+
+	int32 NumMismatched = 0;
+	for (int32 TileIndex = 0; TileIndex < Tiles.Num(); ++TileIndex)
+	{
+		const TArray<FColor>& Tile = Tiles[TileIndex];
+		if (Tile.Num() != Case.TileWidth * Case.TileHeight)
+		{
+			UE_LOG(LogCaptureAtlasValidation, Error, TEXT("%s: tile %d has %d pixels."), Case.Name, TileIndex, Tile.Num());
+			++NumMismatched;
+			continue;
+		}
+		bool bTileMatches = true;
+		for (int32 Y = 0; Y < Case.TileHeight; ++Y)
+		{
+			for (int32 X = 0; X < Case.TileWidth; ++X)
+			{
+				FColor Expected = MakeTilePixel(TileIndex, X, Y);
+				Expected.A = 255;
+				const FColor& Pixel = Tile[Y * Case.TileWidth + X];
+				// One message per tile is enough to locate the fault
+				if (Pixel != Expected && bTileMatches)
+				{
+					UE_LOG(LogCaptureAtlasValidation, Error, TEXT("%s: tile %d pixel (%d, %d) is %s, expected %s."), Case.Name, TileIndex, X, Y,
+						*Pixel.ToString(), *Expected.ToString());
+					bTileMatches = false;
+					++NumMismatched;
+				}
+			}
+		}
+
+		// The camera's principal point in atlas coordinates must fall on the same spot of its own tile
+		const FCameraIntrinsics TileIntrinsics = MakeIntrinsics(Case.TileWidth, Case.TileHeight);
+		const FCameraIntrinsics AtlasIntrinsics = Layout.GetAtlasIntrinsics(TileIntrinsics, TileIndex);
+		const int32 AtlasX = FMath::FloorToInt32(AtlasIntrinsics.PrincipalPointX);
+		const int32 AtlasY = FMath::FloorToInt32(AtlasIntrinsics.PrincipalPointY);
+		const FColor Expected = MakeTilePixel(TileIndex, FMath::FloorToInt32(TileIntrinsics.PrincipalPointX), FMath::FloorToInt32(TileIntrinsics.PrincipalPointY));
+		const bool bInAtlas = AtlasX >= 0 && AtlasY >= 0 && AtlasX < AtlasWidth && AtlasY < AtlasHeight;
+		if (!bInAtlas || Atlas[AtlasY * AtlasWidth + AtlasX] != Expected || AtlasIntrinsics.FocalLengthX != TileIntrinsics.FocalLengthX
+			|| AtlasIntrinsics.ImageWidth != AtlasWidth || AtlasIntrinsics.ImageHeight != AtlasHeight)
+		{
+			UE_LOG(LogCaptureAtlasValidation, Error, TEXT("%s: tile %d principal point (%.2f, %.2f) in the atlas is not on the tile."), Case.Name, TileIndex,
+				AtlasIntrinsics.PrincipalPointX, AtlasIntrinsics.PrincipalPointY);
+			++NumMismatched;
+		}
+	}
+
+	// Without forcing opacity the captured alpha is passed through untouched
+	TArray<TArray<FColor>> RawTiles;
+	const bool bAlphaKept = Layout.SplitAtlas(Atlas, RawTiles, false) && RawTiles.Last()[0].A == CaptureAlpha;
+	if (!bAlphaKept)
+	{
+		UE_LOG(LogCaptureAtlasValidation, Error, TEXT("%s: alpha not kept with bForceOpaque off."), Case.Name);
+	}
+
+	UE_LOG(LogCaptureAtlasValidation, Display, TEXT("%s: %dx%d grid, %dx%d atlas, split in %.2f ms, %d tiles mismatched."), Case.Name, Layout.Columns, Layout.Rows,
+		AtlasWidth, AtlasHeight, OutSplitMilliseconds, NumMismatched);
+	return NumMismatched == 0 && bAlphaKept;
+}
+
+bool UCaptureAtlasValidationCommandlet::CheckRejectsMismatchedBuffer()
+{
+	const FCaptureAtlasLayout Layout = FCaptureAtlasLayout::Make(4, 16, 16);
+	TArray<FColor> Atlas;
+	Atlas.SetNumZeroed(Layout.GetAtlasWidth() * Layout.GetAtlasHeight() - 1);
+	TArray<TArray<FColor>> Tiles;
+	if (Layout.SplitAtlas(Atlas, Tiles))
+	{
+		UE_LOG(LogCaptureAtlasValidation, Error, TEXT("MismatchedBuffer: a buffer one pixel short was split."));
+		return false;
+	}
+	UE_LOG(LogCaptureAtlasValidation, Display, TEXT("MismatchedBuffer: rejected, as expected."));
+	return true;
+}
@@ -0,0 +1,42 @@
+// CaptureAtlasValidationCommandlet.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "CaptureAtlas.h"
+#include "CaptureAtlasValidationCommandlet.generated.h"
+
+/**
+ * Checks FCaptureAtlasLayout on synthetic atlas buffers, without rendering, so it runs under -nullrhi.
+ * Every case fills an atlas with pixels that encode the tile and tile-local position they belong to, splits it and
+ * checks every pixel of every tile, the alpha handling and that each camera's principal point maps back onto its own
+ * tile. Cases cover a single tile, grids with empty cells, portrait tiles and a full rig, plus layouts that must be
+ * rejected (tiles that do not fit, a buffer of the wrong size).
+ *
+ * UnrealEditor-Cmd Project.uproject -run=CaptureAtlasValidation -nullrhi
+ * Returns 1 if any check fails.
+ */
+UCLASS()
+class EXTRACTJOINTLOCATION_API UCaptureAtlasValidationCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UCaptureAtlasValidationCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	struct FCase
+	{
+		const TCHAR* Name;
+		int32 NumTiles;
+		int32 TileWidth;
+		int32 TileHeight;
+		int32 MaxAtlasSize;
+		bool bExpectLayout;
+	};
+
+	static bool RunCase(const FCase& Case, double& OutSplitMilliseconds);
+	static bool CheckRejectsMismatchedBuffer();
+};
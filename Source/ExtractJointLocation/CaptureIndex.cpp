@@ -0,0 +1,267 @@
+#include "CaptureIndex.h"
+#include "ChunkedContainer.h"
+#include "Algo/StableSort.h"
+#include "HAL/PlatformFileManager.h"
+#include "Math/RandomStream.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogCaptureIndex, Log, All);
+
+FArchive& operator<<(FArchive& Ar, FCaptureIndexEntry& Entry)
+{
+	uint8 Kind = static_cast<uint8>(Entry.Kind);
+	Ar << Entry.FrameIndex;
+	Ar << Entry.SubjectId;
+	Ar << Entry.CameraId;
+	Ar << Entry.StreamId;
+	Ar << Kind;
+	Ar << Entry.FileId;
+	Ar << Entry.RecordIndex;
+	Ar << Entry.Offset;
+	Ar << Entry.Size;
+	Ar << Entry.HeaderSize;
+	Entry.Kind = static_cast<ECaptureIndexKind>(Kind);
+	return Ar;
+}
+
+int32 FCaptureIndexBuilder::Intern(TArray<FString>& Table, TMap<FString, int32>& Lookup, const FString& Value)
+{
+	if (Value.IsEmpty())
+	{
+		return INDEX_NONE;
+	}
+	if (const int32* Existing = Lookup.Find(Value))
+	{
+		return *Existing;
+	}
+	const int32 NewId = Table.Add(Value);
+	Lookup.Add(Value, NewId);
+	return NewId;
+}
+
+int32 FCaptureIndexBuilder::AddEntry(int32 FrameIndex, ECaptureIndexKind Kind, const FString& Subject, const FString& Camera, const FString& FilePath, int64 Offset, int64 Size,
+	int32 RecordIndex, const FString& Stream, int32 HeaderSize)
+{
+	FCaptureIndexEntry& Entry = Entries.AddDefaulted_GetRef();
+	Entry.FrameIndex = FrameIndex;
+	Entry.Kind = Kind;
+	Entry.SubjectId = Intern(Subjects, SubjectLookup, Subject);
+	Entry.CameraId = Intern(Cameras, CameraLookup, Camera);
+	Entry.StreamId = Intern(Streams, StreamLookup, Stream);
+	Entry.FileId = Intern(Files, FileLookup, FilePath);
+	Entry.Offset = Offset;
+	Entry.Size = Size;
+	Entry.RecordIndex = RecordIndex;
+	Entry.HeaderSize = HeaderSize;
+	return Entries.Num() - 1;
+}
+
+bool FCaptureIndexBuilder::Save(const FString& FilePath)
+{
+	if (Entries.Num() == 0)
+	{
+		return false;
+	}
+
+	// Stable sort keeps the write order of entries within a frame
+	Algo::StableSortBy(Entries, &FCaptureIndexEntry::FrameIndex);
+
+	int32 MinFrame = Entries[0].FrameIndex;
+	const int32 NumFrames = Entries.Last().FrameIndex - MinFrame + 1;
+
+	// FrameStarts[f] .. FrameStarts[f + 1] is the entry range of frame MinFrame + f
+	TArray<int32> FrameStarts;
+	FrameStarts.SetNumZeroed(NumFrames + 1);
+	for (const FCaptureIndexEntry& Entry : Entries)
+	{
+		++FrameStarts[Entry.FrameIndex - MinFrame + 1];
+	}
+	for (int32 i = 1; i <= NumFrames; ++i)
+	{
+		FrameStarts[i] += FrameStarts[i - 1];
+	}
+
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	uint32 IndexMagic = FCaptureIndex::Magic;
+	uint16 Version = FCaptureIndex::CurrentVersion;
+	Writer << IndexMagic << Version;
+	Writer << Files << Subjects << Cameras << Streams;
+	Writer << MinFrame << FrameStarts << Entries;
+
+	if (!FFileHelper::SaveArrayToFile(Bytes, *FilePath))
+	{
+		UE_LOG(LogCaptureIndex, Error, TEXT("Save: Failed to write capture index: %s"), *FilePath);
+		return false;
+	}
+
+	UE_LOG(LogCaptureIndex, Log, TEXT("Saved capture index %s (%d entries, %d frames, %d bytes)."), *FilePath, Entries.Num(), NumFrames, Bytes.Num());
+	return true;
+}
+
+void FCaptureIndexBuilder::Reset()
+{
+	Entries.Reset();
+	Files.Reset();
+	Subjects.Reset();
+	Cameras.Reset();
+	Streams.Reset();
+	FileLookup.Reset();
+	SubjectLookup.Reset();
+	CameraLookup.Reset();
+	StreamLookup.Reset();
+}
+
+bool FCaptureIndex::Load(const FString& FilePath)
+{
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *FilePath))
+	{
+		UE_LOG(LogCaptureIndex, Error, TEXT("Load: Failed to read capture index: %s"), *FilePath);
+		return false;
+	}
+
+	FMemoryReader Reader(Bytes);
+	uint32 IndexMagic = 0;
+	uint16 Version = 0;
+	Reader << IndexMagic << Version;
+	if (IndexMagic != Magic || Version > CurrentVersion)
+	{
+		UE_LOG(LogCaptureIndex, Error, TEXT("Load: %s is not a capture index."), *FilePath);
+		return false;
+	}
+	if (Version < CurrentVersion)
+	{
+		// Version 1 indexed delta frames that cannot be decoded on their own
+		UE_LOG(LogCaptureIndex, Error, TEXT("Load: %s was written by an older version, capture it again."), *FilePath);
+		return false;
+	}
+	Reader << Files << Subjects << Cameras << Streams;
+	Reader << MinFrame << FrameStarts << Entries;
+	return !Reader.IsError();
+}
+
+TArrayView<const FCaptureIndexEntry> FCaptureIndex::GetFrameEntries(int32 FrameIndex) const
+{
+	const int32 Slot = FrameIndex - MinFrame;
+	if (Slot < 0 || Slot >= GetNumFrames())
+	{
+		return TArrayView<const FCaptureIndexEntry>();
+	}
+	return TArrayView<const FCaptureIndexEntry>(Entries.GetData() + FrameStarts[Slot], FrameStarts[Slot + 1] - FrameStarts[Slot]);
+}
+
+const FCaptureIndexEntry* FCaptureIndex::Find(int32 FrameIndex, const FString& Subject, const FString& Camera, ECaptureIndexKind Kind, const FString& Stream) const
+{
+	const int32 SubjectId = FindSubjectId(Subject);
+	const int32 CameraId = FindCameraId(Camera);
+	const int32 StreamId = FindStreamId(Stream);
+	if ((!Subject.IsEmpty() && SubjectId == INDEX_NONE) || (!Camera.IsEmpty() && CameraId == INDEX_NONE) || (!Stream.IsEmpty() && StreamId == INDEX_NONE))
+	{
+		return nullptr;
+	}
+
+	for (const FCaptureIndexEntry& Entry : GetFrameEntries(FrameIndex))
+	{
+		if (Entry.Kind == Kind && Entry.SubjectId == SubjectId && Entry.CameraId == CameraId && Entry.StreamId == StreamId)
+		{
+			return &Entry;
+		}
+	}
+	return nullptr;
+}
+
+void FCaptureIndex::ForEachInRange(int32 FirstFrame, int32 LastFrame, TFunctionRef<void(const FCaptureIndexEntry&)> Visitor, TOptional<ECaptureIndexKind> Kind) const
+{
+	const int32 FirstSlot = FMath::Max(FirstFrame - MinFrame, 0);
+	const int32 EndSlot = FMath::Min(LastFrame - MinFrame + 1, GetNumFrames());
+	if (FirstSlot >= EndSlot)
+	{
+		return;
+	}
+
+	for (int32 i = FrameStarts[FirstSlot]; i < FrameStarts[EndSlot]; ++i)
+	{
+		if (!Kind.IsSet() || Entries[i].Kind == Kind.GetValue())
+		{
+			Visitor(Entries[i]);
+		}
+	}
+}
+
+TArray<int32> FCaptureIndex::SampleFrames(int32 Count, int32 Seed) const
+{
+	TArray<int32> CapturedFrames;
+	for (int32 Slot = 0; Slot < GetNumFrames(); ++Slot)
+	{
+		if (FrameStarts[Slot + 1] > FrameStarts[Slot])
+		{
+			CapturedFrames.Add(MinFrame + Slot);
+		}
+	}
+
+	// Partial Fisher-Yates: the first Count elements end up a uniform sample without replacement
+	FRandomStream Random(Seed);
+	const int32 NumSamples = FMath::Min(Count, CapturedFrames.Num());
+	for (int32 i = 0; i < NumSamples; ++i)
+	{
+		CapturedFrames.Swap(i, Random.RandRange(i, CapturedFrames.Num() - 1));
+	}
+	CapturedFrames.SetNum(NumSamples);
+	return CapturedFrames;
+}
+
+bool FCaptureIndex::ReadEntryData(const FCaptureIndexEntry& Entry, TArray<uint8>& OutData) const
+{
+	if (!Files.IsValidIndex(Entry.FileId))
+	{
+		return false;
+	}
+	const FString& FilePath = Files[Entry.FileId];
+
+	if (Entry.RecordIndex != INDEX_NONE)
+	{
+		FChunkedContainerReader Reader;
+		if (!Reader.Open(FilePath))
+		{
+			return false;
+		}
+		const int32 BlockIndex = Reader.FindBlockAtOffset(Entry.Offset);
+		TArray<TArray<FChunkedRecord>> BlockRecords;
+		if (BlockIndex == INDEX_NONE || !Reader.ReadBlocks(BlockIndex, 1, BlockRecords) || !BlockRecords[0].IsValidIndex(Entry.RecordIndex))
+		{
+			return false;
+		}
+		OutData = MoveTemp(BlockRecords[0][Entry.RecordIndex].Payload);
+		return true;
+	}
+
+	if (Entry.Size < 0)
+	{
+		return FFileHelper::LoadFileToArray(OutData, *FilePath);
+	}
+
+	// Stream frames need the stream header in front of their byte range to be decoded
+	TUniquePtr<IFileHandle> FileHandle(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*FilePath));
+	OutData.SetNumUninitialized(Entry.HeaderSize + Entry.Size);
+	return FileHandle.IsValid() && (Entry.HeaderSize == 0 || (FileHandle->Seek(0) && FileHandle->Read(OutData.GetData(), Entry.HeaderSize)))
+		&& FileHandle->Seek(Entry.Offset) && FileHandle->Read(OutData.GetData() + Entry.HeaderSize, Entry.Size);
+}
+
+int32 FCaptureIndex::FindSubjectId(const FString& Subject) const
+{
+	return Subject.IsEmpty() ? INDEX_NONE : Subjects.IndexOfByKey(Subject);
+}
+
+int32 FCaptureIndex::FindCameraId(const FString& Camera) const
+{
+	return Camera.IsEmpty() ? INDEX_NONE : Cameras.IndexOfByKey(Camera);
+}
+
+int32 FCaptureIndex::FindStreamId(const FString& Stream) const
+{
+	return Stream.IsEmpty() ? INDEX_NONE : Streams.IndexOfByKey(Stream);
+}
@@ -0,0 +1,130 @@
+// CaptureIndex.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CaptureIndex.generated.h"
+
+// What kind of data an index entry points at
+UENUM(BlueprintType)
+enum class ECaptureIndexKind : uint8
+{
+	Skeleton,
+	Image,
+	Annotation,
+	Calibration
+};
+
+/**
+ * One piece of capture output for a frame. Strings are interned into the index's string tables.
+ * Plain files: [Offset, Offset + Size) of the file (Size -1 = whole file), RecordIndex = INDEX_NONE.
+ * Stream frames: as plain files, but Offset is the keyframe the frame is decoded from, Size runs to the end of the
+ * frame and the first HeaderSize bytes of the file (the stream header) are needed as well.
+ * Container records: Offset/Size are the compressed block's byte range and RecordIndex its position in the block.
+ */
+struct EXTRACTJOINTLOCATION_API FCaptureIndexEntry
+{
+	int32 FrameIndex = 0;
+	int32 SubjectId = INDEX_NONE;
+	int32 CameraId = INDEX_NONE;
+	// Which of a subject's outputs the entry belongs to (e.g. "Body", "Face_Markers"), INDEX_NONE if it has only one
+	int32 StreamId = INDEX_NONE;
+	ECaptureIndexKind Kind = ECaptureIndexKind::Skeleton;
+	int32 FileId = INDEX_NONE;
+	int32 RecordIndex = INDEX_NONE;
+	int64 Offset = 0;
+	int64 Size = -1;
+	int32 HeaderSize = 0;
+
+	friend FArchive& operator<<(FArchive& Ar, FCaptureIndexEntry& Entry);
+};
+
+/** Collects entries during a capture run and writes the compact index file at the end. */
+class EXTRACTJOINTLOCATION_API FCaptureIndexBuilder
+{
+public:
+	/**
+	 * Adds an entry. Subject, Camera and Stream may be empty.
+	 * @return Position of the entry, usable with GetEntry() to patch offsets that are only known later.
+	 */
+	int32 AddEntry(int32 FrameIndex, ECaptureIndexKind Kind, const FString& Subject, const FString& Camera, const FString& FilePath, int64 Offset = 0, int64 Size = -1,
+		int32 RecordIndex = INDEX_NONE, const FString& Stream = FString(), int32 HeaderSize = 0);
+
+	FCaptureIndexEntry& GetEntry(int32 EntryIndex) { return Entries[EntryIndex]; }
+	int32 Num() const { return Entries.Num(); }
+
+	/** Sorts the entries by frame, builds the frame lookup table and writes the index. */
+	bool Save(const FString& FilePath);
+
+	void Reset();
+
+private:
+	static int32 Intern(TArray<FString>& Table, TMap<FString, int32>& Lookup, const FString& Value);
+
+	TArray<FCaptureIndexEntry> Entries;
+	TArray<FString> Files;
+	TArray<FString> Subjects;
+	TArray<FString> Cameras;
+	TArray<FString> Streams;
+	TMap<FString, int32> FileLookup;
+	TMap<FString, int32> SubjectLookup;
+	TMap<FString, int32> CameraLookup;
+	TMap<FString, int32> StreamLookup;
+};
+
+/**
+ * Loaded capture index with O(1) frame lookup.
+ * Entries are sorted by frame and FrameStarts[Frame - MinFrame] gives the first entry of each frame,
+ * so queries never touch unrelated data or scan directories.
+ */
+class EXTRACTJOINTLOCATION_API FCaptureIndex
+{
+public:
+	bool Load(const FString& FilePath);
+
+	/** All entries of a frame (empty if the frame was not captured). */
+	TArrayView<const FCaptureIndexEntry> GetFrameEntries(int32 FrameIndex) const;
+
+	/**
+	 * Finds the entry of a frame for a subject/camera/kind/stream. Pass an empty name to match entries without one.
+	 * Example: Find(4532, TEXT("BP_Subject_7"), TEXT("DomeCam_12"), ECaptureIndexKind::Image).
+	 * Example: Find(4532, TEXT("BP_Subject_7"), FString(), ECaptureIndexKind::Skeleton, TEXT("Body")).
+	 */
+	const FCaptureIndexEntry* Find(int32 FrameIndex, const FString& Subject, const FString& Camera, ECaptureIndexKind Kind, const FString& Stream = FString()) const;
+
+	/** Calls Visitor for every entry in [FirstFrame, LastFrame], optionally restricted to one kind. */
+	void ForEachInRange(int32 FirstFrame, int32 LastFrame, TFunctionRef<void(const FCaptureIndexEntry&)> Visitor, TOptional<ECaptureIndexKind> Kind = {}) const;
+
+	/** Draws Count distinct captured frames uniformly at random (fewer if the run is shorter). */
+	TArray<int32> SampleFrames(int32 Count, int32 Seed) const;
+
+	/**
+	 * Reads the bytes an entry points at, decompressing the container block if needed.
+	 * For stream frames this is the stream header followed by the frames from the keyframe on, which the stream's
+	 * decoder (e.g. FKeypointStreamDecoder) decodes up to the entry's frame.
+	 */
+	bool ReadEntryData(const FCaptureIndexEntry& Entry, TArray<uint8>& OutData) const;
+
+	int32 FindSubjectId(const FString& Subject) const;
+	int32 FindCameraId(const FString& Camera) const;
+	int32 FindStreamId(const FString& Stream) const;
+	const FString& GetFilePath(int32 FileId) const { return Files[FileId]; }
+	const FString& GetSubjectName(int32 SubjectId) const { return Subjects[SubjectId]; }
+	const FString& GetCameraName(int32 CameraId) const { return Cameras[CameraId]; }
+	const FString& GetStreamName(int32 StreamId) const { return Streams[StreamId]; }
+
+	int32 GetMinFrame() const { return MinFrame; }
+	int32 GetNumFrames() const { return FMath::Max(FrameStarts.Num() - 1, 0); }
+	int32 GetNumEntries() const { return Entries.Num(); }
+
+	static constexpr uint32 Magic = 0x494C4A45; // "EJLI"
+	static constexpr uint16 CurrentVersion = 2;
+
+private:
+	TArray<FCaptureIndexEntry> Entries;
+	TArray<int32> FrameStarts;
+	int32 MinFrame = 0;
+	TArray<FString> Files;
+	TArray<FString> Subjects;
+	TArray<FString> Cameras;
+	TArray<FString> Streams;
+};
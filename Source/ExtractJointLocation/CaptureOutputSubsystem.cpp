@@ -0,0 +1,157 @@
+#include "CaptureOutputSubsystem.h"
+#include "Misc/DateTime.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogCaptureOutput, Log, All);
+
+UCaptureOutputSubsystem::UCaptureOutputSubsystem()
+{
+	bWriteIndex = false;
+}
+
+void UCaptureOutputSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	StartFrameCounter = GFrameCounter;
+	RunName = FString::Printf(TEXT("Capture_%s"), *FDateTime::Now().ToString(TEXT("%Y%m%d_%H%M%S")));
+}
+
+void UCaptureOutputSubsystem::Deinitialize()
+{
+	CloseContainer();
+	SaveIndex();
+	Super::Deinitialize();
+}
+
+bool UCaptureOutputSubsystem::OpenContainer(const FString& InRunName, FName CompressionFormat, int32 FramesPerBlock)
+{
+	CloseContainer();
+	// Reopening a closed run's container would truncate the records its index already points at
+	if (bContainerClosed && InRunName == RunName)
+	{
+		UE_LOG(LogCaptureOutput, Error, TEXT("OpenContainer: The container of run %s was already closed; open a new run instead."), *RunName);
+		return false;
+	}
+	RunName = InRunName;
+	bContainerClosed = false;
+	bWarnedWriteAfterClose = false;
+
+	const FString FilePath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Capture"), RunName + TEXT(".ejlc"));
+	ContainerWriter = MakeUnique<FChunkedContainerWriter>(CompressionFormat, FramesPerBlock);
+	if (!ContainerWriter->Open(FilePath))
+	{
+		ContainerWriter.Reset();
+		return false;
+	}
+
+	UE_LOG(LogCaptureOutput, Log, TEXT("Writing capture output to container: %s"), *FilePath);
+	return true;
+}
+
+void UCaptureOutputSubsystem::CloseContainer()
+{
+	if (ContainerWriter.IsValid())
+	{
+		ContainerWriter->Close();
+		ResolveContainerEntries();
+		ContainerWriter.Reset();
+		bContainerClosed = true;
+	}
+}
+
+bool UCaptureOutputSubsystem::WriteRecord(const FString& Name, TArray<uint8>&& Payload, ECaptureIndexKind Kind, const FString& Subject, const FString& Camera)
+{
+	if (!ContainerWriter.IsValid() && bContainerClosed)
+	{
+		if (!bWarnedWriteAfterClose)
+		{
+			UE_LOG(LogCaptureOutput, Error, TEXT("WriteRecord: The container of run %s is closed, dropping %s and any later records."), *RunName, *Name);
+			bWarnedWriteAfterClose = true;
+		}
+		return false;
+	}
+	if (!ContainerWriter.IsValid() && !OpenContainer(RunName))
+	{
+		return false;
+	}
+
+	const int32 FrameIndex = GetCaptureFrameIndex();
+	int32 BlockIndex = INDEX_NONE;
+	int32 RecordIndex = INDEX_NONE;
+	if (!ContainerWriter->AddRecord(FrameIndex, Name, MoveTemp(Payload), &BlockIndex, &RecordIndex))
+	{
+		return false;
+	}
+
+	if (bWriteIndex)
+	{
+		PendingContainerEntries.Add(IndexBuilder.AddEntry(FrameIndex, Kind, Subject, Camera, ContainerWriter->GetFilePath(), BlockIndex, 0, RecordIndex));
+	}
+	return true;
+}
+
+bool UCaptureOutputSubsystem::WriteTextRecord(const FString& Name, const FString& Content, ECaptureIndexKind Kind, const FString& Subject, const FString& Camera)
+{
+	FTCHARToUTF8 Utf8(*Content);
+	TArray<uint8> Payload(reinterpret_cast<const uint8*>(Utf8.Get()), Utf8.Length());
+	return WriteRecord(Name, MoveTemp(Payload), Kind, Subject, Camera);
+}
+
+void UCaptureOutputSubsystem::IndexFile(ECaptureIndexKind Kind, const FString& Subject, const FString& Camera, const FString& FilePath, int64 Offset, int64 Size)
+{
+	if (bWriteIndex)
+	{
+		IndexBuilder.AddEntry(GetCaptureFrameIndex(), Kind, Subject, Camera, FPaths::ConvertRelativePathToFull(FilePath), Offset, Size);
+	}
+}
+
+void UCaptureOutputSubsystem::IndexStreamFrame(int32 FrameIndex, ECaptureIndexKind Kind, const FString& Subject, const FString& Stream, const FString& FilePath, int64 KeyframeOffset, int64 Size, int64 HeaderSize)
+{
+	if (bWriteIndex)
+	{
+		IndexBuilder.AddEntry(FrameIndex, Kind, Subject, FString(), FPaths::ConvertRelativePathToFull(FilePath), KeyframeOffset, Size, INDEX_NONE, Stream, static_cast<int32>(HeaderSize));
+	}
+}
+
+bool UCaptureOutputSubsystem::SaveIndex()
+{
+	if (IndexBuilder.Num() == 0)
+	{
+		return false;
+	}
+
+	// Container entries are only complete once their blocks are on disk
+	if (ContainerWriter.IsValid())
+	{
+		CloseContainer();
+	}
+	return IndexBuilder.Save(FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Capture"), RunName + TEXT(".ejli")));
+}
+
+void UCaptureOutputSubsystem::ResolveContainerEntries()
+{
+	const TArray<FChunkedBlockInfo>& Blocks = ContainerWriter->GetBlocks();
+	for (const int32 EntryIndex : PendingContainerEntries)
+	{
+		FCaptureIndexEntry& Entry = IndexBuilder.GetEntry(EntryIndex);
+		const int32 BlockIndex = static_cast<int32>(Entry.Offset);
+		if (Blocks.IsValidIndex(BlockIndex))
+		{
+			Entry.Offset = Blocks[BlockIndex].Offset;
+			Entry.Size = Blocks[BlockIndex].CompressedSize;
+		}
+	}
+	PendingContainerEntries.Reset();
+}
+
+int32 UCaptureOutputSubsystem::GetCaptureFrameIndex() const
+{
+	return static_cast<int32>(GFrameCounter - StartFrameCounter);
+}
+
+FString UCaptureOutputSubsystem::MakeRecordName(const FString& AbsoluteFilePath)
+{
+	FString RecordName = AbsoluteFilePath;
+	FPaths::MakePathRelativeTo(RecordName, *FPaths::ProjectSavedDir());
+	return RecordName;
+}
@@ -0,0 +1,100 @@
+// CaptureOutputSubsystem.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ChunkedContainer.h"
+#include "CaptureIndex.h"
+#include "CaptureOutputSubsystem.generated.h"
+
+/**
+ * Per-world owner of the capture run's chunked output container.
+ * Components that would otherwise write many small files under Saved/ hand their payloads to this
+ * subsystem instead; records are grouped by capture frame into compressed blocks of one container file.
+ * If bWriteIndex is set, every output (container record or plain file) is also entered into the run's capture index
+ * (Saved/Capture/<RunName>.ejli), which is written when the world is torn down.
+ */
+UCLASS(config = Game)
+class EXTRACTJOINTLOCATION_API UCaptureOutputSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UCaptureOutputSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/**
+	 * Opens Saved/Capture/<RunName>.ejlc. Called implicitly with default settings by the first WriteRecord.
+	 * A run's container cannot be reopened once closed; records written after CloseContainer or SaveIndex are dropped.
+	 * @param CompressionFormat Any FCompression format, e.g. Oodle, Zlib or LZ4.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Capture Output")
+	bool OpenContainer(const FString& RunName, FName CompressionFormat = TEXT("Oodle"), int32 FramesPerBlock = 64);
+
+	UFUNCTION(BlueprintCallable, Category = "Capture Output")
+	void CloseContainer();
+
+	/**
+	 * Adds a record for the current capture frame and indexes it.
+	 * @param Name Path-like record name, e.g. "UpperBodySubset/BP_MetaHuman_C_0_UpperBodySubset_BoneLocations.json".
+	 * @param Subject Actor the record belongs to, empty if none.
+	 * @param Camera Camera the record belongs to, empty if none.
+	 */
+	bool WriteRecord(const FString& Name, TArray<uint8>&& Payload, ECaptureIndexKind Kind, const FString& Subject, const FString& Camera);
+
+	/** Adds a UTF-8 encoded text record for the current capture frame and indexes it. */
+	bool WriteTextRecord(const FString& Name, const FString& Content, ECaptureIndexKind Kind, const FString& Subject, const FString& Camera);
+
+	/**
+	 * Indexes (part of) a plain file written for the current capture frame.
+	 * @param Size Number of bytes from Offset, or -1 for the whole file.
+	 */
+	void IndexFile(ECaptureIndexKind Kind, const FString& Subject, const FString& Camera, const FString& FilePath, int64 Offset = 0, int64 Size = -1);
+
+	/**
+	 * Indexes one frame of a stream file (keypoint, marker or vertex stream) that is only decodable from its keyframe.
+	 * @param FrameIndex The stream's own frame index, as stored in the frame.
+	 * @param Stream Which of the subject's streams the frame belongs to, e.g. "Body" or "Face_Markers".
+	 * @param KeyframeOffset Offset of the keyframe the frame is decoded from; Size runs from there to the end of the frame.
+	 * @param HeaderSize Size of the stream header at the start of the file.
+	 */
+	void IndexStreamFrame(int32 FrameIndex, ECaptureIndexKind Kind, const FString& Subject, const FString& Stream, const FString& FilePath, int64 KeyframeOffset, int64 Size, int64 HeaderSize);
+
+	/**
+	 * Closes the run's container and writes the capture index for everything output so far.
+	 * Called automatically on teardown; call it manually only at the end of a run.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Capture Output")
+	bool SaveIndex();
+
+	UFUNCTION(BlueprintPure, Category = "Capture Output")
+	FString GetRunName() const { return RunName; }
+
+	/** Frame index used for records, counted from the subsystem's creation. */
+	UFUNCTION(BlueprintPure, Category = "Capture Output")
+	int32 GetCaptureFrameIndex() const;
+
+	/** Container path relative to Saved/, used as a record name prefix by callers that have absolute paths. */
+	static FString MakeRecordName(const FString& AbsoluteFilePath);
+
+	/** If true, outputs are indexed and the index is written on teardown. Off by default so play sessions leave no index behind. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Capture Output")
+	bool bWriteIndex;
+
+private:
+	// Patches index entries of container records with their block's file range once the blocks are written
+	void ResolveContainerEntries();
+
+	TUniquePtr<FChunkedContainerWriter> ContainerWriter;
+	// Set once the run's container was closed, after which it is not reopened
+	bool bContainerClosed = false;
+	bool bWarnedWriteAfterClose = false;
+	uint64 StartFrameCounter = 0;
+	FString RunName;
+
+	FCaptureIndexBuilder IndexBuilder;
+	// Index entries whose Offset temporarily holds the container block index
+	TArray<int32> PendingContainerEntries;
+};
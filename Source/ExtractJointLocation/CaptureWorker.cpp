@@ -0,0 +1,436 @@
+#include "CaptureWorker.h"
+#include "Animation/AnimationAsset.h"
+#include "Engine/SkeletalMesh.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogCaptureWorker, Log, All);
+
+// Sets default values for this actor's properties
+ACaptureWorker::ACaptureWorker()
+{
+	PrimaryActorTick.bCanEverTick = true;
+}
+
+// Called when the game starts or when spawned
+void ACaptureWorker::BeginPlay()
+{
+	Super::BeginPlay();
+
+	FParse::Value(FCommandLine::Get(), TEXT("CaptureQueue="), QueueDirectory);
+	QueueRoot = FPaths::IsRelative(QueueDirectory) ? FPaths::Combine(FPaths::ProjectSavedDir(), QueueDirectory) : QueueDirectory;
+	QueueRoot = FPaths::ConvertRelativePathToFull(QueueRoot);
+
+	for (const TCHAR* SubDirectory : { TEXT("pending"), TEXT("running"), TEXT("done"), TEXT("failed"), TEXT("status") })
+	{
+		IFileManager::Get().MakeDirectory(*GetQueuePath(SubDirectory), true);
+	}
+
+	if (!TakeManager)
+	{
+		UE_LOG(LogCaptureWorker, Error, TEXT("BeginPlay: No TakeManager assigned, the worker cannot run jobs."));
+		return;
+	}
+	TakeManager->OnTakeFinished.AddDynamic(this, &ACaptureWorker::HandleTakeFinished);
+	TakeManager->OnAllTakesCompleted.AddDynamic(this, &ACaptureWorker::HandleAllTakesCompleted);
+
+	// Jobs left in running/ by a crashed worker are returned to the queue
+	TArray<FString> StaleJobs;
+	IFileManager::Get().FindFiles(StaleJobs, *FPaths::Combine(GetQueuePath(TEXT("running")), TEXT("*.json")), true, false);
+	for (const FString& StaleJob : StaleJobs)
+	{
+		IFileManager::Get().Move(*FPaths::Combine(GetQueuePath(TEXT("pending")), StaleJob), *FPaths::Combine(GetQueuePath(TEXT("running")), StaleJob));
+	}
+
+	UE_LOG(LogCaptureWorker, Log, TEXT("Capture worker polling %s"), *GetQueuePath(TEXT("pending")));
+}
+
+void ACaptureWorker::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (bJobRunning)
+	{
+		FinishJob(false, TEXT("Worker shut down while the job was running."));
+	}
+	Super::EndPlay(EndPlayReason);
+}
+
+// Called every frame
+void ACaptureWorker::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!TakeManager)
+	{
+		return;
+	}
+
+	if (bJobRunning)
+	{
+		TimeSinceLastStatus += DeltaTime;
+		if (TimeSinceLastStatus >= StatusInterval)
+		{
+			TimeSinceLastStatus = 0.0f;
+			WriteStatus();
+		}
+		return;
+	}
+
+	TimeSinceLastPoll += DeltaTime;
+	if (TimeSinceLastPoll >= PollInterval)
+	{
+		TimeSinceLastPoll = 0.0f;
+		StartNextJob();
+	}
+}
+
+bool ACaptureWorker::StartNextJob()
+{
+	TArray<FString> PendingJobs;
+	IFileManager::Get().FindFiles(PendingJobs, *FPaths::Combine(GetQueuePath(TEXT("pending")), TEXT("*.json")), true, false);
+	if (PendingJobs.Num() == 0)
+	{
+		return false;
+	}
+	PendingJobs.Sort();
+
+	// Claim the job first, so a job that crashes the worker is not picked up again in a loop
+	JobFileName = PendingJobs[0];
+	const FString RunningPath = FPaths::Combine(GetQueuePath(TEXT("running")), JobFileName);
+	if (!IFileManager::Get().Move(*RunningPath, *FPaths::Combine(GetQueuePath(TEXT("pending")), JobFileName)))
+	{
+		// The orchestrator may still be writing it; try again on the next poll
+		return false;
+	}
+
+	bJobRunning = true;
+	JobId = FPaths::GetBaseFilename(JobFileName);
+	JobState = TEXT("loading");
+	NumJobTakes = 0;
+	NumFinishedTakes = 0;
+	JobOutputs.Reset();
+	TakeStatuses.Reset();
+	StageTimings.Reset();
+	JobError.Reset();
+	JobStartTime = FPlatformTime::Seconds();
+
+	FString JobContent;
+	TSharedPtr<FJsonObject> JobObject;
+	if (!FFileHelper::LoadFileToString(JobContent, *RunningPath) ||
+		!FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(JobContent), JobObject) || !JobObject.IsValid())
+	{
+		FinishJob(false, TEXT("Job spec is not valid JSON."));
+		return false;
+	}
+	JobObject->TryGetStringField(TEXT("JobId"), JobId);
+
+	TArray<FCaptureTake> JobTakes;
+	FString Error;
+	if (!ParseJob(JobObject, JobTakes, JobOutputs, Error))
+	{
+		FinishJob(false, Error);
+		return false;
+	}
+	StageTimings.Emplace(TEXT("Load"), FPlatformTime::Seconds() - JobStartTime);
+
+	UE_LOG(LogCaptureWorker, Log, TEXT("Starting job %s with %d takes."), *JobId, JobTakes.Num());
+	NumJobTakes = JobTakes.Num();
+	for (const FCaptureTake& Take : JobTakes)
+	{
+		FTakeStatus& TakeStatus = TakeStatuses.AddDefaulted_GetRef();
+		TakeStatus.TakeName = Take.TakeName;
+		TakeStatus.State = TEXT("pending");
+		for (const FString& Output : JobOutputs)
+		{
+			TakeStatus.OutputDirectories.Add(GetTakeOutputDirectory(Output, Take.TakeName));
+		}
+	}
+	JobState = TEXT("running");
+	MarkTakeStart();
+	WriteStatus();
+
+	TakeManager->QueueTakes(JobTakes);
+	return true;
+}
+
+bool ACaptureWorker::ParseJob(const TSharedPtr<FJsonObject>& JobObject, TArray<FCaptureTake>& OutTakes, TArray<FString>& OutOutputs, FString& OutError) const
+{
+	double FrameRate = 30.0;
+	JobObject->TryGetNumberField(TEXT("FrameRate"), FrameRate);
+	FrameRate = FMath::Max(FrameRate, 1.0);
+
+	if (!JobObject->TryGetStringArrayField(TEXT("Outputs"), OutOutputs))
+	{
+		OutOutputs = { TEXT("Keypoints") };
+	}
+	for (const FString& Output : OutOutputs)
+	{
+		if (GetTakeOutputDirectory(Output, FString()).IsEmpty())
+		{
+			OutError = FString::Printf(TEXT("Unknown output '%s', expected Keypoints, CameraData or CameraFrames."), *Output);
+			return false;
+		}
+	}
+
+	const TArray<TSharedPtr<FJsonValue>>* TakeArray = nullptr;
+	if (!JobObject->TryGetArrayField(TEXT("Takes"), TakeArray) || TakeArray->Num() == 0)
+	{
+		OutError = TEXT("Job spec has no 'Takes'.");
+		return false;
+	}
+
+	auto ReadVector = [](const TSharedPtr<FJsonObject>& Object, const TCHAR* Field, FVector& OutVector) -> bool
+	{
+		const TArray<TSharedPtr<FJsonValue>>* Values = nullptr;
+		if (!Object->TryGetArrayField(Field, Values) || Values->Num() != 3)
+		{
+			return false;
+		}
+		OutVector = FVector((*Values)[0]->AsNumber(), (*Values)[1]->AsNumber(), (*Values)[2]->AsNumber());
+		return true;
+	};
+
+	// Assets are loaded here, on the game thread, so a bad path fails the job before anything runs
+	bool bAssetsLoaded = true;
+	auto LoadAsset = [&OutError, &bAssetsLoaded](const TSharedPtr<FJsonObject>& Object, const TCHAR* Field, UClass* AssetClass) -> UObject*
+	{
+		FString AssetPath;
+		if (!Object->TryGetStringField(Field, AssetPath) || AssetPath.IsEmpty())
+		{
+			return nullptr;
+		}
+		UObject* Asset = StaticLoadObject(AssetClass, nullptr, *AssetPath);
+		if (!Asset)
+		{
+			OutError = FString::Printf(TEXT("Could not load %s '%s'."), Field, *AssetPath);
+			bAssetsLoaded = false;
+		}
+		return Asset;
+	};
+
+	for (const TSharedPtr<FJsonValue>& TakeValue : *TakeArray)
+	{
+		const TSharedPtr<FJsonObject> TakeObject = TakeValue.IsValid() ? TakeValue->AsObject() : nullptr;
+		if (!TakeObject.IsValid())
+		{
+			OutError = TEXT("Take is not an object.");
+			return false;
+		}
+
+		FCaptureTake& Take = OutTakes.AddDefaulted_GetRef();
+		if (!TakeObject->TryGetStringField(TEXT("TakeName"), Take.TakeName))
+		{
+			Take.TakeName = FString::Printf(TEXT("%s_Take%d"), *JobId, OutTakes.Num() - 1);
+		}
+		TakeObject->TryGetStringField(TEXT("RigFile"), Take.RigFilePath);
+
+		const TArray<TSharedPtr<FJsonValue>>* FrameRange = nullptr;
+		if (TakeObject->TryGetArrayField(TEXT("FrameRange"), FrameRange) && FrameRange->Num() == 2)
+		{
+			const double FirstFrame = (*FrameRange)[0]->AsNumber();
+			const double LastFrame = (*FrameRange)[1]->AsNumber();
+			Take.StartTime = FirstFrame / FrameRate;
+			Take.Duration = (LastFrame - FirstFrame + 1.0) / FrameRate;
+		}
+
+		const TArray<TSharedPtr<FJsonValue>>* SubjectArray = nullptr;
+		if (!TakeObject->TryGetArrayField(TEXT("Subjects"), SubjectArray))
+		{
+			OutError = FString::Printf(TEXT("Take '%s' has no 'Subjects'."), *Take.TakeName);
+			return false;
+		}
+
+		for (const TSharedPtr<FJsonValue>& SubjectValue : *SubjectArray)
+		{
+			const TSharedPtr<FJsonObject> SubjectObject = SubjectValue.IsValid() ? SubjectValue->AsObject() : nullptr;
+			if (!SubjectObject.IsValid())
+			{
+				continue;
+			}
+
+			FCaptureTakeSubject& Subject = Take.Subjects.AddDefaulted_GetRef();
+			Subject.BodyMesh = Cast<USkeletalMesh>(LoadAsset(SubjectObject, TEXT("BodyMesh"), USkeletalMesh::StaticClass()));
+			Subject.FaceMesh = Cast<USkeletalMesh>(LoadAsset(SubjectObject, TEXT("FaceMesh"), USkeletalMesh::StaticClass()));
+			Subject.BodyAnimation = Cast<UAnimationAsset>(LoadAsset(SubjectObject, TEXT("BodyAnimation"), UAnimationAsset::StaticClass()));
+			Subject.FaceAnimation = Cast<UAnimationAsset>(LoadAsset(SubjectObject, TEXT("FaceAnimation"), UAnimationAsset::StaticClass()));
+			if (!bAssetsLoaded)
+			{
+				return false;
+			}
+
+			FVector Location = FVector::ZeroVector;
+			FVector RotationValues = FVector::ZeroVector;
+			ReadVector(SubjectObject, TEXT("Location"), Location);
+			ReadVector(SubjectObject, TEXT("Rotation"), RotationValues);
+			Subject.Transform = FTransform(FRotator(RotationValues.X, RotationValues.Y, RotationValues.Z), Location);
+		}
+	}
+	return true;
+}
+
+void ACaptureWorker::HandleTakeFinished(const FString& TakeName)
+{
+	if (!bJobRunning)
+	{
+		return;
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	StageTimings.Emplace(FString::Printf(TEXT("Take:%s"), *TakeName), Now - TakeStartTime);
+
+	// A take only counts as done if it wrote every output the job asked for
+	if (FTakeStatus* TakeStatus = TakeStatuses.FindByPredicate([&TakeName](const FTakeStatus& Status) { return Status.TakeName == TakeName; }))
+	{
+		TakeStatus->Seconds = Now - TakeStartTime;
+		TakeStatus->State = TEXT("done");
+		for (const FString& OutputDirectory : TakeStatus->OutputDirectories)
+		{
+			if (!HasOutputSinceTakeStart(OutputDirectory))
+			{
+				TakeStatus->State = TEXT("failed");
+				TakeStatus->Error = FString::Printf(TEXT("Nothing was written to %s."), *OutputDirectory);
+				UE_LOG(LogCaptureWorker, Error, TEXT("Take %s of job %s failed: %s"), *TakeName, *JobId, *TakeStatus->Error);
+				break;
+			}
+		}
+	}
+	MarkTakeStart();
+	++NumFinishedTakes;
+	WriteStatus();
+}
+
+void ACaptureWorker::HandleAllTakesCompleted()
+{
+	if (!bJobRunning)
+	{
+		return;
+	}
+
+	const int32 NumFailedTakes = TakeStatuses.FilterByPredicate([](const FTakeStatus& Status) { return Status.State != TEXT("done"); }).Num();
+	if (NumFailedTakes > 0)
+	{
+		FinishJob(false, FString::Printf(TEXT("%d of %d takes failed."), NumFailedTakes, TakeStatuses.Num()));
+	}
+	else
+	{
+		FinishJob(true);
+	}
+}
+
+void ACaptureWorker::FinishJob(bool bSucceeded, const FString& Error)
+{
+	StageTimings.Emplace(TEXT("Total"), FPlatformTime::Seconds() - JobStartTime);
+	JobState = bSucceeded ? TEXT("done") : TEXT("failed");
+	bJobRunning = false;
+	++NumJobsCompleted;
+
+	if (!bSucceeded)
+	{
+		UE_LOG(LogCaptureWorker, Error, TEXT("Job %s failed: %s"), *JobId, *Error);
+	}
+	else
+	{
+		UE_LOG(LogCaptureWorker, Log, TEXT("Job %s done in %.2f s."), *JobId, StageTimings.Last().Value);
+	}
+
+	JobError = Error;
+	WriteStatus();
+
+	IFileManager::Get().Move(*FPaths::Combine(GetQueuePath(bSucceeded ? TEXT("done") : TEXT("failed")), JobFileName),
+		*FPaths::Combine(GetQueuePath(TEXT("running")), JobFileName));
+}
+
+void ACaptureWorker::WriteStatus()
+{
+	TSharedPtr<FJsonObject> StatusObject = MakeShareable(new FJsonObject);
+	StatusObject->SetStringField(TEXT("JobId"), JobId);
+	StatusObject->SetStringField(TEXT("State"), JobState);
+	StatusObject->SetNumberField(TEXT("TakesCompleted"), NumFinishedTakes);
+	StatusObject->SetNumberField(TEXT("NumTakes"), NumJobTakes);
+	StatusObject->SetNumberField(TEXT("TakeProgress"), TakeManager && bJobRunning ? TakeManager->GetTakeProgress() : 0.0);
+	StatusObject->SetNumberField(TEXT("ElapsedSeconds"), FPlatformTime::Seconds() - JobStartTime);
+	StatusObject->SetNumberField(TEXT("JobsCompletedByWorker"), NumJobsCompleted);
+	if (!JobError.IsEmpty())
+	{
+		StatusObject->SetStringField(TEXT("Error"), JobError);
+	}
+
+	TArray<TSharedPtr<FJsonValue>> StageArray;
+	for (const TPair<FString, double>& Stage : StageTimings)
+	{
+		TSharedPtr<FJsonObject> StageObject = MakeShareable(new FJsonObject);
+		StageObject->SetStringField(TEXT("Stage"), Stage.Key);
+		StageObject->SetNumberField(TEXT("Seconds"), Stage.Value);
+		StageArray.Add(MakeShareable(new FJsonValueObject(StageObject)));
+	}
+	StatusObject->SetArrayField(TEXT("Stages"), StageArray);
+
+	TArray<TSharedPtr<FJsonValue>> TakeArray;
+	for (const FTakeStatus& TakeStatus : TakeStatuses)
+	{
+		TSharedPtr<FJsonObject> TakeObject = MakeShareable(new FJsonObject);
+		TakeObject->SetStringField(TEXT("TakeName"), TakeStatus.TakeName);
+		TakeObject->SetStringField(TEXT("State"), TakeStatus.State);
+		TakeObject->SetNumberField(TEXT("Seconds"), TakeStatus.Seconds);
+		TArray<TSharedPtr<FJsonValue>> OutputArray;
+		for (const FString& OutputDirectory : TakeStatus.OutputDirectories)
+		{
+			OutputArray.Add(MakeShareable(new FJsonValueString(OutputDirectory)));
+		}
+		TakeObject->SetArrayField(TEXT("Outputs"), OutputArray);
+		if (!TakeStatus.Error.IsEmpty())
+		{
+			TakeObject->SetStringField(TEXT("Error"), TakeStatus.Error);
+		}
+		TakeArray.Add(MakeShareable(new FJsonValueObject(TakeObject)));
+	}
+	StatusObject->SetArrayField(TEXT("Takes"), TakeArray);
+
+	FString StatusContent;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&StatusContent);
+	FJsonSerializer::Serialize(StatusObject.ToSharedRef(), Writer);
+
+	// Write then rename, so readers never see a half-written status file
+	const FString StatusPath = FPaths::Combine(GetQueuePath(TEXT("status")), JobId + TEXT(".json"));
+	const FString TempPath = StatusPath + TEXT(".tmp");
+	if (FFileHelper::SaveStringToFile(StatusContent, *TempPath))
+	{
+		IFileManager::Get().Move(*StatusPath, *TempPath, true, true);
+	}
+}
+
+FString ACaptureWorker::GetQueuePath(const TCHAR* SubDirectory) const
+{
+	return FPaths::Combine(QueueRoot, SubDirectory);
+}
+
+bool ACaptureWorker::HasOutputSinceTakeStart(const FString& OutputDirectory) const
+{
+	TArray<FString> OutputFiles;
+	IFileManager::Get().FindFilesRecursive(OutputFiles, *OutputDirectory, TEXT("*"), true, false);
+	return OutputFiles.ContainsByPredicate([this](const FString& OutputFile) { return IFileManager::Get().GetTimeStamp(*OutputFile) >= TakeStartDate; });
+}
+
+void ACaptureWorker::MarkTakeStart()
+{
+	TakeStartTime = FPlatformTime::Seconds();
+	// File time stamps may only have second resolution
+	const FDateTime Now = FDateTime::UtcNow();
+	TakeStartDate = FDateTime(Now.GetTicks() - Now.GetTicks() % ETimespan::TicksPerSecond);
+}
+
+FString ACaptureWorker::GetTakeOutputDirectory(const FString& Output, const FString& TakeName)
+{
+	const TCHAR* Root = Output == TEXT("Keypoints") ? TEXT("KeypointStreams")
+		: Output == TEXT("CameraData") ? TEXT("CameraData")
+		: Output == TEXT("CameraFrames") ? TEXT("CameraFrames")
+		: nullptr;
+	return Root ? FPaths::ConvertRelativePathToFull(FPaths::Combine(FPaths::ProjectSavedDir(), Root, TakeName)) : FString();
+}
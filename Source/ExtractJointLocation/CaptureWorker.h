@@ -0,0 +1,124 @@
+// CaptureWorker.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "TakeManager.h"
+#include "CaptureWorker.generated.h"
+
+class FJsonObject;
+
+/**
+ * Long-running capture worker fed from a local directory queue, so one engine process serves many jobs.
+ *
+ * Queue layout (default Saved/CaptureQueue, or -CaptureQueue=<dir>):
+ *   pending/<JobId>.json   job specs dropped by the orchestrator, run in file name order
+ *   running/               the job being executed
+ *   done/, failed/         finished job specs
+ *   status/<JobId>.json    progress, per-stage timings and per-take status, rewritten atomically while the job runs
+ *
+ * Job spec:
+ *   { "JobId": "0001", "FrameRate": 30, "Outputs": ["Keypoints", "CameraData"],
+ *     "Takes": [ { "TakeName": "S01_Walk", "RigFile": "Rigs/dome32.json", "FrameRange": [0, 299],
+ *                  "Subjects": [ { "BodyMesh": "/Game/...", "FaceMesh": "/Game/...", "BodyAnimation": "/Game/...",
+ *                                  "FaceAnimation": "/Game/...", "Location": [0, 0, 0], "Rotation": [0, 0, 0] } ] } ] }
+ * FrameRange is optional (default: the whole animation) and converted to seconds with FrameRate.
+ * Outputs lists what every take must produce (default ["Keypoints"]): Keypoints (Saved/KeypointStreams/<TakeName>/),
+ * CameraData (Saved/CameraData/<TakeName>/) and CameraFrames (Saved/CameraFrames/<TakeName>/). A take that leaves
+ * one of them empty is failed, and a job with a failed take ends up in failed/.
+ * Takes are executed by TakeManager, which owns the take names and output paths. Do not place an ASkeletonCaptureDriver
+ * in the same level: it starts its own take on every subject and drives their animations from its own clock.
+ */
+UCLASS()
+class EXTRACTJOINTLOCATION_API ACaptureWorker : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	// Sets default values for this actor's properties
+	ACaptureWorker();
+
+protected:
+	// Called when the game starts or when spawned
+	virtual void BeginPlay() override;
+
+	// Marks a job that is still running as failed
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+public:
+	// Called every frame
+	virtual void Tick(float DeltaTime) override;
+
+protected:
+	/** Take manager that executes the jobs' takes. */
+	UPROPERTY(EditAnywhere, Category = "Capture Worker")
+	ATakeManager* TakeManager = nullptr;
+
+	/** Queue root directory; relative paths are resolved against the project's Saved directory. */
+	UPROPERTY(EditAnywhere, Category = "Capture Worker")
+	FString QueueDirectory = TEXT("CaptureQueue");
+
+	/** Seconds between scans of the pending directory while idle. */
+	UPROPERTY(EditAnywhere, Category = "Capture Worker", meta = (ClampMin = "0.01"))
+	float PollInterval = 0.5f;
+
+	/** Seconds between status file updates while a job runs. */
+	UPROPERTY(EditAnywhere, Category = "Capture Worker", meta = (ClampMin = "0.01"))
+	float StatusInterval = 1.0f;
+
+private:
+	UFUNCTION()
+	void HandleTakeFinished(const FString& TakeName);
+
+	UFUNCTION()
+	void HandleAllTakesCompleted();
+
+	// Moves the oldest pending job to running/ and hands its takes to the take manager
+	bool StartNextJob();
+	bool ParseJob(const TSharedPtr<FJsonObject>& JobObject, TArray<FCaptureTake>& OutTakes, TArray<FString>& OutOutputs, FString& OutError) const;
+	void FinishJob(bool bSucceeded, const FString& Error = FString());
+
+	void WriteStatus();
+	FString GetQueuePath(const TCHAR* SubDirectory) const;
+
+	// Directory a take writes an output (see the job spec's "Outputs") to, empty for unknown outputs
+	static FString GetTakeOutputDirectory(const FString& Output, const FString& TakeName);
+
+	// True if a file in the directory (or below) was written since the running take started
+	bool HasOutputSinceTakeStart(const FString& OutputDirectory) const;
+	void MarkTakeStart();
+
+	FString QueueRoot;
+	float TimeSinceLastPoll = 0.0f;
+	float TimeSinceLastStatus = 0.0f;
+
+	// Running job state
+	bool bJobRunning = false;
+	FString JobId;
+	FString JobFileName;
+	FString JobState;
+	FString JobError;
+	int32 NumJobTakes = 0;
+	int32 NumFinishedTakes = 0;
+	// Outputs every take of the job must produce
+	TArray<FString> JobOutputs;
+
+	struct FTakeStatus
+	{
+		FString TakeName;
+		// pending, done or failed
+		FString State;
+		double Seconds = 0.0;
+		TArray<FString> OutputDirectories;
+		FString Error;
+	};
+	TArray<FTakeStatus> TakeStatuses;
+
+	double JobStartTime = 0.0;
+	double TakeStartTime = 0.0;
+	// UTC start of the running take in whole seconds, older output files are left over from earlier runs
+	FDateTime TakeStartDate;
+	// Stage name and duration in seconds, in execution order
+	TArray<TPair<FString, double>> StageTimings;
+	int32 NumJobsCompleted = 0;
+};
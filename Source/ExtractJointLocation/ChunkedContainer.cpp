@@ -0,0 +1,415 @@
+#include "ChunkedContainer.h"
+#include "Algo/BinarySearch.h"
+#include "Async/ParallelFor.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Compression.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+#include <atomic>
+
+DEFINE_LOG_CATEGORY_STATIC(LogChunkedContainer, Log, All);
+
+FArchive& operator<<(FArchive& Ar, FChunkedRecord& Record)
+{
+	Ar << Record.FrameIndex;
+	Ar << Record.Name;
+	Ar << Record.Payload;
+	return Ar;
+}
+
+FArchive& operator<<(FArchive& Ar, FChunkedBlockInfo& Info)
+{
+	Ar << Info.FirstFrame;
+	Ar << Info.LastFrame;
+	Ar << Info.NumRecords;
+	Ar << Info.Offset;
+	Ar << Info.CompressedSize;
+	Ar << Info.UncompressedSize;
+	Ar << Info.bCompressed;
+	return Ar;
+}
+
+FChunkedContainerWriter::FChunkedContainerWriter(FName InCompressionFormat, int32 InFramesPerBlock, int32 InMaxBlockBytes, int32 InMaxBlocksInFlight)
+	: CompressionFormat(InCompressionFormat)
+	, FramesPerBlock(FMath::Max(InFramesPerBlock, 1))
+	, MaxBlockBytes(FMath::Max(InMaxBlockBytes, 1024))
+	, MaxBlocksInFlight(FMath::Max(InMaxBlocksInFlight, 1))
+{
+	if (!FCompression::IsFormatValid(CompressionFormat))
+	{
+		UE_LOG(LogChunkedContainer, Warning, TEXT("Compression format %s is not available, using Zlib."), *CompressionFormat.ToString());
+		CompressionFormat = NAME_Zlib;
+	}
+}
+
+FChunkedContainerWriter::~FChunkedContainerWriter()
+{
+	Close();
+}
+
+bool FChunkedContainerWriter::Open(const FString& InFilePath)
+{
+	Close();
+	FilePath = InFilePath;
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	const FString DirectoryPath = FPaths::GetPath(FilePath);
+	if (!PlatformFile.DirectoryExists(*DirectoryPath))
+	{
+		PlatformFile.CreateDirectoryTree(*DirectoryPath);
+	}
+
+	FileHandle.Reset(PlatformFile.OpenWrite(*FilePath));
+	if (!FileHandle.IsValid())
+	{
+		UE_LOG(LogChunkedContainer, Error, TEXT("Open: Failed to open container for writing: %s"), *FilePath);
+		return false;
+	}
+
+	TArray<uint8> HeaderBytes;
+	FMemoryWriter Writer(HeaderBytes);
+	uint32 HeaderMagic = Magic;
+	uint16 Version = CurrentVersion;
+	FString FormatString = CompressionFormat.ToString();
+	Writer << HeaderMagic << Version << FormatString << FramesPerBlock;
+
+	Blocks.Reset();
+	BlockBuffer.Reset();
+	BlockNumRecords = 0;
+	FileOffset = HeaderBytes.Num();
+	return FileHandle->Write(HeaderBytes.GetData(), HeaderBytes.Num());
+}
+
+bool FChunkedContainerWriter::AddRecord(int32 FrameIndex, const FString& Name, TArray<uint8>&& Payload, int32* OutBlockIndex, int32* OutRecordIndex)
+{
+	if (!FileHandle.IsValid())
+	{
+		return false;
+	}
+
+	if (BlockNumRecords > 0 && (FrameIndex >= BlockFirstFrame + FramesPerBlock || FrameIndex < BlockFirstFrame || BlockBuffer.Num() >= MaxBlockBytes))
+	{
+		SealBlock();
+	}
+
+	if (BlockNumRecords == 0)
+	{
+		BlockFirstFrame = FrameIndex;
+		BlockLastFrame = FrameIndex;
+	}
+
+	FChunkedRecord Record;
+	Record.FrameIndex = FrameIndex;
+	Record.Name = Name;
+	Record.Payload = MoveTemp(Payload);
+
+	FMemoryWriter Writer(BlockBuffer, false, true);
+	Writer << Record;
+
+	if (OutBlockIndex)
+	{
+		*OutBlockIndex = Blocks.Num() + PendingBlocks.Num();
+	}
+	if (OutRecordIndex)
+	{
+		*OutRecordIndex = BlockNumRecords;
+	}
+
+	BlockLastFrame = FMath::Max(BlockLastFrame, FrameIndex);
+	++BlockNumRecords;
+
+	return WriteCompletedBlocks(false);
+}
+
+void FChunkedContainerWriter::Flush()
+{
+	if (BlockNumRecords > 0)
+	{
+		SealBlock();
+	}
+}
+
+void FChunkedContainerWriter::SealBlock()
+{
+	FChunkedBlockInfo Info;
+	Info.FirstFrame = BlockFirstFrame;
+	Info.LastFrame = BlockLastFrame;
+	Info.NumRecords = BlockNumRecords;
+	Info.UncompressedSize = BlockBuffer.Num();
+
+	// The worker takes ownership of the block bytes; compression runs off the calling thread
+	PendingBlocks.Add(UE::Tasks::Launch(UE_SOURCE_LOCATION,
+		[Info, Uncompressed = MoveTemp(BlockBuffer), Format = CompressionFormat]() mutable
+		{
+			FCompressedBlock Block;
+			Block.Info = Info;
+
+			int32 CompressedSize = FCompression::CompressMemoryBound(Format, Uncompressed.Num());
+			Block.Data.SetNumUninitialized(CompressedSize);
+			if (FCompression::CompressMemory(Format, Block.Data.GetData(), CompressedSize, Uncompressed.GetData(), Uncompressed.Num())
+				&& CompressedSize < Uncompressed.Num())
+			{
+				Block.Data.SetNum(CompressedSize, EAllowShrinking::No);
+				Block.Info.bCompressed = true;
+			}
+			else
+			{
+				Block.Data = MoveTemp(Uncompressed);
+				Block.Info.bCompressed = false;
+			}
+			Block.Info.CompressedSize = Block.Data.Num();
+			return Block;
+		}));
+
+	BlockBuffer = TArray<uint8>();
+	BlockNumRecords = 0;
+
+	// Bound memory: wait for the oldest block once too many are in flight
+	if (PendingBlocks.Num() > MaxBlocksInFlight)
+	{
+		PendingBlocks[0].Wait();
+	}
+}
+
+bool FChunkedContainerWriter::WriteCompletedBlocks(bool bWaitForAll)
+{
+	bool bSuccess = true;
+	int32 NumWritten = 0;
+	for (; NumWritten < PendingBlocks.Num(); ++NumWritten)
+	{
+		UE::Tasks::TTask<FCompressedBlock>& Task = PendingBlocks[NumWritten];
+		if (!bWaitForAll && !Task.IsCompleted())
+		{
+			break;
+		}
+
+		FCompressedBlock& Block = Task.GetResult();
+		Block.Info.Offset = FileOffset;
+		if (!FileHandle->Write(Block.Data.GetData(), Block.Data.Num()))
+		{
+			UE_LOG(LogChunkedContainer, Error, TEXT("Failed to write block %d to %s"), Blocks.Num(), *FilePath);
+			bSuccess = false;
+		}
+		FileOffset += Block.Data.Num();
+		Blocks.Add(Block.Info);
+	}
+	PendingBlocks.RemoveAt(0, NumWritten);
+	return bSuccess;
+}
+
+bool FChunkedContainerWriter::Close()
+{
+	if (!FileHandle.IsValid())
+	{
+		return false;
+	}
+
+	Flush();
+	bool bSuccess = WriteCompletedBlocks(true);
+
+	TArray<uint8> IndexBytes;
+	FMemoryWriter Writer(IndexBytes);
+	Writer << Blocks;
+	int64 IndexOffset = FileOffset;
+	uint32 FooterMagic = Magic;
+	Writer << IndexOffset << FooterMagic;
+
+	bSuccess &= FileHandle->Write(IndexBytes.GetData(), IndexBytes.Num());
+	bSuccess &= FileHandle->Flush();
+	FileHandle.Reset();
+
+	UE_LOG(LogChunkedContainer, Log, TEXT("Closed container %s (%d blocks, %lld bytes)."), *FilePath, Blocks.Num(), FileOffset + IndexBytes.Num());
+	return bSuccess;
+}
+
+FChunkedContainerReader::~FChunkedContainerReader()
+{
+	Close();
+}
+
+bool FChunkedContainerReader::Open(const FString& FilePath)
+{
+	Close();
+
+	FileHandle.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*FilePath));
+	if (!FileHandle.IsValid())
+	{
+		UE_LOG(LogChunkedContainer, Error, TEXT("Open: Failed to open container: %s"), *FilePath);
+		return false;
+	}
+
+	// Header: magic, version, compression format, frames per block
+	TArray<uint8> HeaderBytes;
+	HeaderBytes.SetNumUninitialized(FMath::Min<int64>(FileHandle->Size(), 256));
+	FileHandle->Read(HeaderBytes.GetData(), HeaderBytes.Num());
+	FMemoryReader HeaderReader(HeaderBytes);
+	uint32 HeaderMagic = 0;
+	uint16 Version = 0;
+	FString FormatString;
+	HeaderReader << HeaderMagic << Version << FormatString << FramesPerBlock;
+	if (HeaderReader.IsError() || HeaderMagic != FChunkedContainerWriter::Magic || Version > FChunkedContainerWriter::CurrentVersion)
+	{
+		UE_LOG(LogChunkedContainer, Error, TEXT("Open: %s is not a chunked container."), *FilePath);
+		Close();
+		return false;
+	}
+	CompressionFormat = FName(*FormatString);
+
+	// Footer: index offset and magic
+	const int64 FooterSize = sizeof(int64) + sizeof(uint32);
+	const int64 FileSize = FileHandle->Size();
+	TArray<uint8> FooterBytes;
+	FooterBytes.SetNumUninitialized(FooterSize);
+	int64 IndexOffset = 0;
+	uint32 FooterMagic = 0;
+	if (FileSize >= FooterSize && FileHandle->Seek(FileSize - FooterSize) && FileHandle->Read(FooterBytes.GetData(), FooterSize))
+	{
+		FMemoryReader FooterReader(FooterBytes);
+		FooterReader << IndexOffset << FooterMagic;
+	}
+	if (FooterMagic != FChunkedContainerWriter::Magic || IndexOffset <= 0 || IndexOffset > FileSize - FooterSize)
+	{
+		UE_LOG(LogChunkedContainer, Error, TEXT("Open: %s has no block index (was the writer closed?)."), *FilePath);
+		Close();
+		return false;
+	}
+
+	TArray<uint8> IndexBytes;
+	IndexBytes.SetNumUninitialized(FileSize - FooterSize - IndexOffset);
+	if (!FileHandle->Seek(IndexOffset) || !FileHandle->Read(IndexBytes.GetData(), IndexBytes.Num()))
+	{
+		Close();
+		return false;
+	}
+	FMemoryReader IndexReader(IndexBytes);
+	IndexReader << Blocks;
+
+	// Blocks stay in file order for sequential reads; frame lookups check whether that is also frame order
+	bBlocksInFrameOrder = true;
+	for (int32 i = 1; i < Blocks.Num(); ++i)
+	{
+		bBlocksInFrameOrder &= Blocks[i].FirstFrame >= Blocks[i - 1].FirstFrame && Blocks[i].LastFrame >= Blocks[i - 1].LastFrame;
+	}
+	if (!bBlocksInFrameOrder)
+	{
+		UE_LOG(LogChunkedContainer, Log, TEXT("Open: Blocks of %s are not in frame order, frame lookups scan the index."), *FilePath);
+	}
+	return !IndexReader.IsError();
+}
+
+void FChunkedContainerReader::Close()
+{
+	FileHandle.Reset();
+	Blocks.Reset();
+}
+
+int32 FChunkedContainerReader::FindBlockAtOffset(int64 Offset) const
+{
+	const int32 Candidate = Algo::LowerBoundBy(Blocks, Offset, &FChunkedBlockInfo::Offset);
+	return (Blocks.IsValidIndex(Candidate) && Blocks[Candidate].Offset == Offset) ? Candidate : INDEX_NONE;
+}
+
+int32 FChunkedContainerReader::FindBlockForFrame(int32 FrameIndex) const
+{
+	if (!bBlocksInFrameOrder)
+	{
+		return Blocks.IndexOfByPredicate([FrameIndex](const FChunkedBlockInfo& Info) { return Info.FirstFrame <= FrameIndex && FrameIndex <= Info.LastFrame; });
+	}
+
+	// With non-decreasing frame ranges a binary search on the last frame finds the candidate
+	const int32 Candidate = Algo::LowerBound(Blocks, FrameIndex, [](const FChunkedBlockInfo& Info, int32 Frame) { return Info.LastFrame < Frame; });
+	return (Blocks.IsValidIndex(Candidate) && Blocks[Candidate].FirstFrame <= FrameIndex) ? Candidate : INDEX_NONE;
+}
+
+bool FChunkedContainerReader::ReadBlocks(int32 FirstBlock, int32 NumBlocks, TArray<TArray<FChunkedRecord>>& OutRecords)
+{
+	if (!FileHandle.IsValid() || NumBlocks <= 0 || !Blocks.IsValidIndex(FirstBlock) || !Blocks.IsValidIndex(FirstBlock + NumBlocks - 1))
+	{
+		return false;
+	}
+
+	// Blocks are contiguous on disk: one sequential read covers the whole run
+	const FChunkedBlockInfo& First = Blocks[FirstBlock];
+	const FChunkedBlockInfo& Last = Blocks[FirstBlock + NumBlocks - 1];
+	TArray<uint8> CompressedBytes;
+	CompressedBytes.SetNumUninitialized(Last.Offset + Last.CompressedSize - First.Offset);
+	if (!FileHandle->Seek(First.Offset) || !FileHandle->Read(CompressedBytes.GetData(), CompressedBytes.Num()))
+	{
+		return false;
+	}
+
+	OutRecords.SetNum(NumBlocks);
+	std::atomic<bool> bSuccess(true);
+	ParallelFor(NumBlocks, [&](int32 i)
+	{
+		const FChunkedBlockInfo& Info = Blocks[FirstBlock + i];
+		if (!DecodeBlock(Info, CompressedBytes.GetData() + (Info.Offset - First.Offset), OutRecords[i]))
+		{
+			bSuccess = false;
+		}
+	});
+	return bSuccess;
+}
+
+bool FChunkedContainerReader::ReadFrameRange(int32 FirstFrame, int32 LastFrame, TArray<FChunkedRecord>& OutRecords)
+{
+	int32 FirstBlock = INDEX_NONE;
+	int32 EndBlock = 0;
+	for (int32 i = 0; i < Blocks.Num(); ++i)
+	{
+		if (Blocks[i].LastFrame >= FirstFrame && Blocks[i].FirstFrame <= LastFrame)
+		{
+			FirstBlock = FirstBlock == INDEX_NONE ? i : FirstBlock;
+			EndBlock = i + 1;
+		}
+	}
+	if (FirstBlock == INDEX_NONE)
+	{
+		return true;
+	}
+
+	TArray<TArray<FChunkedRecord>> BlockRecords;
+	if (!ReadBlocks(FirstBlock, EndBlock - FirstBlock, BlockRecords))
+	{
+		return false;
+	}
+
+	for (TArray<FChunkedRecord>& Records : BlockRecords)
+	{
+		for (FChunkedRecord& Record : Records)
+		{
+			if (Record.FrameIndex >= FirstFrame && Record.FrameIndex <= LastFrame)
+			{
+				OutRecords.Add(MoveTemp(Record));
+			}
+		}
+	}
+	return true;
+}
+
+bool FChunkedContainerReader::DecodeBlock(const FChunkedBlockInfo& Info, const uint8* CompressedData, TArray<FChunkedRecord>& OutRecords) const
+{
+	TArray<uint8> Uncompressed;
+	if (Info.bCompressed)
+	{
+		Uncompressed.SetNumUninitialized(Info.UncompressedSize);
+		if (!FCompression::UncompressMemory(CompressionFormat, Uncompressed.GetData(), Info.UncompressedSize, CompressedData, Info.CompressedSize))
+		{
+			UE_LOG(LogChunkedContainer, Error, TEXT("Failed to decompress block at offset %lld."), Info.Offset);
+			return false;
+		}
+	}
+	else
+	{
+		Uncompressed.Append(CompressedData, Info.CompressedSize);
+	}
+
+	FMemoryReader Reader(Uncompressed);
+	OutRecords.SetNum(Info.NumRecords);
+	for (FChunkedRecord& Record : OutRecords)
+	{
+		Reader << Record;
+	}
+	return !Reader.IsError();
+}
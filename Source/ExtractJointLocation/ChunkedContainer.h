@@ -0,0 +1,143 @@
+// ChunkedContainer.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tasks/Task.h"
+
+class IFileHandle;
+
+// One named payload (a JSON file, an image, a stream chunk...) belonging to a capture frame
+struct EXTRACTJOINTLOCATION_API FChunkedRecord
+{
+	int32 FrameIndex = 0;
+	FString Name;
+	TArray<uint8> Payload;
+
+	friend FArchive& operator<<(FArchive& Ar, FChunkedRecord& Record);
+};
+
+// Index entry describing where a compressed block lives in the container file
+struct EXTRACTJOINTLOCATION_API FChunkedBlockInfo
+{
+	int32 FirstFrame = 0;
+	int32 LastFrame = 0;
+	int32 NumRecords = 0;
+	int64 Offset = 0;
+	int32 CompressedSize = 0;
+	int32 UncompressedSize = 0;
+	// False if compression did not shrink the block and it was stored as is
+	bool bCompressed = false;
+
+	friend FArchive& operator<<(FArchive& Ar, FChunkedBlockInfo& Info);
+};
+
+/**
+ * Container file grouping the records of many frames into fixed-size blocks.
+ * Layout: [header][block 0][block 1]...[block index][index offset (int64)][magic (uint32)].
+ * Blocks are compressed on worker threads and written in order, so record order is preserved.
+ */
+class EXTRACTJOINTLOCATION_API FChunkedContainerWriter
+{
+public:
+	/**
+	 * @param CompressionFormat Any format registered with FCompression (NAME_Oodle, NAME_Zlib, NAME_LZ4...).
+	 * Falls back to NAME_Zlib if the format is not available.
+	 * @param FramesPerBlock Number of consecutive frames grouped into one block.
+	 * @param MaxBlockBytes A block is sealed early once its records exceed this size.
+	 * @param MaxBlocksInFlight Blocks being compressed at once before AddRecord waits for the oldest.
+	 */
+	FChunkedContainerWriter(FName CompressionFormat, int32 FramesPerBlock = 64, int32 MaxBlockBytes = 64 * 1024 * 1024, int32 MaxBlocksInFlight = 8);
+	~FChunkedContainerWriter();
+
+	bool Open(const FString& FilePath);
+
+	/**
+	 * Appends a record. Must be called from one thread at a time, with non-decreasing frame indices per block.
+	 * @param OutBlockIndex If set, receives the index (in GetBlocks() once written) of the block holding the record.
+	 * @param OutRecordIndex If set, receives the position of the record inside its block.
+	 */
+	bool AddRecord(int32 FrameIndex, const FString& Name, TArray<uint8>&& Payload, int32* OutBlockIndex = nullptr, int32* OutRecordIndex = nullptr);
+
+	/** Seals and compresses the current block without waiting for it to be written. */
+	void Flush();
+
+	/** Waits for all blocks, writes the block index and closes the file. */
+	bool Close();
+
+	bool IsOpen() const { return FileHandle.IsValid(); }
+	const FString& GetFilePath() const { return FilePath; }
+	const TArray<FChunkedBlockInfo>& GetBlocks() const { return Blocks; }
+
+	static constexpr uint32 Magic = 0x434C4A45; // "EJLC"
+	static constexpr uint16 CurrentVersion = 1;
+
+private:
+	struct FCompressedBlock
+	{
+		FChunkedBlockInfo Info;
+		TArray<uint8> Data;
+	};
+
+	void SealBlock();
+	// Writes finished blocks in order; waits for all of them if bWaitForAll, otherwise only drains completed ones
+	bool WriteCompletedBlocks(bool bWaitForAll);
+
+	FName CompressionFormat;
+	int32 FramesPerBlock;
+	int32 MaxBlockBytes;
+	int32 MaxBlocksInFlight;
+
+	TUniquePtr<IFileHandle> FileHandle;
+	FString FilePath;
+	int64 FileOffset = 0;
+
+	// Block being filled on the calling thread
+	TArray<uint8> BlockBuffer;
+	int32 BlockFirstFrame = 0;
+	int32 BlockLastFrame = 0;
+	int32 BlockNumRecords = 0;
+
+	TArray<UE::Tasks::TTask<FCompressedBlock>> PendingBlocks;
+	TArray<FChunkedBlockInfo> Blocks;
+};
+
+/** Random-access reader for FChunkedContainerWriter files with parallel block decompression. */
+class EXTRACTJOINTLOCATION_API FChunkedContainerReader
+{
+public:
+	~FChunkedContainerReader();
+
+	/** Opens the container and reads its block index. */
+	bool Open(const FString& FilePath);
+	void Close();
+
+	const TArray<FChunkedBlockInfo>& GetBlocks() const { return Blocks; }
+
+	/** Index of the block starting at the given file offset, or INDEX_NONE. */
+	int32 FindBlockAtOffset(int64 Offset) const;
+
+	/**
+	 * Index of the first block whose frame range contains FrameIndex, or INDEX_NONE.
+	 * Binary search if the blocks are in frame order, which they are unless frames were added out of order.
+	 */
+	int32 FindBlockForFrame(int32 FrameIndex) const;
+
+	/**
+	 * Reads a run of consecutive blocks with one sequential read and decompresses them in parallel.
+	 * @param OutRecords One array of records per block read.
+	 */
+	bool ReadBlocks(int32 FirstBlock, int32 NumBlocks, TArray<TArray<FChunkedRecord>>& OutRecords);
+
+	/** Returns every record whose frame lies in [FirstFrame, LastFrame]. */
+	bool ReadFrameRange(int32 FirstFrame, int32 LastFrame, TArray<FChunkedRecord>& OutRecords);
+
+private:
+	bool DecodeBlock(const FChunkedBlockInfo& Info, const uint8* CompressedData, TArray<FChunkedRecord>& OutRecords) const;
+
+	TUniquePtr<IFileHandle> FileHandle;
+	FName CompressionFormat;
+	int32 FramesPerBlock = 0;
+	TArray<FChunkedBlockInfo> Blocks;
+	// True if the blocks' first and last frames never decrease in file order
+	bool bBlocksInFrameOrder = true;
+};
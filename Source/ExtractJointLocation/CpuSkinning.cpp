@@ -0,0 +1,158 @@
+#include "CpuSkinning.h"
+#include "Components/SkinnedMeshComponent.h"
+#include "Engine/SkeletalMesh.h"
+#include "Rendering/SkeletalMeshRenderData.h"
+#include "Rendering/SkeletalMeshLODRenderData.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogCpuSkinning, Log, All);
+
+bool FCpuSkinningBinding::Begin(const USkeletalMesh* SkeletalMesh)
+{
+	BindPositions.Reset();
+	InfluenceStarts.Reset();
+	InfluenceStarts.Add(0);
+	InfluenceBones.Reset();
+	InfluenceWeights.Reset();
+	UsedBones.Reset();
+	InverseBindMatrices.Reset();
+	VertexSlots.Reset();
+	BoneSlots.Reset();
+	NumMeshVertices = 0;
+
+	const FSkeletalMeshRenderData* RenderData = SkeletalMesh ? SkeletalMesh->GetResourceForRendering() : nullptr;
+	if (!RenderData || RenderData->LODRenderData.Num() == 0)
+	{
+		UE_LOG(LogCpuSkinning, Error, TEXT("Begin: %s has no render data."), SkeletalMesh ? *SkeletalMesh->GetName() : TEXT("None"));
+		return false;
+	}
+
+	LODData = &RenderData->LODRenderData[0];
+	SkinWeightBuffer = LODData->GetSkinWeightVertexBuffer();
+	const FPositionVertexBuffer& PositionBuffer = LODData->StaticVertexBuffers.PositionVertexBuffer;
+	if (!PositionBuffer.GetVertexData() || !SkinWeightBuffer || SkinWeightBuffer->GetNumVertices() != PositionBuffer.GetNumVertices())
+	{
+		UE_LOG(LogCpuSkinning, Error, TEXT("Begin: The vertex data of %s is not available on the CPU, enable 'Allow CPU Access' on the mesh."), *SkeletalMesh->GetName());
+		End();
+		return false;
+	}
+
+	NumMeshVertices = static_cast<int32>(PositionBuffer.GetNumVertices());
+	RefBasesInvMatrix = &SkeletalMesh->GetRefBasesInvMatrix();
+	return true;
+}
+
+int32 FCpuSkinningBinding::AddVertex(int32 VertexIndex)
+{
+	check(LODData && VertexIndex >= 0 && VertexIndex < NumMeshVertices);
+	if (const int32* ExistingSlot = VertexSlots.Find(VertexIndex))
+	{
+		return *ExistingSlot;
+	}
+
+	const int32 Slot = BindPositions.Add(FVector4f(LODData->StaticVertexBuffers.PositionVertexBuffer.VertexPosition(VertexIndex), 1.0f));
+	VertexSlots.Add(VertexIndex, Slot);
+
+	// Influence bone indices are relative to the vertex's render section
+	int32 SectionIndex = 0;
+	int32 SectionVertexIndex = 0;
+	LODData->GetSectionFromVertexIndex(VertexIndex, SectionIndex, SectionVertexIndex);
+	const TArray<FBoneIndexType>& BoneMap = LODData->RenderSections[SectionIndex].BoneMap;
+
+	const int32 FirstInfluence = InfluenceBones.Num();
+	float TotalWeight = 0.0f;
+	for (uint32 InfluenceIndex = 0; InfluenceIndex < SkinWeightBuffer->GetMaxBoneInfluences(); ++InfluenceIndex)
+	{
+		const float Weight = static_cast<float>(SkinWeightBuffer->GetBoneWeight(VertexIndex, InfluenceIndex));
+		if (Weight <= 0.0f)
+		{
+			continue;
+		}
+
+		const int32 BoneIndex = BoneMap[SkinWeightBuffer->GetBoneIndex(VertexIndex, InfluenceIndex)];
+		int32* BoneSlot = BoneSlots.Find(BoneIndex);
+		if (!BoneSlot)
+		{
+			BoneSlot = &BoneSlots.Add(BoneIndex, UsedBones.Add(BoneIndex));
+			InverseBindMatrices.Add((*RefBasesInvMatrix)[BoneIndex]);
+		}
+		InfluenceBones.Add(*BoneSlot);
+		InfluenceWeights.Add(Weight);
+		TotalWeight += Weight;
+	}
+
+	// Stored weights are quantized integers, normalize them
+	for (int32 InfluenceIndex = FirstInfluence; InfluenceIndex < InfluenceWeights.Num(); ++InfluenceIndex)
+	{
+		InfluenceWeights[InfluenceIndex] /= TotalWeight;
+	}
+	InfluenceStarts.Add(InfluenceBones.Num());
+	return Slot;
+}
+
+void FCpuSkinningBinding::End()
+{
+	LODData = nullptr;
+	SkinWeightBuffer = nullptr;
+	RefBasesInvMatrix = nullptr;
+	VertexSlots.Empty();
+	BoneSlots.Empty();
+}
+
+bool FCpuSkinningBinding::ComputeSkinningMatrices(const USkinnedMeshComponent* MeshComponent, TArray<FMatrix44f>& OutMatrices) const
+{
+	if (!MeshComponent)
+	{
+		return false;
+	}
+
+	// Follower components have no pose of their own and map their bones onto the leader's
+	const USkinnedMeshComponent* PoseComponent = MeshComponent->LeaderPoseComponent.IsValid() ? MeshComponent->LeaderPoseComponent.Get() : MeshComponent;
+	const TArray<int32>& LeaderBoneMap = MeshComponent->GetLeaderBoneMap();
+	const TArray<FTransform>& ComponentSpaceTransforms = PoseComponent->GetComponentSpaceTransforms();
+
+	OutMatrices.SetNumUninitialized(UsedBones.Num());
+	for (int32 BoneSlot = 0; BoneSlot < UsedBones.Num(); ++BoneSlot)
+	{
+		int32 BoneIndex = UsedBones[BoneSlot];
+		if (PoseComponent != MeshComponent)
+		{
+			BoneIndex = LeaderBoneMap.IsValidIndex(BoneIndex) ? LeaderBoneMap[BoneIndex] : INDEX_NONE;
+		}
+		if (!ComponentSpaceTransforms.IsValidIndex(BoneIndex))
+		{
+			return false;
+		}
+
+		OutMatrices[BoneSlot] = FMatrix44f(FMatrix(InverseBindMatrices[BoneSlot]) * ComponentSpaceTransforms[BoneIndex].ToMatrixWithScale());
+	}
+	return true;
+}
+
+void FCpuSkinningBinding::SkinVertices(TArrayView<const FMatrix44f> SkinningMatrices, int32 FirstSlot, int32 NumSlots, FVector4f* OutPositions) const
+{
+	const FMatrix44f* Matrices = SkinningMatrices.GetData();
+	for (int32 i = 0; i < NumSlots; ++i)
+	{
+		const int32 Slot = FirstSlot + i;
+		VectorRegister4Float Row0 = VectorZeroFloat();
+		VectorRegister4Float Row1 = VectorZeroFloat();
+		VectorRegister4Float Row2 = VectorZeroFloat();
+		VectorRegister4Float Row3 = VectorZeroFloat();
+
+		for (int32 Influence = InfluenceStarts[Slot]; Influence < InfluenceStarts[Slot + 1]; ++Influence)
+		{
+			const FMatrix44f& Matrix = Matrices[InfluenceBones[Influence]];
+			const VectorRegister4Float Weight = VectorSetFloat1(InfluenceWeights[Influence]);
+			Row0 = VectorMultiplyAdd(Weight, VectorLoad(Matrix.M[0]), Row0);
+			Row1 = VectorMultiplyAdd(Weight, VectorLoad(Matrix.M[1]), Row1);
+			Row2 = VectorMultiplyAdd(Weight, VectorLoad(Matrix.M[2]), Row2);
+			Row3 = VectorMultiplyAdd(Weight, VectorLoad(Matrix.M[3]), Row3);
+		}
+
+		const VectorRegister4Float BindPosition = VectorLoad(&BindPositions[Slot].X);
+		const VectorRegister4Float Skinned = VectorMultiplyAdd(VectorReplicate(BindPosition, 0), Row0,
+			VectorMultiplyAdd(VectorReplicate(BindPosition, 1), Row1,
+			VectorMultiplyAdd(VectorReplicate(BindPosition, 2), Row2, Row3)));
+		VectorStore(Skinned, &OutPositions[i].X);
+	}
+}
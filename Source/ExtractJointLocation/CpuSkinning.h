@@ -0,0 +1,69 @@
+// CpuSkinning.h
+#pragma once
+
+#include "CoreMinimal.h"
+
+class USkeletalMesh;
+class USkinnedMeshComponent;
+class FSkeletalMeshLODRenderData;
+class FSkinWeightVertexBuffer;
+
+/**
+ * Bind data of a subset of a skeletal mesh's LOD 0 vertices, for linear blend skinning on the CPU.
+ * Vertices are added once on the game thread; afterwards the binding is immutable and SkinVertices can run
+ * on any thread. Morph targets and cloth are not applied.
+ */
+class EXTRACTJOINTLOCATION_API FCpuSkinningBinding
+{
+public:
+	/**
+	 * Starts reading vertices of SkeletalMesh; the mesh must keep its vertex data on the CPU ("Allow CPU Access"
+	 * in cooked builds).
+	 * @return False if the mesh has no CPU vertex data.
+	 */
+	bool Begin(const USkeletalMesh* SkeletalMesh);
+
+	/** Adds a vertex if it was not added yet and returns its slot. Only valid between Begin and End. */
+	int32 AddVertex(int32 VertexIndex);
+
+	/** Stops reading from the mesh. */
+	void End();
+
+	int32 GetNumMeshVertices() const { return NumMeshVertices; }
+	int32 GetNumVertices() const { return BindPositions.Num(); }
+	int32 GetNumBones() const { return UsedBones.Num(); }
+
+	/**
+	 * Skinning matrix (inverse bind pose * current pose) of every bone influencing an added vertex, from the
+	 * component's pose or, for follower components, its leader's. Skinned positions are in component space; callers
+	 * apply the component's transform in double precision, float matrices lose precision far from the origin.
+	 */
+	bool ComputeSkinningMatrices(const USkinnedMeshComponent* MeshComponent, TArray<FMatrix44f>& OutMatrices) const;
+
+	/**
+	 * Skins the vertex slots [FirstSlot, FirstSlot + NumSlots). Each vertex blends the rows of its bones' matrices
+	 * with 4-wide multiply-adds, then transforms its bind position: P * M = x * Row0 + y * Row1 + z * Row2 + Row3.
+	 * @param OutPositions Receives NumSlots positions; W is unspecified.
+	 */
+	void SkinVertices(TArrayView<const FMatrix44f> SkinningMatrices, int32 FirstSlot, int32 NumSlots, FVector4f* OutPositions) const;
+
+private:
+	// Bind positions (w = 1) and influences [InfluenceStarts[i], InfluenceStarts[i + 1]) per slot
+	TArray<FVector4f> BindPositions;
+	TArray<int32> InfluenceStarts;
+	// Influence bone as an index into UsedBones, weights normalized
+	TArray<int32> InfluenceBones;
+	TArray<float> InfluenceWeights;
+
+	// Reference skeleton bones influencing any added vertex, and their inverse bind matrices
+	TArray<int32> UsedBones;
+	TArray<FMatrix44f> InverseBindMatrices;
+	int32 NumMeshVertices = 0;
+
+	// Only set while adding vertices
+	const FSkeletalMeshLODRenderData* LODData = nullptr;
+	const FSkinWeightVertexBuffer* SkinWeightBuffer = nullptr;
+	const TArray<FMatrix44f>* RefBasesInvMatrix = nullptr;
+	TMap<int32, int32> VertexSlots;
+	TMap<int32, int32> BoneSlots;
+};
@@ -0,0 +1,385 @@
+#include "DenseVertexStream.h"
+#include "Async/ParallelFor.h"
+#include "Engine/SkeletalMesh.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryWriter.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogDenseVertexStream, Log, All);
+
+namespace DenseVertexStream
+{
+	// Frame index and time
+	static constexpr int64 FrameHeaderSize = sizeof(int32) + sizeof(float);
+	static constexpr int64 VertexSize = 3 * sizeof(uint16);
+
+	static int64 GetChunkHeaderSize(EDenseVertexEncoding Encoding)
+	{
+		return (Encoding == EDenseVertexEncoding::Quantized16 ? 6 : 3) * sizeof(float);
+	}
+
+	static int64 GetChunkOffset(const FDenseVertexStreamHeader& Header, int32 ChunkIndex)
+	{
+		return FrameHeaderSize + ChunkIndex * (GetChunkHeaderSize(Header.Encoding) + Header.ChunkSize * VertexSize);
+	}
+
+	static void EncodeChunk(EDenseVertexEncoding Encoding, const FVector4f* Positions, int32 NumVertices, uint8* Out)
+	{
+		VectorRegister4Float Min = VectorLoad(&Positions[0].X);
+		VectorRegister4Float Max = Min;
+		for (int32 i = 1; i < NumVertices; ++i)
+		{
+			const VectorRegister4Float Position = VectorLoad(&Positions[i].X);
+			Min = VectorMin(Min, Position);
+			Max = VectorMax(Max, Position);
+		}
+
+		// Positions are stored relative to the chunk's bounds; W lanes are ignored
+		VectorRegister4Float Origin;
+		VectorRegister4Float Scale;
+		FVector4f ChunkHeader[2];
+		if (Encoding == EDenseVertexEncoding::Quantized16)
+		{
+			const VectorRegister4Float Step = VectorMax(VectorMultiply(VectorSubtract(Max, Min), VectorSetFloat1(1.0f / 65535.0f)), VectorSetFloat1(UE_SMALL_NUMBER));
+			Origin = Min;
+			Scale = VectorReciprocalAccurate(Step);
+			VectorStore(Min, &ChunkHeader[0].X);
+			VectorStore(Step, &ChunkHeader[1].X);
+			FMemory::Memcpy(Out, &ChunkHeader[0].X, 3 * sizeof(float));
+			FMemory::Memcpy(Out + 3 * sizeof(float), &ChunkHeader[1].X, 3 * sizeof(float));
+			Out += 6 * sizeof(float);
+		}
+		else
+		{
+			Origin = VectorMultiply(VectorAdd(Min, Max), VectorSetFloat1(0.5f));
+			Scale = VectorOneFloat();
+			VectorStore(Origin, &ChunkHeader[0].X);
+			FMemory::Memcpy(Out, &ChunkHeader[0].X, 3 * sizeof(float));
+			Out += 3 * sizeof(float);
+		}
+
+		FVector4f Local;
+		uint16 Encoded[3];
+		for (int32 i = 0; i < NumVertices; ++i)
+		{
+			VectorStore(VectorMultiply(VectorSubtract(VectorLoad(&Positions[i].X), Origin), Scale), &Local.X);
+			for (int32 Axis = 0; Axis < 3; ++Axis)
+			{
+				if (Encoding == EDenseVertexEncoding::Quantized16)
+				{
+					Encoded[Axis] = static_cast<uint16>(FMath::Clamp(FMath::RoundToInt32(Local[Axis]), 0, 65535));
+				}
+				else
+				{
+					FPlatformMath::StoreHalf(&Encoded[Axis], Local[Axis]);
+				}
+			}
+			FMemory::Memcpy(Out, Encoded, sizeof(Encoded));
+			Out += sizeof(Encoded);
+		}
+	}
+}
+
+int64 FDenseVertexStreamHeader::GetFrameSize() const
+{
+	const int32 NumChunks = FMath::DivideAndRoundUp(NumVertices, ChunkSize);
+	return DenseVertexStream::FrameHeaderSize + NumChunks * DenseVertexStream::GetChunkHeaderSize(Encoding) + NumVertices * DenseVertexStream::VertexSize;
+}
+
+FArchive& operator<<(FArchive& Ar, FDenseVertexStreamHeader& Header)
+{
+	uint32 Magic = FDenseVertexStreamHeader::Magic;
+	Ar << Magic;
+	if (Ar.IsLoading() && Magic != FDenseVertexStreamHeader::Magic)
+	{
+		Ar.SetError();
+		return Ar;
+	}
+
+	uint8 Encoding = static_cast<uint8>(Header.Encoding);
+	Ar << Header.Version;
+	Ar << Encoding;
+	Ar << Header.NumVertices;
+	Ar << Header.ChunkSize;
+	Header.Encoding = static_cast<EDenseVertexEncoding>(Encoding);
+
+	if (Ar.IsLoading() && (Header.Version != FDenseVertexStreamHeader::CurrentVersion || Header.NumVertices < 0 || Header.ChunkSize <= 0))
+	{
+		Ar.SetError();
+	}
+	return Ar;
+}
+
+FDenseVertexStreamWriter::FDenseVertexStreamWriter(EDenseVertexEncoding Encoding, int32 ChunkSize, int32 InMaxFramesInFlight)
+	: MaxFramesInFlight(FMath::Max(1, InMaxFramesInFlight))
+{
+	Header.Encoding = Encoding;
+	Header.ChunkSize = FMath::Max(1, ChunkSize);
+}
+
+FDenseVertexStreamWriter::~FDenseVertexStreamWriter()
+{
+	Close();
+}
+
+bool FDenseVertexStreamWriter::PrepareBinding(const USkeletalMesh* SkeletalMesh)
+{
+	TSharedPtr<FCpuSkinningBinding> NewBinding = MakeShared<FCpuSkinningBinding>();
+	if (!NewBinding->Begin(SkeletalMesh))
+	{
+		return false;
+	}
+
+	// Slots follow the vertex order, so a chunk is a contiguous range of vertex indices
+	for (int32 VertexIndex = 0; VertexIndex < NewBinding->GetNumMeshVertices(); ++VertexIndex)
+	{
+		NewBinding->AddVertex(VertexIndex);
+	}
+	NewBinding->End();
+
+	Header.NumVertices = NewBinding->GetNumVertices();
+	Binding = NewBinding;
+	return Header.NumVertices > 0;
+}
+
+bool FDenseVertexStreamWriter::Open(const USkeletalMesh* SkeletalMesh, const FString& InFilePath)
+{
+	Close();
+	FilePath = InFilePath;
+	if (!PrepareBinding(SkeletalMesh))
+	{
+		return false;
+	}
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	const FString DirectoryPath = FPaths::GetPath(FilePath);
+	if (!PlatformFile.DirectoryExists(*DirectoryPath))
+	{
+		PlatformFile.CreateDirectoryTree(*DirectoryPath);
+	}
+
+	FileHandle.Reset(PlatformFile.OpenWrite(*FilePath));
+	if (!FileHandle.IsValid())
+	{
+		UE_LOG(LogDenseVertexStream, Error, TEXT("Open: Failed to open dense vertex stream for writing: %s"), *FilePath);
+		return false;
+	}
+
+	TArray<uint8> HeaderBytes;
+	FMemoryWriter Writer(HeaderBytes);
+	Writer << Header;
+	BytesWritten = 0;
+	NumFramesWritten = 0;
+	SkinningCycles = 0;
+	if (!FileHandle->Write(HeaderBytes.GetData(), HeaderBytes.Num()))
+	{
+		Close();
+		return false;
+	}
+	BytesWritten += HeaderBytes.Num();
+	HeaderSize = HeaderBytes.Num();
+
+	UE_LOG(LogDenseVertexStream, Log, TEXT("Open: Streaming %d vertices (%d bones) of %s to %s, %lld bytes per frame."),
+		Header.NumVertices, Binding->GetNumBones(), *SkeletalMesh->GetName(), *FilePath, Header.GetFrameSize());
+	return true;
+}
+
+bool FDenseVertexStreamWriter::OpenForResume(const USkeletalMesh* SkeletalMesh, const FString& InFilePath, int64 ValidBytes)
+{
+	Close();
+	FilePath = InFilePath;
+	if (!PrepareBinding(SkeletalMesh))
+	{
+		return false;
+	}
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	const int64 FileSize = PlatformFile.FileSize(*FilePath);
+	if (FileSize < ValidBytes)
+	{
+		UE_LOG(LogDenseVertexStream, Error, TEXT("OpenForResume: %s has %lld bytes, the checkpoint expects at least %lld."), *FilePath, FileSize, ValidBytes);
+		return false;
+	}
+
+	FileHandle.Reset(PlatformFile.OpenWrite(*FilePath, true, true));
+	if (!FileHandle.IsValid())
+	{
+		UE_LOG(LogDenseVertexStream, Error, TEXT("OpenForResume: Failed to open dense vertex stream for writing: %s"), *FilePath);
+		return false;
+	}
+
+	// Same mesh and encoding, and the checkpoint must end on a frame boundary
+	TArray<uint8> HeaderBytes;
+	FMemoryWriter Writer(HeaderBytes);
+	Writer << Header;
+	TArray<uint8> ExistingHeader;
+	ExistingHeader.SetNumUninitialized(HeaderBytes.Num());
+	if (ValidBytes < HeaderBytes.Num() || (ValidBytes - HeaderBytes.Num()) % Header.GetFrameSize() != 0
+		|| !FileHandle->Seek(0) || !FileHandle->Read(ExistingHeader.GetData(), ExistingHeader.Num())
+		|| FMemory::Memcmp(ExistingHeader.GetData(), HeaderBytes.GetData(), HeaderBytes.Num()) != 0)
+	{
+		UE_LOG(LogDenseVertexStream, Error, TEXT("OpenForResume: %s was written with a different header or does not end on a frame at %lld bytes."), *FilePath, ValidBytes);
+		Close();
+		return false;
+	}
+
+	if (FileSize > ValidBytes)
+	{
+		UE_LOG(LogDenseVertexStream, Warning, TEXT("OpenForResume: Discarding %lld bytes written after the last checkpoint of %s"), FileSize - ValidBytes, *FilePath);
+	}
+	if (!FileHandle->Truncate(ValidBytes) || !FileHandle->SeekFromEnd(0))
+	{
+		UE_LOG(LogDenseVertexStream, Error, TEXT("OpenForResume: Failed to truncate %s to %lld bytes."), *FilePath, ValidBytes);
+		Close();
+		return false;
+	}
+
+	BytesWritten = ValidBytes;
+	HeaderSize = HeaderBytes.Num();
+	NumFramesWritten = static_cast<int32>((ValidBytes - HeaderBytes.Num()) / Header.GetFrameSize());
+	SkinningCycles = 0;
+	return true;
+}
+
+bool FDenseVertexStreamWriter::WriteFrame(int32 FrameIndex, float TimeSeconds, const USkinnedMeshComponent* MeshComponent)
+{
+	if (!FileHandle.IsValid() || !Binding->ComputeSkinningMatrices(MeshComponent, SkinningMatrixScratch))
+	{
+		return false;
+	}
+
+	// The worker owns the matrices; the binding is shared read-only by all frames
+	PendingFrames.Add(UE::Tasks::Launch(UE_SOURCE_LOCATION,
+		[Binding = Binding, Matrices = TArray<FMatrix44f>(SkinningMatrixScratch), ComponentToWorld = MeshComponent->GetComponentTransform(), Header = Header, FrameIndex, TimeSeconds]()
+		{
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			FEncodedFrame Frame;
+			Frame.Data.SetNumUninitialized(Header.GetFrameSize());
+			FMemory::Memcpy(Frame.Data.GetData(), &FrameIndex, sizeof(int32));
+			FMemory::Memcpy(Frame.Data.GetData() + sizeof(int32), &TimeSeconds, sizeof(float));
+
+			// Chunks are independent: each skins its vertex range into scratch and encodes into its slice of the frame
+			const int32 NumChunks = FMath::DivideAndRoundUp(Header.NumVertices, Header.ChunkSize);
+			ParallelFor(NumChunks, [&](int32 ChunkIndex)
+			{
+				const int32 FirstVertex = ChunkIndex * Header.ChunkSize;
+				const int32 NumChunkVertices = FMath::Min(Header.ChunkSize, Header.NumVertices - FirstVertex);
+				TArray<FVector4f> Skinned;
+				Skinned.SetNumUninitialized(NumChunkVertices);
+				Binding->SkinVertices(Matrices, FirstVertex, NumChunkVertices, Skinned.GetData());
+				// Skinned in component space with float matrices, moved to world space in double precision like the markers
+				for (FVector4f& Position : Skinned)
+				{
+					const FVector WorldPosition = ComponentToWorld.TransformPosition(FVector(Position.X, Position.Y, Position.Z));
+					Position = FVector4f(static_cast<float>(WorldPosition.X), static_cast<float>(WorldPosition.Y), static_cast<float>(WorldPosition.Z), 1.0f);
+				}
+				DenseVertexStream::EncodeChunk(Header.Encoding, Skinned.GetData(), NumChunkVertices, Frame.Data.GetData() + DenseVertexStream::GetChunkOffset(Header, ChunkIndex));
+			});
+
+			Frame.Cycles = FPlatformTime::Cycles64() - StartCycles;
+			return Frame;
+		}));
+
+	// Bound memory: wait for the oldest frame once too many are in flight
+	if (PendingFrames.Num() > MaxFramesInFlight)
+	{
+		PendingFrames[0].Wait();
+	}
+	return WriteCompletedFrames(false);
+}
+
+bool FDenseVertexStreamWriter::WriteCompletedFrames(bool bWaitForAll)
+{
+	bool bSuccess = true;
+	int32 NumWritten = 0;
+	for (; NumWritten < PendingFrames.Num(); ++NumWritten)
+	{
+		UE::Tasks::TTask<FEncodedFrame>& Task = PendingFrames[NumWritten];
+		if (!bWaitForAll && !Task.IsCompleted())
+		{
+			break;
+		}
+
+		const FEncodedFrame& Frame = Task.GetResult();
+		if (!FileHandle.IsValid() || !FileHandle->Write(Frame.Data.GetData(), Frame.Data.Num()))
+		{
+			UE_LOG(LogDenseVertexStream, Error, TEXT("Failed to write frame %d to %s"), NumFramesWritten, *FilePath);
+			bSuccess = false;
+			continue;
+		}
+		BytesWritten += Frame.Data.Num();
+		SkinningCycles += Frame.Cycles;
+		++NumFramesWritten;
+	}
+	PendingFrames.RemoveAt(0, NumWritten);
+	return bSuccess;
+}
+
+bool FDenseVertexStreamWriter::Sync()
+{
+	return FileHandle.IsValid() && WriteCompletedFrames(true) && FileHandle->Flush(true);
+}
+
+bool FDenseVertexStreamWriter::Close()
+{
+	bool bSuccess = WriteCompletedFrames(true);
+	if (FileHandle.IsValid())
+	{
+		bSuccess &= FileHandle->Flush();
+		FileHandle.Reset();
+		if (NumFramesWritten > 0)
+		{
+			UE_LOG(LogDenseVertexStream, Log, TEXT("Closed dense vertex stream %s (%d frames, %lld bytes, %.2f ms skinning per frame)."),
+				*FilePath, NumFramesWritten, BytesWritten, GetSkinningSeconds() * 1000.0 / NumFramesWritten);
+		}
+	}
+	return bSuccess;
+}
+
+double FDenseVertexStreamWriter::GetSkinningSeconds() const
+{
+	return FPlatformTime::ToSeconds64(SkinningCycles);
+}
+
+bool FDenseVertexStreamWriter::DecodeFrame(const FDenseVertexStreamHeader& Header, TArrayView<const uint8> FrameData, int32& OutFrameIndex, float& OutTimeSeconds, TArray<FVector3f>& OutPositions)
+{
+	if (FrameData.Num() < Header.GetFrameSize())
+	{
+		return false;
+	}
+
+	const uint8* Data = FrameData.GetData();
+	FMemory::Memcpy(&OutFrameIndex, Data, sizeof(int32));
+	FMemory::Memcpy(&OutTimeSeconds, Data + sizeof(int32), sizeof(float));
+
+	OutPositions.SetNumUninitialized(Header.NumVertices);
+	const int32 NumChunks = FMath::DivideAndRoundUp(Header.NumVertices, Header.ChunkSize);
+	for (int32 ChunkIndex = 0; ChunkIndex < NumChunks; ++ChunkIndex)
+	{
+		const uint8* Chunk = Data + DenseVertexStream::GetChunkOffset(Header, ChunkIndex);
+		FVector3f Origin;
+		FVector3f Step = FVector3f::OneVector;
+		FMemory::Memcpy(&Origin, Chunk, sizeof(FVector3f));
+		if (Header.Encoding == EDenseVertexEncoding::Quantized16)
+		{
+			FMemory::Memcpy(&Step, Chunk + sizeof(FVector3f), sizeof(FVector3f));
+		}
+		Chunk += DenseVertexStream::GetChunkHeaderSize(Header.Encoding);
+
+		const int32 FirstVertex = ChunkIndex * Header.ChunkSize;
+		const int32 NumChunkVertices = FMath::Min(Header.ChunkSize, Header.NumVertices - FirstVertex);
+		for (int32 i = 0; i < NumChunkVertices; ++i)
+		{
+			uint16 Encoded[3];
+			FMemory::Memcpy(Encoded, Chunk + i * DenseVertexStream::VertexSize, sizeof(Encoded));
+			FVector3f& Position = OutPositions[FirstVertex + i];
+			for (int32 Axis = 0; Axis < 3; ++Axis)
+			{
+				const float Local = Header.Encoding == EDenseVertexEncoding::Quantized16 ? static_cast<float>(Encoded[Axis]) : FPlatformMath::LoadHalf(&Encoded[Axis]);
+				Position[Axis] = Origin[Axis] + Local * Step[Axis];
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,123 @@
+// DenseVertexStream.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tasks/Task.h"
+#include "CpuSkinning.h"
+#include "DenseVertexStream.generated.h"
+
+class IFileHandle;
+class USkeletalMesh;
+class USkinnedMeshComponent;
+
+// How the vertex positions of a dense vertex stream are stored; both use 6 bytes per vertex
+UENUM(BlueprintType)
+enum class EDenseVertexEncoding : uint8
+{
+	// Half floats relative to the center of each chunk's bounds, steps of up to 0.06 cm for a 2 m wide chunk
+	Float16,
+	// 16-bit fixed point across each chunk's bounding box, steps of 0.003 cm for a 2 m wide chunk
+	Quantized16
+};
+
+/**
+ * Header at the start of every dense vertex stream.
+ * All frames have the same size: [frame index (int32)][time (float)][chunk 0][chunk 1]..., where each chunk holds
+ * ChunkSize consecutive vertices (the last one the remainder): Float16 chunks start with their center (3 floats),
+ * Quantized16 chunks with their minimum and step (6 floats), followed by x, y, z per vertex.
+ */
+struct EXTRACTJOINTLOCATION_API FDenseVertexStreamHeader
+{
+	static constexpr uint32 Magic = 0x5356444B; // "KDVS"
+	static constexpr uint16 CurrentVersion = 1;
+
+	uint16 Version = CurrentVersion;
+	EDenseVertexEncoding Encoding = EDenseVertexEncoding::Quantized16;
+	int32 NumVertices = 0;
+	int32 ChunkSize = 4096;
+
+	/** Bytes of one frame, the same for every frame of the stream. */
+	int64 GetFrameSize() const;
+
+	friend FArchive& operator<<(FArchive& Ar, FDenseVertexStreamHeader& Header);
+};
+
+/**
+ * Streams the world-space positions of every LOD 0 vertex of a skeletal mesh, for supervising body model fits with
+ * the full surface. The pose's skinning matrices are taken on the calling thread; skinning (FCpuSkinningBinding) and
+ * encoding run on worker threads, one parallel task per chunk, and frames are written in order as they complete.
+ */
+class EXTRACTJOINTLOCATION_API FDenseVertexStreamWriter
+{
+public:
+	/**
+	 * @param ChunkSize Vertices per chunk; each chunk is skinned by one task and quantized against its own bounds.
+	 * @param MaxFramesInFlight Frames being skinned at once before WriteFrame waits for the oldest.
+	 */
+	FDenseVertexStreamWriter(EDenseVertexEncoding Encoding, int32 ChunkSize = 4096, int32 MaxFramesInFlight = 4);
+	~FDenseVertexStreamWriter();
+
+	/** Reads the mesh's vertices and influences, creates the file (and its directory) and writes the header. */
+	bool Open(const USkeletalMesh* SkeletalMesh, const FString& FilePath);
+
+	/**
+	 * Reopens a stream written by an interrupted run, keeping its first ValidBytes (see FKeypointStreamWriter::OpenForResume).
+	 * @return False if the file is missing, shorter than ValidBytes, not on a frame boundary or written with a different header.
+	 */
+	bool OpenForResume(const USkeletalMesh* SkeletalMesh, const FString& FilePath, int64 ValidBytes);
+
+	/** Snapshots the component's pose (or its leader's) and queues the frame for skinning. Game thread only. */
+	bool WriteFrame(int32 FrameIndex, float TimeSeconds, const USkinnedMeshComponent* MeshComponent);
+
+	/** Waits for the queued frames and flushes them to the storage device (fsync). */
+	bool Sync();
+
+	/** Waits for the queued frames and closes the file. */
+	bool Close();
+
+	bool IsOpen() const { return FileHandle.IsValid(); }
+	int64 GetBytesWritten() const { return BytesWritten; }
+	/** File offset the next WriteFrame's frame will be written at, counting queued frames. */
+	int64 GetNextFrameOffset() const { return BytesWritten + PendingFrames.Num() * Header.GetFrameSize(); }
+	int32 GetNumFramesWritten() const { return NumFramesWritten; }
+	/** Size of the stream header at the start of the file; frame N starts at GetHeaderSize() + N * frame size. */
+	int64 GetHeaderSize() const { return HeaderSize; }
+	const FString& GetFilePath() const { return FilePath; }
+	const FDenseVertexStreamHeader& GetHeader() const { return Header; }
+
+	/** Worker time spent skinning and encoding the written frames. */
+	double GetSkinningSeconds() const;
+
+	/**
+	 * Decodes one frame of a stream.
+	 * @param FrameData GetFrameSize() bytes, e.g. at header size + frame * frame size in the file.
+	 */
+	static bool DecodeFrame(const FDenseVertexStreamHeader& Header, TArrayView<const uint8> FrameData, int32& OutFrameIndex, float& OutTimeSeconds, TArray<FVector3f>& OutPositions);
+
+private:
+	struct FEncodedFrame
+	{
+		TArray<uint8> Data;
+		uint64 Cycles = 0;
+	};
+
+	bool PrepareBinding(const USkeletalMesh* SkeletalMesh);
+	// Writes finished frames in order; waits for all of them if bWaitForAll, otherwise only drains completed ones
+	bool WriteCompletedFrames(bool bWaitForAll);
+
+	FDenseVertexStreamHeader Header;
+	int32 MaxFramesInFlight;
+
+	// Immutable once opened, shared with the skinning tasks
+	TSharedPtr<const FCpuSkinningBinding> Binding;
+	TArray<FMatrix44f> SkinningMatrixScratch;
+
+	TUniquePtr<IFileHandle> FileHandle;
+	FString FilePath;
+	int64 BytesWritten = 0;
+	int64 HeaderSize = 0;
+	int32 NumFramesWritten = 0;
+	uint64 SkinningCycles = 0;
+
+	TArray<UE::Tasks::TTask<FEncodedFrame>> PendingFrames;
+};
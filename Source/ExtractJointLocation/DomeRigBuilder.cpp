@@ -0,0 +1,413 @@
+#include "DomeRigBuilder.h"
+#include "CameraDataComponent.h"
+#include "RenderTargetPool.h"
+
+// Camera-Specific Includes
+#include "Engine/SceneCapture2D.h"
+#include "Components/SceneCaptureComponent2D.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "Engine/World.h"
+
+// File I/O Includes
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+
+// Logging
+#include "Logging/LogMacros.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogDomeRigBuilder, Log, All);
+
+// Sets default values for this actor's properties
+ADomeRigBuilder::ADomeRigBuilder()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("RigRoot"));
+	RenderTargetPool = nullptr;
+}
+
+// Called when the game starts or when spawned
+void ADomeRigBuilder::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (bBuildOnBeginPlay)
+	{
+		BuildRig();
+	}
+}
+
+void ADomeRigBuilder::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	ClearRig();
+	if (RenderTargetPool)
+	{
+		RenderTargetPool->Empty();
+	}
+	Super::EndPlay(EndPlayReason);
+}
+
+void ADomeRigBuilder::BuildRig()
+{
+	TArray<FDomeCameraPlacement> Placements;
+	if (!ComputePlacements(Placements))
+	{
+		UE_LOG(LogDomeRigBuilder, Error, TEXT("BuildRig: Layout produced no cameras for %s."), *GetName());
+		return;
+	}
+	BuildRigFromPlacements(Placements);
+}
+
+void ADomeRigBuilder::BuildRigFromPlacements(const TArray<FDomeCameraPlacement>& Placements)
+{
+	UWorld* World = GetWorld();
+	if (!World)
+	{
+		return;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	if (!RenderTargetPool)
+	{
+		RenderTargetPool = NewObject<URenderTargetPool>(this, TEXT("RenderTargetPool"));
+	}
+
+	// Remove cameras that are no longer part of the rig, handing their render targets back first
+	while (SpawnedCameras.Num() > Placements.Num())
+	{
+		ReleaseCamera(SpawnedCameras.Num() - 1);
+		SpawnedCameras.Pop();
+		SpawnedCameraTargets.Pop();
+	}
+
+	// Cameras deleted since the last build are replaced below; their render targets would otherwise stay in use
+	for (int32 i = 0; i < SpawnedCameras.Num(); ++i)
+	{
+		if (!IsValid(SpawnedCameras[i]))
+		{
+			ReleaseCamera(i);
+		}
+	}
+
+	// Size the pool to the rig before spawning so no render target is created mid-build: one target per new camera
+	// and per kept camera whose resolution changes, counted per resolution
+	TMap<FIntPoint, int32> NumTargetsNeeded;
+	for (int32 i = 0; i < Placements.Num(); ++i)
+	{
+		const FIntPoint Size(Placements[i].ImageWidth, Placements[i].ImageHeight);
+		const ASceneCapture2D* Camera = SpawnedCameras.IsValidIndex(i) ? SpawnedCameras[i] : nullptr;
+		const UTextureRenderTarget2D* RenderTarget = IsValid(Camera) && Camera->GetCaptureComponent2D() ? Camera->GetCaptureComponent2D()->TextureTarget : nullptr;
+		if (!RenderTarget || RenderTarget->SizeX != Size.X || RenderTarget->SizeY != Size.Y)
+		{
+			++NumTargetsNeeded.FindOrAdd(Size);
+		}
+	}
+	for (const TPair<FIntPoint, int32>& Needed : NumTargetsNeeded)
+	{
+		RenderTargetPool->Reserve(Needed.Value, Needed.Key.X, Needed.Key.Y);
+	}
+
+	for (int32 i = 0; i < Placements.Num(); ++i)
+	{
+		if (SpawnedCameras.IsValidIndex(i) && IsValid(SpawnedCameras[i]))
+		{
+			ConfigureCamera(SpawnedCameras[i], Placements[i]);
+			SpawnedCameraTargets[i] = SpawnedCameras[i]->GetCaptureComponent2D()->TextureTarget;
+		}
+		else if (ASceneCapture2D* NewCamera = SpawnCamera(Placements[i]))
+		{
+			if (SpawnedCameras.IsValidIndex(i))
+			{
+				SpawnedCameras[i] = NewCamera;
+				SpawnedCameraTargets[i] = NewCamera->GetCaptureComponent2D()->TextureTarget;
+			}
+			else
+			{
+				SpawnedCameras.Add(NewCamera);
+				SpawnedCameraTargets.Add(NewCamera->GetCaptureComponent2D()->TextureTarget);
+			}
+		}
+	}
+
+	UE_LOG(LogDomeRigBuilder, Log, TEXT("BuildRig: Built %d cameras in %.2f ms (%d render targets in use, %d free)."),
+		SpawnedCameras.Num(), (FPlatformTime::Seconds() - StartTime) * 1000.0, RenderTargetPool->GetNumInUse(), RenderTargetPool->GetNumFree());
+}
+
+void ADomeRigBuilder::ClearRig()
+{
+	for (int32 i = 0; i < SpawnedCameras.Num(); ++i)
+	{
+		ReleaseCamera(i);
+	}
+	SpawnedCameras.Empty();
+	SpawnedCameraTargets.Empty();
+}
+
+bool ADomeRigBuilder::ComputePlacements(TArray<FDomeCameraPlacement>& OutPlacements) const
+{
+	OutPlacements.Reset();
+
+	auto AddPlacement = [this, &OutPlacements](const FVector& LocalLocation, const FRotator& Rotation)
+	{
+		FDomeCameraPlacement& Placement = OutPlacements.AddDefaulted_GetRef();
+		Placement.CameraName = FString::Printf(TEXT("%s_%d"), *CameraNamePrefix, OutPlacements.Num() - 1);
+		Placement.Transform = FTransform(Rotation, LocalLocation);
+		Placement.FOVAngle = FOVAngle;
+		Placement.ImageWidth = ImageWidth;
+		Placement.ImageHeight = ImageHeight;
+	};
+
+	switch (Layout)
+	{
+	case EDomeRigLayout::Ring:
+	{
+		for (int32 i = 0; i < NumCameras; ++i)
+		{
+			const float Angle = 2.0f * PI * i / NumCameras;
+			const FVector LocalLocation(Radius * FMath::Cos(Angle), Radius * FMath::Sin(Angle), RingHeight);
+			AddPlacement(LocalLocation, LookAtRotation(LocalLocation));
+		}
+		break;
+	}
+	case EDomeRigLayout::FormulaicDome:
+	{
+		// Port of generate_formulaic_dome() in dome_cameras.py: heights and pitches are linearly interpolated
+		// and cameras are allocated per ring proportional to cos(normalised height * PI/2).
+		const int32 Rings = FMath::Max(NumRings, 2);
+		TArray<float> Weights;
+		float TotalWeight = 0.0f;
+		for (int32 Ring = 0; Ring < Rings; ++Ring)
+		{
+			const float Alpha = static_cast<float>(Ring) / (Rings - 1);
+			Weights.Add(FMath::Cos(Alpha * HALF_PI));
+			TotalWeight += Weights.Last();
+		}
+
+		// Largest-remainder allocation, so the rings add up to exactly NumCameras
+		TArray<int32> Counts;
+		TArray<TPair<float, int32>> Remainders;
+		int32 Allocated = 0;
+		for (int32 Ring = 0; Ring < Rings; ++Ring)
+		{
+			const float Quota = Weights[Ring] / TotalWeight * NumCameras;
+			Counts.Add(FMath::FloorToInt32(Quota));
+			Allocated += Counts.Last();
+			Remainders.Emplace(Quota - Counts.Last(), Ring);
+		}
+		Remainders.Sort([](const TPair<float, int32>& A, const TPair<float, int32>& B) { return A.Key > B.Key; });
+		for (int32 i = 0; i < NumCameras - Allocated; ++i)
+		{
+			++Counts[Remainders[i % Rings].Value];
+		}
+
+		// With enough cameras every ring gets one, taken from the most populated ring
+		for (int32 Ring = 0; NumCameras >= Rings && Ring < Rings; ++Ring)
+		{
+			if (Counts[Ring] == 0)
+			{
+				int32 LargestRing = 0;
+				for (int32 Other = 1; Other < Rings; ++Other)
+				{
+					LargestRing = Counts[Other] > Counts[LargestRing] ? Other : LargestRing;
+				}
+				--Counts[LargestRing];
+				Counts[Ring] = 1;
+			}
+		}
+
+		for (int32 Ring = 0; Ring < Rings; ++Ring)
+		{
+			const float Alpha = static_cast<float>(Ring) / (Rings - 1);
+			const float Height = FMath::Lerp(MinHeight, MaxHeight, Alpha);
+			const float Pitch = FMath::Lerp(StartPitch, EndPitch, Alpha);
+			const int32 Count = Counts[Ring];
+
+			for (int32 i = 0; i < Count; ++i)
+			{
+				const float Angle = 2.0f * PI * i / Count;
+				const FVector LocalLocation(Radius * FMath::Cos(Angle), Radius * FMath::Sin(Angle), Height);
+				// Face the rig centre horizontally, pitch as configured for the ring
+				const float Yaw = FMath::RadiansToDegrees(Angle) + 180.0f;
+				AddPlacement(LocalLocation, FRotator(Pitch, Yaw, 0.0f));
+			}
+		}
+		break;
+	}
+	case EDomeRigLayout::GeodesicDome:
+	{
+		// Fibonacci lattice over the spherical band: uniform in sin(elevation) gives equal-area spacing
+		const float GoldenAngle = PI * (3.0f - FMath::Sqrt(5.0f));
+		const float MinSin = FMath::Sin(FMath::DegreesToRadians(MinElevation));
+		const float MaxSin = FMath::Sin(FMath::DegreesToRadians(MaxElevation));
+		for (int32 i = 0; i < NumCameras; ++i)
+		{
+			const float SinElevation = FMath::Lerp(MinSin, MaxSin, (i + 0.5f) / NumCameras);
+			const float CosElevation = FMath::Sqrt(FMath::Max(0.0f, 1.0f - SinElevation * SinElevation));
+			const float Azimuth = GoldenAngle * i;
+			const FVector LocalLocation = LookAtOffset + Radius * FVector(CosElevation * FMath::Cos(Azimuth), CosElevation * FMath::Sin(Azimuth), SinElevation);
+			AddPlacement(LocalLocation, LookAtRotation(LocalLocation));
+		}
+		break;
+	}
+	case EDomeRigLayout::RigFile:
+	{
+		LoadPlacementsFromFile(RigFilePath, OutPlacements);
+		break;
+	}
+	}
+
+	return OutPlacements.Num() > 0;
+}
+
+bool ADomeRigBuilder::LoadPlacementsFromFile(const FString& FilePath, TArray<FDomeCameraPlacement>& OutPlacements) const
+{
+	const FString AbsoluteFilePath = FPaths::IsRelative(FilePath) ? FPaths::Combine(FPaths::ProjectDir(), FilePath) : FilePath;
+
+	FString FileContent;
+	if (!FFileHelper::LoadFileToString(FileContent, *AbsoluteFilePath))
+	{
+		UE_LOG(LogDomeRigBuilder, Error, TEXT("LoadPlacementsFromFile: Failed to read rig file: %s"), *AbsoluteFilePath);
+		return false;
+	}
+
+	TSharedPtr<FJsonObject> RootObject;
+	TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(FileContent);
+	if (!FJsonSerializer::Deserialize(Reader, RootObject) || !RootObject.IsValid())
+	{
+		UE_LOG(LogDomeRigBuilder, Error, TEXT("LoadPlacementsFromFile: Rig file is not valid JSON: %s"), *AbsoluteFilePath);
+		return false;
+	}
+
+	const TArray<TSharedPtr<FJsonValue>>* CameraArray = nullptr;
+	if (!RootObject->TryGetArrayField(TEXT("Cameras"), CameraArray))
+	{
+		UE_LOG(LogDomeRigBuilder, Error, TEXT("LoadPlacementsFromFile: Rig file has no 'Cameras' array: %s"), *AbsoluteFilePath);
+		return false;
+	}
+
+	auto ReadVector = [](const TSharedPtr<FJsonObject>& Object, const TCHAR* Field, FVector& OutVector) -> bool
+	{
+		const TArray<TSharedPtr<FJsonValue>>* Values = nullptr;
+		if (!Object->TryGetArrayField(Field, Values) || Values->Num() != 3)
+		{
+			return false;
+		}
+		OutVector = FVector((*Values)[0]->AsNumber(), (*Values)[1]->AsNumber(), (*Values)[2]->AsNumber());
+		return true;
+	};
+
+	for (const TSharedPtr<FJsonValue>& CameraValue : *CameraArray)
+	{
+		const TSharedPtr<FJsonObject> CameraObject = CameraValue.IsValid() ? CameraValue->AsObject() : nullptr;
+		FVector LocalLocation;
+		if (!CameraObject.IsValid() || !ReadVector(CameraObject, TEXT("Location"), LocalLocation))
+		{
+			UE_LOG(LogDomeRigBuilder, Warning, TEXT("LoadPlacementsFromFile: Skipping camera %d without a valid 'Location'."), OutPlacements.Num());
+			continue;
+		}
+
+		FVector RotationValues;
+		const FRotator Rotation = ReadVector(CameraObject, TEXT("Rotation"), RotationValues)
+			? FRotator(RotationValues.X, RotationValues.Y, RotationValues.Z)
+			: LookAtRotation(LocalLocation);
+
+		FDomeCameraPlacement& Placement = OutPlacements.AddDefaulted_GetRef();
+		if (!CameraObject->TryGetStringField(TEXT("Name"), Placement.CameraName))
+		{
+			Placement.CameraName = FString::Printf(TEXT("%s_%d"), *CameraNamePrefix, OutPlacements.Num() - 1);
+		}
+		Placement.Transform = FTransform(Rotation, LocalLocation);
+
+		double NumberValue = 0.0;
+		Placement.FOVAngle = CameraObject->TryGetNumberField(TEXT("FOV"), NumberValue) ? NumberValue : FOVAngle;
+		Placement.ImageWidth = CameraObject->TryGetNumberField(TEXT("Width"), NumberValue) ? static_cast<int32>(NumberValue) : ImageWidth;
+		Placement.ImageHeight = CameraObject->TryGetNumberField(TEXT("Height"), NumberValue) ? static_cast<int32>(NumberValue) : ImageHeight;
+	}
+
+	UE_LOG(LogDomeRigBuilder, Log, TEXT("LoadPlacementsFromFile: Read %d cameras from %s"), OutPlacements.Num(), *AbsoluteFilePath);
+	return OutPlacements.Num() > 0;
+}
+
+ASceneCapture2D* ADomeRigBuilder::SpawnCamera(const FDomeCameraPlacement& Placement)
+{
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.Owner = this;
+	SpawnParams.Name = FName(*Placement.CameraName);
+	SpawnParams.NameMode = FActorSpawnParameters::ESpawnActorNameMode::Requested;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	ASceneCapture2D* Camera = GetWorld()->SpawnActor<ASceneCapture2D>(ASceneCapture2D::StaticClass(), Placement.Transform * GetActorTransform(), SpawnParams);
+	if (!Camera)
+	{
+		UE_LOG(LogDomeRigBuilder, Error, TEXT("SpawnCamera: Failed to spawn camera %s."), *Placement.CameraName);
+		return nullptr;
+	}
+#if WITH_EDITOR
+	Camera->SetActorLabel(Placement.CameraName);
+#endif
+	Camera->AttachToActor(this, FAttachmentTransformRules::KeepWorldTransform);
+
+	ConfigureCamera(Camera, Placement);
+
+	// The data component reads its render target in BeginPlay, so it must be assigned before registering
+	UCameraDataComponent* CameraData = NewObject<UCameraDataComponent>(Camera, TEXT("CameraData"));
+	CameraData->TargetRenderTarget = Camera->GetCaptureComponent2D()->TextureTarget;
+	Camera->AddInstanceComponent(CameraData);
+	CameraData->RegisterComponent();
+
+	return Camera;
+}
+
+void ADomeRigBuilder::ConfigureCamera(ASceneCapture2D* Camera, const FDomeCameraPlacement& Placement)
+{
+	Camera->SetActorTransform(Placement.Transform * GetActorTransform());
+
+	USceneCaptureComponent2D* CaptureComp = Camera->GetCaptureComponent2D();
+	CaptureComp->FOVAngle = Placement.FOVAngle;
+	CaptureComp->bCaptureEveryFrame = bCaptureEveryFrame;
+	CaptureComp->bCaptureOnMovement = false;
+	CaptureComp->CaptureSource = ESceneCaptureSource::SCS_FinalColorLDR;
+
+	// Swap the render target only if the resolution changed, the pooled one is reused otherwise
+	UTextureRenderTarget2D* RenderTarget = CaptureComp->TextureTarget;
+	if (!RenderTarget || RenderTarget->SizeX != Placement.ImageWidth || RenderTarget->SizeY != Placement.ImageHeight)
+	{
+		RenderTargetPool->Release(RenderTarget);
+		RenderTarget = RenderTargetPool->Acquire(Placement.ImageWidth, Placement.ImageHeight);
+		CaptureComp->TextureTarget = RenderTarget;
+	}
+
+	if (UCameraDataComponent* CameraData = Camera->FindComponentByClass<UCameraDataComponent>())
+	{
+		CameraData->TargetRenderTarget = RenderTarget;
+	}
+}
+
+void ADomeRigBuilder::ReleaseCamera(int32 CameraIndex)
+{
+	if (RenderTargetPool && SpawnedCameraTargets[CameraIndex])
+	{
+		RenderTargetPool->Release(SpawnedCameraTargets[CameraIndex]);
+		SpawnedCameraTargets[CameraIndex] = nullptr;
+	}
+
+	ASceneCapture2D* Camera = SpawnedCameras[CameraIndex];
+	if (!IsValid(Camera))
+	{
+		return;
+	}
+	if (USceneCaptureComponent2D* CaptureComp = Camera->GetCaptureComponent2D())
+	{
+		CaptureComp->TextureTarget = nullptr;
+	}
+	Camera->Destroy();
+}
+
+FRotator ADomeRigBuilder::LookAtRotation(const FVector& LocalLocation) const
+{
+	return (LookAtOffset - LocalLocation).Rotation();
+}
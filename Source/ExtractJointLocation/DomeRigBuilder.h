@@ -0,0 +1,188 @@
+// DomeRigBuilder.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "DomeRigBuilder.generated.h"
+
+class ASceneCapture2D;
+class UCameraDataComponent;
+class URenderTargetPool;
+
+UENUM(BlueprintType)
+enum class EDomeRigLayout : uint8
+{
+	// A single horizontal ring of cameras at RingHeight
+	Ring,
+	// Stacked rings with a cosine-weighted camera count per ring (same as dome_cameras.py)
+	FormulaicDome,
+	// Near-uniform (Fibonacci) distribution over the dome between MinElevation and MaxElevation
+	GeodesicDome,
+	// Camera placements read from RigFilePath
+	RigFile
+};
+
+// One camera of a rig, in the builder's local space
+USTRUCT(BlueprintType)
+struct FDomeCameraPlacement
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Dome Rig")
+	FString CameraName;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Dome Rig")
+	FTransform Transform;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Dome Rig")
+	float FOVAngle = 90.0f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Dome Rig")
+	int32 ImageWidth = 1920;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Dome Rig")
+	int32 ImageHeight = 1080;
+};
+
+/**
+ * Spawns a rig of ASceneCapture2D cameras around its own location, attaches a UCameraDataComponent to
+ * each one and assigns render targets from a shared URenderTargetPool.
+ * Rebuilding the rig reuses the already spawned cameras and pooled render targets, so re-optimised rigs
+ * can be swapped in between iterations without spawning or allocating from scratch.
+ */
+UCLASS()
+class EXTRACTJOINTLOCATION_API ADomeRigBuilder : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	// Sets default values for this actor's properties
+	ADomeRigBuilder();
+
+protected:
+	// Called when the game starts or when spawned
+	virtual void BeginPlay() override;
+
+	// Destroys the spawned cameras and returns their render targets to the pool
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+public:
+	/** Builds (or rebuilds) the rig from the current layout parameters. */
+	UFUNCTION(BlueprintCallable, Category = "Dome Rig")
+	void BuildRig();
+
+	/**
+	 * Builds (or rebuilds) the rig from explicit camera placements, reusing spawned cameras where possible.
+	 * @param Placements Camera placements relative to this actor.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Dome Rig")
+	void BuildRigFromPlacements(const TArray<FDomeCameraPlacement>& Placements);
+
+	/** Destroys all spawned cameras and returns their render targets to the pool. */
+	UFUNCTION(BlueprintCallable, Category = "Dome Rig")
+	void ClearRig();
+
+	/**
+	 * Computes the camera placements for the current layout without spawning anything.
+	 * @param OutPlacements Filled with one placement per camera, relative to this actor.
+	 * @return True if the layout produced at least one camera.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Dome Rig")
+	bool ComputePlacements(TArray<FDomeCameraPlacement>& OutPlacements) const;
+
+	/**
+	 * Reads camera placements from a JSON rig file.
+	 * Expected layout: { "Cameras": [ { "Name": "Cam0", "Location": [X, Y, Z], "Rotation": [Pitch, Yaw, Roll],
+	 * "FOV": 90, "Width": 1920, "Height": 1080 } ] } with locations in centimetres relative to the builder.
+	 * If "Rotation" is omitted the camera looks at the rig target.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Dome Rig")
+	bool LoadPlacementsFromFile(const FString& FilePath, TArray<FDomeCameraPlacement>& OutPlacements) const;
+
+	UFUNCTION(BlueprintPure, Category = "Dome Rig")
+	TArray<ASceneCapture2D*> GetSpawnedCameras() const { return SpawnedCameras; }
+
+	UFUNCTION(BlueprintPure, Category = "Dome Rig")
+	URenderTargetPool* GetRenderTargetPool() const { return RenderTargetPool; }
+
+	/** Layout used by BuildRig(). */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Dome Rig")
+	EDomeRigLayout Layout = EDomeRigLayout::FormulaicDome;
+
+	/** Total number of cameras for the procedural layouts. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Dome Rig", meta = (ClampMin = "1"))
+	int32 NumCameras = 32;
+
+	/** Number of rings for the FormulaicDome layout. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Dome Rig", meta = (ClampMin = "2"))
+	int32 NumRings = 4;
+
+	/** Horizontal distance from the rig centre to the cameras (cm). */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Dome Rig")
+	float Radius = 500.0f;
+
+	/** Camera height for the Ring layout (cm). */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Dome Rig")
+	float RingHeight = 150.0f;
+
+	/** Lowest / highest ring height for the FormulaicDome layout (cm). */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Dome Rig")
+	float MinHeight = 10.0f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Dome Rig")
+	float MaxHeight = 350.0f;
+
+	/** Pitch of the lowest / highest ring for the FormulaicDome layout (degrees, positive looks up). */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Dome Rig")
+	float StartPitch = 25.0f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Dome Rig")
+	float EndPitch = -30.0f;
+
+	/** Elevation range of the GeodesicDome layout (degrees above the horizon). */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Dome Rig")
+	float MinElevation = 5.0f;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Dome Rig")
+	float MaxElevation = 75.0f;
+
+	/** Point the Ring and GeodesicDome cameras look at, relative to this actor (cm). */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Dome Rig")
+	FVector LookAtOffset = FVector(0.0f, 0.0f, 100.0f);
+
+	/** Horizontal field of view of every procedural camera (degrees). */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Dome Rig")
+	float FOVAngle = 60.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Dome Rig")
+	int32 ImageWidth = 1920;
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Dome Rig")
+	int32 ImageHeight = 1080;
+
+	/** JSON rig file used by the RigFile layout. Relative paths are resolved against the project directory. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Dome Rig")
+	FString RigFilePath;
+
+	/** Prefix for the names of spawned camera actors. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Dome Rig")
+	FString CameraNamePrefix = TEXT("DomeCam");
+
+	/** If true the rig is built in BeginPlay. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Dome Rig")
+	bool bBuildOnBeginPlay = true;
+
+	/** If false the cameras only render when captured explicitly (e.g. by ACameraDataManager). */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Dome Rig")
+	bool bCaptureEveryFrame = false;
+
+private:
+	ASceneCapture2D* SpawnCamera(const FDomeCameraPlacement& Placement);
+	void ConfigureCamera(ASceneCapture2D* Camera, const FDomeCameraPlacement& Placement);
+	// Hands the render target of SpawnedCameras[CameraIndex] back to the pool and destroys the camera if it still exists
+	void ReleaseCamera(int32 CameraIndex);
+
+	FRotator LookAtRotation(const FVector& LocalLocation) const;
+
+	UPROPERTY()
+	URenderTargetPool* RenderTargetPool;
+
+	UPROPERTY()
+	TArray<ASceneCapture2D*> SpawnedCameras;
+
+	// Render target of each spawned camera, kept so it can be released after the camera was deleted from outside
+	UPROPERTY()
+	TArray<UTextureRenderTarget2D*> SpawnedCameraTargets;
+};
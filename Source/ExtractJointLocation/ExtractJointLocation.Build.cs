@@ -20,6 +20,7 @@ public class ExtractJointLocation : ModuleRules
 		});
 		
 		PrivateDependencyModuleNames.AddRange(new string[] { 
+			"AssetRegistry", // Animation discovery in the offline sampling commandlet
 			"Core",
 			"CoreUObject",
 			"Engine",
@@ -27,8 +28,11 @@ public class ExtractJointLocation : ModuleRules
 			"ImageWriteQueue",
 			"ImageWrapper",
 			"Json",
+			"Networking", // UDP socket builder for the keypoint network stream
 			"Projects",
-			"RenderCore" // May also be needed for texture resources
+			"RenderCore", // May also be needed for texture resources
+			"RHI", // Render thread texture copies for atlas capture
+			"Sockets"
 
 		});
 
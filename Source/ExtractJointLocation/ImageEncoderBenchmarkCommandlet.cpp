@@ -0,0 +1,259 @@
+#include "ImageEncoderBenchmarkCommandlet.h"
+#include "Async/ParallelFor.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogImageEncoderBenchmark, Log, All);
+
+namespace ImageEncoderBenchmark
+{
+	// Distinct synthetic frames; the rest of the run cycles through them
+	static constexpr int32 NumDistinctFrames = 4;
+	static constexpr int32 NumShapes = 24;
+	// Per channel amplitude of the noise, about what temporal AA leaves on a render
+	static constexpr int32 NoiseAmplitude = 3;
+}
+
+UImageEncoderBenchmarkCommandlet::UImageEncoderBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UImageEncoderBenchmarkCommandlet::Main(const FString& Params)
+{
+	using namespace ImageEncoderBenchmark;
+	TArray<FString> Tokens;
+	TArray<FString> Switches;
+	TMap<FString, FString> ParamsMap;
+	ParseCommandLine(*Params, Tokens, Switches, ParamsMap);
+
+	const int32 NumFrames = ParamsMap.Contains(TEXT("Frames")) ? FCString::Atoi(*ParamsMap[TEXT("Frames")]) : 32;
+	const int32 Width = ParamsMap.Contains(TEXT("Width")) ? FCString::Atoi(*ParamsMap[TEXT("Width")]) : 1920;
+	const int32 Height = ParamsMap.Contains(TEXT("Height")) ? FCString::Atoi(*ParamsMap[TEXT("Height")]) : 1080;
+	const FString CodecList = ParamsMap.Contains(TEXT("Codecs")) ? ParamsMap[TEXT("Codecs")] : TEXT("Png0,Png2,Qoi,Jpeg90,RawLz4");
+
+	TArray<FString> CodecNames;
+	CodecList.ParseIntoArray(CodecNames, TEXT(","));
+	TArray<FCaptureImageEncoding> Encodings;
+	for (const FString& CodecName : CodecNames)
+	{
+		FCaptureImageEncoding& Encoding = Encodings.AddDefaulted_GetRef();
+		if (!ParseEncoding(CodecName, Encoding))
+		{
+			UE_LOG(LogImageEncoderBenchmark, Error, TEXT("Unknown codec %s; expected Png<0-9>, Qoi, Jpeg<1-100> or RawLz4."), *CodecName);
+			return 1;
+		}
+	}
+	if (NumFrames <= 0 || Width <= 0 || Height <= 0 || Encodings.Num() == 0)
+	{
+		UE_LOG(LogImageEncoderBenchmark, Error, TEXT("Usage: -run=ImageEncoderBenchmark [-Frames=32] [-Width=1920] [-Height=1080] [-Codecs=Png0,Png2,Qoi,Jpeg90,RawLz4]"));
+		return 1;
+	}
+
+	TArray<TArray<FColor>> Frames;
+	Frames.SetNum(FMath::Min(NumFrames, NumDistinctFrames));
+	for (int32 FrameIndex = 0; FrameIndex < Frames.Num(); ++FrameIndex)
+	{
+		MakeFrame(Width, Height, FrameIndex, Frames[FrameIndex]);
+	}
+
+	// Constructing a pool loads the image wrapper module before the workers use it
+	FImageEncoderPool Pool;
+	const int32 NumWorkers = FTaskGraphInterface::Get().GetNumWorkerThreads();
+	const int64 FrameBytes = static_cast<int64>(Width) * Height * sizeof(FColor);
+	UE_LOG(LogImageEncoderBenchmark, Display, TEXT("Encoding %d frames of %dx%d on %d workers."), NumFrames, Width, Height, NumWorkers);
+
+	int32 NumFailed = 0;
+	TArray<TSharedPtr<FJsonValue>> CodecArray;
+	for (const FCaptureImageEncoding& Encoding : Encodings)
+	{
+		// A hand-written encoder that writes wrong pixels must not win on speed
+		if ((Encoding.Codec == ECaptureImageCodec::Qoi || Encoding.Codec == ECaptureImageCodec::RawLz4) && !VerifyRoundTrip(Frames, Width, Height, Encoding))
+		{
+			++NumFailed;
+			continue;
+		}
+
+		TArray<int64> EncodedBytes;
+		TArray<uint64> EncodeCycles;
+		EncodedBytes.SetNumZeroed(NumFrames);
+		EncodeCycles.SetNumZeroed(NumFrames);
+
+		const double StartTime = FPlatformTime::Seconds();
+		ParallelFor(NumFrames, [&](int32 FrameIndex)
+		{
+			const TArray<FColor>& Pixels = Frames[FrameIndex % Frames.Num()];
+			TArray64<uint8> Encoded;
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			if (FImageEncoderPool::Encode(Pixels.GetData(), Width, Height, Encoding, Encoded))
+			{
+				EncodeCycles[FrameIndex] = FPlatformTime::Cycles64() - StartCycles;
+				EncodedBytes[FrameIndex] = Encoded.Num();
+			}
+		});
+		const double WallSeconds = FPlatformTime::Seconds() - StartTime;
+
+		FImageEncoderStats Stats;
+		for (int32 FrameIndex = 0; FrameIndex < NumFrames; ++FrameIndex)
+		{
+			if (EncodedBytes[FrameIndex] > 0)
+			{
+				++Stats.NumFrames;
+				Stats.RawBytes += FrameBytes;
+				Stats.EncodedBytes += EncodedBytes[FrameIndex];
+				Stats.EncodeCycles += EncodeCycles[FrameIndex];
+			}
+		}
+		if (Stats.NumFrames < NumFrames)
+		{
+			UE_LOG(LogImageEncoderBenchmark, Error, TEXT("%s: %lld of %d frames failed to encode."), *Encoding.GetName(), NumFrames - Stats.NumFrames, NumFrames);
+			++NumFailed;
+		}
+
+		const double TotalMegabytesPerSecond = WallSeconds > 0.0 ? Stats.RawBytes / (1024.0 * 1024.0) / WallSeconds : 0.0;
+		const double FramesPerSecond = WallSeconds > 0.0 ? Stats.NumFrames / WallSeconds : 0.0;
+		const double AverageMegabytes = Stats.NumFrames > 0 ? Stats.EncodedBytes / (1024.0 * 1024.0) / Stats.NumFrames : 0.0;
+		UE_LOG(LogImageEncoderBenchmark, Display, TEXT("%-8s %8.1f MB/s per core %8.1f MB/s total %7.1f frames/s %6.2f:1 %7.2f MB per frame"), *Encoding.GetName(),
+			Stats.GetMegabytesPerSecond(), TotalMegabytesPerSecond, FramesPerSecond, Stats.GetCompressionRatio(), AverageMegabytes);
+
+		TSharedPtr<FJsonObject> CodecObj = MakeShareable(new FJsonObject());
+		CodecObj->SetStringField(TEXT("Codec"), Encoding.GetName());
+		CodecObj->SetStringField(TEXT("Extension"), Encoding.GetExtension());
+		CodecObj->SetNumberField(TEXT("Frames"), Stats.NumFrames);
+		CodecObj->SetNumberField(TEXT("MegabytesPerSecondPerCore"), Stats.GetMegabytesPerSecond());
+		CodecObj->SetNumberField(TEXT("MegabytesPerSecond"), TotalMegabytesPerSecond);
+		CodecObj->SetNumberField(TEXT("FramesPerSecond"), FramesPerSecond);
+		CodecObj->SetNumberField(TEXT("CompressionRatio"), Stats.GetCompressionRatio());
+		CodecObj->SetNumberField(TEXT("AverageBytes"), Stats.NumFrames > 0 ? static_cast<double>(Stats.EncodedBytes) / Stats.NumFrames : 0.0);
+		CodecArray.Add(MakeShareable(new FJsonValueObject(CodecObj)));
+	}
+
+	TSharedPtr<FJsonObject> RootObj = MakeShareable(new FJsonObject());
+	RootObj->SetNumberField(TEXT("Width"), Width);
+	RootObj->SetNumberField(TEXT("Height"), Height);
+	RootObj->SetNumberField(TEXT("Frames"), NumFrames);
+	RootObj->SetNumberField(TEXT("Workers"), NumWorkers);
+	RootObj->SetArrayField(TEXT("Codecs"), CodecArray);
+
+	FString OutputString;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&OutputString);
+	FJsonSerializer::Serialize(RootObj.ToSharedRef(), Writer);
+	const FString ReportPath = FPaths::ProjectSavedDir() + TEXT("ImageEncoderBenchmark.json");
+	if (!FFileHelper::SaveStringToFile(OutputString, *ReportPath))
+	{
+		UE_LOG(LogImageEncoderBenchmark, Warning, TEXT("Failed to write %s"), *ReportPath);
+	}
+	return NumFailed > 0 ? 1 : 0;
+}
+
+bool UImageEncoderBenchmarkCommandlet::ParseEncoding(const FString& Name, FCaptureImageEncoding& OutEncoding)
+{
+	if (Name.Equals(TEXT("Qoi"), ESearchCase::IgnoreCase))
+	{
+		OutEncoding.Codec = ECaptureImageCodec::Qoi;
+		return true;
+	}
+	if (Name.Equals(TEXT("RawLz4"), ESearchCase::IgnoreCase))
+	{
+		OutEncoding.Codec = ECaptureImageCodec::RawLz4;
+		return true;
+	}
+	if (Name.StartsWith(TEXT("Png")) && Name.Len() > 3 && Name.Mid(3).IsNumeric())
+	{
+		OutEncoding.Codec = ECaptureImageCodec::Png;
+		OutEncoding.PngCompressionLevel = FCString::Atoi(*Name.Mid(3));
+		return OutEncoding.PngCompressionLevel >= 0 && OutEncoding.PngCompressionLevel <= 9;
+	}
+	if (Name.StartsWith(TEXT("Jpeg")) && Name.Len() > 4 && Name.Mid(4).IsNumeric())
+	{
+		OutEncoding.Codec = ECaptureImageCodec::Jpeg;
+		OutEncoding.JpegQuality = FCString::Atoi(*Name.Mid(4));
+		return OutEncoding.JpegQuality >= 1 && OutEncoding.JpegQuality <= 100;
+	}
+	return false;
+}
+
+bool UImageEncoderBenchmarkCommandlet::VerifyRoundTrip(const TArray<TArray<FColor>>& Frames, int32 Width, int32 Height, const FCaptureImageEncoding& Encoding)
+{
+	for (int32 FrameIndex = 0; FrameIndex < Frames.Num(); ++FrameIndex)
+	{
+		// The synthetic frames are opaque, so forcing A = 255 while encoding leaves them unchanged
+		const TArray<FColor>& Pixels = Frames[FrameIndex];
+		TArray64<uint8> Encoded;
+		TArray64<FColor> Decoded;
+		int32 DecodedWidth = 0;
+		int32 DecodedHeight = 0;
+		if (!FImageEncoderPool::Encode(Pixels.GetData(), Width, Height, Encoding, Encoded)
+			|| !FImageEncoderPool::Decode(Encoded.GetData(), Encoded.Num(), Decoded, DecodedWidth, DecodedHeight))
+		{
+			UE_LOG(LogImageEncoderBenchmark, Error, TEXT("%s: Frame %d does not decode."), *Encoding.GetName(), FrameIndex);
+			return false;
+		}
+		if (DecodedWidth != Width || DecodedHeight != Height)
+		{
+			UE_LOG(LogImageEncoderBenchmark, Error, TEXT("%s: Frame %d decodes to %dx%d instead of %dx%d."), *Encoding.GetName(), FrameIndex, DecodedWidth, DecodedHeight, Width, Height);
+			return false;
+		}
+		for (int32 PixelIndex = 0; PixelIndex < Pixels.Num(); ++PixelIndex)
+		{
+			if (Decoded[PixelIndex] != Pixels[PixelIndex])
+			{
+				UE_LOG(LogImageEncoderBenchmark, Error, TEXT("%s: Frame %d decodes to %s instead of %s at pixel (%d, %d)."), *Encoding.GetName(), FrameIndex,
+					*Decoded[PixelIndex].ToString(), *Pixels[PixelIndex].ToString(), PixelIndex % Width, PixelIndex / Width);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+void UImageEncoderBenchmarkCommandlet::MakeFrame(int32 Width, int32 Height, int32 Seed, TArray<FColor>& OutPixels)
+{
+	using namespace ImageEncoderBenchmark;
+	FRandomStream Random(Seed);
+
+	// Sky-like vertical gradient with a horizontal tint
+	OutPixels.SetNumUninitialized(Width * Height);
+	for (int32 Y = 0; Y < Height; ++Y)
+	{
+		for (int32 X = 0; X < Width; ++X)
+		{
+			OutPixels[Y * Width + X] = FColor(60 + 120 * X / Width, 90 + 100 * Y / Height, 200 - 80 * Y / Height, 255);
+		}
+	}
+
+	// Flat shaded boxes standing in for floor, props and people
+	for (int32 ShapeIndex = 0; ShapeIndex < NumShapes; ++ShapeIndex)
+	{
+		const int32 MinX = Random.RandRange(0, Width - 1);
+		const int32 MinY = Random.RandRange(0, Height - 1);
+		const int32 MaxX = FMath::Min(MinX + Random.RandRange(Width / 32, Width / 4), Width);
+		const int32 MaxY = FMath::Min(MinY + Random.RandRange(Height / 16, Height / 2), Height);
+		const FColor Color(Random.RandRange(0, 255), Random.RandRange(0, 255), Random.RandRange(0, 255), 255);
+		for (int32 Y = MinY; Y < MaxY; ++Y)
+		{
+			// Darker towards the bottom, like a lit surface
+			const int32 Shade = 32 * (Y - MinY) / FMath::Max(MaxY - MinY, 1);
+			for (int32 X = MinX; X < MaxX; ++X)
+			{
+				OutPixels[Y * Width + X] = FColor(FMath::Max(Color.R - Shade, 0), FMath::Max(Color.G - Shade, 0), FMath::Max(Color.B - Shade, 0), 255);
+			}
+		}
+	}
+
+	for (FColor& Pixel : OutPixels)
+	{
+		Pixel.R = FMath::Clamp(Pixel.R + Random.RandRange(-NoiseAmplitude, NoiseAmplitude), 0, 255);
+		Pixel.G = FMath::Clamp(Pixel.G + Random.RandRange(-NoiseAmplitude, NoiseAmplitude), 0, 255);
+		Pixel.B = FMath::Clamp(Pixel.B + Random.RandRange(-NoiseAmplitude, NoiseAmplitude), 0, 255);
+	}
+}
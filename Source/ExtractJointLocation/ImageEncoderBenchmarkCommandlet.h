@@ -0,0 +1,35 @@
+// ImageEncoderBenchmarkCommandlet.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ImageEncoderPool.h"
+#include "ImageEncoderBenchmarkCommandlet.generated.h"
+
+/**
+ * Measures the capture codecs of FImageEncoderPool on synthetic render-like frames (gradients, flat shapes, mild
+ * noise), without rendering, so it runs under -nullrhi. Frames are encoded on every worker at once, as during
+ * capture; the report lists each codec's throughput per core and in total, its compression ratio and the average
+ * frame size, and is written to Saved/ImageEncoderBenchmark.json. Qoi and RawLz4 frames are decoded first and must
+ * match the source pixels; a codec that does not round-trip is reported as failed and left out of the report.
+ *
+ * UnrealEditor-Cmd Project.uproject -run=ImageEncoderBenchmark -nullrhi [-Frames=32] [-Width=1920] [-Height=1080]
+ *     [-Codecs=Png0,Png2,Qoi,Jpeg90,RawLz4]
+ */
+UCLASS()
+class EXTRACTJOINTLOCATION_API UImageEncoderBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UImageEncoderBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	// Parses names as returned by FCaptureImageEncoding::GetName(), e.g. "Png2" or "Jpeg90"
+	static bool ParseEncoding(const FString& Name, FCaptureImageEncoding& OutEncoding);
+	static void MakeFrame(int32 Width, int32 Height, int32 Seed, TArray<FColor>& OutPixels);
+	// Encodes and decodes every frame with a lossless hand-written codec; false if any decodes to other pixels
+	static bool VerifyRoundTrip(const TArray<TArray<FColor>>& Frames, int32 Width, int32 Height, const FCaptureImageEncoding& Encoding);
+};
@@ -0,0 +1,444 @@
+#include "ImageEncoderPool.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "Misc/Compression.h"
+#include "Misc/FileHelper.h"
+#include "Modules/ModuleManager.h"
+#include "HAL/PlatformTime.h"
+#include "Async/TaskGraphInterfaces.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogImageEncoderPool, Log, All);
+
+namespace ImageEncoderPool
+{
+	// QOI operations, see qoiformat.org/qoi-specification.pdf
+	static constexpr uint8 QoiOpIndex = 0x00;
+	static constexpr uint8 QoiOpDiff = 0x40;
+	static constexpr uint8 QoiOpLuma = 0x80;
+	static constexpr uint8 QoiOpRun = 0xc0;
+	static constexpr uint8 QoiOpRgb = 0xfe;
+	static constexpr uint8 QoiOpRgba = 0xff;
+	static constexpr int32 QoiHeaderSize = 14;
+	static constexpr uint8 QoiEndMarker[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+
+	static int64 GetQoiMaxSize(int32 Width, int32 Height)
+	{
+		return QoiHeaderSize + static_cast<int64>(Width) * Height * 5 + sizeof(QoiEndMarker);
+	}
+
+	// Writes a 4 channel sRGB QOI image to Out, which holds GetQoiMaxSize bytes; returns the bytes written
+	static int64 EncodeQoi(const FColor* Pixels, int32 Width, int32 Height, uint8* Out)
+	{
+		uint8* Write = Out;
+		auto WriteBigEndian32 = [&Write](uint32 Value)
+		{
+			*Write++ = static_cast<uint8>(Value >> 24);
+			*Write++ = static_cast<uint8>(Value >> 16);
+			*Write++ = static_cast<uint8>(Value >> 8);
+			*Write++ = static_cast<uint8>(Value);
+		};
+		*Write++ = 'q';
+		*Write++ = 'o';
+		*Write++ = 'i';
+		*Write++ = 'f';
+		WriteBigEndian32(static_cast<uint32>(Width));
+		WriteBigEndian32(static_cast<uint32>(Height));
+		*Write++ = 4;
+		*Write++ = 0;
+
+		FColor Index[64];
+		FMemory::Memzero(Index);
+		FColor Previous(0, 0, 0, 255);
+		int32 Run = 0;
+		const int64 NumPixels = static_cast<int64>(Width) * Height;
+		for (int64 PixelIndex = 0; PixelIndex < NumPixels; ++PixelIndex)
+		{
+			const FColor Pixel = Pixels[PixelIndex];
+			if (Pixel == Previous)
+			{
+				if (++Run == 62 || PixelIndex == NumPixels - 1)
+				{
+					*Write++ = QoiOpRun | static_cast<uint8>(Run - 1);
+					Run = 0;
+				}
+				continue;
+			}
+			if (Run > 0)
+			{
+				*Write++ = QoiOpRun | static_cast<uint8>(Run - 1);
+				Run = 0;
+			}
+
+			const int32 Hash = (Pixel.R * 3 + Pixel.G * 5 + Pixel.B * 7 + Pixel.A * 11) % 64;
+			if (Index[Hash] == Pixel)
+			{
+				*Write++ = QoiOpIndex | static_cast<uint8>(Hash);
+			}
+			else if (Pixel.A == Previous.A)
+			{
+				Index[Hash] = Pixel;
+				// Differences wrap around, as in the reference encoder
+				const int8 DeltaR = static_cast<int8>(Pixel.R - Previous.R);
+				const int8 DeltaG = static_cast<int8>(Pixel.G - Previous.G);
+				const int8 DeltaB = static_cast<int8>(Pixel.B - Previous.B);
+				const int8 DeltaRG = static_cast<int8>(DeltaR - DeltaG);
+				const int8 DeltaBG = static_cast<int8>(DeltaB - DeltaG);
+				if (DeltaR > -3 && DeltaR < 2 && DeltaG > -3 && DeltaG < 2 && DeltaB > -3 && DeltaB < 2)
+				{
+					*Write++ = QoiOpDiff | static_cast<uint8>((DeltaR + 2) << 4 | (DeltaG + 2) << 2 | (DeltaB + 2));
+				}
+				else if (DeltaRG > -9 && DeltaRG < 8 && DeltaG > -33 && DeltaG < 32 && DeltaBG > -9 && DeltaBG < 8)
+				{
+					*Write++ = QoiOpLuma | static_cast<uint8>(DeltaG + 32);
+					*Write++ = static_cast<uint8>((DeltaRG + 8) << 4 | (DeltaBG + 8));
+				}
+				else
+				{
+					*Write++ = QoiOpRgb;
+					*Write++ = Pixel.R;
+					*Write++ = Pixel.G;
+					*Write++ = Pixel.B;
+				}
+			}
+			else
+			{
+				Index[Hash] = Pixel;
+				*Write++ = QoiOpRgba;
+				*Write++ = Pixel.R;
+				*Write++ = Pixel.G;
+				*Write++ = Pixel.B;
+				*Write++ = Pixel.A;
+			}
+			Previous = Pixel;
+		}
+
+		FMemory::Memcpy(Write, QoiEndMarker, sizeof(QoiEndMarker));
+		Write += sizeof(QoiEndMarker);
+		return Write - Out;
+	}
+
+	// Reads a QOI image as written by EncodeQoi; false if it is truncated or malformed
+	static bool DecodeQoi(const uint8* Data, int64 Size, TArray64<FColor>& OutPixels, int32& OutWidth, int32& OutHeight)
+	{
+		if (Size < QoiHeaderSize + static_cast<int64>(sizeof(QoiEndMarker)) || FMemory::Memcmp(Data, "qoif", 4) != 0)
+		{
+			return false;
+		}
+		auto ReadBigEndian32 = [Data](int32 Offset)
+		{
+			return static_cast<uint32>(Data[Offset]) << 24 | static_cast<uint32>(Data[Offset + 1]) << 16 | static_cast<uint32>(Data[Offset + 2]) << 8 | Data[Offset + 3];
+		};
+		const uint32 Width = ReadBigEndian32(4);
+		const uint32 Height = ReadBigEndian32(8);
+		const uint8* Read = Data + QoiHeaderSize;
+		const uint8* End = Data + Size - sizeof(QoiEndMarker);
+		const int64 NumPixels = static_cast<int64>(Width) * Height;
+		// A run byte covers at most 62 pixels
+		if (Width == 0 || Height == 0 || Width > MAX_int32 || Height > MAX_int32 || NumPixels > (End - Read) * 62)
+		{
+			return false;
+		}
+
+		OutPixels.SetNumUninitialized(NumPixels);
+		FColor Index[64];
+		FMemory::Memzero(Index);
+		FColor Pixel(0, 0, 0, 255);
+		int32 Run = 0;
+		for (int64 PixelIndex = 0; PixelIndex < NumPixels; ++PixelIndex)
+		{
+			if (Run > 0)
+			{
+				--Run;
+				OutPixels[PixelIndex] = Pixel;
+				continue;
+			}
+			if (Read >= End)
+			{
+				return false;
+			}
+
+			const uint8 Op = *Read++;
+			if (Op == QoiOpRgb || Op == QoiOpRgba)
+			{
+				const int32 NumChannels = Op == QoiOpRgb ? 3 : 4;
+				if (End - Read < NumChannels)
+				{
+					return false;
+				}
+				Pixel.R = Read[0];
+				Pixel.G = Read[1];
+				Pixel.B = Read[2];
+				Pixel.A = NumChannels == 4 ? Read[3] : Pixel.A;
+				Read += NumChannels;
+			}
+			else if ((Op & 0xc0) == QoiOpIndex)
+			{
+				Pixel = Index[Op & 0x3f];
+			}
+			else if ((Op & 0xc0) == QoiOpDiff)
+			{
+				Pixel.R = static_cast<uint8>(Pixel.R + ((Op >> 4) & 0x03) - 2);
+				Pixel.G = static_cast<uint8>(Pixel.G + ((Op >> 2) & 0x03) - 2);
+				Pixel.B = static_cast<uint8>(Pixel.B + (Op & 0x03) - 2);
+			}
+			else if ((Op & 0xc0) == QoiOpLuma)
+			{
+				if (Read >= End)
+				{
+					return false;
+				}
+				const uint8 Deltas = *Read++;
+				const int32 DeltaG = (Op & 0x3f) - 32;
+				Pixel.R = static_cast<uint8>(Pixel.R + DeltaG - 8 + (Deltas >> 4));
+				Pixel.G = static_cast<uint8>(Pixel.G + DeltaG);
+				Pixel.B = static_cast<uint8>(Pixel.B + DeltaG - 8 + (Deltas & 0x0f));
+			}
+			else
+			{
+				Run = Op & 0x3f;
+			}
+			Index[(Pixel.R * 3 + Pixel.G * 5 + Pixel.B * 7 + Pixel.A * 11) % 64] = Pixel;
+			OutPixels[PixelIndex] = Pixel;
+		}
+
+		OutWidth = static_cast<int32>(Width);
+		OutHeight = static_cast<int32>(Height);
+		return Read == End && FMemory::Memcmp(End, QoiEndMarker, sizeof(QoiEndMarker)) == 0;
+	}
+
+	static bool EncodeWithImageWrapper(EImageFormat Format, int32 Quality, const FColor* Pixels, int32 Width, int32 Height, TArray64<uint8>& OutEncoded)
+	{
+		// Loaded on the game thread by FImageEncoderPool's constructor, so workers only look it up
+		IImageWrapperModule* ImageWrapperModule = FModuleManager::GetModulePtr<IImageWrapperModule>(TEXT("ImageWrapper"));
+		TSharedPtr<IImageWrapper> ImageWrapper = ImageWrapperModule ? ImageWrapperModule->CreateImageWrapper(Format) : nullptr;
+		if (!ImageWrapper.IsValid() || !ImageWrapper->SetRaw(Pixels, static_cast<int64>(Width) * Height * sizeof(FColor), Width, Height, ERGBFormat::BGRA, 8))
+		{
+			return false;
+		}
+		OutEncoded = ImageWrapper->GetCompressed(Quality);
+		return OutEncoded.Num() > 0;
+	}
+}
+
+const TCHAR* FCaptureImageEncoding::GetExtension() const
+{
+	switch (Codec)
+	{
+	case ECaptureImageCodec::Qoi:
+		return TEXT("qoi");
+	case ECaptureImageCodec::Jpeg:
+		return TEXT("jpg");
+	case ECaptureImageCodec::RawLz4:
+		return TEXT("bgra.lz4");
+	default:
+		return TEXT("png");
+	}
+}
+
+FString FCaptureImageEncoding::GetName() const
+{
+	switch (Codec)
+	{
+	case ECaptureImageCodec::Qoi:
+		return TEXT("Qoi");
+	case ECaptureImageCodec::Jpeg:
+		return FString::Printf(TEXT("Jpeg%d"), JpegQuality);
+	case ECaptureImageCodec::RawLz4:
+		return TEXT("RawLz4");
+	default:
+		return FString::Printf(TEXT("Png%d"), PngCompressionLevel);
+	}
+}
+
+double FImageEncoderStats::GetMegabytesPerSecond() const
+{
+	const double Seconds = FPlatformTime::ToSeconds64(EncodeCycles);
+	return Seconds > 0.0 ? RawBytes / (1024.0 * 1024.0) / Seconds : 0.0;
+}
+
+FImageEncoderPool::FImageEncoderPool(int32 InMaxFramesInFlight)
+	: MaxFramesInFlight(InMaxFramesInFlight > 0 ? InMaxFramesInFlight : FMath::Max(2 * FTaskGraphInterface::Get().GetNumWorkerThreads(), 2))
+{
+	FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+}
+
+FImageEncoderPool::~FImageEncoderPool()
+{
+	Flush();
+}
+
+bool FImageEncoderPool::Encode(const FColor* Pixels, int32 Width, int32 Height, const FCaptureImageEncoding& Encoding, TArray64<uint8>& OutEncoded, bool bForceOpaque)
+{
+	using namespace ImageEncoderPool;
+	OutEncoded.Reset();
+	if (!Pixels || Width <= 0 || Height <= 0)
+	{
+		return false;
+	}
+
+	const int64 RawBytes = static_cast<int64>(Width) * Height * sizeof(FColor);
+	if (bForceOpaque)
+	{
+		TArray64<FColor> OpaquePixels(Pixels, static_cast<int64>(Width) * Height);
+		for (FColor& Pixel : OpaquePixels)
+		{
+			Pixel.A = 255;
+		}
+		return Encode(OpaquePixels.GetData(), Width, Height, Encoding, OutEncoded, false);
+	}
+
+	switch (Encoding.Codec)
+	{
+	case ECaptureImageCodec::Qoi:
+	{
+		OutEncoded.SetNumUninitialized(GetQoiMaxSize(Width, Height));
+		OutEncoded.SetNum(EncodeQoi(Pixels, Width, Height, OutEncoded.GetData()), EAllowShrinking::No);
+		return true;
+	}
+	case ECaptureImageCodec::Jpeg:
+		return EncodeWithImageWrapper(EImageFormat::JPEG, FMath::Clamp(Encoding.JpegQuality, 1, 100), Pixels, Width, Height, OutEncoded);
+	case ECaptureImageCodec::RawLz4:
+	{
+		if (RawBytes > MAX_int32)
+		{
+			return false;
+		}
+		FRawLz4ImageHeader Header;
+		Header.Width = Width;
+		Header.Height = Height;
+		Header.UncompressedSize = RawBytes;
+
+		int32 CompressedSize = FCompression::CompressMemoryBound(NAME_LZ4, static_cast<int32>(RawBytes));
+		OutEncoded.SetNumUninitialized(sizeof(Header) + CompressedSize);
+		FMemory::Memcpy(OutEncoded.GetData(), &Header, sizeof(Header));
+		if (!FCompression::CompressMemory(NAME_LZ4, OutEncoded.GetData() + sizeof(Header), CompressedSize, Pixels, static_cast<int32>(RawBytes)))
+		{
+			return false;
+		}
+		OutEncoded.SetNum(sizeof(Header) + CompressedSize, EAllowShrinking::No);
+		return true;
+	}
+	default:
+		// Passed through as EImageCompressionQuality: 0 is the default level and 1 is uncompressed, not zlib level 1
+		return EncodeWithImageWrapper(EImageFormat::PNG, FMath::Clamp(Encoding.PngCompressionLevel, 0, 9), Pixels, Width, Height, OutEncoded);
+	}
+}
+
+bool FImageEncoderPool::Decode(const uint8* Encoded, int64 EncodedSize, TArray64<FColor>& OutPixels, int32& OutWidth, int32& OutHeight)
+{
+	using namespace ImageEncoderPool;
+	OutPixels.Reset();
+	if (!Encoded || EncodedSize < 4)
+	{
+		return false;
+	}
+	if (FMemory::Memcmp(Encoded, "qoif", 4) == 0)
+	{
+		return DecodeQoi(Encoded, EncodedSize, OutPixels, OutWidth, OutHeight);
+	}
+
+	FRawLz4ImageHeader Header;
+	if (EncodedSize < static_cast<int64>(sizeof(Header)))
+	{
+		return false;
+	}
+	FMemory::Memcpy(&Header, Encoded, sizeof(Header));
+	const int64 NumPixels = static_cast<int64>(Header.Width) * Header.Height;
+	if (Header.FileMagic != FRawLz4ImageHeader::Magic || Header.Version != FRawLz4ImageHeader::CurrentVersion || Header.PixelFormat != 0
+		|| Header.Width > MAX_int32 || Header.Height > MAX_int32 || Header.UncompressedSize != NumPixels * sizeof(FColor)
+		|| Header.UncompressedSize > MAX_int32 || EncodedSize - static_cast<int64>(sizeof(Header)) > MAX_int32)
+	{
+		return false;
+	}
+	OutPixels.SetNumUninitialized(NumPixels);
+	if (!FCompression::UncompressMemory(NAME_LZ4, OutPixels.GetData(), static_cast<int32>(Header.UncompressedSize), Encoded + sizeof(Header), static_cast<int32>(EncodedSize - sizeof(Header))))
+	{
+		OutPixels.Reset();
+		return false;
+	}
+	OutWidth = static_cast<int32>(Header.Width);
+	OutHeight = static_cast<int32>(Header.Height);
+	return true;
+}
+
+FString FImageEncoderPool::EncodeToFile(TArray<FColor>&& Pixels, int32 Width, int32 Height, const FCaptureImageEncoding& Encoding, const FString& FilePathWithoutExtension, bool bForceOpaque)
+{
+	const FString FilePath = FilePathWithoutExtension + TEXT(".") + Encoding.GetExtension();
+
+	// The worker owns the pixels; encoding and writing both run off the calling thread
+	PendingFrames.Add(UE::Tasks::Launch(UE_SOURCE_LOCATION,
+		[Pixels = MoveTemp(Pixels), Width, Height, Encoding, FilePath, bForceOpaque]() mutable
+		{
+			// The worker owns the pixels, so alpha is fixed in place instead of in a copy
+			if (bForceOpaque)
+			{
+				for (FColor& Pixel : Pixels)
+				{
+					Pixel.A = 255;
+				}
+			}
+
+			FEncodedFrame Frame;
+			Frame.CodecName = Encoding.GetName();
+			Frame.FilePath = FilePath;
+			Frame.RawBytes = static_cast<int64>(Width) * Height * sizeof(FColor);
+
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			TArray64<uint8> Encoded;
+			const bool bEncoded = Pixels.Num() == Width * Height && Encode(Pixels.GetData(), Width, Height, Encoding, Encoded, false);
+			Frame.Cycles = FPlatformTime::Cycles64() - StartCycles;
+			Frame.EncodedBytes = Encoded.Num();
+			Frame.bSaved = bEncoded && FFileHelper::SaveArrayToFile(Encoded, *FilePath);
+			return Frame;
+		}));
+
+	// Bound memory: wait for the oldest frame once too many are in flight
+	if (PendingFrames.Num() > MaxFramesInFlight)
+	{
+		PendingFrames[0].Wait();
+	}
+	CollectCompletedFrames(false);
+	return FilePath;
+}
+
+void FImageEncoderPool::Flush()
+{
+	CollectCompletedFrames(true);
+}
+
+void FImageEncoderPool::CollectCompletedFrames(bool bWaitForAll)
+{
+	int32 NumCollected = 0;
+	for (; NumCollected < PendingFrames.Num(); ++NumCollected)
+	{
+		UE::Tasks::TTask<FEncodedFrame>& Task = PendingFrames[NumCollected];
+		if (!bWaitForAll && !Task.IsCompleted())
+		{
+			break;
+		}
+
+		const FEncodedFrame& Frame = Task.GetResult();
+		if (!Frame.bSaved)
+		{
+			UE_LOG(LogImageEncoderPool, Error, TEXT("Failed to encode or write %s"), *Frame.FilePath);
+			continue;
+		}
+		FImageEncoderStats& CodecStats = Stats.FindOrAdd(Frame.CodecName);
+		++CodecStats.NumFrames;
+		CodecStats.RawBytes += Frame.RawBytes;
+		CodecStats.EncodedBytes += Frame.EncodedBytes;
+		CodecStats.EncodeCycles += Frame.Cycles;
+	}
+	PendingFrames.RemoveAt(0, NumCollected);
+}
+
+void FImageEncoderPool::LogStats() const
+{
+	for (const TPair<FString, FImageEncoderStats>& Pair : Stats)
+	{
+		const FImageEncoderStats& CodecStats = Pair.Value;
+		UE_LOG(LogImageEncoderPool, Log, TEXT("%s: %lld frames, %.1f MB/s per core, %.2f:1, %.2f MB per frame."), *Pair.Key, CodecStats.NumFrames,
+			CodecStats.GetMegabytesPerSecond(), CodecStats.GetCompressionRatio(),
+			CodecStats.NumFrames > 0 ? CodecStats.EncodedBytes / (1024.0 * 1024.0) / CodecStats.NumFrames : 0.0);
+	}
+}
@@ -0,0 +1,130 @@
+// ImageEncoderPool.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tasks/Task.h"
+#include "ImageEncoderPool.generated.h"
+
+// File format captured frames are written in
+UENUM(BlueprintType)
+enum class ECaptureImageCodec : uint8
+{
+	// Lossless, read everywhere; the slowest to encode at high compression levels
+	Png,
+	// Lossless "Quite OK Image" format (qoiformat.org), several times faster than PNG at a similar size on renders
+	Qoi,
+	// Lossy, the smallest files
+	Jpeg,
+	// BGRA8 pixels as one LZ4 block after an FRawLz4ImageHeader, the fastest to write and to read back
+	RawLz4
+};
+
+USTRUCT(BlueprintType)
+struct EXTRACTJOINTLOCATION_API FCaptureImageEncoding
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Image Encoding")
+	ECaptureImageCodec Codec = ECaptureImageCodec::Png;
+
+	/**
+	 * Compression quality passed to the engine's PNG writer: 0 uses its default zlib level, 1 writes uncompressed PNGs
+	 * (zlib level 0, the fastest and largest), and 2 to 9 are zlib levels from faster to smaller.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Image Encoding", meta = (ClampMin = "0", ClampMax = "9", EditCondition = "Codec == ECaptureImageCodec::Png"))
+	int32 PngCompressionLevel = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Image Encoding", meta = (ClampMin = "1", ClampMax = "100", EditCondition = "Codec == ECaptureImageCodec::Jpeg"))
+	int32 JpegQuality = 90;
+
+	/** File extension without the dot, e.g. "png" or "bgra.lz4". */
+	const TCHAR* GetExtension() const;
+	/** Short name for logs and benchmark tables, e.g. "Png2" or "Jpeg90". */
+	FString GetName() const;
+};
+
+/** Header of ECaptureImageCodec::RawLz4 files, followed by the LZ4 block of Height rows of Width BGRA8 pixels. */
+struct FRawLz4ImageHeader
+{
+	static constexpr uint32 Magic = 0x3452574B; // "KWR4"
+	static constexpr uint16 CurrentVersion = 1;
+
+	uint32 FileMagic = Magic;
+	uint16 Version = CurrentVersion;
+	// 0 = BGRA8
+	uint16 PixelFormat = 0;
+	uint32 Width = 0;
+	uint32 Height = 0;
+	uint64 UncompressedSize = 0;
+};
+
+/** Frames, bytes and encode time of one codec, accumulated by FImageEncoderPool. */
+struct FImageEncoderStats
+{
+	int64 NumFrames = 0;
+	int64 RawBytes = 0;
+	int64 EncodedBytes = 0;
+	uint64 EncodeCycles = 0;
+
+	/** Raw megabytes encoded per second of worker time, i.e. the throughput of one core. */
+	double GetMegabytesPerSecond() const;
+	double GetCompressionRatio() const { return EncodedBytes > 0 ? static_cast<double>(RawBytes) / EncodedBytes : 0.0; }
+};
+
+/**
+ * Encodes captured frames with a selectable codec and writes them on worker threads, so capture continues while
+ * earlier frames compress on every core. Per-codec throughput and size are accumulated on the calling thread as
+ * frames complete.
+ */
+class EXTRACTJOINTLOCATION_API FImageEncoderPool
+{
+public:
+	/** @param MaxFramesInFlight Frames being encoded at once before EncodeToFile waits for the oldest; 0 = twice the worker count. */
+	explicit FImageEncoderPool(int32 MaxFramesInFlight = 0);
+	~FImageEncoderPool();
+
+	/**
+	 * Encodes a frame synchronously on the calling thread.
+	 * @param Pixels Width x Height BGRA pixels, tightly packed.
+	 * @param bForceOpaque Scene captures leave inverse opacity in alpha; set to write A = 255 instead (encodes a copy).
+	 */
+	static bool Encode(const FColor* Pixels, int32 Width, int32 Height, const FCaptureImageEncoding& Encoding, TArray64<uint8>& OutEncoded, bool bForceOpaque = true);
+
+	/**
+	 * Decodes a Qoi or RawLz4 frame as written by Encode; PNG and JPEG are read with the image wrapper instead.
+	 * @return False if the data is neither codec or is malformed.
+	 */
+	static bool Decode(const uint8* Encoded, int64 EncodedSize, TArray64<FColor>& OutPixels, int32& OutWidth, int32& OutHeight);
+
+	/**
+	 * Queues a frame for encoding and writing to FilePathWithoutExtension + "." + Encoding.GetExtension().
+	 * @param bForceOpaque Scene captures leave inverse opacity in alpha; set to write A = 255 instead.
+	 * @return The path the frame is written to.
+	 */
+	FString EncodeToFile(TArray<FColor>&& Pixels, int32 Width, int32 Height, const FCaptureImageEncoding& Encoding, const FString& FilePathWithoutExtension, bool bForceOpaque = true);
+
+	/** Waits for every queued frame. */
+	void Flush();
+
+	const TMap<FString, FImageEncoderStats>& GetStats() const { return Stats; }
+	/** Logs frames, MB/s and compression ratio of every codec used. */
+	void LogStats() const;
+
+private:
+	struct FEncodedFrame
+	{
+		FString CodecName;
+		FString FilePath;
+		int64 RawBytes = 0;
+		int64 EncodedBytes = 0;
+		uint64 Cycles = 0;
+		bool bSaved = false;
+	};
+
+	void CollectCompletedFrames(bool bWaitForAll);
+
+	int32 MaxFramesInFlight;
+	TArray<UE::Tasks::TTask<FEncodedFrame>> PendingFrames;
+	// By FCaptureImageEncoding::GetName()
+	TMap<FString, FImageEncoderStats> Stats;
+};
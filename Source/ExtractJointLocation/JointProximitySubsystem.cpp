@@ -0,0 +1,478 @@
+#include "JointProximitySubsystem.h"
+#include "CaptureOutputSubsystem.h"
+#include "Components/ActorComponent.h"
+#include "Engine/World.h"
+#include "HAL/PlatformTime.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogJointProximity, Log, All);
+
+namespace JointProximity
+{
+	static constexpr uint64 InvalidCell = ~0ull;
+	// Cell coordinates are packed into 21 bits per axis, about +-10 km with 1 cm cells
+	static constexpr int32 CellCoordinateBias = 1 << 20;
+	static constexpr uint64 CellCoordinateMask = (1ull << 21) - 1;
+	// Queries spanning more cells per axis than this visit all joints instead
+	static constexpr int32 MaxQueryCellsPerAxis = 32;
+}
+
+UJointProximitySubsystem::UJointProximitySubsystem()
+{
+	// 25 cm cells hold a few joints of a body; hands are in contact within 8 cm of each other
+	CellSize = 25.0f;
+	ContactDistance = 8.0f;
+	GroundContactJoints = { TEXT("foot_l"), TEXT("ball_l"), TEXT("foot_r"), TEXT("ball_r") };
+	GroundHeight = 0.0f;
+	bTraceGround = false;
+	GroundContactHeight = 10.0f;
+	GroundContactSpeed = 30.0f;
+	bWriteContactLabels = true;
+	// One record per 10 s at 60 fps
+	LabelFramesPerRecord = 600;
+	MaxSubjectAgeFrames = 2;
+}
+
+void UJointProximitySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UJointProximitySubsystem::OnWorldPostActorTick);
+}
+
+void UJointProximitySubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+	if (NumEvaluatedFrames > 0)
+	{
+		UE_LOG(LogJointProximity, Log, TEXT("Evaluated %d frames of up to %d joints, %.3f ms per frame."),
+			NumEvaluatedFrames, Positions.Num(), FPlatformTime::ToMilliseconds64(EvaluateCycles) / NumEvaluatedFrames);
+	}
+	Super::Deinitialize();
+}
+
+FIntVector UJointProximitySubsystem::GetCellCoordinates(const FVector& Position) const
+{
+	const double InvCellSize = 1.0 / FMath::Max(CellSize, 1.0f);
+	return FIntVector(FMath::FloorToInt32(Position.X * InvCellSize), FMath::FloorToInt32(Position.Y * InvCellSize), FMath::FloorToInt32(Position.Z * InvCellSize));
+}
+
+uint64 UJointProximitySubsystem::MakeCellKey(const FIntVector& Cell)
+{
+	using namespace JointProximity;
+	return (static_cast<uint64>(Cell.X + CellCoordinateBias) & CellCoordinateMask)
+		| ((static_cast<uint64>(Cell.Y + CellCoordinateBias) & CellCoordinateMask) << 21)
+		| ((static_cast<uint64>(Cell.Z + CellCoordinateBias) & CellCoordinateMask) << 42);
+}
+
+uint64 UJointProximitySubsystem::GetCellKey(const FVector& Position) const
+{
+	return MakeCellKey(GetCellCoordinates(Position));
+}
+
+void UJointProximitySubsystem::AddJointToCell(int32 Joint, uint64 CellKey)
+{
+	int32* CellIndex = CellsByKey.Find(CellKey);
+	if (!CellIndex)
+	{
+		const int32 NewCell = FreeCells.Num() > 0 ? FreeCells.Pop(EAllowShrinking::No) : Cells.AddDefaulted();
+		CellIndex = &CellsByKey.Add(CellKey, NewCell);
+	}
+	Cells[*CellIndex].Add(Joint);
+	JointCells[Joint] = CellKey;
+}
+
+void UJointProximitySubsystem::RemoveJointFromCell(int32 Joint, uint64 CellKey)
+{
+	if (const int32* CellIndex = CellsByKey.Find(CellKey))
+	{
+		FCellJoints& Cell = Cells[*CellIndex];
+		Cell.RemoveSingleSwap(Joint, EAllowShrinking::No);
+		if (Cell.Num() == 0)
+		{
+			FreeCells.Add(*CellIndex);
+			CellsByKey.Remove(CellKey);
+		}
+	}
+	JointCells[Joint] = JointProximity::InvalidCell;
+}
+
+void UJointProximitySubsystem::UpdateSubject(const UObject* Owner, const FString& SubjectName, int32 FrameIndex, float TimeSeconds, TArrayView<const FName> JointNames, TArrayView<const FVector> NewPositions)
+{
+	if (!Owner || JointNames.Num() != NewPositions.Num())
+	{
+		return;
+	}
+
+	const int32* ExistingSubject = SubjectsByOwner.Find(Owner);
+	if (ExistingSubject && Subjects[*ExistingSubject].JointNames != JointNames)
+	{
+		RemoveSubject(Owner);
+		ExistingSubject = nullptr;
+	}
+
+	int32 SubjectIndex = ExistingSubject ? *ExistingSubject : INDEX_NONE;
+	if (SubjectIndex == INDEX_NONE)
+	{
+		FSubject& NewSubject = Subjects.AddDefaulted_GetRef();
+		NewSubject.Owner = Owner;
+		NewSubject.OwnerKey = Owner;
+		NewSubject.JointNames = TArray<FName>(JointNames);
+		NewSubject.FirstJoint = Positions.Num();
+		NewSubject.bActive = true;
+		SubjectIndex = Subjects.Num() - 1;
+		SubjectsByOwner.Add(Owner, SubjectIndex);
+
+		Positions.Append(NewPositions);
+		PreviousPositions.Append(NewPositions);
+		for (int32 i = NewSubject.FirstJoint; i < Positions.Num(); ++i)
+		{
+			JointCells.Add(JointProximity::InvalidCell);
+			JointSubjects.Add(SubjectIndex);
+		}
+	}
+
+	FSubject& Subject = Subjects[SubjectIndex];
+	Subject.Name = SubjectName;
+	Subject.bHasPrevious = ExistingSubject != nullptr;
+	Subject.PreviousTimeSeconds = Subject.TimeSeconds;
+	Subject.TimeSeconds = TimeSeconds;
+	Subject.FrameIndex = FrameIndex;
+	Subject.LastUpdateFrame = GFrameCounter;
+	Subject.bUpdated = true;
+
+	// Joints only change cells when they cross a cell boundary, which most do not between frames
+	for (int32 i = 0; i < NewPositions.Num(); ++i)
+	{
+		const int32 Joint = Subject.FirstJoint + i;
+		PreviousPositions[Joint] = Positions[Joint];
+		Positions[Joint] = NewPositions[i];
+
+		const uint64 CellKey = GetCellKey(NewPositions[i]);
+		if (CellKey != JointCells[Joint])
+		{
+			if (JointCells[Joint] != JointProximity::InvalidCell)
+			{
+				RemoveJointFromCell(Joint, JointCells[Joint]);
+			}
+			AddJointToCell(Joint, CellKey);
+		}
+	}
+}
+
+void UJointProximitySubsystem::RemoveSubject(const UObject* Owner)
+{
+	if (const int32* SubjectIndex = SubjectsByOwner.Find(Owner))
+	{
+		RemoveSubjectAt(*SubjectIndex);
+	}
+}
+
+void UJointProximitySubsystem::RemoveSubjectAt(int32 SubjectIndex)
+{
+	FSubject& Subject = Subjects[SubjectIndex];
+	SubjectsByOwner.Remove(Subject.OwnerKey);
+	for (int32 Joint = Subject.FirstJoint; Joint < Subject.FirstJoint + Subject.JointNames.Num(); ++Joint)
+	{
+		if (JointCells[Joint] != JointProximity::InvalidCell)
+		{
+			RemoveJointFromCell(Joint, JointCells[Joint]);
+		}
+		JointSubjects[Joint] = INDEX_NONE;
+	}
+	Subject.bActive = false;
+	Subject.bUpdated = false;
+
+	// Joint slots of removed subjects are only reclaimed once no subject is left, which also ends the label stream
+	if (SubjectsByOwner.Num() == 0)
+	{
+		FlushContactLabels();
+		Subjects.Reset();
+		Positions.Reset();
+		PreviousPositions.Reset();
+		JointCells.Reset();
+		JointSubjects.Reset();
+		CellsByKey.Reset();
+		Cells.Reset();
+		FreeCells.Reset();
+	}
+}
+
+void UJointProximitySubsystem::EvictStaleSubjects()
+{
+	// Removing the last subject resets Subjects, which ends the loop
+	for (int32 SubjectIndex = 0; SubjectIndex < Subjects.Num(); ++SubjectIndex)
+	{
+		const FSubject& Subject = Subjects[SubjectIndex];
+		if (Subject.bActive && GFrameCounter - Subject.LastUpdateFrame > static_cast<uint64>(FMath::Max(MaxSubjectAgeFrames, 1)))
+		{
+			UE_LOG(LogJointProximity, Log, TEXT("Removing subject '%s', it was last updated %llu frames ago."), *Subject.Name, GFrameCounter - Subject.LastUpdateFrame);
+			RemoveSubjectAt(SubjectIndex);
+		}
+	}
+}
+
+void UJointProximitySubsystem::ForEachJointNear(const FVector& Position, float HalfExtent, TFunctionRef<void(int32 Joint)> Visit) const
+{
+	const FIntVector MinCell = GetCellCoordinates(Position - FVector(HalfExtent));
+	const FIntVector MaxCell = GetCellCoordinates(Position + FVector(HalfExtent));
+	const FIntVector CellRange = MaxCell - MinCell;
+	if (CellRange.GetMax() >= JointProximity::MaxQueryCellsPerAxis)
+	{
+		for (int32 Joint = 0; Joint < JointSubjects.Num(); ++Joint)
+		{
+			if (JointSubjects[Joint] != INDEX_NONE)
+			{
+				Visit(Joint);
+			}
+		}
+		return;
+	}
+
+	for (int32 Z = MinCell.Z; Z <= MaxCell.Z; ++Z)
+	{
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+		{
+			for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+			{
+				if (const int32* CellIndex = CellsByKey.Find(MakeCellKey(FIntVector(X, Y, Z))))
+				{
+					for (const int32 Joint : Cells[*CellIndex])
+					{
+						Visit(Joint);
+					}
+				}
+			}
+		}
+	}
+}
+
+FJointProximityHit UJointProximitySubsystem::MakeHit(int32 Joint, float Distance) const
+{
+	const FSubject& Subject = Subjects[JointSubjects[Joint]];
+	FJointProximityHit Hit;
+	Hit.Subject = Subject.Name;
+	Hit.Joint = Subject.JointNames[Joint - Subject.FirstJoint];
+	Hit.Position = Positions[Joint];
+	Hit.Distance = Distance;
+	return Hit;
+}
+
+bool UJointProximitySubsystem::FindNearestJoint(const FVector& Position, float MaxDistance, const FString& IgnoredSubject, FJointProximityHit& OutHit) const
+{
+	int32 NearestJoint = INDEX_NONE;
+	double NearestDistanceSquared = FMath::Square(static_cast<double>(MaxDistance));
+	ForEachJointNear(Position, MaxDistance, [&](int32 Joint)
+	{
+		const double DistanceSquared = FVector::DistSquared(Position, Positions[Joint]);
+		if (DistanceSquared <= NearestDistanceSquared && (IgnoredSubject.IsEmpty() || Subjects[JointSubjects[Joint]].Name != IgnoredSubject))
+		{
+			NearestDistanceSquared = DistanceSquared;
+			NearestJoint = Joint;
+		}
+	});
+
+	if (NearestJoint == INDEX_NONE)
+	{
+		return false;
+	}
+	OutHit = MakeHit(NearestJoint, static_cast<float>(FMath::Sqrt(NearestDistanceSquared)));
+	return true;
+}
+
+void UJointProximitySubsystem::FindJointsInRadius(const FVector& Position, float Radius, TArray<FJointProximityHit>& OutHits) const
+{
+	const double RadiusSquared = FMath::Square(static_cast<double>(Radius));
+	ForEachJointNear(Position, Radius, [&](int32 Joint)
+	{
+		const double DistanceSquared = FVector::DistSquared(Position, Positions[Joint]);
+		if (DistanceSquared <= RadiusSquared)
+		{
+			OutHits.Add(MakeHit(Joint, static_cast<float>(FMath::Sqrt(DistanceSquared))));
+		}
+	});
+}
+
+void UJointProximitySubsystem::OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	if (World != GetWorld())
+	{
+		return;
+	}
+
+	// All subjects have submitted the frame once every actor has ticked
+	EvictStaleSubjects();
+	if (Subjects.ContainsByPredicate([](const FSubject& Subject) { return Subject.bUpdated; }))
+	{
+		EvaluateFrame();
+	}
+}
+
+void UJointProximitySubsystem::EvaluateFrame()
+{
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	const double ContactDistanceSquared = FMath::Square(static_cast<double>(ContactDistance));
+
+	Contacts.Reset();
+	TArray<TSharedPtr<FJsonValue>> SubjectArray;
+	int32 FrameIndex = 0;
+	for (int32 SubjectIndex = 0; SubjectIndex < Subjects.Num(); ++SubjectIndex)
+	{
+		const FSubject& Subject = Subjects[SubjectIndex];
+		if (!Subject.bUpdated)
+		{
+			continue;
+		}
+		FrameIndex = Subject.FrameIndex;
+
+		int32 NearestJoint = INDEX_NONE;
+		int32 NearestOtherJoint = INDEX_NONE;
+		double NearestDistanceSquared = FMath::Square(static_cast<double>(CellSize));
+		for (int32 Joint = Subject.FirstJoint; Joint < Subject.FirstJoint + Subject.JointNames.Num(); ++Joint)
+		{
+			// Visits ceil(2 * ContactDistance / CellSize) + 1 cells per axis at most, 2 x 2 x 2 below the cell size
+			ForEachJointNear(Positions[Joint], ContactDistance, [&](int32 OtherJoint)
+			{
+				const int32 OtherSubject = JointSubjects[OtherJoint];
+				// Each pair once: the lower joint of two updated subjects reports it
+				if (OtherSubject == SubjectIndex || (Subjects[OtherSubject].bUpdated && OtherJoint < Joint))
+				{
+					return;
+				}
+				const double DistanceSquared = FVector::DistSquared(Positions[Joint], Positions[OtherJoint]);
+				if (DistanceSquared < ContactDistanceSquared)
+				{
+					FJointContact& Contact = Contacts.AddDefaulted_GetRef();
+					Contact.SubjectA = Subject.Name;
+					Contact.JointA = Subject.JointNames[Joint - Subject.FirstJoint];
+					Contact.SubjectB = Subjects[OtherSubject].Name;
+					Contact.JointB = Subjects[OtherSubject].JointNames[OtherJoint - Subjects[OtherSubject].FirstJoint];
+					Contact.Distance = static_cast<float>(FMath::Sqrt(DistanceSquared));
+				}
+			});
+
+			ForEachJointNear(Positions[Joint], CellSize, [&](int32 OtherJoint)
+			{
+				if (JointSubjects[OtherJoint] == SubjectIndex)
+				{
+					return;
+				}
+				const double DistanceSquared = FVector::DistSquared(Positions[Joint], Positions[OtherJoint]);
+				if (DistanceSquared < NearestDistanceSquared)
+				{
+					NearestDistanceSquared = DistanceSquared;
+					NearestJoint = Joint;
+					NearestOtherJoint = OtherJoint;
+				}
+			});
+		}
+
+		if (!bWriteContactLabels)
+		{
+			continue;
+		}
+
+		TSharedPtr<FJsonObject> SubjectObject = MakeShareable(new FJsonObject);
+		SubjectObject->SetStringField(TEXT("Subject"), Subject.Name);
+		if (NearestJoint != INDEX_NONE)
+		{
+			const FJointProximityHit Hit = MakeHit(NearestOtherJoint, static_cast<float>(FMath::Sqrt(NearestDistanceSquared)));
+			TSharedPtr<FJsonObject> NearestObject = MakeShareable(new FJsonObject);
+			NearestObject->SetStringField(TEXT("Joint"), Subject.JointNames[NearestJoint - Subject.FirstJoint].ToString());
+			NearestObject->SetStringField(TEXT("OtherSubject"), Hit.Subject);
+			NearestObject->SetStringField(TEXT("OtherJoint"), Hit.Joint.ToString());
+			NearestObject->SetNumberField(TEXT("Distance"), Hit.Distance);
+			SubjectObject->SetObjectField(TEXT("Nearest"), NearestObject);
+		}
+
+		// Ground contact: low above the ground and (nearly) at rest
+		const UActorComponent* OwnerComponent = Cast<UActorComponent>(Subject.Owner.Get());
+		const float DeltaTime = Subject.TimeSeconds - Subject.PreviousTimeSeconds;
+		TArray<TSharedPtr<FJsonValue>> GroundArray;
+		for (const FName& GroundJointName : GroundContactJoints)
+		{
+			const int32 LocalJoint = Subject.JointNames.IndexOfByKey(GroundJointName);
+			if (LocalJoint == INDEX_NONE)
+			{
+				continue;
+			}
+			const FVector& Position = Positions[Subject.FirstJoint + LocalJoint];
+
+			double Ground = GroundHeight;
+			if (bTraceGround)
+			{
+				FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(JointGroundTrace), false);
+				QueryParams.AddIgnoredActor(OwnerComponent ? OwnerComponent->GetOwner() : nullptr);
+				FHitResult GroundHit;
+				if (GetWorld()->LineTraceSingleByChannel(GroundHit, Position + FVector(0.0, 0.0, GroundContactHeight), Position - FVector(0.0, 0.0, 200.0), ECC_Visibility, QueryParams))
+				{
+					Ground = GroundHit.ImpactPoint.Z;
+				}
+			}
+
+			const double Height = Position.Z - Ground;
+			const double Speed = Subject.bHasPrevious && DeltaTime > 0.0f ? FVector::Dist(Position, PreviousPositions[Subject.FirstJoint + LocalJoint]) / DeltaTime : 0.0;
+			if (Height < GroundContactHeight && Speed < GroundContactSpeed)
+			{
+				GroundArray.Add(MakeShareable(new FJsonValueString(GroundJointName.ToString())));
+			}
+		}
+		SubjectObject->SetArrayField(TEXT("GroundContacts"), GroundArray);
+		SubjectArray.Add(MakeShareable(new FJsonValueObject(SubjectObject)));
+	}
+
+	for (FSubject& Subject : Subjects)
+	{
+		Subject.bUpdated = false;
+	}
+	EvaluateCycles += FPlatformTime::Cycles64() - StartCycles;
+	++NumEvaluatedFrames;
+
+	if (!bWriteContactLabels)
+	{
+		return;
+	}
+
+	TSharedPtr<FJsonObject> FrameObject = MakeShareable(new FJsonObject);
+	FrameObject->SetNumberField(TEXT("Frame"), FrameIndex);
+	TArray<TSharedPtr<FJsonValue>> ContactArray;
+	for (const FJointContact& Contact : Contacts)
+	{
+		TSharedPtr<FJsonObject> ContactObject = MakeShareable(new FJsonObject);
+		ContactObject->SetStringField(TEXT("SubjectA"), Contact.SubjectA);
+		ContactObject->SetStringField(TEXT("JointA"), Contact.JointA.ToString());
+		ContactObject->SetStringField(TEXT("SubjectB"), Contact.SubjectB);
+		ContactObject->SetStringField(TEXT("JointB"), Contact.JointB.ToString());
+		ContactObject->SetNumberField(TEXT("Distance"), Contact.Distance);
+		ContactArray.Add(MakeShareable(new FJsonValueObject(ContactObject)));
+	}
+	FrameObject->SetArrayField(TEXT("Contacts"), ContactArray);
+	FrameObject->SetArrayField(TEXT("Subjects"), SubjectArray);
+	LabelFrames.Add(MakeShareable(new FJsonValueObject(FrameObject)));
+	if (LabelFrames.Num() >= FMath::Max(LabelFramesPerRecord, 1))
+	{
+		FlushContactLabels();
+	}
+}
+
+void UJointProximitySubsystem::FlushContactLabels()
+{
+	UCaptureOutputSubsystem* CaptureOutput = GetWorld() ? GetWorld()->GetSubsystem<UCaptureOutputSubsystem>() : nullptr;
+	if (LabelFrames.Num() == 0 || !CaptureOutput)
+	{
+		LabelFrames.Reset();
+		return;
+	}
+
+	TSharedPtr<FJsonObject> RootObject = MakeShareable(new FJsonObject);
+	RootObject->SetArrayField(TEXT("Frames"), LabelFrames);
+
+	FString LabelContent;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&LabelContent);
+	FJsonSerializer::Serialize(RootObject.ToSharedRef(), Writer);
+	CaptureOutput->WriteTextRecord(FString::Printf(TEXT("Contacts/Contacts_%03d.json"), NumLabelRecords), LabelContent, ECaptureIndexKind::Annotation, FString(), FString());
+	UE_LOG(LogJointProximity, Log, TEXT("Wrote contact labels of %d frames to Contacts/Contacts_%03d.json."), LabelFrames.Num(), NumLabelRecords);
+	++NumLabelRecords;
+	LabelFrames.Reset();
+}
@@ -0,0 +1,199 @@
+// JointProximitySubsystem.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "JointProximitySubsystem.generated.h"
+
+class FJsonValue;
+
+// A joint found by a proximity query
+USTRUCT(BlueprintType)
+struct FJointProximityHit
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Joint Proximity")
+	FString Subject;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Joint Proximity")
+	FName Joint;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Joint Proximity")
+	FVector Position = FVector::ZeroVector;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Joint Proximity")
+	float Distance = 0.0f;
+};
+
+// Two joints of different subjects closer than ContactDistance
+USTRUCT(BlueprintType)
+struct FJointContact
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Joint Proximity")
+	FString SubjectA;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Joint Proximity")
+	FName JointA;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Joint Proximity")
+	FString SubjectB;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Joint Proximity")
+	FName JointB;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Joint Proximity")
+	float Distance = 0.0f;
+};
+
+/**
+ * Spatial hash over the joints of every subject in the world, for inter-person contact, nearest neighbour and
+ * ground contact labels without comparing all joint pairs.
+ * Subjects (see USkeletalExtractor::bReportContacts) submit their joints every captured frame; a joint only moves
+ * between hash cells when it crosses a cell boundary. After all actors have ticked the frame is evaluated: contact
+ * pairs are searched in the cells within ContactDistance of each joint (at most 8 while it is below CellSize), every
+ * subject's nearest joint of another subject within one cell size is found, and ground contact joints are flagged when
+ * low and slow. Subjects that stop submitting without being removed are evicted after MaxSubjectAgeFrames engine frames.
+ * The labels are written through UCaptureOutputSubsystem as Annotation records (Contacts/Contacts_<Record>.json) of
+ * LabelFramesPerRecord frames each, the last one when the last subject is removed (e.g. at the end of a take).
+ */
+UCLASS(config = Game)
+class EXTRACTJOINTLOCATION_API UJointProximitySubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UJointProximitySubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/**
+	 * Updates a subject's joints for the current frame, adding the subject on first use.
+	 * @param Owner Identifies the subject, e.g. its extractor.
+	 * @param FrameIndex Capture frame the positions belong to, written with the labels.
+	 * @param JointNames Must stay the same for the subject between calls, a change re-adds it.
+	 * @param Positions World-space joint positions.
+	 */
+	void UpdateSubject(const UObject* Owner, const FString& SubjectName, int32 FrameIndex, float TimeSeconds, TArrayView<const FName> JointNames, TArrayView<const FVector> Positions);
+
+	/** Removes a subject's joints from the index. */
+	void RemoveSubject(const UObject* Owner);
+
+	/** Nearest joint within MaxDistance of Position, optionally ignoring one subject's joints. */
+	UFUNCTION(BlueprintCallable, Category = "Joint Proximity")
+	bool FindNearestJoint(const FVector& Position, float MaxDistance, const FString& IgnoredSubject, FJointProximityHit& OutHit) const;
+
+	/** All joints within Radius of Position. */
+	UFUNCTION(BlueprintCallable, Category = "Joint Proximity")
+	void FindJointsInRadius(const FVector& Position, float Radius, TArray<FJointProximityHit>& OutHits) const;
+
+	/** Inter-subject contacts of the last evaluated frame. */
+	UFUNCTION(BlueprintPure, Category = "Joint Proximity")
+	const TArray<FJointContact>& GetContacts() const { return Contacts; }
+
+	/** Edge length (cm) of the hash cells; nearest neighbours are searched within this distance. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Joint Proximity")
+	float CellSize;
+
+	/** Joints of different subjects closer than this (cm) are in contact. Searching is cheapest while it is below CellSize. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Joint Proximity")
+	float ContactDistance;
+
+	/** Joints checked for ground contact. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Joint Proximity")
+	TArray<FName> GroundContactJoints;
+
+	/** Height of the ground plane, used where no ground is traced. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Joint Proximity")
+	float GroundHeight;
+
+	/** Traces down from every ground contact joint to find the ground instead of using GroundHeight. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Joint Proximity")
+	bool bTraceGround;
+
+	/** Ground contact joints lower than this above the ground (cm) and slower than GroundContactSpeed are in contact. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Joint Proximity")
+	float GroundContactHeight;
+
+	/** Speed limit (cm/s) of a ground contact, see GroundContactHeight. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Joint Proximity")
+	float GroundContactSpeed;
+
+	/** Writes the labels to the capture output. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Joint Proximity")
+	bool bWriteContactLabels;
+
+	/** Frames per label record, so long captures do not hold every frame's labels in memory until the end. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Joint Proximity", meta = (ClampMin = "1"))
+	int32 LabelFramesPerRecord;
+
+	/** Subjects not updated for more than this many engine frames are removed, so stale joints report no contacts. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Joint Proximity", meta = (ClampMin = "1"))
+	int32 MaxSubjectAgeFrames;
+
+private:
+	struct FSubject
+	{
+		TWeakObjectPtr<const UObject> Owner;
+		// Key of the subject in SubjectsByOwner, valid after the owner is destroyed
+		const UObject* OwnerKey = nullptr;
+		FString Name;
+		TArray<FName> JointNames;
+		// Range of the subject's joints in the joint arrays
+		int32 FirstJoint = 0;
+		int32 FrameIndex = 0;
+		float TimeSeconds = 0.0f;
+		float PreviousTimeSeconds = 0.0f;
+		// GFrameCounter of the last update
+		uint64 LastUpdateFrame = 0;
+		bool bActive = false;
+		bool bHasPrevious = false;
+		bool bUpdated = false;
+	};
+
+	// Hashed cells with their joints; empty cells are recycled
+	using FCellJoints = TArray<int32, TInlineAllocator<8>>;
+
+	uint64 GetCellKey(const FVector& Position) const;
+	static uint64 MakeCellKey(const FIntVector& Cell);
+	FIntVector GetCellCoordinates(const FVector& Position) const;
+	void AddJointToCell(int32 Joint, uint64 CellKey);
+	void RemoveJointFromCell(int32 Joint, uint64 CellKey);
+	// Calls Visit for every active joint in the cells overlapping the cube of HalfExtent around Position
+	void ForEachJointNear(const FVector& Position, float HalfExtent, TFunctionRef<void(int32 Joint)> Visit) const;
+	FJointProximityHit MakeHit(int32 Joint, float Distance) const;
+
+	void RemoveSubjectAt(int32 SubjectIndex);
+	// Removes the subjects not updated within MaxSubjectAgeFrames
+	void EvictStaleSubjects();
+
+	void OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	// Evaluates contacts, nearest neighbours and ground contacts of the subjects updated this frame
+	void EvaluateFrame();
+	// Writes the labels gathered since the last flush as one record
+	void FlushContactLabels();
+
+	TArray<FSubject> Subjects;
+	TMap<const UObject*, int32> SubjectsByOwner;
+
+	// Per joint: position, previous position, cell and subject
+	TArray<FVector> Positions;
+	TArray<FVector> PreviousPositions;
+	TArray<uint64> JointCells;
+	TArray<int32> JointSubjects;
+
+	TMap<uint64, int32> CellsByKey;
+	TArray<FCellJoints> Cells;
+	TArray<int32> FreeCells;
+
+	TArray<FJointContact> Contacts;
+	// Labels of the frames evaluated since the last flush
+	TArray<TSharedPtr<FJsonValue>> LabelFrames;
+	int32 NumLabelRecords = 0;
+	FDelegateHandle PostActorTickHandle;
+	int32 NumEvaluatedFrames = 0;
+	uint64 EvaluateCycles = 0;
+};
@@ -0,0 +1,209 @@
+#include "JointRegressor.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogJointRegressor, Log, All);
+
+namespace JointRegressor
+{
+	static const TCHAR* const COCO17Joints[] =
+	{
+		TEXT("nose"), TEXT("left_eye"), TEXT("right_eye"), TEXT("left_ear"), TEXT("right_ear"),
+		TEXT("left_shoulder"), TEXT("right_shoulder"), TEXT("left_elbow"), TEXT("right_elbow"), TEXT("left_wrist"), TEXT("right_wrist"),
+		TEXT("left_hip"), TEXT("right_hip"), TEXT("left_knee"), TEXT("right_knee"), TEXT("left_ankle"), TEXT("right_ankle")
+	};
+
+	static const TCHAR* const Halpe26Joints[] =
+	{
+		TEXT("nose"), TEXT("left_eye"), TEXT("right_eye"), TEXT("left_ear"), TEXT("right_ear"),
+		TEXT("left_shoulder"), TEXT("right_shoulder"), TEXT("left_elbow"), TEXT("right_elbow"), TEXT("left_wrist"), TEXT("right_wrist"),
+		TEXT("left_hip"), TEXT("right_hip"), TEXT("left_knee"), TEXT("right_knee"), TEXT("left_ankle"), TEXT("right_ankle"),
+		TEXT("head"), TEXT("neck"), TEXT("hip"), TEXT("left_big_toe"), TEXT("right_big_toe"), TEXT("left_small_toe"), TEXT("right_small_toe"),
+		TEXT("left_heel"), TEXT("right_heel")
+	};
+
+	// Same names and order as the first 55 entries of the smplx package's JOINT_NAMES
+	static const TCHAR* const SMPLXJoints[] =
+	{
+		TEXT("pelvis"), TEXT("left_hip"), TEXT("right_hip"), TEXT("spine1"), TEXT("left_knee"), TEXT("right_knee"), TEXT("spine2"),
+		TEXT("left_ankle"), TEXT("right_ankle"), TEXT("spine3"), TEXT("left_foot"), TEXT("right_foot"), TEXT("neck"),
+		TEXT("left_collar"), TEXT("right_collar"), TEXT("head"), TEXT("left_shoulder"), TEXT("right_shoulder"),
+		TEXT("left_elbow"), TEXT("right_elbow"), TEXT("left_wrist"), TEXT("right_wrist"), TEXT("jaw"),
+		TEXT("left_eye_smplhf"), TEXT("right_eye_smplhf"),
+		TEXT("left_index1"), TEXT("left_index2"), TEXT("left_index3"), TEXT("left_middle1"), TEXT("left_middle2"), TEXT("left_middle3"),
+		TEXT("left_pinky1"), TEXT("left_pinky2"), TEXT("left_pinky3"), TEXT("left_ring1"), TEXT("left_ring2"), TEXT("left_ring3"),
+		TEXT("left_thumb1"), TEXT("left_thumb2"), TEXT("left_thumb3"),
+		TEXT("right_index1"), TEXT("right_index2"), TEXT("right_index3"), TEXT("right_middle1"), TEXT("right_middle2"), TEXT("right_middle3"),
+		TEXT("right_pinky1"), TEXT("right_pinky2"), TEXT("right_pinky3"), TEXT("right_ring1"), TEXT("right_ring2"), TEXT("right_ring3"),
+		TEXT("right_thumb1"), TEXT("right_thumb2"), TEXT("right_thumb3")
+	};
+
+	struct FParsedJoint
+	{
+		FName Name;
+		TArray<int32> SourceIndices;
+		TArray<double> Weights;
+	};
+}
+
+TArrayView<const TCHAR* const> FJointRegressor::GetJointSetNames(EJointSet JointSet)
+{
+	switch (JointSet)
+	{
+	case EJointSet::COCO17:
+		return JointRegressor::COCO17Joints;
+	case EJointSet::Halpe26:
+		return JointRegressor::Halpe26Joints;
+	case EJointSet::SMPLX:
+		return JointRegressor::SMPLXJoints;
+	default:
+		return TArrayView<const TCHAR* const>();
+	}
+}
+
+bool FJointRegressor::LoadFromFile(const FString& FilePath)
+{
+	JointSet = EJointSet::Custom;
+	JointNames.Reset();
+	Sources.Reset();
+	RowStarts.Reset();
+	SourceIndices.Reset();
+	Weights.Reset();
+
+	const FString AbsoluteFilePath = FPaths::IsRelative(FilePath) ? FPaths::Combine(FPaths::ProjectDir(), FilePath) : FilePath;
+
+	FString FileContent;
+	if (!FFileHelper::LoadFileToString(FileContent, *AbsoluteFilePath))
+	{
+		UE_LOG(LogJointRegressor, Error, TEXT("LoadFromFile: Failed to read regressor file: %s"), *AbsoluteFilePath);
+		return false;
+	}
+
+	TSharedPtr<FJsonObject> RootObject;
+	TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(FileContent);
+	const TArray<TSharedPtr<FJsonValue>>* JointArray = nullptr;
+	if (!FJsonSerializer::Deserialize(Reader, RootObject) || !RootObject.IsValid() || !RootObject->TryGetArrayField(TEXT("Joints"), JointArray))
+	{
+		UE_LOG(LogJointRegressor, Error, TEXT("LoadFromFile: Regressor file is not valid JSON or has no 'Joints' array: %s"), *AbsoluteFilePath);
+		return false;
+	}
+
+	FString JointSetName;
+	if (RootObject->TryGetStringField(TEXT("JointSet"), JointSetName))
+	{
+		const int64 JointSetValue = StaticEnum<EJointSet>()->GetValueByNameString(JointSetName);
+		if (JointSetValue == INDEX_NONE)
+		{
+			UE_LOG(LogJointRegressor, Error, TEXT("LoadFromFile: Unknown joint set '%s' in %s"), *JointSetName, *AbsoluteFilePath);
+			return false;
+		}
+		JointSet = static_cast<EJointSet>(JointSetValue);
+	}
+
+	TArray<JointRegressor::FParsedJoint> ParsedJoints;
+	for (const TSharedPtr<FJsonValue>& JointValue : *JointArray)
+	{
+		const TSharedPtr<FJsonObject> JointObject = JointValue.IsValid() ? JointValue->AsObject() : nullptr;
+		FString JointName;
+		const TArray<TSharedPtr<FJsonValue>>* SourceValues = nullptr;
+		if (!JointObject.IsValid() || !JointObject->TryGetStringField(TEXT("Name"), JointName) || !JointObject->TryGetArrayField(TEXT("Sources"), SourceValues))
+		{
+			UE_LOG(LogJointRegressor, Warning, TEXT("LoadFromFile: Skipping joint %d without 'Name' and 'Sources'."), ParsedJoints.Num());
+			continue;
+		}
+
+		JointRegressor::FParsedJoint& Joint = ParsedJoints.AddDefaulted_GetRef();
+		Joint.Name = FName(*JointName);
+		for (const TSharedPtr<FJsonValue>& SourceValue : *SourceValues)
+		{
+			const TSharedPtr<FJsonObject> SourceObject = SourceValue.IsValid() ? SourceValue->AsObject() : nullptr;
+			FJointRegressorSource Source;
+			FString SourceName;
+			double Weight = 0.0;
+			if (!SourceObject.IsValid() || !SourceObject->TryGetNumberField(TEXT("Weight"), Weight))
+			{
+				UE_LOG(LogJointRegressor, Warning, TEXT("LoadFromFile: Skipping a source of joint '%s' without 'Weight'."), *JointName);
+				continue;
+			}
+			if (SourceObject->TryGetStringField(TEXT("Marker"), SourceName))
+			{
+				Source.bMarker = true;
+			}
+			else if (!SourceObject->TryGetStringField(TEXT("Bone"), SourceName))
+			{
+				UE_LOG(LogJointRegressor, Warning, TEXT("LoadFromFile: Skipping a source of joint '%s' without 'Bone' or 'Marker'."), *JointName);
+				continue;
+			}
+			if (Weight == 0.0)
+			{
+				continue;
+			}
+
+			Source.Name = FName(*SourceName);
+			int32 SourceIndex = Sources.IndexOfByKey(Source);
+			if (SourceIndex == INDEX_NONE)
+			{
+				SourceIndex = Sources.Add(Source);
+			}
+			Joint.SourceIndices.Add(SourceIndex);
+			Joint.Weights.Add(Weight);
+		}
+	}
+
+	// Predefined sets are output in their canonical order, so consumers can index joints by position
+	TArray<const JointRegressor::FParsedJoint*> OrderedJoints;
+	const TArrayView<const TCHAR* const> SetNames = GetJointSetNames(JointSet);
+	if (SetNames.Num() > 0)
+	{
+		for (const TCHAR* SetJointName : SetNames)
+		{
+			const JointRegressor::FParsedJoint* Joint = ParsedJoints.FindByPredicate([SetJointName](const JointRegressor::FParsedJoint& Parsed) { return Parsed.Name == FName(SetJointName); });
+			if (!Joint)
+			{
+				UE_LOG(LogJointRegressor, Error, TEXT("LoadFromFile: %s has no weights for the %s joint '%s'."), *AbsoluteFilePath, *JointSetName, SetJointName);
+				return false;
+			}
+			OrderedJoints.Add(Joint);
+		}
+		if (ParsedJoints.Num() > SetNames.Num())
+		{
+			UE_LOG(LogJointRegressor, Warning, TEXT("LoadFromFile: Ignoring %d joints of %s that are not part of %s."), ParsedJoints.Num() - SetNames.Num(), *AbsoluteFilePath, *JointSetName);
+		}
+	}
+	else
+	{
+		for (const JointRegressor::FParsedJoint& Joint : ParsedJoints)
+		{
+			OrderedJoints.Add(&Joint);
+		}
+	}
+
+	RowStarts.Add(0);
+	for (const JointRegressor::FParsedJoint* Joint : OrderedJoints)
+	{
+		JointNames.Add(Joint->Name);
+		SourceIndices.Append(Joint->SourceIndices);
+		Weights.Append(Joint->Weights);
+		RowStarts.Add(SourceIndices.Num());
+	}
+
+	UE_LOG(LogJointRegressor, Log, TEXT("LoadFromFile: Read %d joints from %d sources (%d weights) from %s"), JointNames.Num(), Sources.Num(), Weights.Num(), *AbsoluteFilePath);
+	return JointNames.Num() > 0;
+}
+
+void FJointRegressor::Apply(TArrayView<const FVector> SourcePositions, TArrayView<FVector> OutJoints) const
+{
+	check(SourcePositions.Num() == Sources.Num() && OutJoints.Num() == JointNames.Num());
+	for (int32 JointIndex = 0; JointIndex < JointNames.Num(); ++JointIndex)
+	{
+		FVector Joint = FVector::ZeroVector;
+		for (int32 i = RowStarts[JointIndex]; i < RowStarts[JointIndex + 1]; ++i)
+		{
+			Joint += SourcePositions[SourceIndices[i]] * Weights[i];
+		}
+		OutJoints[JointIndex] = Joint;
+	}
+}
@@ -0,0 +1,71 @@
+// JointRegressor.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "JointRegressor.generated.h"
+
+// Joint definitions a regressor can output; all but Custom fix the joint names and their order
+UENUM(BlueprintType)
+enum class EJointSet : uint8
+{
+	// Joints in the order of the regressor file
+	Custom,
+	// COCO-17 keypoints
+	COCO17,
+	// Halpe-26: COCO-17 plus head, neck, hip and feet keypoints
+	Halpe26,
+	// The 55 SMPL-X skeleton joints (body, jaw, eyes and hands)
+	SMPLX
+};
+
+// Input of a regressor: a bone of the skeletal meshes or a virtual marker (see FVirtualMarker)
+struct EXTRACTJOINTLOCATION_API FJointRegressorSource
+{
+	FName Name;
+	bool bMarker = false;
+
+	bool operator==(const FJointRegressorSource& Other) const { return Name == Other.Name && bMarker == Other.bMarker; }
+};
+
+/**
+ * Maps bone and virtual marker positions to the joints of another skeleton definition with a sparse linear
+ * regressor: every joint is a weighted sum of a few sources, J = W * S. The weights are stored in compressed
+ * sparse rows, so a frame costs one multiply-add per non-zero weight.
+ */
+class EXTRACTJOINTLOCATION_API FJointRegressor
+{
+public:
+	/**
+	 * Reads a regressor from a JSON file:
+	 * { "JointSet": "COCO17", "Joints": [ { "Name": "left_hip", "Sources": [ { "Bone": "thigh_l", "Weight": 0.8 },
+	 * { "Marker": "LASI", "Weight": 0.2 } ] } ] }
+	 * For the predefined joint sets the joints are reordered to the set's order, and every joint of the set must be
+	 * present. Relative paths are resolved against the project directory.
+	 */
+	bool LoadFromFile(const FString& FilePath);
+
+	EJointSet GetJointSet() const { return JointSet; }
+	const TArray<FName>& GetJointNames() const { return JointNames; }
+	const TArray<FJointRegressorSource>& GetSources() const { return Sources; }
+	int32 GetNumWeights() const { return Weights.Num(); }
+
+	/**
+	 * Regresses one frame.
+	 * @param SourcePositions One position per source, in GetSources() order.
+	 * @param OutJoints One position per joint, in GetJointNames() order.
+	 */
+	void Apply(TArrayView<const FVector> SourcePositions, TArrayView<FVector> OutJoints) const;
+
+	/** Joint names of a predefined set in their canonical order; empty for Custom. */
+	static TArrayView<const TCHAR* const> GetJointSetNames(EJointSet JointSet);
+
+private:
+	EJointSet JointSet = EJointSet::Custom;
+	TArray<FName> JointNames;
+	TArray<FJointRegressorSource> Sources;
+
+	// Non-zero weights of joint i are [RowStarts[i], RowStarts[i + 1])
+	TArray<int32> RowStarts;
+	TArray<int32> SourceIndices;
+	TArray<double> Weights;
+};
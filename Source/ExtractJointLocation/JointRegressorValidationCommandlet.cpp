@@ -0,0 +1,269 @@
+#include "JointRegressorValidationCommandlet.h"
+#include "JointRegressor.h"
+#include "KeypointStream.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogJointRegressorValidation, Log, All);
+
+UJointRegressorValidationCommandlet::UJointRegressorValidationCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UJointRegressorValidationCommandlet::Main(const FString& Params)
+{
+	TArray<FString> Tokens;
+	TArray<FString> Switches;
+	TMap<FString, FString> ParamsMap;
+	ParseCommandLine(*Params, Tokens, Switches, ParamsMap);
+
+	const FString RegressorPath = ParamsMap.FindRef(TEXT("Regressor"));
+	const FString JointsPath = ParamsMap.FindRef(TEXT("Joints"));
+	const FString ReferencePath = ParamsMap.FindRef(TEXT("Reference"));
+	TArray<FString> StreamPaths;
+	ParamsMap.FindRef(TEXT("Streams")).ParseIntoArray(StreamPaths, TEXT(","));
+	const float Tolerance = ParamsMap.Contains(TEXT("Tolerance")) ? FCString::Atof(*ParamsMap[TEXT("Tolerance")]) : 0.05f;
+	if (RegressorPath.IsEmpty() || JointsPath.IsEmpty() || ReferencePath.IsEmpty())
+	{
+		UE_LOG(LogJointRegressorValidation, Error, TEXT("Usage: -run=JointRegressorValidation -Regressor=<regressor.json> -Joints=<Actor>_<Regressor>.kps -Reference=<joints.json> [-Streams=<a.kps>,<b.kps>] [-Tolerance=0.05]"));
+		return 1;
+	}
+
+	FJointRegressor Regressor;
+	TArray<FName> ReferenceJoints;
+	TArray<FReferenceFrame> ReferenceFrames;
+	if (!Regressor.LoadFromFile(RegressorPath) || !LoadReference(ReferencePath, ReferenceJoints, ReferenceFrames))
+	{
+		return 1;
+	}
+	const TArray<FName>& JointNames = Regressor.GetJointNames();
+	const int32 NumJoints = JointNames.Num();
+
+	// The extractor's output, which must have been written by this regressor
+	FKeypointStreamHeader JointsHeader;
+	TArray<int32> JointsFrameIndices;
+	TArray<TArray<FVector>> JointsFrames;
+	if (!FKeypointStreamDecoder::DecodeFile(JointsPath, JointsHeader, JointsFrameIndices, JointsFrames))
+	{
+		return 1;
+	}
+	if (JointsHeader.JointNames != JointNames)
+	{
+		UE_LOG(LogJointRegressorValidation, Error, TEXT("The joints of %s do not match the %d joints of regressor %s."), *JointsPath, NumJoints, *RegressorPath);
+		return 1;
+	}
+	TMap<int32, int32> JointsFramesByIndex;
+	for (int32 i = 0; i < JointsFrameIndices.Num(); ++i)
+	{
+		JointsFramesByIndex.Add(JointsFrameIndices[i], i);
+	}
+
+	// Decode every source stream; marker streams are recognized by the name USkeletalExtractor gives them
+	struct FDecodedStream
+	{
+		FKeypointStreamHeader Header;
+		TMap<int32, int32> FramesByIndex;
+		TArray<TArray<FVector>> Frames;
+		bool bMarkers = false;
+	};
+	TArray<FDecodedStream> Streams;
+	for (const FString& StreamPath : StreamPaths)
+	{
+		FDecodedStream& Stream = Streams.AddDefaulted_GetRef();
+		TArray<int32> FrameIndices;
+		if (!FKeypointStreamDecoder::DecodeFile(StreamPath, Stream.Header, FrameIndices, Stream.Frames))
+		{
+			return 1;
+		}
+		for (int32 i = 0; i < FrameIndices.Num(); ++i)
+		{
+			Stream.FramesByIndex.Add(FrameIndices[i], i);
+		}
+		Stream.bMarkers = FPaths::GetBaseFilename(StreamPath).EndsWith(TEXT("_Markers"));
+	}
+
+	// Resolve every regressor source to a joint of one of the source streams
+	const TArray<FJointRegressorSource>& Sources = Regressor.GetSources();
+	TArray<int32> SourceStreams;
+	TArray<int32> SourceJoints;
+	for (int32 SourceIndex = 0; SourceIndex < Sources.Num() && Streams.Num() > 0; ++SourceIndex)
+	{
+		const FJointRegressorSource& Source = Sources[SourceIndex];
+		int32 JointIndex = INDEX_NONE;
+		int32 StreamIndex = 0;
+		for (; StreamIndex < Streams.Num(); ++StreamIndex)
+		{
+			JointIndex = Streams[StreamIndex].bMarkers == Source.bMarker ? Streams[StreamIndex].Header.JointNames.IndexOfByKey(Source.Name) : INDEX_NONE;
+			if (JointIndex != INDEX_NONE)
+			{
+				break;
+			}
+		}
+		if (JointIndex == INDEX_NONE)
+		{
+			UE_LOG(LogJointRegressorValidation, Error, TEXT("%s '%s' is not in any of the streams."), Source.bMarker ? TEXT("Marker") : TEXT("Bone"), *Source.Name.ToString());
+			return 1;
+		}
+		SourceStreams.Add(StreamIndex);
+		SourceJoints.Add(JointIndex);
+	}
+
+	// Reference joints in the regressor's joint order
+	TArray<int32> ReferenceJointIndices;
+	for (const FName& JointName : JointNames)
+	{
+		const int32 ReferenceIndex = ReferenceJoints.IndexOfByKey(JointName);
+		if (ReferenceIndex == INDEX_NONE)
+		{
+			UE_LOG(LogJointRegressorValidation, Error, TEXT("Joint '%s' is missing from the reference %s"), *JointName.ToString(), *ReferencePath);
+			return 1;
+		}
+		ReferenceJointIndices.Add(ReferenceIndex);
+	}
+
+	FJointErrors StreamErrors;
+	FJointErrors RegressedErrors;
+	TArray<FVector> ReferencePositions;
+	TArray<FVector> SourcePositions;
+	TArray<FVector> RegressedJoints;
+	ReferencePositions.SetNumUninitialized(NumJoints);
+	SourcePositions.SetNumUninitialized(Sources.Num());
+	RegressedJoints.SetNumUninitialized(NumJoints);
+	for (const FReferenceFrame& ReferenceFrame : ReferenceFrames)
+	{
+		const int32* JointsFrame = JointsFramesByIndex.Find(ReferenceFrame.FrameIndex);
+		if (!JointsFrame)
+		{
+			continue;
+		}
+		for (int32 JointIndex = 0; JointIndex < NumJoints; ++JointIndex)
+		{
+			ReferencePositions[JointIndex] = ReferenceFrame.Positions[ReferenceJointIndices[JointIndex]];
+		}
+		StreamErrors.AddFrame(JointsFrames[*JointsFrame], ReferencePositions, Tolerance);
+
+		// Regress the frame again from its sources, the same way USkeletalExtractor does while streaming
+		const bool bInAllStreams = Streams.Num() > 0 && !Streams.ContainsByPredicate([&ReferenceFrame](const FDecodedStream& Stream) { return !Stream.FramesByIndex.Contains(ReferenceFrame.FrameIndex); });
+		if (bInAllStreams)
+		{
+			for (int32 SourceIndex = 0; SourceIndex < Sources.Num(); ++SourceIndex)
+			{
+				const FDecodedStream& Stream = Streams[SourceStreams[SourceIndex]];
+				SourcePositions[SourceIndex] = Stream.Frames[Stream.FramesByIndex[ReferenceFrame.FrameIndex]][SourceJoints[SourceIndex]];
+			}
+			Regressor.Apply(SourcePositions, RegressedJoints);
+			RegressedErrors.AddFrame(RegressedJoints, ReferencePositions, Tolerance);
+		}
+	}
+	if (StreamErrors.NumFrames == 0)
+	{
+		UE_LOG(LogJointRegressorValidation, Error, TEXT("None of the %d reference frames is in %s."), ReferenceFrames.Num(), *JointsPath);
+		return 1;
+	}
+
+	bool bPassed = StreamErrors.Report(*FPaths::GetCleanFilename(JointsPath), JointNames, Tolerance);
+	if (Streams.Num() > 0)
+	{
+		if (RegressedErrors.NumFrames == 0)
+		{
+			UE_LOG(LogJointRegressorValidation, Error, TEXT("None of the compared frames is present in all source streams."));
+			return 1;
+		}
+		bPassed &= RegressedErrors.Report(TEXT("Joints regressed from the source streams"), JointNames, Tolerance);
+	}
+	return bPassed ? 0 : 1;
+}
+
+void UJointRegressorValidationCommandlet::FJointErrors::AddFrame(TConstArrayView<FVector> Joints, TConstArrayView<FVector> ReferenceJoints, double Tolerance)
+{
+	MaxErrors.SetNumZeroed(Joints.Num());
+	ErrorSums.SetNumZeroed(Joints.Num());
+	bool bFrameFailed = false;
+	for (int32 JointIndex = 0; JointIndex < Joints.Num(); ++JointIndex)
+	{
+		const double Error = FVector::Dist(Joints[JointIndex], ReferenceJoints[JointIndex]);
+		MaxErrors[JointIndex] = FMath::Max(MaxErrors[JointIndex], Error);
+		ErrorSums[JointIndex] += Error;
+		bFrameFailed |= Error > Tolerance;
+	}
+	++NumFrames;
+	NumFailedFrames += bFrameFailed ? 1 : 0;
+}
+
+bool UJointRegressorValidationCommandlet::FJointErrors::Report(const TCHAR* What, const TArray<FName>& JointNames, double Tolerance) const
+{
+	double MaxError = 0.0;
+	for (int32 JointIndex = 0; JointIndex < MaxErrors.Num(); ++JointIndex)
+	{
+		MaxError = FMath::Max(MaxError, MaxErrors[JointIndex]);
+		if (MaxErrors[JointIndex] > Tolerance)
+		{
+			UE_LOG(LogJointRegressorValidation, Warning, TEXT("%s, joint '%s': max error %.4f cm, mean %.4f cm."),
+				What, *JointNames[JointIndex].ToString(), MaxErrors[JointIndex], ErrorSums[JointIndex] / NumFrames);
+		}
+	}
+
+	UE_LOG(LogJointRegressorValidation, Display, TEXT("%s: compared %d joints over %d frames, max error %.4f cm, %d frames above the %.4f cm tolerance."),
+		What, JointNames.Num(), NumFrames, MaxError, NumFailedFrames, Tolerance);
+	return NumFailedFrames == 0;
+}
+
+bool UJointRegressorValidationCommandlet::LoadReference(const FString& FilePath, TArray<FName>& OutJointNames, TArray<FReferenceFrame>& OutFrames)
+{
+	FString FileContent;
+	if (!FFileHelper::LoadFileToString(FileContent, *FilePath))
+	{
+		UE_LOG(LogJointRegressorValidation, Error, TEXT("LoadReference: Failed to read reference file: %s"), *FilePath);
+		return false;
+	}
+
+	TSharedPtr<FJsonObject> RootObject;
+	TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(FileContent);
+	const TArray<TSharedPtr<FJsonValue>>* JointValues = nullptr;
+	const TArray<TSharedPtr<FJsonValue>>* FrameValues = nullptr;
+	if (!FJsonSerializer::Deserialize(Reader, RootObject) || !RootObject.IsValid()
+		|| !RootObject->TryGetArrayField(TEXT("Joints"), JointValues) || !RootObject->TryGetArrayField(TEXT("Frames"), FrameValues))
+	{
+		UE_LOG(LogJointRegressorValidation, Error, TEXT("LoadReference: Reference file is not valid JSON or has no 'Joints' and 'Frames' arrays: %s"), *FilePath);
+		return false;
+	}
+
+	for (const TSharedPtr<FJsonValue>& JointValue : *JointValues)
+	{
+		OutJointNames.Add(FName(*JointValue->AsString()));
+	}
+
+	for (const TSharedPtr<FJsonValue>& FrameValue : *FrameValues)
+	{
+		const TSharedPtr<FJsonObject> FrameObject = FrameValue.IsValid() ? FrameValue->AsObject() : nullptr;
+		int32 FrameIndex = 0;
+		const TArray<TSharedPtr<FJsonValue>>* PositionValues = nullptr;
+		if (!FrameObject.IsValid() || !FrameObject->TryGetNumberField(TEXT("Frame"), FrameIndex) || !FrameObject->TryGetArrayField(TEXT("Positions"), PositionValues)
+			|| PositionValues->Num() != OutJointNames.Num())
+		{
+			UE_LOG(LogJointRegressorValidation, Error, TEXT("LoadReference: Frame %d of %s needs a 'Frame' and a position per joint."), OutFrames.Num(), *FilePath);
+			return false;
+		}
+
+		FReferenceFrame& Frame = OutFrames.AddDefaulted_GetRef();
+		Frame.FrameIndex = FrameIndex;
+		for (const TSharedPtr<FJsonValue>& PositionValue : *PositionValues)
+		{
+			const TArray<TSharedPtr<FJsonValue>>& Components = PositionValue->AsArray();
+			if (Components.Num() != 3)
+			{
+				UE_LOG(LogJointRegressorValidation, Error, TEXT("LoadReference: Positions of frame %d of %s must have three components."), FrameIndex, *FilePath);
+				return false;
+			}
+			Frame.Positions.Add(FVector(Components[0]->AsNumber(), Components[1]->AsNumber(), Components[2]->AsNumber()));
+		}
+	}
+	return OutFrames.Num() > 0;
+}
@@ -0,0 +1,54 @@
+// JointRegressorValidationCommandlet.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "JointRegressorValidationCommandlet.generated.h"
+
+/**
+ * Checks the joints USkeletalExtractor regressed during a capture against reference joints computed by the Python
+ * regressor from the same capture. Every frame of the extractor's <Actor>_<Regressor>.kps stream is compared with
+ * the reference frame of the same index.
+ * With -Streams, the regressor's bones and markers are also read from the capture's keypoint streams (e.g.
+ * <Actor>_Body.kps and <Actor>_Body_Markers.kps) and regressed again with FJointRegressor::Apply, the function the
+ * extractor uses, which tells a wrong regressor apart from a wrong source stream.
+ *
+ * UnrealEditor-Cmd Project.uproject -run=JointRegressorValidation -Regressor=Config/Regressors/COCO17.json
+ *   -Joints=<Actor>_COCO17.kps -Reference=<joints.json> [-Streams=<a.kps>,<b.kps>] [-Tolerance=0.05]
+ * Reference file: { "Joints": ["nose", ...], "Frames": [ { "Frame": 0, "Positions": [[x, y, z], ...] } ] }, with
+ * positions in centimeters in the capture's coordinate system. Returns 1 if any joint differs by more than
+ * -Tolerance (cm); quantized streams add up to their quantization error to the difference.
+ */
+UCLASS()
+class EXTRACTJOINTLOCATION_API UJointRegressorValidationCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UJointRegressorValidationCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	// Reference joints of one frame, in the order of the reference file's joint names
+	struct FReferenceFrame
+	{
+		int32 FrameIndex = 0;
+		TArray<FVector> Positions;
+	};
+
+	// Per-joint error of one set of joints against the reference, accumulated over frames
+	struct FJointErrors
+	{
+		TArray<double> MaxErrors;
+		TArray<double> ErrorSums;
+		int32 NumFrames = 0;
+		int32 NumFailedFrames = 0;
+
+		void AddFrame(TConstArrayView<FVector> Joints, TConstArrayView<FVector> ReferenceJoints, double Tolerance);
+		// Logs the joints above the tolerance and a summary; returns false if any frame failed
+		bool Report(const TCHAR* What, const TArray<FName>& JointNames, double Tolerance) const;
+	};
+
+	static bool LoadReference(const FString& FilePath, TArray<FName>& OutJointNames, TArray<FReferenceFrame>& OutFrames);
+};
@@ -0,0 +1,65 @@
+// KeypointNetworkProtocol.h
+#pragma once
+
+// Datagrams sent by FKeypointNetworkSender and read by Tools/KeypointNetworkClient. Plain C++ so both sides include the
+// same definitions. All values are little-endian and unaligned; read them with memcpy.
+//
+// Every datagram starts with an FPacketHeader. One captured frame is sent as PartCount datagrams that share its
+// Sequence, each holding NumSubjects whole subjects, so a lost datagram loses only its subjects.
+//
+// Frame datagram, per subject: FFrameSubject, then NumJoints joint positions in world space (cm): float[3] each, or
+// with PacketFlagQuantized int16[3] each, the position being Origin + Value * Step.
+// Schema datagram, per subject: uint16 SubjectId, uint8 name length + name, uint16 joint count, then per joint uint8
+// name length + name. Schemas are resent whenever a subject is added and every few seconds, since UDP may drop them.
+
+#include <cstdint>
+
+namespace KeypointNetwork
+{
+	static constexpr uint32_t Magic = 0x534E504B; // "KPNS"
+	static constexpr uint8_t Version = 1;
+	static constexpr uint16_t DefaultPort = 7777;
+
+	enum class EPacketType : uint8_t
+	{
+		Frame = 0,
+		Schema = 1
+	};
+
+	enum EPacketFlags : uint8_t
+	{
+		PacketFlagQuantized = 1 << 0
+	};
+
+#pragma pack(push, 1)
+	struct FPacketHeader
+	{
+		uint32_t Magic;
+		uint8_t Version;
+		uint8_t Type;
+		uint8_t Flags;
+		uint8_t PartIndex;
+		uint8_t PartCount;
+		uint8_t Reserved;
+		uint16_t NumSubjects;
+		// Frames and schemas count separately
+		uint32_t Sequence;
+		int32_t FrameIndex;
+		// Game time of the frame, and the sender's UTC clock (microseconds since 1970) when it was captured
+		double TimeSeconds;
+		uint64_t CaptureTimeMicros;
+	};
+
+	struct FFrameSubject
+	{
+		uint16_t SubjectId;
+		uint16_t NumJoints;
+		// Quantized frames only
+		float Origin[3];
+		float Step;
+	};
+#pragma pack(pop)
+
+	static_assert(sizeof(FPacketHeader) == 36, "Packet header layout changed");
+	static_assert(sizeof(FFrameSubject) == 20, "Subject header layout changed");
+}
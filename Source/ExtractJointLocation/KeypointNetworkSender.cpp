@@ -0,0 +1,350 @@
+#include "KeypointNetworkSender.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+#include "Common/UdpSocketBuilder.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogKeypointNetworkSender, Log, All);
+
+namespace KeypointNetwork
+{
+	// Every supported platform is little-endian, so values are written as they are in memory
+	template <typename T>
+	static void Append(TArray<uint8>& Out, const T& Value)
+	{
+		Out.Append(reinterpret_cast<const uint8*>(&Value), sizeof(T));
+	}
+
+	static void AppendName(TArray<uint8>& Out, const FString& Name)
+	{
+		const FTCHARToUTF8 Utf8(*Name);
+		const uint8 Length = static_cast<uint8>(FMath::Min(Utf8.Length(), 255));
+		Out.Add(Length);
+		Out.Append(reinterpret_cast<const uint8*>(Utf8.Get()), Length);
+	}
+
+	static constexpr int32 MaxParts = 255;
+	static constexpr float MaxQuantizedValue = 32767.0f;
+}
+
+FKeypointNetworkSender::~FKeypointNetworkSender()
+{
+	Shutdown();
+}
+
+bool FKeypointNetworkSender::Start(const FKeypointNetworkSenderSettings& InSettings)
+{
+	Shutdown();
+	Settings = InSettings;
+
+	ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+	if (!SocketSubsystem)
+	{
+		UE_LOG(LogKeypointNetworkSender, Warning, TEXT("Start: No socket subsystem on this platform."));
+		return false;
+	}
+
+	bool bIsValid = false;
+	TargetAddress = SocketSubsystem->CreateInternetAddr();
+	TargetAddress->SetIp(*Settings.TargetAddress, bIsValid);
+	TargetAddress->SetPort(Settings.Port);
+	if (!bIsValid)
+	{
+		UE_LOG(LogKeypointNetworkSender, Warning, TEXT("Start: '%s' is not an IP address."), *Settings.TargetAddress);
+		TargetAddress.Reset();
+		return false;
+	}
+
+	// Broadcast so a 255.255.255.255 target reaches every client on the subnet
+	Socket = FUdpSocketBuilder(TEXT("KeypointNetworkSender")).WithBroadcast().WithSendBufferSize(1 << 20).Build();
+	if (!Socket)
+	{
+		UE_LOG(LogKeypointNetworkSender, Warning, TEXT("Start: Failed to create a UDP socket."));
+		TargetAddress.Reset();
+		return false;
+	}
+
+	bStopping = false;
+	bSubjectsChanged = true;
+	LastSchemaTime = -UE_BIG_NUMBER;
+	WakeEvent = FPlatformProcess::GetSynchEventFromPool(false);
+	Thread = FRunnableThread::Create(this, TEXT("KeypointNetworkSender"), 0, TPri_AboveNormal);
+	if (!Thread)
+	{
+		Shutdown();
+		return false;
+	}
+
+	UE_LOG(LogKeypointNetworkSender, Log, TEXT("Streaming keypoints to %s:%d (%s)."), *Settings.TargetAddress, Settings.Port,
+		Settings.bQuantize ? TEXT("quantized") : TEXT("float"));
+	return true;
+}
+
+void FKeypointNetworkSender::Shutdown()
+{
+	if (Thread)
+	{
+		// Kill calls Stop and waits for Run to send what is queued
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+	}
+	if (WakeEvent)
+	{
+		FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+		WakeEvent = nullptr;
+	}
+	if (Socket)
+	{
+		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+		Socket = nullptr;
+	}
+	TargetAddress.Reset();
+	PendingFrames.Empty();
+	NumPendingFrames = 0;
+}
+
+TUniquePtr<FKeypointNetworkFrame> FKeypointNetworkSender::AllocateFrame()
+{
+	TUniquePtr<FKeypointNetworkFrame> Frame;
+	if (!FreeFrames.Dequeue(Frame) || !Frame)
+	{
+		Frame = MakeUnique<FKeypointNetworkFrame>();
+	}
+	return Frame;
+}
+
+void FKeypointNetworkSender::EnqueueFrame(TUniquePtr<FKeypointNetworkFrame> Frame)
+{
+	if (!Thread || !Frame)
+	{
+		return;
+	}
+	if (NumPendingFrames.load(std::memory_order_relaxed) >= FMath::Max(Settings.MaxQueuedFrames, 1))
+	{
+		DroppedFrames.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	NumPendingFrames.fetch_add(1, std::memory_order_relaxed);
+	PendingFrames.Enqueue(MoveTemp(Frame));
+	WakeEvent->Trigger();
+}
+
+void FKeypointNetworkSender::SetSubjects(TArray<FKeypointNetworkSubject> InSubjects)
+{
+	{
+		FScopeLock Lock(&SubjectsLock);
+		Subjects = MoveTemp(InSubjects);
+	}
+	bSubjectsChanged = true;
+	if (WakeEvent)
+	{
+		WakeEvent->Trigger();
+	}
+}
+
+uint32 FKeypointNetworkSender::Run()
+{
+	bool bRunning = true;
+	while (bRunning)
+	{
+		// Sends the queue once more after Stop
+		bRunning = !bStopping.load(std::memory_order_acquire);
+		if (bRunning)
+		{
+			WakeEvent->Wait(100);
+		}
+
+		// Schemas first, so a client knows a new subject before its first frame
+		const double Now = FPlatformTime::Seconds();
+		const bool bSubjectsUpdated = bSubjectsChanged.exchange(false);
+		if (bSubjectsUpdated || Now - LastSchemaTime >= Settings.SchemaInterval)
+		{
+			SendSchema(bSubjectsUpdated);
+			LastSchemaTime = Now;
+		}
+
+		TUniquePtr<FKeypointNetworkFrame> Frame;
+		while (PendingFrames.Dequeue(Frame))
+		{
+			SendFrame(*Frame);
+			NumPendingFrames.fetch_sub(1, std::memory_order_relaxed);
+			Frame->Reset();
+			FreeFrames.Enqueue(MoveTemp(Frame));
+		}
+	}
+	return 0;
+}
+
+void FKeypointNetworkSender::Stop()
+{
+	bStopping.store(true, std::memory_order_release);
+	if (WakeEvent)
+	{
+		WakeEvent->Trigger();
+	}
+}
+
+void FKeypointNetworkSender::BeginPacket(KeypointNetwork::EPacketType Type, uint32 Sequence, const FKeypointNetworkFrame* Frame)
+{
+	using namespace KeypointNetwork;
+	FPacketHeader Header = {};
+	Header.Magic = Magic;
+	Header.Version = Version;
+	Header.Type = static_cast<uint8_t>(Type);
+	Header.Flags = Type == EPacketType::Frame && Settings.bQuantize ? PacketFlagQuantized : 0;
+	Header.Sequence = Sequence;
+	Header.FrameIndex = Frame ? Frame->FrameIndex : INDEX_NONE;
+	Header.TimeSeconds = Frame ? Frame->TimeSeconds : 0.0;
+	Header.CaptureTimeMicros = Frame ? Frame->CaptureTimeMicros : 0;
+	Packet.Reset();
+	Append(Packet, Header);
+}
+
+void FKeypointNetworkSender::SendPacket(uint8 PartIndex, uint8 PartCount, uint16 NumSubjects)
+{
+	using namespace KeypointNetwork;
+	FPacketHeader* Header = reinterpret_cast<FPacketHeader*>(Packet.GetData());
+	Header->PartIndex = PartIndex;
+	Header->PartCount = PartCount;
+	Header->NumSubjects = NumSubjects;
+
+	int32 BytesSent = 0;
+	if (Socket->SendTo(Packet.GetData(), Packet.Num(), BytesSent, *TargetAddress))
+	{
+		SentBytes.fetch_add(BytesSent, std::memory_order_relaxed);
+	}
+}
+
+void FKeypointNetworkSender::SendFrame(const FKeypointNetworkFrame& Frame)
+{
+	using namespace KeypointNetwork;
+	const int32 NumSubjects = Frame.SubjectIds.Num();
+	const int32 JointBytes = Settings.bQuantize ? 3 * sizeof(int16) : sizeof(FVector3f);
+	const int32 MaxDatagramBytes = FMath::Max(Settings.MaxDatagramBytes, 512);
+
+	// Split at subject boundaries so every datagram decodes on its own; a subject larger than a datagram gets its own
+	TArray<int32, TInlineAllocator<16>> PartEnds;
+	int32 PartBytes = sizeof(FPacketHeader);
+	for (int32 SubjectIndex = 0; SubjectIndex < NumSubjects; ++SubjectIndex)
+	{
+		const int32 SubjectBytes = sizeof(FFrameSubject) + Frame.JointCounts[SubjectIndex] * JointBytes;
+		if (PartBytes + SubjectBytes > MaxDatagramBytes && PartBytes > static_cast<int32>(sizeof(FPacketHeader)))
+		{
+			PartEnds.Add(SubjectIndex);
+			PartBytes = sizeof(FPacketHeader);
+		}
+		PartBytes += SubjectBytes;
+	}
+	PartEnds.Add(NumSubjects);
+	PartEnds.SetNum(FMath::Min(PartEnds.Num(), MaxParts));
+
+	const uint32 Sequence = FrameSequence++;
+	int32 SubjectIndex = 0;
+	int32 FirstJoint = 0;
+	for (int32 PartIndex = 0; PartIndex < PartEnds.Num(); ++PartIndex)
+	{
+		BeginPacket(EPacketType::Frame, Sequence, &Frame);
+		const int32 PartFirstSubject = SubjectIndex;
+		for (; SubjectIndex < PartEnds[PartIndex]; ++SubjectIndex)
+		{
+			const int32 NumJoints = Frame.JointCounts[SubjectIndex];
+			const TArrayView<const FVector3f> Joints(Frame.Positions.GetData() + FirstJoint, NumJoints);
+			FirstJoint += NumJoints;
+
+			FFrameSubject SubjectHeader = {};
+			SubjectHeader.SubjectId = Frame.SubjectIds[SubjectIndex];
+			SubjectHeader.NumJoints = static_cast<uint16_t>(NumJoints);
+			if (!Settings.bQuantize)
+			{
+				Append(Packet, SubjectHeader);
+				Packet.Append(reinterpret_cast<const uint8*>(Joints.GetData()), Joints.Num() * sizeof(FVector3f));
+				continue;
+			}
+
+			// Offsets from the subject's bounds centre; the step grows for subjects int16 cannot span at the configured one
+			FVector3f Min(UE_BIG_NUMBER), Max(-UE_BIG_NUMBER);
+			for (const FVector3f& Joint : Joints)
+			{
+				Min = Min.ComponentMin(Joint);
+				Max = Max.ComponentMax(Joint);
+			}
+			const FVector3f Origin = NumJoints > 0 ? (Min + Max) * 0.5f : FVector3f::ZeroVector;
+			const float HalfExtent = NumJoints > 0 ? (Max - Min).GetMax() * 0.5f : 0.0f;
+			const float Step = FMath::Max3(Settings.QuantizationStep, HalfExtent / MaxQuantizedValue, UE_KINDA_SMALL_NUMBER);
+			const float InvStep = 1.0f / Step;
+			SubjectHeader.Origin[0] = Origin.X;
+			SubjectHeader.Origin[1] = Origin.Y;
+			SubjectHeader.Origin[2] = Origin.Z;
+			SubjectHeader.Step = Step;
+			Append(Packet, SubjectHeader);
+			for (const FVector3f& Joint : Joints)
+			{
+				const FVector3f Offset = (Joint - Origin) * InvStep;
+				for (int32 Axis = 0; Axis < 3; ++Axis)
+				{
+					Append(Packet, static_cast<int16>(FMath::Clamp(FMath::RoundToInt32(Offset[Axis]), -32767, 32767)));
+				}
+			}
+		}
+		SendPacket(static_cast<uint8>(PartIndex), static_cast<uint8>(PartEnds.Num()), static_cast<uint16>(SubjectIndex - PartFirstSubject));
+	}
+	SentFrames.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FKeypointNetworkSender::SendSchema(bool bSubjectsUpdated)
+{
+	using namespace KeypointNetwork;
+	if (bSubjectsUpdated)
+	{
+		FScopeLock Lock(&SubjectsLock);
+		SerializedSubjects.SetNum(Subjects.Num());
+		for (int32 SubjectIndex = 0; SubjectIndex < Subjects.Num(); ++SubjectIndex)
+		{
+			const FKeypointNetworkSubject& Subject = Subjects[SubjectIndex];
+			TArray<uint8>& Serialized = SerializedSubjects[SubjectIndex];
+			Serialized.Reset();
+			Append(Serialized, static_cast<uint16_t>(Subject.Id));
+			AppendName(Serialized, Subject.Name);
+			Append(Serialized, static_cast<uint16_t>(Subject.JointNames.Num()));
+			for (const FName& JointName : Subject.JointNames)
+			{
+				AppendName(Serialized, JointName.ToString());
+			}
+		}
+	}
+	if (SerializedSubjects.Num() == 0)
+	{
+		return;
+	}
+
+	const int32 MaxDatagramBytes = FMath::Max(Settings.MaxDatagramBytes, 512);
+	TArray<int32, TInlineAllocator<16>> PartEnds;
+	int32 PartBytes = sizeof(FPacketHeader);
+	for (int32 SubjectIndex = 0; SubjectIndex < SerializedSubjects.Num(); ++SubjectIndex)
+	{
+		if (PartBytes + SerializedSubjects[SubjectIndex].Num() > MaxDatagramBytes && PartBytes > static_cast<int32>(sizeof(FPacketHeader)))
+		{
+			PartEnds.Add(SubjectIndex);
+			PartBytes = sizeof(FPacketHeader);
+		}
+		PartBytes += SerializedSubjects[SubjectIndex].Num();
+	}
+	PartEnds.Add(SerializedSubjects.Num());
+	PartEnds.SetNum(FMath::Min(PartEnds.Num(), MaxParts));
+
+	const uint32 Sequence = SchemaSequence++;
+	int32 SubjectIndex = 0;
+	for (int32 PartIndex = 0; PartIndex < PartEnds.Num(); ++PartIndex)
+	{
+		BeginPacket(EPacketType::Schema, Sequence, nullptr);
+		const int32 PartFirstSubject = SubjectIndex;
+		for (; SubjectIndex < PartEnds[PartIndex]; ++SubjectIndex)
+		{
+			Packet.Append(SerializedSubjects[SubjectIndex]);
+		}
+		SendPacket(static_cast<uint8>(PartIndex), static_cast<uint8>(PartEnds.Num()), static_cast<uint16>(SubjectIndex - PartFirstSubject));
+	}
+}
@@ -0,0 +1,115 @@
+// KeypointNetworkSender.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "Containers/Queue.h"
+#include "KeypointNetworkProtocol.h"
+
+class FSocket;
+class FInternetAddr;
+class FRunnableThread;
+
+/** All subjects' keypoints of one frame, queued for FKeypointNetworkSender. */
+struct FKeypointNetworkFrame
+{
+	int32 FrameIndex = INDEX_NONE;
+	double TimeSeconds = 0.0;
+	uint64 CaptureTimeMicros = 0;
+	// Per subject its id and joint count; Positions holds the joints of all subjects in that order
+	TArray<uint16> SubjectIds;
+	TArray<uint16> JointCounts;
+	TArray<FVector3f> Positions;
+
+	void Reset()
+	{
+		SubjectIds.Reset();
+		JointCounts.Reset();
+		Positions.Reset();
+	}
+};
+
+/** Name and joints of a streamed subject, sent in schema datagrams. */
+struct FKeypointNetworkSubject
+{
+	uint16 Id = 0;
+	FString Name;
+	TArray<FName> JointNames;
+};
+
+struct FKeypointNetworkSenderSettings
+{
+	FString TargetAddress;
+	int32 Port = KeypointNetwork::DefaultPort;
+	bool bQuantize = true;
+	// Finest quantization step (cm); subjects too large for int16 at this step get a coarser one
+	float QuantizationStep = 0.1f;
+	int32 MaxDatagramBytes = 1400;
+	int32 MaxQueuedFrames = 4;
+	float SchemaInterval = 2.0f;
+};
+
+/**
+ * Sends keypoint frames as UDP datagrams (see KeypointNetworkProtocol.h) from its own thread. The game thread only
+ * fills a pooled frame and queues it; serialization, quantization and the socket calls all run on the sender thread.
+ * Frames queued while MaxQueuedFrames are still pending are dropped, so a stalled network never backs up capture.
+ */
+class EXTRACTJOINTLOCATION_API FKeypointNetworkSender : public FRunnable
+{
+public:
+	~FKeypointNetworkSender();
+
+	/** Creates the socket and starts the sender thread. */
+	bool Start(const FKeypointNetworkSenderSettings& InSettings);
+	/** Sends the frames still queued and stops the thread. */
+	void Shutdown();
+	bool IsRunning() const { return Thread != nullptr; }
+
+	/** Returns an empty frame, reusing one the sender is done with when possible. */
+	TUniquePtr<FKeypointNetworkFrame> AllocateFrame();
+	/** Queues a frame for sending, or drops it if MaxQueuedFrames are pending. */
+	void EnqueueFrame(TUniquePtr<FKeypointNetworkFrame> Frame);
+	/** Replaces the subjects sent in schema datagrams; they are resent right away. */
+	void SetSubjects(TArray<FKeypointNetworkSubject> InSubjects);
+
+	uint64 GetSentFrames() const { return SentFrames.load(std::memory_order_relaxed); }
+	uint64 GetSentBytes() const { return SentBytes.load(std::memory_order_relaxed); }
+	uint64 GetDroppedFrames() const { return DroppedFrames.load(std::memory_order_relaxed); }
+
+	// FRunnable
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	void SendFrame(const FKeypointNetworkFrame& Frame);
+	void SendSchema(bool bSubjectsUpdated);
+	void BeginPacket(KeypointNetwork::EPacketType Type, uint32 Sequence, const FKeypointNetworkFrame* Frame);
+	void SendPacket(uint8 PartIndex, uint8 PartCount, uint16 NumSubjects);
+
+	FKeypointNetworkSenderSettings Settings;
+	FSocket* Socket = nullptr;
+	TSharedPtr<FInternetAddr> TargetAddress;
+	FRunnableThread* Thread = nullptr;
+	FEvent* WakeEvent = nullptr;
+	std::atomic<bool> bStopping{ false };
+
+	TQueue<TUniquePtr<FKeypointNetworkFrame>, EQueueMode::Spsc> PendingFrames;
+	TQueue<TUniquePtr<FKeypointNetworkFrame>, EQueueMode::Spsc> FreeFrames;
+	std::atomic<int32> NumPendingFrames{ 0 };
+
+	FCriticalSection SubjectsLock;
+	TArray<FKeypointNetworkSubject> Subjects;
+	std::atomic<bool> bSubjectsChanged{ false };
+
+	// Sender thread only
+	TArray<uint8> Packet;
+	uint32 FrameSequence = 0;
+	uint32 SchemaSequence = 0;
+	double LastSchemaTime = -UE_BIG_NUMBER;
+	// Schema of each subject as serialized into schema datagrams, rebuilt when the subjects change
+	TArray<TArray<uint8>> SerializedSubjects;
+
+	std::atomic<uint64> SentFrames{ 0 };
+	std::atomic<uint64> SentBytes{ 0 };
+	std::atomic<uint64> DroppedFrames{ 0 };
+};
@@ -0,0 +1,130 @@
+#include "KeypointNetworkSubsystem.h"
+#include "Engine/World.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogKeypointNetwork, Log, All);
+
+UKeypointNetworkSubsystem::UKeypointNetworkSubsystem()
+{
+	// 1400 byte datagrams stay below a typical Ethernet MTU; 0.1 cm steps are finer than any pose estimate
+	bEnableNetworkStream = false;
+	TargetAddress = TEXT("127.0.0.1");
+	Port = KeypointNetwork::DefaultPort;
+	bQuantizePositions = true;
+	QuantizationStep = 0.1f;
+	MaxDatagramBytes = 1400;
+	MaxQueuedFrames = 4;
+	SchemaInterval = 2.0f;
+}
+
+void UKeypointNetworkSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UKeypointNetworkSubsystem::OnWorldPostActorTick);
+}
+
+void UKeypointNetworkSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+	if (Sender.IsRunning())
+	{
+		Sender.Shutdown();
+		UE_LOG(LogKeypointNetwork, Log, TEXT("Sent %llu frames (%.1f KB) to %s:%d, %llu dropped."), Sender.GetSentFrames(),
+			Sender.GetSentBytes() / 1024.0, *TargetAddress, Port, Sender.GetDroppedFrames());
+	}
+	PendingFrame.Reset();
+	Super::Deinitialize();
+}
+
+bool UKeypointNetworkSubsystem::StartSender()
+{
+	if (Sender.IsRunning() || bStartFailed)
+	{
+		return Sender.IsRunning();
+	}
+
+	FKeypointNetworkSenderSettings Settings;
+	Settings.TargetAddress = TargetAddress;
+	Settings.Port = Port;
+	Settings.bQuantize = bQuantizePositions;
+	Settings.QuantizationStep = QuantizationStep;
+	Settings.MaxDatagramBytes = FMath::Clamp(MaxDatagramBytes, 512, 65507);
+	Settings.MaxQueuedFrames = MaxQueuedFrames;
+	Settings.SchemaInterval = SchemaInterval;
+
+	// Failing once (e.g. a bad address) disables the stream instead of retrying every frame
+	bStartFailed = !Sender.Start(Settings);
+	if (!bStartFailed)
+	{
+		SendSubjects();
+	}
+	return !bStartFailed;
+}
+
+void UKeypointNetworkSubsystem::SubmitSubjectKeypoints(const UObject* Owner, const FString& SubjectName, int32 FrameIndex, double TimeSeconds, TArrayView<const FName> JointNames, TArrayView<const FVector> Positions)
+{
+	if (!bEnableNetworkStream || !Owner || JointNames.Num() != Positions.Num() || Positions.Num() > MAX_uint16 || !StartSender())
+	{
+		return;
+	}
+
+	FSubject* Subject = Subjects.FindByPredicate([Owner](const FSubject& Candidate) { return Candidate.Owner.Get() == Owner; });
+	if (!Subject || Subject->Name != SubjectName || Subject->JointNames != JointNames)
+	{
+		if (!Subject)
+		{
+			Subject = &Subjects.AddDefaulted_GetRef();
+			Subject->Owner = Owner;
+			Subject->Id = NextSubjectId++;
+		}
+		Subject->Name = SubjectName;
+		Subject->JointNames = TArray<FName>(JointNames);
+		SendSubjects();
+	}
+
+	// Only a copy here; the sender thread serializes the frame
+	if (!PendingFrame)
+	{
+		PendingFrame = Sender.AllocateFrame();
+		PendingFrame->FrameIndex = FrameIndex;
+		PendingFrame->TimeSeconds = TimeSeconds;
+		PendingFrame->CaptureTimeMicros = static_cast<uint64>((FDateTime::UtcNow() - FDateTime(1970, 1, 1)).GetTicks() / ETimespan::TicksPerMicrosecond);
+	}
+	PendingFrame->FrameIndex = FMath::Max(PendingFrame->FrameIndex, FrameIndex);
+	PendingFrame->SubjectIds.Add(Subject->Id);
+	PendingFrame->JointCounts.Add(static_cast<uint16>(Positions.Num()));
+	for (const FVector& Position : Positions)
+	{
+		PendingFrame->Positions.Add(FVector3f(Position));
+	}
+}
+
+void UKeypointNetworkSubsystem::RemoveSubject(const UObject* Owner)
+{
+	if (Subjects.RemoveAll([Owner](const FSubject& Subject) { return Subject.Owner.Get() == Owner || !Subject.Owner.IsValid(); }) > 0 && Sender.IsRunning())
+	{
+		SendSubjects();
+	}
+}
+
+void UKeypointNetworkSubsystem::SendSubjects()
+{
+	TArray<FKeypointNetworkSubject> SenderSubjects;
+	SenderSubjects.Reserve(Subjects.Num());
+	for (const FSubject& Subject : Subjects)
+	{
+		FKeypointNetworkSubject& SenderSubject = SenderSubjects.AddDefaulted_GetRef();
+		SenderSubject.Id = Subject.Id;
+		SenderSubject.Name = Subject.Name;
+		SenderSubject.JointNames = Subject.JointNames;
+	}
+	Sender.SetSubjects(MoveTemp(SenderSubjects));
+}
+
+void UKeypointNetworkSubsystem::OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	// All subjects have submitted the frame once every actor has ticked
+	if (World == GetWorld() && PendingFrame)
+	{
+		Sender.EnqueueFrame(MoveTemp(PendingFrame));
+	}
+}
@@ -0,0 +1,84 @@
+// KeypointNetworkSubsystem.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "KeypointNetworkSender.h"
+#include "KeypointNetworkSubsystem.generated.h"
+
+/**
+ * Streams all subjects' keypoints of every frame over UDP while capturing, for live consumers on other machines
+ * (e.g. a robot controller or a remote visualizer). Clients link Tools/KeypointNetworkClient.
+ * Subjects (see USkeletalExtractor::bStreamKeypointsToNetwork) submit their Body keypoints every streamed frame; once
+ * every actor has ticked, the frame's subjects are queued as one FKeypointNetworkFrame and sent by the
+ * FKeypointNetworkSender thread, batched into as few datagrams as MaxDatagramBytes allows.
+ */
+UCLASS(config = Game)
+class EXTRACTJOINTLOCATION_API UKeypointNetworkSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UKeypointNetworkSubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/** Adds a subject's keypoints to the frame sent after this tick, starting the sender on first use. */
+	void SubmitSubjectKeypoints(const UObject* Owner, const FString& SubjectName, int32 FrameIndex, double TimeSeconds, TArrayView<const FName> JointNames, TArrayView<const FVector> Positions);
+
+	/** Removes a subject from the stream. */
+	void RemoveSubject(const UObject* Owner);
+
+	/** Streams keypoints over the network. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Network Stream")
+	bool bEnableNetworkStream;
+
+	/** IPv4 address datagrams are sent to; unicast, multicast or broadcast (255.255.255.255). */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Network Stream")
+	FString TargetAddress;
+
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Network Stream", meta = (ClampMin = "1", ClampMax = "65535"))
+	int32 Port;
+
+	/** Sends positions as int16 offsets from each subject's bounds centre instead of floats, halving the datagrams. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Network Stream")
+	bool bQuantizePositions;
+
+	/** Finest quantization step (cm) with bQuantizePositions. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Network Stream", meta = (ClampMin = "0.001"))
+	float QuantizationStep;
+
+	/** Largest datagram (bytes); a frame is split at subject boundaries into more datagrams beyond it. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Network Stream", meta = (ClampMin = "512", ClampMax = "65507"))
+	int32 MaxDatagramBytes;
+
+	/** Frames waiting for the sender thread beyond which new frames are dropped. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Network Stream", meta = (ClampMin = "1"))
+	int32 MaxQueuedFrames;
+
+	/** Seconds between repeats of the subject schema, so clients that join late or lose it catch up. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Network Stream")
+	float SchemaInterval;
+
+private:
+	struct FSubject
+	{
+		TWeakObjectPtr<const UObject> Owner;
+		uint16 Id = 0;
+		FString Name;
+		TArray<FName> JointNames;
+	};
+
+	void OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	bool StartSender();
+	void SendSubjects();
+
+	TArray<FSubject> Subjects;
+	uint16 NextSubjectId = 0;
+	FKeypointNetworkSender Sender;
+	bool bStartFailed = false;
+	// Frame being filled by this tick's submissions
+	TUniquePtr<FKeypointNetworkFrame> PendingFrame;
+	FDelegateHandle PostActorTickHandle;
+};
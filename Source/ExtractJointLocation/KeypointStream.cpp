@@ -0,0 +1,483 @@
+#include "KeypointStream.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogKeypointStream, Log, All);
+
+namespace KeypointStream
+{
+	enum class EFrameType : uint8
+	{
+		Raw = 0,
+		Keyframe = 1,
+		Delta = 2
+	};
+
+	static void WriteVarUInt(TArray<uint8>& Out, uint32 Value)
+	{
+		while (Value >= 0x80)
+		{
+			Out.Add(static_cast<uint8>(Value | 0x80));
+			Value >>= 7;
+		}
+		Out.Add(static_cast<uint8>(Value));
+	}
+
+	static bool ReadVarUInt(TArrayView<const uint8> Data, int64& Offset, uint32& OutValue)
+	{
+		uint32 Result = 0;
+		for (int32 Shift = 0; Shift < 35; Shift += 7)
+		{
+			if (Offset >= Data.Num())
+			{
+				return false;
+			}
+			const uint8 Byte = Data[Offset++];
+			Result |= static_cast<uint32>(Byte & 0x7F) << Shift;
+			if ((Byte & 0x80) == 0)
+			{
+				OutValue = Result;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static void WriteVarInt(TArray<uint8>& Out, int32 Value)
+	{
+		// Zig-zag so small negative residuals also encode to one byte
+		WriteVarUInt(Out, (static_cast<uint32>(Value) << 1) ^ static_cast<uint32>(Value >> 31));
+	}
+
+	static bool ReadVarInt(TArrayView<const uint8> Data, int64& Offset, int32& OutValue)
+	{
+		uint32 Encoded = 0;
+		if (!ReadVarUInt(Data, Offset, Encoded))
+		{
+			return false;
+		}
+		OutValue = static_cast<int32>(Encoded >> 1) ^ -static_cast<int32>(Encoded & 1);
+		return true;
+	}
+
+	static void WriteFloat(TArray<uint8>& Out, float Value)
+	{
+		const int32 Start = Out.AddUninitialized(sizeof(float));
+		FMemory::Memcpy(Out.GetData() + Start, &Value, sizeof(float));
+	}
+
+	static bool ReadFloat(TArrayView<const uint8> Data, int64& Offset, float& OutValue)
+	{
+		if (Offset + static_cast<int64>(sizeof(float)) > Data.Num())
+		{
+			return false;
+		}
+		FMemory::Memcpy(&OutValue, Data.GetData() + Offset, sizeof(float));
+		Offset += sizeof(float);
+		return true;
+	}
+
+	// Linear prediction from the two previous frames (constant velocity), or the previous frame only
+	static FIntVector Predict(int32 FramesSinceKeyframe, const FIntVector& Previous, const FIntVector& PreviousPrevious)
+	{
+		if (FramesSinceKeyframe <= 0)
+		{
+			return FIntVector::ZeroValue;
+		}
+		if (FramesSinceKeyframe == 1)
+		{
+			return Previous;
+		}
+		return Previous * 2 - PreviousPrevious;
+	}
+}
+
+FArchive& operator<<(FArchive& Ar, FKeypointStreamHeader& Header)
+{
+	uint32 Magic = FKeypointStreamHeader::Magic;
+	Ar << Magic;
+	if (Ar.IsLoading() && Magic != FKeypointStreamHeader::Magic)
+	{
+		Ar.SetError();
+		return Ar;
+	}
+
+	uint8 Encoding = static_cast<uint8>(Header.Encoding);
+	Ar << Header.Version;
+	Ar << Encoding;
+	Ar << Header.QuantizationStep;
+	Ar << Header.KeyframeInterval;
+	Header.Encoding = static_cast<EKeypointStreamEncoding>(Encoding);
+
+	int32 NumJoints = Header.JointNames.Num();
+	Ar << NumJoints;
+	if (Ar.IsLoading())
+	{
+		if (NumJoints < 0 || NumJoints > 65536)
+		{
+			Ar.SetError();
+			return Ar;
+		}
+		Header.JointNames.SetNum(NumJoints);
+	}
+	for (FName& JointName : Header.JointNames)
+	{
+		FString NameString = JointName.ToString();
+		Ar << NameString;
+		JointName = FName(*NameString);
+	}
+	return Ar;
+}
+
+FKeypointStreamEncoder::FKeypointStreamEncoder(EKeypointStreamEncoding Encoding, const TArray<FName>& JointNames, float MaxError, int32 KeyframeInterval)
+{
+	Header.Encoding = Encoding;
+	Header.JointNames = JointNames;
+	// Rounding to the nearest step keeps the error within half a step
+	Header.QuantizationStep = 2.0f * FMath::Max(MaxError, UE_KINDA_SMALL_NUMBER);
+	Header.KeyframeInterval = FMath::Max(KeyframeInterval, 1);
+}
+
+void FKeypointStreamEncoder::WriteHeader(TArray<uint8>& Out) const
+{
+	// Appends after any bytes already in Out
+	FMemoryWriter Writer(Out, false, true);
+	FKeypointStreamHeader HeaderCopy = Header;
+	Writer << HeaderCopy;
+}
+
+void FKeypointStreamEncoder::Reset()
+{
+	FramesSinceKeyframe = 0;
+}
+
+void FKeypointStreamEncoder::EncodeFrame(int32 FrameIndex, float TimeSeconds, TArrayView<const FVector> Positions, TArray<uint8>& Out)
+{
+	using namespace KeypointStream;
+
+	const int32 NumJoints = Header.JointNames.Num();
+	check(Positions.Num() == NumJoints);
+
+	if (Header.Encoding == EKeypointStreamEncoding::RawFloat)
+	{
+		bLastFrameKeyframe = true;
+		Out.Add(static_cast<uint8>(EFrameType::Raw));
+		WriteVarUInt(Out, static_cast<uint32>(FrameIndex));
+		WriteFloat(Out, TimeSeconds);
+		for (const FVector& Position : Positions)
+		{
+			WriteFloat(Out, Position.X);
+			WriteFloat(Out, Position.Y);
+			WriteFloat(Out, Position.Z);
+		}
+		return;
+	}
+
+	// Quantize the root absolutely and every other joint against the *dequantized* root,
+	// so the reconstruction error of a joint does not include the root's rounding error.
+	const double Step = Header.QuantizationStep;
+	Current.SetNumUninitialized(NumJoints);
+	if (NumJoints > 0)
+	{
+		const FVector& Root = Positions[0];
+		Current[0] = FIntVector(FMath::RoundToInt(Root.X / Step), FMath::RoundToInt(Root.Y / Step), FMath::RoundToInt(Root.Z / Step));
+		const FVector QuantizedRoot = FVector(Current[0]) * Step;
+		for (int32 Joint = 1; Joint < NumJoints; ++Joint)
+		{
+			const FVector Relative = Positions[Joint] - QuantizedRoot;
+			Current[Joint] = FIntVector(FMath::RoundToInt(Relative.X / Step), FMath::RoundToInt(Relative.Y / Step), FMath::RoundToInt(Relative.Z / Step));
+		}
+	}
+
+	const bool bKeyframe = FramesSinceKeyframe == 0 || Previous.Num() != NumJoints;
+	if (bKeyframe)
+	{
+		FramesSinceKeyframe = 0;
+	}
+	bLastFrameKeyframe = bKeyframe;
+
+	Out.Add(static_cast<uint8>(bKeyframe ? EFrameType::Keyframe : EFrameType::Delta));
+	WriteVarUInt(Out, static_cast<uint32>(FrameIndex));
+	WriteFloat(Out, TimeSeconds);
+	for (int32 Joint = 0; Joint < NumJoints; ++Joint)
+	{
+		const FIntVector Prediction = bKeyframe ? FIntVector::ZeroValue : Predict(FramesSinceKeyframe, Previous[Joint], PreviousPrevious[Joint]);
+		const FIntVector Residual = Current[Joint] - Prediction;
+		WriteVarInt(Out, Residual.X);
+		WriteVarInt(Out, Residual.Y);
+		WriteVarInt(Out, Residual.Z);
+	}
+
+	Swap(PreviousPrevious, Previous);
+	Swap(Previous, Current);
+	FramesSinceKeyframe = (FramesSinceKeyframe + 1) % Header.KeyframeInterval;
+}
+
+bool FKeypointStreamDecoder::ReadHeader(TArrayView<const uint8> Data, int64& Offset)
+{
+	if (Offset < 0 || Offset >= Data.Num())
+	{
+		return false;
+	}
+
+	FMemoryReaderView Reader(Data.Slice(Offset, Data.Num() - Offset));
+	Reader << Header;
+	if (Reader.IsError() || Header.Version > FKeypointStreamHeader::CurrentVersion)
+	{
+		return false;
+	}
+
+	Offset += Reader.Tell();
+	Previous.Reset();
+	PreviousPrevious.Reset();
+	FramesSinceKeyframe = 0;
+	return true;
+}
+
+bool FKeypointStreamDecoder::DecodeFrame(TArrayView<const uint8> Data, int64& Offset, int32& OutFrameIndex, float& OutTimeSeconds, TArray<FVector>& OutPositions)
+{
+	using namespace KeypointStream;
+
+	int64 Cursor = Offset;
+	if (Cursor >= Data.Num())
+	{
+		return false;
+	}
+
+	const EFrameType FrameType = static_cast<EFrameType>(Data[Cursor++]);
+	uint32 FrameIndex = 0;
+	if (!ReadVarUInt(Data, Cursor, FrameIndex) || !ReadFloat(Data, Cursor, OutTimeSeconds))
+	{
+		return false;
+	}
+	OutFrameIndex = static_cast<int32>(FrameIndex);
+
+	const int32 NumJoints = Header.JointNames.Num();
+	OutPositions.SetNumUninitialized(NumJoints);
+
+	if (FrameType == EFrameType::Raw)
+	{
+		for (FVector& Position : OutPositions)
+		{
+			float X, Y, Z;
+			if (!ReadFloat(Data, Cursor, X) || !ReadFloat(Data, Cursor, Y) || !ReadFloat(Data, Cursor, Z))
+			{
+				return false;
+			}
+			Position = FVector(X, Y, Z);
+		}
+		bLastFrameKeyframe = true;
+		Offset = Cursor;
+		return true;
+	}
+
+	const bool bKeyframe = FrameType == EFrameType::Keyframe;
+	if (!bKeyframe && (FrameType != EFrameType::Delta || Previous.Num() != NumJoints))
+	{
+		// Unknown frame type, or a delta frame without a preceding keyframe
+		return false;
+	}
+	if (bKeyframe)
+	{
+		FramesSinceKeyframe = 0;
+	}
+
+	Current.SetNumUninitialized(NumJoints);
+	for (int32 Joint = 0; Joint < NumJoints; ++Joint)
+	{
+		FIntVector Residual;
+		if (!ReadVarInt(Data, Cursor, Residual.X) || !ReadVarInt(Data, Cursor, Residual.Y) || !ReadVarInt(Data, Cursor, Residual.Z))
+		{
+			return false;
+		}
+		const FIntVector Prediction = bKeyframe ? FIntVector::ZeroValue : Predict(FramesSinceKeyframe, Previous[Joint], PreviousPrevious[Joint]);
+		Current[Joint] = Prediction + Residual;
+	}
+
+	const double Step = Header.QuantizationStep;
+	if (NumJoints > 0)
+	{
+		const FVector Root = FVector(Current[0]) * Step;
+		OutPositions[0] = Root;
+		for (int32 Joint = 1; Joint < NumJoints; ++Joint)
+		{
+			OutPositions[Joint] = Root + FVector(Current[Joint]) * Step;
+		}
+	}
+
+	Swap(PreviousPrevious, Previous);
+	Swap(Previous, Current);
+	FramesSinceKeyframe = (FramesSinceKeyframe + 1) % FMath::Max(Header.KeyframeInterval, 1);
+	bLastFrameKeyframe = bKeyframe;
+	Offset = Cursor;
+	return true;
+}
+
+bool FKeypointStreamDecoder::DecodeFile(const FString& FilePath, FKeypointStreamHeader& OutHeader, TArray<int32>& OutFrameIndices, TArray<TArray<FVector>>& OutFrames)
+{
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *FilePath))
+	{
+		UE_LOG(LogKeypointStream, Error, TEXT("DecodeFile: Failed to read keypoint stream: %s"), *FilePath);
+		return false;
+	}
+
+	FKeypointStreamDecoder Decoder;
+	int64 Offset = 0;
+	if (!Decoder.ReadHeader(Data, Offset))
+	{
+		UE_LOG(LogKeypointStream, Error, TEXT("DecodeFile: %s is not a keypoint stream."), *FilePath);
+		return false;
+	}
+	OutHeader = Decoder.GetHeader();
+
+	int32 FrameIndex = 0;
+	float TimeSeconds = 0.0f;
+	TArray<FVector> Positions;
+	while (Decoder.DecodeFrame(Data, Offset, FrameIndex, TimeSeconds, Positions))
+	{
+		OutFrameIndices.Add(FrameIndex);
+		OutFrames.Add(Positions);
+	}
+
+	if (Offset != Data.Num())
+	{
+		UE_LOG(LogKeypointStream, Warning, TEXT("DecodeFile: Ignoring %lld trailing bytes of a truncated frame in %s"), Data.Num() - Offset, *FilePath);
+	}
+	return true;
+}
+
+FKeypointStreamWriter::FKeypointStreamWriter(EKeypointStreamEncoding Encoding, const TArray<FName>& JointNames, float MaxError, int32 KeyframeInterval)
+	: Encoder(Encoding, JointNames, MaxError, KeyframeInterval)
+{
+}
+
+FKeypointStreamWriter::~FKeypointStreamWriter()
+{
+	Close();
+}
+
+bool FKeypointStreamWriter::Open(const FString& InFilePath)
+{
+	Close();
+	FilePath = InFilePath;
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	const FString DirectoryPath = FPaths::GetPath(FilePath);
+	if (!PlatformFile.DirectoryExists(*DirectoryPath))
+	{
+		PlatformFile.CreateDirectoryTree(*DirectoryPath);
+	}
+
+	FileHandle.Reset(PlatformFile.OpenWrite(*FilePath));
+	if (!FileHandle.IsValid())
+	{
+		UE_LOG(LogKeypointStream, Error, TEXT("Open: Failed to open keypoint stream for writing: %s"), *FilePath);
+		return false;
+	}
+
+	Encoder.Reset();
+	FrameBuffer.Reset();
+	Encoder.WriteHeader(FrameBuffer);
+	BytesWritten = 0;
+	if (!FileHandle->Write(FrameBuffer.GetData(), FrameBuffer.Num()))
+	{
+		Close();
+		return false;
+	}
+	BytesWritten += FrameBuffer.Num();
+	HeaderSize = FrameBuffer.Num();
+	KeyframeOffset = BytesWritten;
+	return true;
+}
+
+bool FKeypointStreamWriter::OpenForResume(const FString& InFilePath, int64 ValidBytes)
+{
+	Close();
+	FilePath = InFilePath;
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	const int64 FileSize = PlatformFile.FileSize(*FilePath);
+	if (FileSize < ValidBytes)
+	{
+		UE_LOG(LogKeypointStream, Error, TEXT("OpenForResume: %s has %lld bytes, the checkpoint expects at least %lld."), *FilePath, FileSize, ValidBytes);
+		return false;
+	}
+
+	FileHandle.Reset(PlatformFile.OpenWrite(*FilePath, true, true));
+	if (!FileHandle.IsValid())
+	{
+		UE_LOG(LogKeypointStream, Error, TEXT("OpenForResume: Failed to open keypoint stream for writing: %s"), *FilePath);
+		return false;
+	}
+
+	// The stream must continue with the same joints and quantization it was started with
+	Encoder.Reset();
+	FrameBuffer.Reset();
+	Encoder.WriteHeader(FrameBuffer);
+	TArray<uint8> ExistingHeader;
+	ExistingHeader.SetNumUninitialized(FrameBuffer.Num());
+	if (ValidBytes < FrameBuffer.Num() || !FileHandle->Seek(0) || !FileHandle->Read(ExistingHeader.GetData(), ExistingHeader.Num())
+		|| FMemory::Memcmp(ExistingHeader.GetData(), FrameBuffer.GetData(), FrameBuffer.Num()) != 0)
+	{
+		UE_LOG(LogKeypointStream, Error, TEXT("OpenForResume: %s was written with a different header."), *FilePath);
+		Close();
+		return false;
+	}
+
+	if (FileSize > ValidBytes)
+	{
+		UE_LOG(LogKeypointStream, Warning, TEXT("OpenForResume: Discarding %lld bytes written after the last checkpoint of %s"), FileSize - ValidBytes, *FilePath);
+	}
+	if (!FileHandle->Truncate(ValidBytes) || !FileHandle->SeekFromEnd(0))
+	{
+		UE_LOG(LogKeypointStream, Error, TEXT("OpenForResume: Failed to truncate %s to %lld bytes."), *FilePath, ValidBytes);
+		Close();
+		return false;
+	}
+
+	// The encoder starts without prediction history, so the next frame is a keyframe as in an uninterrupted run
+	BytesWritten = ValidBytes;
+	HeaderSize = FrameBuffer.Num();
+	KeyframeOffset = BytesWritten;
+	return true;
+}
+
+bool FKeypointStreamWriter::WriteFrame(int32 FrameIndex, float TimeSeconds, TArrayView<const FVector> Positions)
+{
+	if (!FileHandle.IsValid())
+	{
+		return false;
+	}
+
+	FrameBuffer.Reset();
+	Encoder.EncodeFrame(FrameIndex, TimeSeconds, Positions, FrameBuffer);
+	if (!FileHandle->Write(FrameBuffer.GetData(), FrameBuffer.Num()))
+	{
+		UE_LOG(LogKeypointStream, Error, TEXT("WriteFrame: Failed to write frame %d to %s"), FrameIndex, *FilePath);
+		return false;
+	}
+	if (Encoder.WasKeyframe())
+	{
+		KeyframeOffset = BytesWritten;
+	}
+	BytesWritten += FrameBuffer.Num();
+	return true;
+}
+
+bool FKeypointStreamWriter::Sync()
+{
+	return FileHandle.IsValid() && FileHandle->Flush(true);
+}
+
+void FKeypointStreamWriter::Close()
+{
+	if (FileHandle.IsValid())
+	{
+		FileHandle->Flush();
+		FileHandle.Reset();
+	}
+}
@@ -0,0 +1,158 @@
+// KeypointStream.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "KeypointStream.generated.h"
+
+class IFileHandle;
+
+// How per-frame keypoints are stored in a keypoint stream file
+UENUM(BlueprintType)
+enum class EKeypointStreamEncoding : uint8
+{
+	// Full precision float triplets per joint per frame
+	RawFloat,
+	// Root-relative fixed point positions, stored as predicted deltas between keyframes
+	QuantizedDelta
+};
+
+/**
+ * Header at the start of every keypoint stream.
+ * The first joint is the stream's root; the other joints are quantized relative to it.
+ */
+struct EXTRACTJOINTLOCATION_API FKeypointStreamHeader
+{
+	static constexpr uint32 Magic = 0x5344504B; // "KPDS"
+	static constexpr uint16 CurrentVersion = 1;
+
+	uint16 Version = CurrentVersion;
+	EKeypointStreamEncoding Encoding = EKeypointStreamEncoding::QuantizedDelta;
+	// Size of one quantization step (cm); the reconstruction error per axis is at most half of it
+	float QuantizationStep = 0.02f;
+	// A keyframe (no prediction from previous frames) is written every KeyframeInterval frames
+	int32 KeyframeInterval = 120;
+	TArray<FName> JointNames;
+
+	friend FArchive& operator<<(FArchive& Ar, FKeypointStreamHeader& Header);
+};
+
+/**
+ * Encodes frames of joint positions into a byte stream.
+ * Quantized frames store zig-zag varint residuals against a linear prediction from the two previous
+ * frames, so slowly moving joints cost one byte per axis.
+ */
+class EXTRACTJOINTLOCATION_API FKeypointStreamEncoder
+{
+public:
+	/**
+	 * @param Encoding Raw or quantized delta.
+	 * @param JointNames Joints in the order positions will be passed to EncodeFrame; the first is the root.
+	 * @param MaxError Largest allowed reconstruction error per axis (cm), e.g. 0.01 for 0.1 mm.
+	 * @param KeyframeInterval Number of frames between keyframes.
+	 */
+	FKeypointStreamEncoder(EKeypointStreamEncoding Encoding, const TArray<FName>& JointNames, float MaxError, int32 KeyframeInterval);
+
+	const FKeypointStreamHeader& GetHeader() const { return Header; }
+
+	/** Appends the serialized stream header to Out. */
+	void WriteHeader(TArray<uint8>& Out) const;
+
+	/**
+	 * Appends one frame to Out.
+	 * @param Positions World-space positions, one per joint in header order.
+	 */
+	void EncodeFrame(int32 FrameIndex, float TimeSeconds, TArrayView<const FVector> Positions, TArray<uint8>& Out);
+
+	/** Forces the next frame to be a keyframe. */
+	void Reset();
+
+	/** True if the last encoded frame decodes without the frames before it (a keyframe or a raw frame). */
+	bool WasKeyframe() const { return bLastFrameKeyframe; }
+
+private:
+	FKeypointStreamHeader Header;
+	int32 FramesSinceKeyframe = 0;
+	bool bLastFrameKeyframe = false;
+	TArray<FIntVector> Previous;
+	TArray<FIntVector> PreviousPrevious;
+	TArray<FIntVector> Current;
+};
+
+/** Decodes a byte stream written by FKeypointStreamEncoder. */
+class EXTRACTJOINTLOCATION_API FKeypointStreamDecoder
+{
+public:
+	/**
+	 * Reads the stream header starting at Offset and advances Offset past it.
+	 * @return False if the data is not a keypoint stream or the version is unsupported.
+	 */
+	bool ReadHeader(TArrayView<const uint8> Data, int64& Offset);
+
+	/**
+	 * Decodes the frame starting at Offset and advances Offset past it.
+	 * @return False at the end of the data or if the frame is truncated or malformed.
+	 */
+	bool DecodeFrame(TArrayView<const uint8> Data, int64& Offset, int32& OutFrameIndex, float& OutTimeSeconds, TArray<FVector>& OutPositions);
+
+	const FKeypointStreamHeader& GetHeader() const { return Header; }
+
+	/** True if the last decoded frame did not depend on the frames before it (a keyframe or a raw frame). */
+	bool WasKeyframe() const { return bLastFrameKeyframe; }
+
+	/** Convenience: decodes a whole stream file into per-frame positions. */
+	static bool DecodeFile(const FString& FilePath, FKeypointStreamHeader& OutHeader, TArray<int32>& OutFrameIndices, TArray<TArray<FVector>>& OutFrames);
+
+private:
+	FKeypointStreamHeader Header;
+	TArray<FIntVector> Previous;
+	TArray<FIntVector> PreviousPrevious;
+	TArray<FIntVector> Current;
+	int32 FramesSinceKeyframe = 0;
+	bool bLastFrameKeyframe = false;
+};
+
+/** Owns an open keypoint stream file and appends encoded frames to it. */
+class EXTRACTJOINTLOCATION_API FKeypointStreamWriter
+{
+public:
+	FKeypointStreamWriter(EKeypointStreamEncoding Encoding, const TArray<FName>& JointNames, float MaxError, int32 KeyframeInterval);
+	~FKeypointStreamWriter();
+
+	/** Creates the file (and its directory) and writes the header. */
+	bool Open(const FString& FilePath);
+
+	/**
+	 * Reopens a stream written by an interrupted run so it can be continued. The file keeps its first
+	 * ValidBytes (a size recorded at a checkpoint, ending on a frame boundary before a keyframe); anything after
+	 * it, such as a frame that was only partially written when the process died, is discarded.
+	 * @return False if the file is missing, shorter than ValidBytes or was written with a different header.
+	 */
+	bool OpenForResume(const FString& FilePath, int64 ValidBytes);
+
+	/** Encodes and appends one frame. */
+	bool WriteFrame(int32 FrameIndex, float TimeSeconds, TArrayView<const FVector> Positions);
+
+	/** Flushes the written frames to the storage device (fsync), so they survive a crash. */
+	bool Sync();
+
+	void Close();
+
+	bool IsOpen() const { return FileHandle.IsValid(); }
+	int64 GetBytesWritten() const { return BytesWritten; }
+	const FString& GetFilePath() const { return FilePath; }
+
+	/** Size of the stream header at the start of the file. */
+	int64 GetHeaderSize() const { return HeaderSize; }
+
+	/** File offset of the keyframe the last written frame is predicted from; decoding from there reaches the frame. */
+	int64 GetKeyframeOffset() const { return KeyframeOffset; }
+
+private:
+	FKeypointStreamEncoder Encoder;
+	TUniquePtr<IFileHandle> FileHandle;
+	TArray<uint8> FrameBuffer;
+	FString FilePath;
+	int64 BytesWritten = 0;
+	int64 HeaderSize = 0;
+	int64 KeyframeOffset = 0;
+};
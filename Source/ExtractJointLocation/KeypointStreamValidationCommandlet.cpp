@@ -0,0 +1,238 @@
+#include "KeypointStreamValidationCommandlet.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogKeypointStreamValidation, Log, All);
+
+namespace KeypointStreamValidation
+{
+	static constexpr float FrameRate = 60.0f;
+	// Slack on top of the error bound for double rounding far from the origin
+	static constexpr double RelativeTolerance = 1e-9;
+}
+
+UKeypointStreamValidationCommandlet::UKeypointStreamValidationCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UKeypointStreamValidationCommandlet::Main(const FString& Params)
+{
+	TArray<FString> Tokens;
+	TArray<FString> Switches;
+	TMap<FString, FString> ParamsMap;
+	ParseCommandLine(*Params, Tokens, Switches, ParamsMap);
+
+	const int32 NumFrames = ParamsMap.Contains(TEXT("Frames")) ? FCString::Atoi(*ParamsMap[TEXT("Frames")]) : 600;
+	const int32 NumJoints = ParamsMap.Contains(TEXT("Joints")) ? FCString::Atoi(*ParamsMap[TEXT("Joints")]) : 24;
+	if (NumFrames < 3 || NumJoints < 1)
+	{
+		UE_LOG(LogKeypointStreamValidation, Error, TEXT("Usage: -run=KeypointStreamValidation [-Frames=600] [-Joints=24]"));
+		return 1;
+	}
+
+	const FCase Cases[] = {
+		{ TEXT("Raw"), EKeypointStreamEncoding::RawFloat, 0.0f, 120, FVector::ZeroVector, 0 },
+		{ TEXT("Quantized0.1mm"), EKeypointStreamEncoding::QuantizedDelta, 0.01f, 120, FVector::ZeroVector, 0 },
+		{ TEXT("Quantized1mm"), EKeypointStreamEncoding::QuantizedDelta, 0.1f, 120, FVector::ZeroVector, 0 },
+		{ TEXT("Quantized1cm"), EKeypointStreamEncoding::QuantizedDelta, 1.0f, 120, FVector::ZeroVector, 0 },
+		{ TEXT("KeyframesOnly"), EKeypointStreamEncoding::QuantizedDelta, 0.01f, 1, FVector::ZeroVector, 0 },
+		{ TEXT("ShortKeyframeInterval"), EKeypointStreamEncoding::QuantizedDelta, 0.01f, 7, FVector::ZeroVector, 0 },
+		{ TEXT("FarFromOrigin"), EKeypointStreamEncoding::QuantizedDelta, 0.01f, 120, FVector(50000.0, -80000.0, 2000.0), 0 },
+		{ TEXT("Jumps"), EKeypointStreamEncoding::QuantizedDelta, 0.01f, 120, FVector::ZeroVector, 37 } };
+
+	const int32 NumCases = UE_ARRAY_COUNT(Cases) + 1;
+	int32 NumFailed = 0;
+	for (const FCase& Case : Cases)
+	{
+		if (!RunCase(Case, NumFrames, NumJoints))
+		{
+			++NumFailed;
+		}
+	}
+	if (!CheckRejectsMalformedStreams(NumJoints))
+	{
+		++NumFailed;
+	}
+
+	UE_LOG(LogKeypointStreamValidation, Display, TEXT("%d of %d cases passed."), NumCases - NumFailed, NumCases);
+	return NumFailed > 0 ? 1 : 0;
+}
+
+TArray<FName> UKeypointStreamValidationCommandlet::MakeJointNames(int32 NumJoints)
+{
+	TArray<FName> JointNames;
+	for (int32 Joint = 0; Joint < NumJoints; ++Joint)
+	{
+		JointNames.Add(FName(*FString::Printf(TEXT("joint_%02d"), Joint)));
+	}
+	return JointNames;
+}
+
+void UKeypointStreamValidationCommandlet::MakeTake(const FCase& Case, int32 NumFrames, int32 NumJoints, TArray<TArray<FVector>>& OutFrames)
+{
+	using namespace KeypointStreamValidation;
+	FRandomStream Random(NumJoints);
+	TArray<FVector> RestOffsets;
+	TArray<float> Phases;
+	for (int32 Joint = 0; Joint < NumJoints; ++Joint)
+	{
+		RestOffsets.Add(Joint == 0 ? FVector::ZeroVector : Random.GetUnitVector() * Random.FRandRange(10.0f, 90.0f));
+		Phases.Add(Random.FRandRange(0.0f, 2.0f * PI));
+	}
+
+	// Root walks at 1.5 m/s, limbs swing a few centimetres at the gait frequency
+	OutFrames.SetNum(NumFrames);
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		const double Time = Frame / FrameRate;
+		const FVector Root = Case.Origin + FVector(150.0 * Time, 20.0 * FMath::Sin(0.5 * Time), 95.0 + 2.0 * FMath::Sin(2.0 * PI * 1.8 * Time));
+		const bool bJump = Case.JumpInterval > 0 && Frame > 0 && Frame % Case.JumpInterval == 0;
+		TArray<FVector>& Positions = OutFrames[Frame];
+		Positions.SetNum(NumJoints);
+		for (int32 Joint = 0; Joint < NumJoints; ++Joint)
+		{
+			const FVector Swing = FVector(FMath::Sin(2.0 * PI * 0.9 * Time + Phases[Joint]), FMath::Cos(2.0 * PI * 0.9 * Time + Phases[Joint]), 0.0) * 8.0;
+			// A jump moves the joint far enough that its residual needs several varint bytes
+			const FVector Jump = bJump ? Random.GetUnitVector() * 500.0 : FVector::ZeroVector;
+			Positions[Joint] = Joint == 0 ? Root + Jump : Root + RestOffsets[Joint] + Swing + Jump;
+		}
+	}
+}
+
+bool UKeypointStreamValidationCommandlet::RunCase(const FCase& Case, int32 NumFrames, int32 NumJoints)
+{
+	using namespace KeypointStreamValidation;
+	TArray<TArray<FVector>> Frames;
+	MakeTake(Case, NumFrames, NumJoints, Frames);
+
+	FKeypointStreamEncoder Encoder(Case.Encoding, MakeJointNames(NumJoints), Case.MaxError, Case.KeyframeInterval);
+	TArray<uint8> Data;
+	Encoder.WriteHeader(Data);
+	const int32 HeaderBytes = Data.Num();
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		// Frame indices that do not start at 0 and skip some, as a capture started mid play session would
+		Encoder.EncodeFrame(1000 + Frame * 2, Frame / FrameRate, Frames[Frame], Data);
+	}
+
+	FKeypointStreamDecoder Decoder;
+	int64 Offset = 0;
+	if (!Decoder.ReadHeader(Data, Offset) || Offset != HeaderBytes || Decoder.GetHeader().JointNames != Encoder.GetHeader().JointNames
+		|| Decoder.GetHeader().Encoding != Case.Encoding)
+	{
+		UE_LOG(LogKeypointStreamValidation, Error, TEXT("%s: header did not round-trip."), Case.Name);
+		return false;
+	}
+
+	// Rounding to the nearest step bounds the error by half a step, which the encoder derives from MaxError
+	const double Bound = Case.Encoding == EKeypointStreamEncoding::RawFloat ? 0.0 : 0.5 * Decoder.GetHeader().QuantizationStep;
+	int32 NumDecoded = 0;
+	int32 NumMismatched = 0;
+	double MaxError = 0.0;
+	int32 FrameIndex = 0;
+	float TimeSeconds = 0.0f;
+	TArray<FVector> Positions;
+	while (Decoder.DecodeFrame(Data, Offset, FrameIndex, TimeSeconds, Positions))
+	{
+		const int32 Frame = NumDecoded++;
+		if (Frame >= NumFrames || FrameIndex != 1000 + Frame * 2 || TimeSeconds != static_cast<float>(Frame / FrameRate) || Positions.Num() != NumJoints)
+		{
+			UE_LOG(LogKeypointStreamValidation, Error, TEXT("%s: frame %d decoded as frame %d at %.4f s with %d joints."), Case.Name, Frame, FrameIndex, TimeSeconds, Positions.Num());
+			return false;
+		}
+		for (int32 Joint = 0; Joint < NumJoints; ++Joint)
+		{
+			// Raw frames store floats, so they must match the float rounding of the input exactly
+			const FVector Expected = Case.Encoding == EKeypointStreamEncoding::RawFloat ? FVector(FVector3f(Frames[Frame][Joint])) : Frames[Frame][Joint];
+			const FVector Error = (Positions[Joint] - Expected).GetAbs();
+			const double Tolerance = Bound + RelativeTolerance * Expected.GetAbsMax();
+			MaxError = FMath::Max(MaxError, Error.GetMax());
+			if (Error.GetMax() > Tolerance)
+			{
+				if (NumMismatched++ == 0)
+				{
+					UE_LOG(LogKeypointStreamValidation, Error, TEXT("%s: frame %d joint %d off by %s, bound %.5f."), Case.Name, Frame, Joint, *Error.ToString(), Tolerance);
+				}
+			}
+		}
+	}
+
+	if (Offset != Data.Num() || NumDecoded != NumFrames)
+	{
+		UE_LOG(LogKeypointStreamValidation, Error, TEXT("%s: decoded %d of %d frames, stopped at byte %lld of %d."), Case.Name, NumDecoded, NumFrames, Offset, Data.Num());
+		return false;
+	}
+
+	const double RawBytes = static_cast<double>(NumFrames) * NumJoints * 3 * sizeof(float);
+	const double CompressionRatio = RawBytes / FMath::Max(Data.Num() - HeaderBytes, 1);
+	UE_LOG(LogKeypointStreamValidation, Display, TEXT("%s: %d frames, largest error %.5f cm (bound %.5f), %.1f bytes per frame, %.1fx smaller than raw floats, %d joints out of bounds."),
+		Case.Name, NumFrames, MaxError, Bound, static_cast<double>(Data.Num() - HeaderBytes) / NumFrames, CompressionRatio, NumMismatched);
+	return NumMismatched == 0;
+}
+
+bool UKeypointStreamValidationCommandlet::CheckRejectsMalformedStreams(int32 NumJoints)
+{
+	const FCase Case = { TEXT("Malformed"), EKeypointStreamEncoding::QuantizedDelta, 0.01f, 120, FVector::ZeroVector, 0 };
+	TArray<TArray<FVector>> Frames;
+	MakeTake(Case, 3, NumJoints, Frames);
+
+	FKeypointStreamEncoder Encoder(Case.Encoding, MakeJointNames(NumJoints), Case.MaxError, Case.KeyframeInterval);
+	TArray<uint8> Data;
+	Encoder.WriteHeader(Data);
+	const int32 HeaderBytes = Data.Num();
+	Encoder.EncodeFrame(0, 0.0f, Frames[0], Data);
+	const int32 DeltaStart = Data.Num();
+	Encoder.EncodeFrame(1, 1.0f / KeypointStreamValidation::FrameRate, Frames[1], Data);
+
+	bool bPassed = true;
+	int32 FrameIndex = 0;
+	float TimeSeconds = 0.0f;
+	TArray<FVector> Positions;
+
+	// A delta frame read without the keyframe before it has nothing to predict from
+	{
+		FKeypointStreamDecoder Decoder;
+		int64 Offset = 0;
+		Decoder.ReadHeader(Data, Offset);
+		Offset = DeltaStart;
+		if (Decoder.DecodeFrame(Data, Offset, FrameIndex, TimeSeconds, Positions))
+		{
+			UE_LOG(LogKeypointStreamValidation, Error, TEXT("Malformed: a delta frame decoded without its keyframe."));
+			bPassed = false;
+		}
+	}
+
+	// A frame cut short must not decode, nor advance the offset
+	{
+		const TArrayView<const uint8> Truncated(Data.GetData(), Data.Num() - 1);
+		FKeypointStreamDecoder Decoder;
+		int64 Offset = 0;
+		const bool bHeaderRead = Decoder.ReadHeader(Truncated, Offset);
+		const bool bKeyframeDecoded = bHeaderRead && Decoder.DecodeFrame(Truncated, Offset, FrameIndex, TimeSeconds, Positions);
+		const int64 TruncatedStart = Offset;
+		if (!bKeyframeDecoded || Decoder.DecodeFrame(Truncated, Offset, FrameIndex, TimeSeconds, Positions) || Offset != TruncatedStart || TruncatedStart != DeltaStart)
+		{
+			UE_LOG(LogKeypointStreamValidation, Error, TEXT("Malformed: a truncated stream was not rejected at its last frame."));
+			bPassed = false;
+		}
+	}
+
+	// Bytes that are not a stream header
+	{
+		FKeypointStreamDecoder Decoder;
+		int64 Offset = 0;
+		if (Decoder.ReadHeader(TArrayView<const uint8>(Data.GetData() + HeaderBytes, Data.Num() - HeaderBytes), Offset))
+		{
+			UE_LOG(LogKeypointStreamValidation, Error, TEXT("Malformed: frame data was read as a header."));
+			bPassed = false;
+		}
+	}
+
+	if (bPassed)
+	{
+		UE_LOG(LogKeypointStreamValidation, Display, TEXT("Malformed: rejected, as expected."));
+	}
+	return bPassed;
+}
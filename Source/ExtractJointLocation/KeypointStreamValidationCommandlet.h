@@ -0,0 +1,46 @@
+// KeypointStreamValidationCommandlet.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "KeypointStream.h"
+#include "KeypointStreamValidationCommandlet.generated.h"
+
+/**
+ * Round-trips synthetic keypoint takes through FKeypointStreamEncoder and FKeypointStreamDecoder, without loading
+ * any assets. Every case encodes a walking skeleton, decodes it again and checks frame indices, times and that every
+ * joint is within the requested error per axis. Cases cover raw floats, several error bounds, keyframe-only streams,
+ * a root far from the origin and joints that jump between frames, plus a truncated stream and a delta frame without
+ * its keyframe, which must be rejected.
+ *
+ * UnrealEditor-Cmd Project.uproject -run=KeypointStreamValidation [-Frames=600] [-Joints=24]
+ * Returns 1 if any check fails.
+ */
+UCLASS()
+class EXTRACTJOINTLOCATION_API UKeypointStreamValidationCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UKeypointStreamValidationCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	struct FCase
+	{
+		const TCHAR* Name;
+		EKeypointStreamEncoding Encoding;
+		float MaxError;
+		int32 KeyframeInterval;
+		// Offset of the whole take from the origin (cm)
+		FVector Origin;
+		// Every this many frames all joints jump, 0 for smooth motion only
+		int32 JumpInterval;
+	};
+
+	static bool RunCase(const FCase& Case, int32 NumFrames, int32 NumJoints);
+	static bool CheckRejectsMalformedStreams(int32 NumJoints);
+	static void MakeTake(const FCase& Case, int32 NumFrames, int32 NumJoints, TArray<TArray<FVector>>& OutFrames);
+	static TArray<FName> MakeJointNames(int32 NumJoints);
+};
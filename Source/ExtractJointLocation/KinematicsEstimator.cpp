@@ -0,0 +1,197 @@
+#include "KinematicsEstimator.h"
+
+// Frames are copied and derivatives written as flat component arrays
+static_assert(sizeof(FVector) == 3 * sizeof(double), "FKinematicsEstimator expects FVector to be three packed doubles");
+
+namespace KinematicsEstimator
+{
+	// Cubic fit: enough for a non-zero third derivative
+	static constexpr int32 NumPolynomialTerms = 4;
+}
+
+FKinematicsEstimator::FKinematicsEstimator(EKinematicsFilter Filter, int32 InNumJoints, int32 HalfWindow)
+	: NumJoints(FMath::Max(InNumJoints, 0))
+{
+	if (Filter == EKinematicsFilter::SavitzkyGolay)
+	{
+		HalfWindow = FMath::Max(HalfWindow, 2);
+		WindowSize = 2 * HalfWindow + 1;
+		EvalSlot = HalfWindow;
+	}
+	else
+	{
+		WindowSize = KinematicsEstimator::NumPolynomialTerms;
+		EvalSlot = WindowSize - 1;
+	}
+
+	ComputeWeights();
+
+	Window.SetNum(WindowSize);
+	for (TArray<double>& Frame : Window)
+	{
+		Frame.SetNumZeroed(NumJoints * 3);
+	}
+	WindowFrames.SetNumZeroed(WindowSize);
+	WindowTimes.SetNumZeroed(WindowSize);
+}
+
+void FKinematicsEstimator::ComputeWeights()
+{
+	using namespace KinematicsEstimator;
+
+	// Least squares fit of a cubic over offsets x_i = i - EvalSlot: coefficients = (A^T A)^-1 A^T y,
+	// and the k-th derivative at the evaluated frame is k! times coefficient k
+	double Normal[NumPolynomialTerms][2 * NumPolynomialTerms] = {};
+	for (int32 Row = 0; Row < NumPolynomialTerms; ++Row)
+	{
+		for (int32 Column = 0; Column < NumPolynomialTerms; ++Column)
+		{
+			for (int32 i = 0; i < WindowSize; ++i)
+			{
+				Normal[Row][Column] += FMath::Pow(static_cast<double>(i - EvalSlot), Row + Column);
+			}
+		}
+		Normal[Row][NumPolynomialTerms + Row] = 1.0;
+	}
+
+	// Gauss-Jordan inversion with partial pivoting, the matrix is tiny and well conditioned for these windows
+	for (int32 Pivot = 0; Pivot < NumPolynomialTerms; ++Pivot)
+	{
+		int32 BestRow = Pivot;
+		for (int32 Row = Pivot + 1; Row < NumPolynomialTerms; ++Row)
+		{
+			if (FMath::Abs(Normal[Row][Pivot]) > FMath::Abs(Normal[BestRow][Pivot]))
+			{
+				BestRow = Row;
+			}
+		}
+		for (int32 Column = 0; Column < 2 * NumPolynomialTerms; ++Column)
+		{
+			Swap(Normal[Pivot][Column], Normal[BestRow][Column]);
+		}
+
+		const double InvPivot = 1.0 / Normal[Pivot][Pivot];
+		for (int32 Column = 0; Column < 2 * NumPolynomialTerms; ++Column)
+		{
+			Normal[Pivot][Column] *= InvPivot;
+		}
+		for (int32 Row = 0; Row < NumPolynomialTerms; ++Row)
+		{
+			if (Row != Pivot)
+			{
+				const double Factor = Normal[Row][Pivot];
+				for (int32 Column = 0; Column < 2 * NumPolynomialTerms; ++Column)
+				{
+					Normal[Row][Column] -= Factor * Normal[Pivot][Column];
+				}
+			}
+		}
+	}
+
+	double Factorial = 1.0;
+	for (int32 Order = 1; Order <= 3; ++Order)
+	{
+		Factorial *= Order;
+		Weights[Order - 1].SetNumZeroed(WindowSize);
+		for (int32 i = 0; i < WindowSize; ++i)
+		{
+			double Weight = 0.0;
+			for (int32 Term = 0; Term < NumPolynomialTerms; ++Term)
+			{
+				Weight += Normal[Order][NumPolynomialTerms + Term] * FMath::Pow(static_cast<double>(i - EvalSlot), Term);
+			}
+			Weights[Order - 1][i] = Factorial * Weight;
+		}
+	}
+}
+
+bool FKinematicsEstimator::AddFrame(int32 InFrameIndex, float InTimeSeconds, TArrayView<const FVector> Positions)
+{
+	if (Positions.Num() != NumJoints)
+	{
+		return false;
+	}
+
+	if (NumHeld > 0)
+	{
+		const int32 Newest = (Head + NumHeld - 1) % WindowSize;
+		if (InFrameIndex != WindowFrames[Newest] + 1 || InTimeSeconds <= WindowTimes[Newest])
+		{
+			Reset();
+		}
+	}
+
+	int32 Slot;
+	if (NumHeld < WindowSize)
+	{
+		Slot = (Head + NumHeld) % WindowSize;
+		++NumHeld;
+	}
+	else
+	{
+		// Overwrite the oldest frame
+		Slot = Head;
+		Head = (Head + 1) % WindowSize;
+	}
+	FMemory::Memcpy(Window[Slot].GetData(), Positions.GetData(), NumJoints * sizeof(FVector));
+	WindowFrames[Slot] = InFrameIndex;
+	WindowTimes[Slot] = InTimeSeconds;
+
+	if (NumHeld < WindowSize)
+	{
+		return false;
+	}
+
+	// Frames are consecutive, so the mean spacing converts from per-frame to per-second units
+	const int32 Newest = (Head + WindowSize - 1) % WindowSize;
+	const double InvFrameTime = (WindowSize - 1) / static_cast<double>(WindowTimes[Newest] - WindowTimes[Head]);
+	Evaluate(Weights[0], InvFrameTime, Velocities);
+	Evaluate(Weights[1], InvFrameTime * InvFrameTime, Accelerations);
+	Evaluate(Weights[2], InvFrameTime * InvFrameTime * InvFrameTime, Jerks);
+
+	const int32 EvalIndex = (Head + EvalSlot) % WindowSize;
+	FrameIndex = WindowFrames[EvalIndex];
+	TimeSeconds = WindowTimes[EvalIndex];
+	return true;
+}
+
+void FKinematicsEstimator::Evaluate(const TArray<double>& InWeights, double Scale, TArray<FVector>& Out) const
+{
+	Out.SetNumUninitialized(NumJoints);
+	double* RESTRICT OutComponents = reinterpret_cast<double*>(Out.GetData());
+	const int32 NumComponents = NumJoints * 3;
+	FMemory::Memzero(OutComponents, NumComponents * sizeof(double));
+
+	// One multiply-add sweep over all joints' components per window frame, which the compiler vectorizes
+	for (int32 i = 0; i < WindowSize; ++i)
+	{
+		const double Weight = InWeights[i] * Scale;
+		const double* RESTRICT FrameComponents = Window[(Head + i) % WindowSize].GetData();
+		for (int32 Component = 0; Component < NumComponents; ++Component)
+		{
+			OutComponents[Component] += Weight * FrameComponents[Component];
+		}
+	}
+}
+
+double FKinematicsEstimator::GetMaxJerk(int32& OutJointIndex) const
+{
+	OutJointIndex = INDEX_NONE;
+	double MaxJerkSquared = 0.0;
+	for (int32 JointIndex = 0; JointIndex < Jerks.Num(); ++JointIndex)
+	{
+		const double JerkSquared = Jerks[JointIndex].SizeSquared();
+		if (JerkSquared > MaxJerkSquared)
+		{
+			MaxJerkSquared = JerkSquared;
+			OutJointIndex = JointIndex;
+		}
+	}
+	return FMath::Sqrt(MaxJerkSquared);
+}
+
+void FKinematicsEstimator::Reset()
+{
+	Head = 0;
+	NumHeld = 0;
+}
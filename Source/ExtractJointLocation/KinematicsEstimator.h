@@ -0,0 +1,79 @@
+// KinematicsEstimator.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "KinematicsEstimator.generated.h"
+
+// How joint derivatives are estimated from the positions of neighbouring frames
+UENUM(BlueprintType)
+enum class EKinematicsFilter : uint8
+{
+	// Derivatives of the cubic through the last four frames: no latency, but quantization noise is amplified
+	FiniteDifference,
+	// Derivatives of a cubic least-squares fit over a centred window: smooths noise, lags by the half window
+	SavitzkyGolay
+};
+
+/**
+ * Incrementally estimates joint velocity, acceleration and jerk over a sliding window of frames.
+ * Every derivative is a fixed weighted sum of the window's frames (a polynomial fit evaluated at one frame),
+ * computed once per frame for all joints at a time over contiguous component arrays.
+ */
+class EXTRACTJOINTLOCATION_API FKinematicsEstimator
+{
+public:
+	/**
+	 * @param Filter Finite differences or Savitzky-Golay.
+	 * @param NumJoints Number of positions passed to AddFrame.
+	 * @param HalfWindow Savitzky-Golay window is 2 * HalfWindow + 1 frames (at least 2); ignored for finite differences.
+	 */
+	FKinematicsEstimator(EKinematicsFilter Filter, int32 NumJoints, int32 HalfWindow);
+
+	/**
+	 * Adds the next frame; a gap in frame indices or a non-increasing time restarts the window.
+	 * @return True if derivatives are available, for frame GetFrameIndex() which lags GetLatency() frames behind.
+	 */
+	bool AddFrame(int32 FrameIndex, float TimeSeconds, TArrayView<const FVector> Positions);
+
+	void Reset();
+
+	/** Frame and time the current derivatives belong to. */
+	int32 GetFrameIndex() const { return FrameIndex; }
+	float GetTimeSeconds() const { return TimeSeconds; }
+
+	/** Derivatives per joint, in units per second, per second squared and per second cubed. */
+	TArrayView<const FVector> GetVelocities() const { return Velocities; }
+	TArrayView<const FVector> GetAccelerations() const { return Accelerations; }
+	TArrayView<const FVector> GetJerks() const { return Jerks; }
+
+	/** Largest jerk magnitude of the current frame, and the joint it belongs to. */
+	double GetMaxJerk(int32& OutJointIndex) const;
+
+	/** Frames between the newest frame added and the frame the derivatives are computed for. */
+	int32 GetLatency() const { return WindowSize - 1 - EvalSlot; }
+
+private:
+	// Weights of the window's frames (oldest first) for derivative orders 1 to 3, at unit frame spacing
+	void ComputeWeights();
+	void Evaluate(const TArray<double>& Weights, double Scale, TArray<FVector>& Out) const;
+
+	int32 NumJoints;
+	int32 WindowSize;
+	// Window slot (0 = oldest) the fit is evaluated at
+	int32 EvalSlot;
+	TArray<double> Weights[3];
+
+	// Ring of the last WindowSize frames, each NumJoints * 3 components
+	TArray<TArray<double>> Window;
+	TArray<int32> WindowFrames;
+	TArray<float> WindowTimes;
+	// Slot of the oldest frame and number of frames held
+	int32 Head = 0;
+	int32 NumHeld = 0;
+
+	int32 FrameIndex = 0;
+	float TimeSeconds = 0.0f;
+	TArray<FVector> Velocities;
+	TArray<FVector> Accelerations;
+	TArray<FVector> Jerks;
+};
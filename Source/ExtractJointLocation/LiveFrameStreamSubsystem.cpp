@@ -0,0 +1,230 @@
+#include "LiveFrameStreamSubsystem.h"
+#include "CameraRegistrySubsystem.h"
+#include "SubjectVisibilitySubsystem.h"
+#include "Engine/World.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogLiveFrameStream, Log, All);
+
+ULiveFrameStreamSubsystem::ULiveFrameStreamSubsystem()
+{
+	// 8 slots of up to 2048x2048 BGRA are ~130 MB of shared memory
+	bEnableLiveStream = false;
+	SegmentName = TEXT("ExtractJointLocationFrames");
+	SlotCount = 8;
+	MaxImageSize = FIntPoint(2048, 2048);
+	MaxKeypoints = 4096;
+	BackPressure = ELiveStreamBackPressure::Block;
+	BlockTimeout = 1.0f;
+}
+
+void ULiveFrameStreamSubsystem::Deinitialize()
+{
+	if (Ring.IsOpen())
+	{
+		UE_LOG(LogLiveFrameStream, Log, TEXT("Published %d frames to /%s, %llu dropped."), NumPublishedFrames, *SegmentName, Ring.GetDroppedFrames());
+	}
+	Ring.Close();
+	Super::Deinitialize();
+}
+
+void ULiveFrameStreamSubsystem::SubmitSubjectKeypoints(const UObject* Owner, const FString& SubjectName, int32 FrameIndex, TArrayView<const FName> JointNames, TArrayView<const FVector> Positions)
+{
+	if (!Owner || JointNames.Num() != Positions.Num())
+	{
+		return;
+	}
+
+	FSubject* Subject = Subjects.FindByPredicate([Owner](const FSubject& Candidate) { return Candidate.Owner.Get() == Owner; });
+	const bool bJointsChanged = !Subject || Subject->JointNames != JointNames;
+	if (!Subject)
+	{
+		Subject = &Subjects.AddDefaulted_GetRef();
+		Subject->Owner = Owner;
+	}
+	Subject->Name = SubjectName;
+	if (bJointsChanged)
+	{
+		Subject->JointNames = TArray<FName>(JointNames);
+	}
+	Subject->Positions.Reset();
+	Subject->Positions.Append(Positions.GetData(), Positions.Num());
+	Subject->FrameIndex = FrameIndex;
+
+	if (bJointsChanged && bEnableLiveStream)
+	{
+		WriteSubjectsFile();
+	}
+}
+
+void ULiveFrameStreamSubsystem::RemoveSubject(const UObject* Owner)
+{
+	Subjects.RemoveAll([Owner](const FSubject& Subject) { return Subject.Owner.Get() == Owner || !Subject.Owner.IsValid(); });
+}
+
+bool ULiveFrameStreamSubsystem::OpenRing()
+{
+	if (Ring.IsOpen() || bOpenFailed)
+	{
+		return Ring.IsOpen();
+	}
+
+	const uint64 PayloadBytes = static_cast<uint64>(MaxImageSize.X) * MaxImageSize.Y * sizeof(FColor)
+		+ FMath::Max(Subjects.Num(), 16) * sizeof(SharedFrameRing::FSubjectEntry)
+		+ static_cast<uint64>(MaxKeypoints) * sizeof(SharedFrameRing::FKeypoint) + 2 * SharedFrameRing::Alignment;
+	const SharedFrameRing::EBackPressure RingBackPressure = BackPressure == ELiveStreamBackPressure::Block ? SharedFrameRing::EBackPressure::Block : SharedFrameRing::EBackPressure::Drop;
+
+	// Failing once (e.g. no /dev/shm) disables the stream instead of retrying every frame
+	bOpenFailed = !Ring.Open(SegmentName, static_cast<uint32>(FMath::Max(SlotCount, 2)), PayloadBytes, RingBackPressure);
+	if (!bOpenFailed)
+	{
+		WriteSubjectsFile();
+	}
+	return !bOpenFailed;
+}
+
+bool ULiveFrameStreamSubsystem::PublishCameraFrame(const FRegisteredCamera& Camera, const FColor* Pixels, int32 Width, int32 Height)
+{
+	using namespace SharedFrameRing;
+	if (!bEnableLiveStream || !Pixels || !OpenRing())
+	{
+		return false;
+	}
+	if (Width > MaxImageSize.X || Height > MaxImageSize.Y)
+	{
+		UE_LOG(LogLiveFrameStream, Warning, TEXT("PublishCameraFrame: %dx%d frame of %s exceeds MaxImageSize %dx%d, dropped."), Width, Height, *Camera.Name, MaxImageSize.X, MaxImageSize.Y);
+		return false;
+	}
+
+	FSlotHeader* Slot = Ring.BeginFrame(BlockTimeout);
+	if (!Slot)
+	{
+		return false;
+	}
+
+	// Subjects culled for this camera by USubjectVisibilitySubsystem are left out of its slot
+	USubjectVisibilitySubsystem* SubjectVisibility = GetWorld() ? GetWorld()->GetSubsystem<USubjectVisibilitySubsystem>() : nullptr;
+	const int32 VisibilityCamera = SubjectVisibility ? SubjectVisibility->GetVisibility().FindCamera(Camera.Component.Get()) : INDEX_NONE;
+	TArray<const FSubject*, TInlineAllocator<16>> VisibleSubjects;
+	for (const FSubject& Subject : Subjects)
+	{
+		if (!SubjectVisibility || SubjectVisibility->GetVisibility().IsVisible(VisibilityCamera, Subject.Name))
+		{
+			VisibleSubjects.Add(&Subject);
+		}
+	}
+
+	// Pixels first, then as many whole subjects as fit
+	const uint64 ImageBytes = static_cast<uint64>(Width) * Height * sizeof(FColor);
+	const uint64 SubjectsOffset = AlignUp(sizeof(FSlotHeader) + ImageBytes, Alignment);
+	const uint64 PayloadEnd = sizeof(FSlotHeader) + Ring.GetSlotPayloadBytes();
+	int32 NumSubjects = 0;
+	int32 NumKeypoints = 0;
+	for (const FSubject* Subject : VisibleSubjects)
+	{
+		const uint64 KeypointsEnd = AlignUp(SubjectsOffset + (NumSubjects + 1) * sizeof(FSubjectEntry), Alignment) + (NumKeypoints + Subject->Positions.Num()) * sizeof(FKeypoint);
+		if (KeypointsEnd > PayloadEnd || NumKeypoints + Subject->Positions.Num() > MaxKeypoints)
+		{
+			break;
+		}
+		++NumSubjects;
+		NumKeypoints += Subject->Positions.Num();
+	}
+	const uint64 KeypointsOffset = AlignUp(SubjectsOffset + NumSubjects * sizeof(FSubjectEntry), Alignment);
+
+	uint8* SlotBase = reinterpret_cast<uint8*>(Slot);
+	FMemory::Memcpy(SlotBase + sizeof(FSlotHeader), Pixels, ImageBytes);
+
+	FSubjectEntry* SubjectEntries = reinterpret_cast<FSubjectEntry*>(SlotBase + SubjectsOffset);
+	FKeypoint* Keypoints = reinterpret_cast<FKeypoint*>(SlotBase + KeypointsOffset);
+	const FCameraIntrinsics& Intrinsics = Camera.Intrinsics;
+	int32 FrameIndex = INDEX_NONE;
+	int32 KeypointIndex = 0;
+	for (int32 SubjectIndex = 0; SubjectIndex < NumSubjects; ++SubjectIndex)
+	{
+		const FSubject& Subject = *VisibleSubjects[SubjectIndex];
+		FSubjectEntry& Entry = SubjectEntries[SubjectIndex];
+		FCStringAnsi::Strncpy(Entry.Name, TCHAR_TO_UTF8(*Subject.Name), NameLength);
+		Entry.FirstKeypoint = KeypointIndex;
+		Entry.NumKeypoints = Subject.Positions.Num();
+		FrameIndex = FMath::Max(FrameIndex, Subject.FrameIndex);
+
+		// Pinhole projection in the camera's frame (X forward, Y right, Z up), as in the exported calibration
+		for (const FVector& Position : Subject.Positions)
+		{
+			const FVector Local = Camera.Extrinsics.InverseTransformPositionNoScale(Position);
+			FKeypoint& Keypoint = Keypoints[KeypointIndex++];
+			Keypoint.X = static_cast<float>(Position.X);
+			Keypoint.Y = static_cast<float>(Position.Y);
+			Keypoint.Z = static_cast<float>(Position.Z);
+			Keypoint.Flags = 0;
+			Keypoint.U = -1.0f;
+			Keypoint.V = -1.0f;
+			if (Local.X > UE_KINDA_SMALL_NUMBER)
+			{
+				Keypoint.U = static_cast<float>(Intrinsics.PrincipalPointX + Intrinsics.FocalLengthX * Local.Y / Local.X);
+				Keypoint.V = static_cast<float>(Intrinsics.PrincipalPointY - Intrinsics.FocalLengthY * Local.Z / Local.X);
+				Keypoint.Flags |= KeypointInFront;
+				if (Keypoint.U >= 0.0f && Keypoint.U < Width && Keypoint.V >= 0.0f && Keypoint.V < Height)
+				{
+					Keypoint.Flags |= KeypointInImage;
+				}
+			}
+		}
+	}
+
+	FCStringAnsi::Strncpy(Slot->CameraName, TCHAR_TO_UTF8(*Camera.Name), NameLength);
+	Slot->FrameIndex = FrameIndex;
+	Slot->TimeSeconds = GetWorld() ? GetWorld()->GetTimeSeconds() : 0.0f;
+	Slot->Width = Width;
+	Slot->Height = Height;
+	Slot->RowPitch = Width * sizeof(FColor);
+	Slot->PixelFormat = static_cast<uint32_t>(EPixelFormat::BGRA8);
+	Slot->FocalLengthX = Intrinsics.FocalLengthX;
+	Slot->FocalLengthY = Intrinsics.FocalLengthY;
+	Slot->PrincipalPointX = Intrinsics.PrincipalPointX;
+	Slot->PrincipalPointY = Intrinsics.PrincipalPointY;
+	Slot->NumSubjects = NumSubjects;
+	Slot->NumKeypoints = NumKeypoints;
+	Slot->ImageOffset = sizeof(FSlotHeader);
+	Slot->SubjectsOffset = SubjectsOffset;
+	Slot->KeypointsOffset = KeypointsOffset;
+	Ring.EndFrame();
+
+	++NumPublishedFrames;
+	return true;
+}
+
+void ULiveFrameStreamSubsystem::WriteSubjectsFile() const
+{
+	TArray<TSharedPtr<FJsonValue>> SubjectValues;
+	for (const FSubject& Subject : Subjects)
+	{
+		TArray<TSharedPtr<FJsonValue>> JointValues;
+		for (const FName& JointName : Subject.JointNames)
+		{
+			JointValues.Add(MakeShareable(new FJsonValueString(JointName.ToString())));
+		}
+		TSharedPtr<FJsonObject> SubjectObject = MakeShareable(new FJsonObject());
+		SubjectObject->SetStringField(TEXT("Name"), Subject.Name);
+		SubjectObject->SetArrayField(TEXT("Joints"), JointValues);
+		SubjectValues.Add(MakeShareable(new FJsonValueObject(SubjectObject)));
+	}
+
+	TSharedPtr<FJsonObject> RootObject = MakeShareable(new FJsonObject());
+	RootObject->SetStringField(TEXT("Segment"), TEXT("/") + SegmentName);
+	RootObject->SetArrayField(TEXT("Subjects"), SubjectValues);
+
+	FString OutputString;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&OutputString);
+	FJsonSerializer::Serialize(RootObject.ToSharedRef(), Writer);
+	const FString FilePath = FPaths::ProjectSavedDir() + TEXT("LiveStream/") + SegmentName + TEXT("_Subjects.json");
+	if (!FFileHelper::SaveStringToFile(OutputString, *FilePath))
+	{
+		UE_LOG(LogLiveFrameStream, Warning, TEXT("WriteSubjectsFile: Failed to write %s"), *FilePath);
+	}
+}
@@ -0,0 +1,99 @@
+// LiveFrameStreamSubsystem.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SharedFrameRing.h"
+#include "LiveFrameStreamSubsystem.generated.h"
+
+struct FRegisteredCamera;
+
+UENUM(BlueprintType)
+enum class ELiveStreamBackPressure : uint8
+{
+	// Capture waits (up to BlockTimeout) for the consumer, so no frame is lost while one is attached
+	Block,
+	// Frames that find the ring full are dropped, capture never waits
+	Drop
+};
+
+/**
+ * Publishes every captured camera frame with its ground-truth keypoints to a local consumer through a shared-memory
+ * ring (FSharedFrameRingWriter), as soon as the frame has been read back, so e.g. pose inference runs alongside
+ * the capture instead of after it. Consumers link Tools/SharedFrameConsumer.
+ * Subjects (see USkeletalExtractor::bPublishLiveKeypoints) submit their Body keypoints every streamed frame; each
+ * frame carries the keypoints of all subjects the USubjectVisibilitySubsystem did not cull for the frame's camera,
+ * projected with that camera. The subjects' joint names are written to Saved/LiveStream/<SegmentName>_Subjects.json
+ * whenever a subject is added.
+ */
+UCLASS(config = Game)
+class EXTRACTJOINTLOCATION_API ULiveFrameStreamSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	ULiveFrameStreamSubsystem();
+
+	virtual void Deinitialize() override;
+
+	/** True if frames are published, i.e. callers should read back pixels for PublishCameraFrame. */
+	bool IsEnabled() const { return bEnableLiveStream; }
+
+	/** Updates a subject's keypoints for the frames published next, adding the subject on first use. */
+	void SubmitSubjectKeypoints(const UObject* Owner, const FString& SubjectName, int32 FrameIndex, TArrayView<const FName> JointNames, TArrayView<const FVector> Positions);
+
+	/** Removes a subject from the published frames. */
+	void RemoveSubject(const UObject* Owner);
+
+	/**
+	 * Publishes one camera frame with the current keypoints of all subjects, opening the ring on first use.
+	 * @param Pixels Width x Height BGRA pixels, tightly packed.
+	 * @return False if the stream is disabled or the frame was dropped.
+	 */
+	bool PublishCameraFrame(const FRegisteredCamera& Camera, const FColor* Pixels, int32 Width, int32 Height);
+
+	/** Publishes frames to the shared-memory ring. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Live Stream")
+	bool bEnableLiveStream;
+
+	/** Name of the POSIX shared memory object (/<SegmentName>). */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Live Stream")
+	FString SegmentName;
+
+	/** Frames the consumer may lag behind before back-pressure applies. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Live Stream", meta = (ClampMin = "2"))
+	int32 SlotCount;
+
+	/** Largest image (pixels) a slot holds; larger frames are dropped. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Live Stream")
+	FIntPoint MaxImageSize;
+
+	/** Keypoints of all subjects a slot holds; further subjects are left out. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Live Stream")
+	int32 MaxKeypoints;
+
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Live Stream")
+	ELiveStreamBackPressure BackPressure;
+
+	/** Longest wait (s) for the consumer per frame with ELiveStreamBackPressure::Block, the frame is dropped after it. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Live Stream")
+	float BlockTimeout;
+
+private:
+	struct FSubject
+	{
+		TWeakObjectPtr<const UObject> Owner;
+		FString Name;
+		TArray<FName> JointNames;
+		TArray<FVector> Positions;
+		int32 FrameIndex = INDEX_NONE;
+	};
+
+	bool OpenRing();
+	void WriteSubjectsFile() const;
+
+	TArray<FSubject> Subjects;
+	FSharedFrameRingWriter Ring;
+	bool bOpenFailed = false;
+	int32 NumPublishedFrames = 0;
+};
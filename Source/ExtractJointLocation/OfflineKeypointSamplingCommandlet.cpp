@@ -0,0 +1,342 @@
+#include "OfflineKeypointSamplingCommandlet.h"
+#include "SkeletalExtractor.h"
+#include "Animation/AnimSequence.h"
+#include "Animation/AnimationPoseData.h"
+#include "Animation/AttributesRuntime.h"
+#include "Animation/Skeleton.h"
+#include "AnimationRuntime.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Async/ParallelFor.h"
+#include "BonePose.h"
+#include "Engine/SkeletalMesh.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogOfflineKeypointSampling, Log, All);
+
+UOfflineKeypointSamplingCommandlet::UOfflineKeypointSamplingCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UOfflineKeypointSamplingCommandlet::Main(const FString& Params)
+{
+	TArray<FString> Tokens;
+	TArray<FString> Switches;
+	TMap<FString, FString> ParamsMap;
+	ParseCommandLine(*Params, Tokens, Switches, ParamsMap);
+
+	if (const FString* Value = ParamsMap.Find(TEXT("FPS")))
+	{
+		SampleRate = FCString::Atof(**Value);
+	}
+	if (const FString* Value = ParamsMap.Find(TEXT("Encoding")))
+	{
+		const int64 EncodingValue = StaticEnum<EKeypointStreamEncoding>()->GetValueByNameString(*Value);
+		if (EncodingValue == INDEX_NONE)
+		{
+			UE_LOG(LogOfflineKeypointSampling, Error, TEXT("Unknown encoding '%s'."), **Value);
+			return 1;
+		}
+		Encoding = static_cast<EKeypointStreamEncoding>(EncodingValue);
+	}
+	if (const FString* Value = ParamsMap.Find(TEXT("MaxError")))
+	{
+		MaxError = FMath::Max(FCString::Atof(**Value), 0.0001f);
+	}
+	if (const FString* Value = ParamsMap.Find(TEXT("KeyframeInterval")))
+	{
+		KeyframeInterval = FMath::Max(FCString::Atoi(**Value), 1);
+	}
+	bRequiredBonesOnly = !Switches.Contains(TEXT("FullPose"));
+	const FString* OutputParam = ParamsMap.Find(TEXT("Output"));
+	OutputDirectory = OutputParam ? *OutputParam : FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("KeypointStreams"), TEXT("Offline"));
+
+	// Same keypoint sets as the in-level extractor: Body = upper + lower body, Face = face keypoints
+	const USkeletalExtractor* ExtractorDefaults = GetDefault<USkeletalExtractor>();
+	TArray<FName> BodyKeypoints = ExtractorDefaults->GetUpperBodyKeypointsToExtract();
+	BodyKeypoints.Append(ExtractorDefaults->GetLowerBodyKeypointsToExtract());
+
+	// Loading happens here on the game thread, only pose evaluation runs in parallel
+	TArray<FSamplingJob> Jobs;
+	if (ParamsMap.Contains(TEXT("BodyMesh")))
+	{
+		AddJobs(ParamsMap[TEXT("BodyMesh")], ParamsMap.FindRef(TEXT("BodyAnims")), TEXT("Body"), BodyKeypoints, Jobs);
+	}
+	if (ParamsMap.Contains(TEXT("FaceMesh")))
+	{
+		AddJobs(ParamsMap[TEXT("FaceMesh")], ParamsMap.FindRef(TEXT("FaceAnims")), TEXT("Face"), ExtractorDefaults->GetFaceKeypointsToExtract(), Jobs);
+	}
+
+	if (Jobs.Num() == 0)
+	{
+		UE_LOG(LogOfflineKeypointSampling, Error, TEXT("Nothing to sample. Usage: -run=OfflineKeypointSampling -BodyMesh=<mesh> -BodyAnims=<folders or assets> [-FaceMesh=<mesh> -FaceAnims=<folders or assets>] [-FPS=30] [-Encoding=QuantizedDelta] [-MaxError=0.01] [-KeyframeInterval=120] [-Output=<dir>] [-FullPose] [-Benchmark]"));
+		return 1;
+	}
+
+	if (Switches.Contains(TEXT("Benchmark")))
+	{
+		RunBenchmark(Jobs);
+		return 0;
+	}
+
+	// One animation per task; animations differ a lot in length, so let the scheduler balance them
+	const double StartTime = FPlatformTime::Seconds();
+	ParallelFor(Jobs.Num(), [this, &Jobs](int32 JobIndex)
+	{
+		Jobs[JobIndex].bSucceeded = SampleAnimation(Jobs[JobIndex]);
+	}, EParallelForFlags::Unbalanced);
+	const double ElapsedSeconds = FMath::Max(FPlatformTime::Seconds() - StartTime, UE_SMALL_NUMBER);
+
+	int32 NumFailed = 0;
+	int64 TotalFrames = 0;
+	for (const FSamplingJob& Job : Jobs)
+	{
+		NumFailed += Job.bSucceeded ? 0 : 1;
+		TotalFrames += Job.NumFrames;
+	}
+
+	UE_LOG(LogOfflineKeypointSampling, Display, TEXT("Sampled %d animations (%lld frames) in %.2f s on %d worker threads: %.0f frames/s. %d failed."),
+		Jobs.Num() - NumFailed, TotalFrames, ElapsedSeconds, FTaskGraphInterface::Get().GetNumWorkerThreads(), TotalFrames / ElapsedSeconds, NumFailed);
+	return NumFailed == 0 ? 0 : 1;
+}
+
+void UOfflineKeypointSamplingCommandlet::AddJobs(const FString& MeshPath, const FString& AnimList, const FString& MeshType, const TArray<FName>& Keypoints, TArray<FSamplingJob>& OutJobs) const
+{
+	USkeletalMesh* SkeletalMesh = LoadObject<USkeletalMesh>(nullptr, *MeshPath);
+	if (!SkeletalMesh || !SkeletalMesh->GetSkeleton())
+	{
+		UE_LOG(LogOfflineKeypointSampling, Error, TEXT("Could not load %s skeletal mesh '%s'."), *MeshType, *MeshPath);
+		return;
+	}
+
+	// Keypoints missing on this skeleton are dropped so every frame has the same joint layout
+	TArray<FName> MeshKeypoints;
+	for (const FName& KeypointName : Keypoints)
+	{
+		if (SkeletalMesh->GetRefSkeleton().FindBoneIndex(KeypointName) == INDEX_NONE)
+		{
+			UE_LOG(LogOfflineKeypointSampling, Warning, TEXT("Bone '%s' not found on %s, it will not be sampled."), *KeypointName.ToString(), *SkeletalMesh->GetName());
+			continue;
+		}
+		MeshKeypoints.Add(KeypointName);
+	}
+	if (MeshKeypoints.Num() == 0)
+	{
+		UE_LOG(LogOfflineKeypointSampling, Error, TEXT("No keypoints of the %s set found on %s."), *MeshType, *SkeletalMesh->GetName());
+		return;
+	}
+
+	const TArray<FBoneIndexType> RequiredBones = USkeletalExtractor::ComputeRequiredBones(SkeletalMesh->GetRefSkeleton(), MeshKeypoints);
+	UE_LOG(LogOfflineKeypointSampling, Display, TEXT("%s: %d keypoints need %d of %d bones."), *MeshType, MeshKeypoints.Num(), RequiredBones.Num(), SkeletalMesh->GetRefSkeleton().GetNum());
+
+	int32 NumAdded = 0;
+	for (UAnimSequence* Animation : LoadAnimations(AnimList))
+	{
+		if (Animation->GetSkeleton() != SkeletalMesh->GetSkeleton())
+		{
+			UE_LOG(LogOfflineKeypointSampling, Warning, TEXT("Skipping %s: its skeleton does not match %s."), *Animation->GetPathName(), *SkeletalMesh->GetPathName());
+			continue;
+		}
+
+#if WITH_EDITOR
+		// Compressed data is built asynchronously in the editor; it must be ready before worker threads sample it
+		Animation->WaitOnExistingCompression();
+#endif
+
+		FSamplingJob& Job = OutJobs.AddDefaulted_GetRef();
+		Job.SkeletalMesh = SkeletalMesh;
+		Job.Animation = Animation;
+		Job.MeshType = MeshType;
+		Job.Keypoints = MeshKeypoints;
+		++NumAdded;
+	}
+
+	UE_LOG(LogOfflineKeypointSampling, Display, TEXT("%s: %d animations to sample on %s."), *MeshType, NumAdded, *SkeletalMesh->GetName());
+}
+
+TArray<UAnimSequence*> UOfflineKeypointSamplingCommandlet::LoadAnimations(const FString& AnimList)
+{
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+
+	TArray<FString> Entries;
+	AnimList.ParseIntoArray(Entries, TEXT(","));
+
+	TArray<UAnimSequence*> Animations;
+	for (const FString& Entry : Entries)
+	{
+		// A folder: every animation sequence below it
+		AssetRegistry.ScanPathsSynchronous({ Entry }, true);
+		FARFilter Filter;
+		Filter.PackagePaths.Add(FName(*Entry));
+		Filter.ClassPaths.Add(UAnimSequence::StaticClass()->GetClassPathName());
+		Filter.bRecursivePaths = true;
+		Filter.bRecursiveClasses = true;
+
+		TArray<FAssetData> Assets;
+		AssetRegistry.GetAssets(Filter, Assets);
+		for (const FAssetData& Asset : Assets)
+		{
+			if (UAnimSequence* Animation = Cast<UAnimSequence>(Asset.GetAsset()))
+			{
+				Animations.AddUnique(Animation);
+			}
+		}
+
+		// Otherwise a single animation asset
+		if (Assets.Num() == 0)
+		{
+			if (UAnimSequence* Animation = LoadObject<UAnimSequence>(nullptr, *Entry))
+			{
+				Animations.AddUnique(Animation);
+			}
+			else
+			{
+				UE_LOG(LogOfflineKeypointSampling, Warning, TEXT("'%s' is neither a folder with animations nor an animation sequence."), *Entry);
+			}
+		}
+	}
+	return Animations;
+}
+
+bool UOfflineKeypointSamplingCommandlet::SampleAnimation(FSamplingJob& Job) const
+{
+	// Animations in different folders may share a name; the package path hash keeps their streams apart across runs
+	const uint32 PackageHash = FCrc::StrCrc32(*Job.Animation->GetPathName());
+	const FString FilePath = FPaths::Combine(OutputDirectory, FString::Printf(TEXT("%s_%08x_%s.kps"), *Job.Animation->GetName(), PackageHash, *Job.MeshType));
+	FKeypointStreamWriter Writer(Encoding, Job.Keypoints, MaxError, KeyframeInterval);
+	if (!Writer.Open(FilePath))
+	{
+		return false;
+	}
+
+	const bool bWritten = EvaluateAnimation(Job, bRequiredBonesOnly, [&Writer](int32 FrameIndex, double Time, TArrayView<const FVector> Positions)
+	{
+		return Writer.WriteFrame(FrameIndex, static_cast<float>(Time), Positions);
+	});
+
+	Writer.Close();
+	Job.NumFrames = bWritten ? GetNumFrames(Job.Animation) : 0;
+	return bWritten;
+}
+
+bool UOfflineKeypointSamplingCommandlet::EvaluateAnimation(const FSamplingJob& Job, bool bUseRequiredBones, TFunctionRef<bool(int32 FrameIndex, double Time, TArrayView<const FVector> Positions)> OnFrame) const
+{
+	const FReferenceSkeleton& RefSkeleton = Job.SkeletalMesh->GetRefSkeleton();
+
+	// The bone container maps the animation's tracks onto the evaluated bones; tracks of other bones are not decompressed
+	TArray<FBoneIndexType> RequiredBones;
+	if (bUseRequiredBones)
+	{
+		RequiredBones = USkeletalExtractor::ComputeRequiredBones(RefSkeleton, Job.Keypoints);
+	}
+	else
+	{
+		RequiredBones.SetNumUninitialized(RefSkeleton.GetNum());
+		for (int32 BoneIndex = 0; BoneIndex < RefSkeleton.GetNum(); ++BoneIndex)
+		{
+			RequiredBones[BoneIndex] = static_cast<FBoneIndexType>(BoneIndex);
+		}
+	}
+	FBoneContainer BoneContainer(RequiredBones, UE::Anim::FCurveFilterSettings(UE::Anim::ECurveFilterMode::DisallowAll), *Job.SkeletalMesh);
+
+	TArray<FCompactPoseBoneIndex> KeypointPoseIndices;
+	for (const FName& KeypointName : Job.Keypoints)
+	{
+		KeypointPoseIndices.Add(BoneContainer.MakeCompactPoseIndex(FMeshPoseBoneIndex(RefSkeleton.FindBoneIndex(KeypointName))));
+	}
+
+	const double FrameRate = SampleRate > 0.0f ? SampleRate : Job.Animation->GetSamplingFrameRate().AsDecimal();
+	const double PlayLength = Job.Animation->GetPlayLength();
+	const int32 NumFrames = GetNumFrames(Job.Animation);
+
+	TArray<FVector> Positions;
+	Positions.SetNumUninitialized(KeypointPoseIndices.Num());
+	for (int32 FrameIndex = 0; FrameIndex < NumFrames; ++FrameIndex)
+	{
+		// Pose data lives on this thread's animation memory stack and is released every frame
+		FMemMark Mark(FMemStack::Get());
+
+		FCompactPose Pose;
+		Pose.SetBoneContainer(&BoneContainer);
+		FBlendedCurve Curve;
+		Curve.InitFrom(BoneContainer);
+		UE::Anim::FStackAttributeContainer Attributes;
+		FAnimationPoseData PoseData(Pose, Curve, Attributes);
+
+		const double Time = FMath::Min(FrameIndex / FrameRate, PlayLength);
+		Job.Animation->GetAnimationPose(PoseData, FAnimExtractContext(Time));
+
+		FCSPose<FCompactPose> ComponentSpacePose;
+		ComponentSpacePose.InitPose(Pose);
+		for (int32 i = 0; i < KeypointPoseIndices.Num(); ++i)
+		{
+			Positions[i] = ComponentSpacePose.GetComponentSpaceTransform(KeypointPoseIndices[i]).GetLocation();
+		}
+
+		if (!OnFrame(FrameIndex, Time, Positions))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+int32 UOfflineKeypointSamplingCommandlet::GetNumFrames(const UAnimSequence* Animation) const
+{
+	const double FrameRate = SampleRate > 0.0f ? SampleRate : Animation->GetSamplingFrameRate().AsDecimal();
+	return FMath::FloorToInt32(Animation->GetPlayLength() * FrameRate + UE_KINDA_SMALL_NUMBER) + 1;
+}
+
+void UOfflineKeypointSamplingCommandlet::RunBenchmark(const TArray<FSamplingJob>& Jobs) const
+{
+	// Single-threaded so the numbers are per-subject costs, not a measure of the machine's core count
+	double TotalFullSeconds = 0.0;
+	double TotalReducedSeconds = 0.0;
+	int64 TotalFrames = 0;
+
+	for (const FSamplingJob& Job : Jobs)
+	{
+		TArray<FVector> FullPositions;
+		double StartTime = FPlatformTime::Seconds();
+		EvaluateAnimation(Job, false, [&FullPositions](int32 FrameIndex, double Time, TArrayView<const FVector> Positions)
+		{
+			FullPositions.Append(Positions.GetData(), Positions.Num());
+			return true;
+		});
+		const double FullSeconds = FPlatformTime::Seconds() - StartTime;
+
+		// Compare against the full pose while evaluating; the reduction must not change any keypoint
+		double MaxDeviation = 0.0;
+		int32 PositionIndex = 0;
+		StartTime = FPlatformTime::Seconds();
+		EvaluateAnimation(Job, true, [&FullPositions, &PositionIndex, &MaxDeviation](int32 FrameIndex, double Time, TArrayView<const FVector> Positions)
+		{
+			for (const FVector& Position : Positions)
+			{
+				MaxDeviation = FMath::Max(MaxDeviation, FVector::Distance(Position, FullPositions[PositionIndex++]));
+			}
+			return true;
+		});
+		const double ReducedSeconds = FPlatformTime::Seconds() - StartTime;
+
+		const int32 NumFrames = GetNumFrames(Job.Animation);
+		const int32 NumRequiredBones = USkeletalExtractor::ComputeRequiredBones(Job.SkeletalMesh->GetRefSkeleton(), Job.Keypoints).Num();
+		UE_LOG(LogOfflineKeypointSampling, Display, TEXT("%s (%s, %d frames): full %d bones %.2f us/frame, required %d bones %.2f us/frame, %.2fx faster, max keypoint deviation %.6f cm"),
+			*Job.Animation->GetName(), *Job.MeshType, NumFrames,
+			Job.SkeletalMesh->GetRefSkeleton().GetNum(), FullSeconds * 1e6 / NumFrames,
+			NumRequiredBones, ReducedSeconds * 1e6 / NumFrames,
+			FullSeconds / FMath::Max(ReducedSeconds, UE_SMALL_NUMBER), MaxDeviation);
+
+		TotalFullSeconds += FullSeconds;
+		TotalReducedSeconds += ReducedSeconds;
+		TotalFrames += NumFrames;
+	}
+
+	UE_LOG(LogOfflineKeypointSampling, Display, TEXT("Benchmark: %d animations, %lld frames. Full pose %.2f us/frame, required bones %.2f us/frame (%.2fx)."),
+		Jobs.Num(), TotalFrames, TotalFullSeconds * 1e6 / FMath::Max<int64>(TotalFrames, 1), TotalReducedSeconds * 1e6 / FMath::Max<int64>(TotalFrames, 1),
+		TotalFullSeconds / FMath::Max(TotalReducedSeconds, UE_SMALL_NUMBER));
+}
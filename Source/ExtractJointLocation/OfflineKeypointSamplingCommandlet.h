@@ -0,0 +1,78 @@
+// OfflineKeypointSamplingCommandlet.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "KeypointStream.h"
+#include "OfflineKeypointSamplingCommandlet.generated.h"
+
+class USkeletalMesh;
+class UAnimSequence;
+
+/**
+ * Samples keypoints straight from UAnimSequence assets, without a world or actors.
+ * Every animation is one task on the task graph: its pose is evaluated for every frame and the
+ * USkeletalExtractor keypoint sets are written with FKeypointStreamWriter to
+ * <Output>/<Animation>_<PathHash>_<MeshType>.kps (default Saved/KeypointStreams/Offline), where PathHash is the CRC32 of
+ * the animation's object path so equally named animations of different folders do not overwrite each other.
+ * Positions are in component space.
+ *
+ * UnrealEditor-Cmd Project.uproject -run=OfflineKeypointSampling
+ *   -BodyMesh=/Game/MetaHumans/Common/Male/Medium/NormalWeight/Body/m_med_nrw_body -BodyAnims=/Game/Mocap/Body
+ *   [-FaceMesh=<mesh> -FaceAnims=<paths>] [-FPS=30] [-Encoding=RawFloat|QuantizedDelta] [-MaxError=0.01]
+ *   [-KeyframeInterval=120] [-Output=<dir>] [-FullPose] [-Benchmark]
+ * Animation lists are comma separated content folders (searched recursively) or animation asset paths.
+ * -FPS defaults to each animation's own sampling rate.
+ * Only the keypoints and their ancestors are evaluated (see USkeletalExtractor::ComputeRequiredBones);
+ * -FullPose evaluates every bone of the mesh instead. -Benchmark writes nothing and instead times every
+ * animation with the full and the reduced bone set, and checks both give the same keypoints.
+ */
+UCLASS()
+class EXTRACTJOINTLOCATION_API UOfflineKeypointSamplingCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UOfflineKeypointSamplingCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	// One animation to sample on one mesh
+	struct FSamplingJob
+	{
+		USkeletalMesh* SkeletalMesh = nullptr;
+		UAnimSequence* Animation = nullptr;
+		FString MeshType;
+		// Keypoints present on the mesh's skeleton
+		TArray<FName> Keypoints;
+		// Result, filled by the task
+		int32 NumFrames = 0;
+		bool bSucceeded = false;
+	};
+
+	// Adds a job for every animation of AnimList that plays on SkeletalMesh's skeleton
+	void AddJobs(const FString& MeshPath, const FString& AnimList, const FString& MeshType, const TArray<FName>& Keypoints, TArray<FSamplingJob>& OutJobs) const;
+	static TArray<UAnimSequence*> LoadAnimations(const FString& AnimList);
+
+	// Evaluates every frame of the job's animation and writes its keypoint stream; safe to run on any thread
+	bool SampleAnimation(FSamplingJob& Job) const;
+
+	/**
+	 * Evaluates every frame of the job's animation and passes the keypoint positions to OnFrame.
+	 * @param bUseRequiredBones Evaluate only the keypoints and their ancestors instead of the full skeleton.
+	 * @return False if OnFrame returned false.
+	 */
+	bool EvaluateAnimation(const FSamplingJob& Job, bool bUseRequiredBones, TFunctionRef<bool(int32 FrameIndex, double Time, TArrayView<const FVector> Positions)> OnFrame) const;
+	int32 GetNumFrames(const UAnimSequence* Animation) const;
+
+	// Times full and reduced pose evaluation of every job on the calling thread and logs the comparison
+	void RunBenchmark(const TArray<FSamplingJob>& Jobs) const;
+
+	float SampleRate = 0.0f;
+	EKeypointStreamEncoding Encoding = EKeypointStreamEncoding::QuantizedDelta;
+	float MaxError = 0.01f;
+	int32 KeyframeInterval = 120;
+	bool bRequiredBonesOnly = true;
+	FString OutputDirectory;
+};
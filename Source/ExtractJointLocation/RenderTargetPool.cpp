@@ -0,0 +1,119 @@
+#include "RenderTargetPool.h"
+
+// Logging
+#include "Logging/LogMacros.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogRenderTargetPool, Log, All);
+
+UTextureRenderTarget2D* URenderTargetPool::Acquire(int32 SizeX, int32 SizeY, ETextureRenderTargetFormat Format)
+{
+	if (SizeX <= 0 || SizeY <= 0)
+	{
+		UE_LOG(LogRenderTargetPool, Error, TEXT("Acquire: Invalid render target size %dx%d."), SizeX, SizeY);
+		return nullptr;
+	}
+
+	// Search from the back so the most recently released (and most likely still resident) target is reused first
+	for (int32 i = FreeTargets.Num() - 1; i >= 0; --i)
+	{
+		UTextureRenderTarget2D* Candidate = FreeTargets[i];
+		if (Candidate && Candidate->SizeX == SizeX && Candidate->SizeY == SizeY && Candidate->RenderTargetFormat == Format)
+		{
+			FreeTargets.RemoveAtSwap(i);
+			InUseTargets.Add(Candidate);
+			return Candidate;
+		}
+	}
+
+	UTextureRenderTarget2D* NewTarget = CreateRenderTarget(SizeX, SizeY, Format);
+	if (NewTarget)
+	{
+		InUseTargets.Add(NewTarget);
+	}
+	return NewTarget;
+}
+
+void URenderTargetPool::Release(UTextureRenderTarget2D* RenderTarget)
+{
+	if (!RenderTarget)
+	{
+		return;
+	}
+
+	if (InUseTargets.RemoveSingleSwap(RenderTarget) == 0)
+	{
+		UE_LOG(LogRenderTargetPool, Warning, TEXT("Release: Render target %s was not acquired from this pool."), *RenderTarget->GetName());
+		return;
+	}
+	FreeTargets.Add(RenderTarget);
+}
+
+void URenderTargetPool::Reserve(int32 Count, int32 SizeX, int32 SizeY, ETextureRenderTargetFormat Format)
+{
+	int32 NumMatching = 0;
+	for (const UTextureRenderTarget2D* Target : FreeTargets)
+	{
+		if (Target && Target->SizeX == SizeX && Target->SizeY == SizeY && Target->RenderTargetFormat == Format)
+		{
+			++NumMatching;
+		}
+	}
+
+	for (int32 i = NumMatching; i < Count; ++i)
+	{
+		if (UTextureRenderTarget2D* NewTarget = CreateRenderTarget(SizeX, SizeY, Format))
+		{
+			FreeTargets.Add(NewTarget);
+		}
+	}
+}
+
+void URenderTargetPool::Trim(int32 MaxFree)
+{
+	while (FreeTargets.Num() > FMath::Max(MaxFree, 0))
+	{
+		UTextureRenderTarget2D* Target = FreeTargets.Pop(EAllowShrinking::No);
+		if (Target)
+		{
+			Target->ReleaseResource();
+		}
+	}
+}
+
+void URenderTargetPool::Empty()
+{
+	for (UTextureRenderTarget2D* Target : InUseTargets)
+	{
+		if (Target)
+		{
+			Target->ReleaseResource();
+		}
+	}
+	InUseTargets.Empty();
+	Trim(0);
+}
+
+void URenderTargetPool::BeginDestroy()
+{
+	InUseTargets.Empty();
+	FreeTargets.Empty();
+	Super::BeginDestroy();
+}
+
+UTextureRenderTarget2D* URenderTargetPool::CreateRenderTarget(int32 SizeX, int32 SizeY, ETextureRenderTargetFormat Format)
+{
+	UTextureRenderTarget2D* NewTarget = NewObject<UTextureRenderTarget2D>(this);
+	if (!NewTarget)
+	{
+		return nullptr;
+	}
+
+	NewTarget->RenderTargetFormat = Format;
+	NewTarget->ClearColor = FLinearColor::Black;
+	NewTarget->bAutoGenerateMips = false;
+	NewTarget->InitAutoFormat(SizeX, SizeY);
+	NewTarget->UpdateResourceImmediate(true);
+
+	UE_LOG(LogRenderTargetPool, Verbose, TEXT("Created pooled render target %s (%dx%d)."), *NewTarget->GetName(), SizeX, SizeY);
+	return NewTarget;
+}
@@ -0,0 +1,73 @@
+// RenderTargetPool.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "RenderTargetPool.generated.h"
+
+/**
+ * Simple pool of UTextureRenderTarget2D objects shared by programmatically spawned capture rigs.
+ * Targets handed back with Release() are kept alive and reused by the next Acquire() with a matching
+ * size and format, so rebuilding a rig does not allocate (or leak) GPU textures.
+ */
+UCLASS(BlueprintType)
+class EXTRACTJOINTLOCATION_API URenderTargetPool : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Returns a render target of the requested size and format, reusing a free one if possible.
+	 * @param SizeX Width of the render target in pixels.
+	 * @param SizeY Height of the render target in pixels.
+	 * @param Format Pixel format of the render target.
+	 * @return The render target, or nullptr if the dimensions are invalid.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Render Target Pool")
+	UTextureRenderTarget2D* Acquire(int32 SizeX, int32 SizeY, ETextureRenderTargetFormat Format = RTF_RGBA8);
+
+	/**
+	 * Hands a render target back to the pool so a later Acquire() can reuse it.
+	 * @param RenderTarget A render target previously returned by Acquire().
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Render Target Pool")
+	void Release(UTextureRenderTarget2D* RenderTarget);
+
+	/**
+	 * Makes sure at least Count free render targets of the given size and format exist,
+	 * so a rig of that size can be built without allocating mid-build.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Render Target Pool")
+	void Reserve(int32 Count, int32 SizeX, int32 SizeY, ETextureRenderTargetFormat Format = RTF_RGBA8);
+
+	/**
+	 * Releases the GPU resources of free render targets beyond MaxFree and drops them from the pool.
+	 * @param MaxFree Number of free render targets to keep around.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Render Target Pool")
+	void Trim(int32 MaxFree = 0);
+
+	/** Releases every render target owned by the pool, including those still in use. */
+	UFUNCTION(BlueprintCallable, Category = "Render Target Pool")
+	void Empty();
+
+	UFUNCTION(BlueprintPure, Category = "Render Target Pool")
+	int32 GetNumInUse() const { return InUseTargets.Num(); }
+
+	UFUNCTION(BlueprintPure, Category = "Render Target Pool")
+	int32 GetNumFree() const { return FreeTargets.Num(); }
+
+	virtual void BeginDestroy() override;
+
+private:
+	UTextureRenderTarget2D* CreateRenderTarget(int32 SizeX, int32 SizeY, ETextureRenderTargetFormat Format);
+
+	// Render targets waiting to be reused. UPROPERTY keeps them from being garbage collected.
+	UPROPERTY()
+	TArray<UTextureRenderTarget2D*> FreeTargets;
+
+	// Render targets currently handed out by Acquire().
+	UPROPERTY()
+	TArray<UTextureRenderTarget2D*> InUseTargets;
+};
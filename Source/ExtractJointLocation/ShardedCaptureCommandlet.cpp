@@ -0,0 +1,834 @@
+#include "ShardedCaptureCommandlet.h"
+#include "CaptureIndex.h"
+#include "KeypointStream.h"
+#include "DenseVertexStream.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogShardedCapture, Log, All);
+
+namespace ShardedCapture
+{
+	const TCHAR* ManifestFileName = TEXT("Shards.json");
+	// Mesh types of USkeletalExtractor streams, which follow the actor name in <Actor>_<MeshType>[_<Suffix>].kps
+	const TCHAR* MeshTypes[] = { TEXT("Body"), TEXT("Face") };
+	// Derivative channels of USkeletalExtractor's Kinematics/<Actor>_<MeshType>_<Channel>.kps streams
+	const TCHAR* KinematicsChannels[] = { TEXT("Velocity"), TEXT("Acceleration"), TEXT("Jerk") };
+	const int32 JerkChannel = 2;
+	// USkeletalExtractor's defaults
+	const EKinematicsFilter DefaultKinematicsFilter = EKinematicsFilter::SavitzkyGolay;
+	const int32 DefaultKinematicsHalfWindow = 3;
+	const float DefaultJerkFlagThreshold = 200000.0f;
+
+	// A keypoint stream file with the time of every frame, which FKeypointStreamDecoder::DecodeFile does not keep
+	struct FDecodedStream
+	{
+		FKeypointStreamHeader Header;
+		TArray<int32> FrameIndices;
+		TArray<float> Times;
+		TArray<TArray<FVector>> Frames;
+	};
+
+	// Fails if the file is missing, not a keypoint stream or ends with a truncated frame
+	bool DecodeStream(const FString& FilePath, FDecodedStream& OutStream)
+	{
+		TArray<uint8> Data;
+		if (!FFileHelper::LoadFileToArray(Data, *FilePath, FILEREAD_Silent))
+		{
+			return false;
+		}
+
+		FKeypointStreamDecoder Decoder;
+		int64 Offset = 0;
+		if (!Decoder.ReadHeader(Data, Offset))
+		{
+			return false;
+		}
+		OutStream.Header = Decoder.GetHeader();
+
+		int32 FrameIndex = 0;
+		float TimeSeconds = 0.0f;
+		TArray<FVector> Positions;
+		while (Decoder.DecodeFrame(Data, Offset, FrameIndex, TimeSeconds, Positions))
+		{
+			OutStream.FrameIndices.Add(FrameIndex);
+			OutStream.Times.Add(TimeSeconds);
+			OutStream.Frames.Add(Positions);
+		}
+		return Offset == Data.Num();
+	}
+
+	// Streams are named <Actor>_<MeshType>[_<Suffix>] or <Actor>_<Regressor>; the index keys them by actor and the rest
+	// of the name, as USkeletalExtractor does (e.g. "Body", "Body_Markers")
+	void SplitStreamName(const FString& BaseFileName, FString& OutSubject, FString& OutStream)
+	{
+		int32 SeparatorIndex = INDEX_NONE;
+		for (const TCHAR* MeshType : MeshTypes)
+		{
+			const FString Token = FString(TEXT("_")) + MeshType;
+			for (int32 TokenIndex = BaseFileName.Find(Token, ESearchCase::CaseSensitive, ESearchDir::FromEnd); TokenIndex != INDEX_NONE;
+				TokenIndex = TokenIndex > 0 ? BaseFileName.Find(Token, ESearchCase::CaseSensitive, ESearchDir::FromEnd, TokenIndex + Token.Len() - 1) : INDEX_NONE)
+			{
+				const int32 TokenEnd = TokenIndex + Token.Len();
+				if (TokenEnd == BaseFileName.Len() || BaseFileName[TokenEnd] == TEXT('_'))
+				{
+					SeparatorIndex = FMath::Max(SeparatorIndex, TokenIndex);
+					break;
+				}
+			}
+		}
+		if (SeparatorIndex == INDEX_NONE)
+		{
+			BaseFileName.FindLastChar(TEXT('_'), SeparatorIndex);
+		}
+		OutSubject = SeparatorIndex != INDEX_NONE ? BaseFileName.Left(SeparatorIndex) : BaseFileName;
+		OutStream = SeparatorIndex != INDEX_NONE ? BaseFileName.Mid(SeparatorIndex + 1) : FString();
+	}
+
+	bool SaveJson(const TSharedRef<FJsonObject>& Object, const FString& FilePath)
+	{
+		FString Content;
+		TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Content);
+		FJsonSerializer::Serialize(Object, Writer);
+		return FFileHelper::SaveStringToFile(Content, *FilePath);
+	}
+}
+
+UShardedCaptureCommandlet::UShardedCaptureCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UShardedCaptureCommandlet::Main(const FString& Params)
+{
+	TArray<FString> Tokens;
+	TArray<FString> Switches;
+	TMap<FString, FString> ParamsMap;
+	ParseCommandLine(*Params, Tokens, Switches, ParamsMap);
+
+	const FString* RunParam = ParamsMap.Find(TEXT("ShardRun"));
+	RunName = RunParam ? *RunParam : TEXT("SkeletonCapture");
+	RunDirectory = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("KeypointStreams"), RunName);
+
+	// Only used to fill the kinematics frames the shards' estimators could not evaluate
+	KinematicsFilter = ShardedCapture::DefaultKinematicsFilter;
+	if (const FString* FilterParam = ParamsMap.Find(TEXT("KinematicsFilter")))
+	{
+		const int64 FilterValue = StaticEnum<EKinematicsFilter>()->GetValueByNameString(*FilterParam);
+		if (FilterValue == INDEX_NONE)
+		{
+			UE_LOG(LogShardedCapture, Error, TEXT("Unknown -KinematicsFilter=%s, expected FiniteDifference or SavitzkyGolay."), **FilterParam);
+			return 1;
+		}
+		KinematicsFilter = static_cast<EKinematicsFilter>(FilterValue);
+	}
+	const FString* HalfWindowParam = ParamsMap.Find(TEXT("KinematicsHalfWindow"));
+	KinematicsHalfWindow = FMath::Max(HalfWindowParam ? FCString::Atoi(**HalfWindowParam) : ShardedCapture::DefaultKinematicsHalfWindow, 2);
+	const FString* ThresholdParam = ParamsMap.Find(TEXT("JerkFlagThreshold"));
+	JerkFlagThreshold = ThresholdParam ? FCString::Atof(**ThresholdParam) : ShardedCapture::DefaultJerkFlagThreshold;
+
+	if (!Switches.Contains(TEXT("MergeOnly")))
+	{
+		const FString* MapParam = ParamsMap.Find(TEXT("Map"));
+		const FString* FramesParam = ParamsMap.Find(TEXT("Frames"));
+		const int32 NumFrames = FramesParam ? FCString::Atoi(**FramesParam) : 0;
+		if (!MapParam || NumFrames <= 0)
+		{
+			UE_LOG(LogShardedCapture, Error, TEXT("Usage: -run=ShardedCapture -Map=<map> -Frames=<count> [-Processes=N] [-FPS=60] [-Seed=0] [-ShardRun=<name>] [-Resume] [-MergeOnly]"));
+			return 1;
+		}
+
+		const FString* ProcessesParam = ParamsMap.Find(TEXT("Processes"));
+		const int32 NumProcesses = FMath::Max(ProcessesParam ? FCString::Atoi(**ProcessesParam) : FPlatformMisc::NumberOfCores(), 1);
+		const FString* FPSParam = ParamsMap.Find(TEXT("FPS"));
+		const float FrameRate = FMath::Max(FPSParam ? FCString::Atof(**FPSParam) : 60.0f, 1.0f);
+		const FString* SeedParam = ParamsMap.Find(TEXT("Seed"));
+		const int32 Seed = SeedParam ? FCString::Atoi(**SeedParam) : 0;
+
+		// Stale shards from an earlier run with a different split would be merged too
+		const bool bResume = Switches.Contains(TEXT("Resume"));
+		if (!bResume)
+		{
+			IFileManager::Get().DeleteDirectory(*RunDirectory, false, true);
+		}
+
+		if (!WriteShardManifest(NumProcesses, NumFrames) || !RunShards(*MapParam, NumFrames, NumProcesses, FrameRate, Seed, bResume))
+		{
+			return 1;
+		}
+	}
+
+	return MergeShards() ? 0 : 1;
+}
+
+bool UShardedCaptureCommandlet::RunShards(const FString& MapName, int32 NumFrames, int32 NumProcesses, float FrameRate, int32 Seed, bool bResume) const
+{
+	const FString ExecutablePath = FPlatformProcess::ExecutablePath();
+	const FString ProjectPath = FPaths::ConvertRelativePathToFull(FPaths::GetProjectFilePath());
+
+	const double StartTime = FPlatformTime::Seconds();
+	TArray<FProcHandle> Processes;
+	for (int32 ShardIndex = 0; ShardIndex < NumProcesses; ++ShardIndex)
+	{
+		// Every shard runs the same level with the same seed and frame clock; only the frame range differs
+		const FString Arguments = FString::Printf(TEXT("\"%s\" %s -game -nullrhi -nosound -unattended -nosplash -SkeletonCaptureFPS=%g -SkeletonCaptureFrames=%d -ShardIndex=%d -ShardCount=%d -ShardRun=%s -CaptureSeed=%d%s"),
+			*ProjectPath, *MapName, FrameRate, NumFrames, ShardIndex, NumProcesses, *RunName, Seed, bResume ? TEXT(" -ResumeCapture") : TEXT(""));
+
+		FProcHandle Process = FPlatformProcess::CreateProc(*ExecutablePath, *Arguments, true, true, true, nullptr, 0, nullptr, nullptr);
+		if (!Process.IsValid())
+		{
+			UE_LOG(LogShardedCapture, Error, TEXT("RunShards: Failed to start shard %d (%s %s)."), ShardIndex, *ExecutablePath, *Arguments);
+			for (FProcHandle& Started : Processes)
+			{
+				FPlatformProcess::TerminateProc(Started);
+				FPlatformProcess::CloseProc(Started);
+			}
+			return false;
+		}
+		Processes.Add(Process);
+	}
+	UE_LOG(LogShardedCapture, Display, TEXT("Capturing %d frames in %d processes..."), NumFrames, NumProcesses);
+
+	bool bAllSucceeded = true;
+	for (int32 ShardIndex = 0; ShardIndex < Processes.Num(); ++ShardIndex)
+	{
+		FPlatformProcess::WaitForProc(Processes[ShardIndex]);
+		int32 ReturnCode = 0;
+		FPlatformProcess::GetProcReturnCode(Processes[ShardIndex], &ReturnCode);
+		FPlatformProcess::CloseProc(Processes[ShardIndex]);
+		if (ReturnCode != 0)
+		{
+			UE_LOG(LogShardedCapture, Error, TEXT("RunShards: Shard %d exited with code %d."), ShardIndex, ReturnCode);
+			bAllSucceeded = false;
+		}
+	}
+
+	UE_LOG(LogShardedCapture, Display, TEXT("All shards finished in %.1f s."), FPlatformTime::Seconds() - StartTime);
+	return bAllSucceeded;
+}
+
+bool UShardedCaptureCommandlet::WriteShardManifest(int32 NumProcesses, int32 NumFrames) const
+{
+	TSharedPtr<FJsonObject> ManifestObject = MakeShareable(new FJsonObject);
+	ManifestObject->SetNumberField(TEXT("Processes"), NumProcesses);
+	ManifestObject->SetNumberField(TEXT("Frames"), NumFrames);
+
+	FString ManifestContent;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&ManifestContent);
+	FJsonSerializer::Serialize(ManifestObject.ToSharedRef(), Writer);
+
+	const FString ManifestPath = FPaths::Combine(RunDirectory, ShardedCapture::ManifestFileName);
+	if (!FFileHelper::SaveStringToFile(ManifestContent, *ManifestPath))
+	{
+		UE_LOG(LogShardedCapture, Error, TEXT("WriteShardManifest: Failed to write %s."), *ManifestPath);
+		return false;
+	}
+	return true;
+}
+
+bool UShardedCaptureCommandlet::MergeShards() const
+{
+	// The manifest says how many shards there must be; a shard that never started leaves no folder to find
+	const FString ManifestPath = FPaths::Combine(RunDirectory, ShardedCapture::ManifestFileName);
+	FString ManifestContent;
+	TSharedPtr<FJsonObject> ManifestObject;
+	int32 NumProcesses = 0;
+	int32 NumFrames = 0;
+	if (!FFileHelper::LoadFileToString(ManifestContent, *ManifestPath) ||
+		!FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(ManifestContent), ManifestObject) || !ManifestObject.IsValid() ||
+		!ManifestObject->TryGetNumberField(TEXT("Processes"), NumProcesses) || !ManifestObject->TryGetNumberField(TEXT("Frames"), NumFrames) || NumProcesses <= 0)
+	{
+		UE_LOG(LogShardedCapture, Error, TEXT("MergeShards: %s is missing or invalid, the shards cannot be checked for completeness."), *ManifestPath);
+		return false;
+	}
+
+	// Shard_000, Shard_001, ... are in frame order
+	TArray<FString> ShardDirectories;
+	TSet<FString> StreamFileNameSet;
+	TSet<FString> VertexStreamFileNameSet;
+	TSet<FString> KinematicsStreamFileNameSet;
+	TSet<FString> ReportFileNameSet;
+	for (int32 ShardIndex = 0; ShardIndex < NumProcesses; ++ShardIndex)
+	{
+		const FString ShardDirectory = FPaths::Combine(RunDirectory, FString::Printf(TEXT("Shard_%03d"), ShardIndex));
+		if (!IFileManager::Get().DirectoryExists(*ShardDirectory))
+		{
+			UE_LOG(LogShardedCapture, Error, TEXT("MergeShards: Shard %d of %d is missing (%s)."), ShardIndex, NumProcesses, *ShardDirectory);
+			return false;
+		}
+		ShardDirectories.Add(ShardDirectory);
+
+		TArray<FString> ShardStreams;
+		IFileManager::Get().FindFiles(ShardStreams, *FPaths::Combine(ShardDirectory, TEXT("*.kps")), true, false);
+		StreamFileNameSet.Append(ShardStreams);
+
+		TArray<FString> ShardVertexStreams;
+		IFileManager::Get().FindFiles(ShardVertexStreams, *FPaths::Combine(ShardDirectory, TEXT("*.kdv")), true, false);
+		VertexStreamFileNameSet.Append(ShardVertexStreams);
+
+		// Kinematics/<Actor>_<MeshType>_<Channel>.kps belongs to the <Actor>_<MeshType>.kps stream
+		TArray<FString> ShardChannels;
+		IFileManager::Get().FindFiles(ShardChannels, *FPaths::Combine(ShardDirectory, TEXT("Kinematics"), TEXT("*.kps")), true, false);
+		for (const FString& ChannelFileName : ShardChannels)
+		{
+			const FString ChannelBaseName = FPaths::GetBaseFilename(ChannelFileName);
+			int32 SeparatorIndex = INDEX_NONE;
+			if (ChannelBaseName.FindLastChar(TEXT('_'), SeparatorIndex))
+			{
+				KinematicsStreamFileNameSet.Add(ChannelBaseName.Left(SeparatorIndex) + TEXT(".kps"));
+			}
+		}
+
+		TArray<FString> ShardReports;
+		IFileManager::Get().FindFiles(ShardReports, *FPaths::Combine(ShardDirectory, TEXT("QA"), TEXT("*_BoneLengths.json")), true, false);
+		ReportFileNameSet.Append(ShardReports);
+	}
+
+	// Sorted, so the merged index is the same on every run
+	TArray<FString> StreamFileNames = StreamFileNameSet.Array();
+	StreamFileNames.Sort();
+	TArray<FString> VertexStreamFileNames = VertexStreamFileNameSet.Array();
+	VertexStreamFileNames.Sort();
+	TArray<FString> KinematicsStreamFileNames = KinematicsStreamFileNameSet.Array();
+	KinematicsStreamFileNames.Sort();
+	TArray<FString> ReportFileNames = ReportFileNameSet.Array();
+	ReportFileNames.Sort();
+
+	const FString MergedDirectory = FPaths::Combine(RunDirectory, TEXT("Merged"));
+	FCaptureIndexBuilder IndexBuilder;
+	bool bAllMerged = true;
+	for (const FString& StreamFileName : StreamFileNames)
+	{
+		bAllMerged &= MergeStream(StreamFileName, ShardDirectories, NumFrames, MergedDirectory, IndexBuilder);
+	}
+	for (const FString& StreamFileName : VertexStreamFileNames)
+	{
+		bAllMerged &= MergeVertexStream(StreamFileName, ShardDirectories, NumFrames, MergedDirectory, IndexBuilder);
+	}
+
+	// Missing derivatives are computed from the merged positions, so the position streams are merged first
+	for (const FString& StreamFileName : KinematicsStreamFileNames)
+	{
+		bAllMerged &= MergeKinematics(StreamFileName, ShardDirectories, MergedDirectory);
+	}
+	for (const FString& ReportFileName : ReportFileNames)
+	{
+		bAllMerged &= MergeBoneLengthReport(ReportFileName, ShardDirectories, MergedDirectory);
+	}
+
+	if (IndexBuilder.Num() > 0)
+	{
+		IndexBuilder.Save(FPaths::Combine(MergedDirectory, TEXT("KeypointStreams.ejli")));
+	}
+	return bAllMerged;
+}
+
+bool UShardedCaptureCommandlet::MergeStream(const FString& StreamFileName, const TArray<FString>& ShardDirectories, int32 NumFrames, const FString& MergedDirectory, FCaptureIndexBuilder& IndexBuilder) const
+{
+	FString Subject;
+	FString Stream;
+	ShardedCapture::SplitStreamName(FPaths::GetBaseFilename(StreamFileName), Subject, Stream);
+
+	const FString MergedFilePath = FPaths::ConvertRelativePathToFull(FPaths::Combine(MergedDirectory, StreamFileName));
+	TArray<uint8> Merged;
+	TArray<uint8> HeaderBytes;
+	int32 ExpectedFrame = INDEX_NONE;
+	int32 NumMergedFrames = 0;
+
+	for (const FString& ShardDirectory : ShardDirectories)
+	{
+		// Every shard opens all streams, even a trailing shard without frames, so a missing file is a failed shard
+		const FString ShardFilePath = FPaths::Combine(ShardDirectory, StreamFileName);
+		TArray<uint8> Data;
+		if (!FFileHelper::LoadFileToArray(Data, *ShardFilePath, FILEREAD_Silent))
+		{
+			UE_LOG(LogShardedCapture, Error, TEXT("MergeStream: %s is missing."), *ShardFilePath);
+			return false;
+		}
+
+		FKeypointStreamDecoder Decoder;
+		int64 Offset = 0;
+		if (!Decoder.ReadHeader(Data, Offset))
+		{
+			UE_LOG(LogShardedCapture, Error, TEXT("MergeStream: %s is not a keypoint stream."), *ShardFilePath);
+			return false;
+		}
+
+		if (HeaderBytes.Num() == 0)
+		{
+			HeaderBytes.Append(Data.GetData(), Offset);
+			Merged = HeaderBytes;
+		}
+		else if (Offset != HeaderBytes.Num() || FMemory::Memcmp(Data.GetData(), HeaderBytes.GetData(), Offset) != 0)
+		{
+			UE_LOG(LogShardedCapture, Error, TEXT("MergeStream: %s was written with different joints or encoding settings than the previous shards."), *ShardFilePath);
+			return false;
+		}
+
+		// Decoding checks every frame is complete; the frame bytes are copied unchanged. Shards start on a keyframe, and
+		// every frame is indexed from its keyframe on so it can be decoded without the rest of the stream.
+		int32 FrameIndex = 0;
+		float TimeSeconds = 0.0f;
+		TArray<FVector> Positions;
+		int64 FrameStart = Offset;
+		int64 KeyframeOffset = Merged.Num();
+		while (Decoder.DecodeFrame(Data, Offset, FrameIndex, TimeSeconds, Positions))
+		{
+			if (ExpectedFrame != INDEX_NONE && FrameIndex != ExpectedFrame)
+			{
+				UE_LOG(LogShardedCapture, Error, TEXT("MergeStream: %s starts or continues at frame %d, expected %d."), *ShardFilePath, FrameIndex, ExpectedFrame);
+				return false;
+			}
+			ExpectedFrame = FrameIndex + 1;
+
+			if (Decoder.WasKeyframe())
+			{
+				KeyframeOffset = Merged.Num();
+			}
+			Merged.Append(Data.GetData() + FrameStart, Offset - FrameStart);
+			IndexBuilder.AddEntry(FrameIndex, ECaptureIndexKind::Skeleton, Subject, FString(), MergedFilePath, KeyframeOffset, Merged.Num() - KeyframeOffset,
+				INDEX_NONE, Stream, HeaderBytes.Num());
+			FrameStart = Offset;
+			++NumMergedFrames;
+		}
+
+		if (Offset != Data.Num())
+		{
+			UE_LOG(LogShardedCapture, Error, TEXT("MergeStream: %s ends with a truncated frame, the shard did not finish."), *ShardFilePath);
+			return false;
+		}
+	}
+
+	if (ExpectedFrame != INDEX_NONE && ExpectedFrame != NumFrames)
+	{
+		UE_LOG(LogShardedCapture, Error, TEXT("MergeStream: %s ends at frame %d of %d, the last shards did not finish."), *StreamFileName, ExpectedFrame, NumFrames);
+		return false;
+	}
+
+	if (!FFileHelper::SaveArrayToFile(Merged, *MergedFilePath))
+	{
+		UE_LOG(LogShardedCapture, Error, TEXT("MergeStream: Failed to write %s."), *MergedFilePath);
+		return false;
+	}
+
+	UE_LOG(LogShardedCapture, Display, TEXT("Merged %d frames of %s from %d shards into %s."), NumMergedFrames, *StreamFileName, ShardDirectories.Num(), *MergedFilePath);
+	return true;
+}
+
+bool UShardedCaptureCommandlet::MergeVertexStream(const FString& StreamFileName, const TArray<FString>& ShardDirectories, int32 NumFrames, const FString& MergedDirectory, FCaptureIndexBuilder& IndexBuilder) const
+{
+	FString Subject;
+	FString Stream;
+	ShardedCapture::SplitStreamName(FPaths::GetBaseFilename(StreamFileName), Subject, Stream);
+
+	// Dense vertex frames are ~150 KB each, so shards are copied frame by frame instead of being loaded whole
+	const FString MergedFilePath = FPaths::ConvertRelativePathToFull(FPaths::Combine(MergedDirectory, StreamFileName));
+	TUniquePtr<FArchive> MergedFile(IFileManager::Get().CreateFileWriter(*MergedFilePath));
+	if (!MergedFile)
+	{
+		UE_LOG(LogShardedCapture, Error, TEXT("MergeVertexStream: Failed to create %s."), *MergedFilePath);
+		return false;
+	}
+	auto DiscardMerged = [&MergedFile, &MergedFilePath]()
+	{
+		MergedFile.Reset();
+		IFileManager::Get().Delete(*MergedFilePath);
+		return false;
+	};
+
+	// Every header field has a fixed size, so any header gives the size of the one at the start of the shards
+	FDenseVertexStreamHeader Header;
+	TArray<uint8> HeaderBytes;
+	FMemoryWriter HeaderWriter(HeaderBytes);
+	HeaderWriter << Header;
+	const int64 HeaderSize = HeaderBytes.Num();
+	int64 FrameSize = 0;
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	TArray<uint8> ShardHeaderBytes;
+	TArray<uint8> FrameData;
+	int32 PreviousFrame = INDEX_NONE;
+	int32 FrameInterval = 0;
+	int32 NumMergedFrames = 0;
+	for (const FString& ShardDirectory : ShardDirectories)
+	{
+		// Every shard opens all streams, even a trailing shard without frames, so a missing file is a failed shard
+		const FString ShardFilePath = FPaths::Combine(ShardDirectory, StreamFileName);
+		TUniquePtr<IFileHandle> ShardFile(PlatformFile.OpenRead(*ShardFilePath));
+		if (!ShardFile)
+		{
+			UE_LOG(LogShardedCapture, Error, TEXT("MergeVertexStream: %s is missing."), *ShardFilePath);
+			return DiscardMerged();
+		}
+
+		ShardHeaderBytes.SetNumUninitialized(HeaderSize);
+		FDenseVertexStreamHeader ShardHeader;
+		FMemoryReader HeaderReader(ShardHeaderBytes);
+		const bool bHeaderRead = ShardFile->Read(ShardHeaderBytes.GetData(), HeaderSize);
+		if (bHeaderRead)
+		{
+			HeaderReader << ShardHeader;
+		}
+		if (!bHeaderRead || HeaderReader.IsError())
+		{
+			UE_LOG(LogShardedCapture, Error, TEXT("MergeVertexStream: %s is not a dense vertex stream."), *ShardFilePath);
+			return DiscardMerged();
+		}
+
+		if (FrameSize == 0)
+		{
+			HeaderBytes = ShardHeaderBytes;
+			FrameSize = ShardHeader.GetFrameSize();
+			MergedFile->Serialize(HeaderBytes.GetData(), HeaderSize);
+		}
+		else if (FMemory::Memcmp(ShardHeaderBytes.GetData(), HeaderBytes.GetData(), HeaderSize) != 0)
+		{
+			UE_LOG(LogShardedCapture, Error, TEXT("MergeVertexStream: %s was written with a different mesh or encoding than the previous shards."), *ShardFilePath);
+			return DiscardMerged();
+		}
+
+		const int64 ShardSize = ShardFile->Size();
+		if ((ShardSize - HeaderSize) % FrameSize != 0)
+		{
+			UE_LOG(LogShardedCapture, Error, TEXT("MergeVertexStream: %s ends with a truncated frame, the shard did not finish."), *ShardFilePath);
+			return DiscardMerged();
+		}
+
+		// Frames keep the spacing of the stream's first two, so a missing or repeated frame shows up at the shard boundary
+		FrameData.SetNumUninitialized(FrameSize);
+		for (int64 FrameOffset = HeaderSize; FrameOffset < ShardSize; FrameOffset += FrameSize)
+		{
+			if (!ShardFile->Read(FrameData.GetData(), FrameSize))
+			{
+				UE_LOG(LogShardedCapture, Error, TEXT("MergeVertexStream: Failed to read %s."), *ShardFilePath);
+				return DiscardMerged();
+			}
+
+			int32 FrameIndex = 0;
+			FMemory::Memcpy(&FrameIndex, FrameData.GetData(), sizeof(int32));
+			if (PreviousFrame != INDEX_NONE)
+			{
+				const int32 Spacing = FrameIndex - PreviousFrame;
+				if (Spacing <= 0 || (FrameInterval > 0 && Spacing != FrameInterval))
+				{
+					UE_LOG(LogShardedCapture, Error, TEXT("MergeVertexStream: %s has frame %d after frame %d."), *ShardFilePath, FrameIndex, PreviousFrame);
+					return DiscardMerged();
+				}
+				FrameInterval = Spacing;
+			}
+			PreviousFrame = FrameIndex;
+
+			IndexBuilder.AddEntry(FrameIndex, ECaptureIndexKind::Skeleton, Subject, FString(), MergedFilePath, MergedFile->Tell(), FrameSize,
+				INDEX_NONE, Stream, HeaderSize);
+			MergedFile->Serialize(FrameData.GetData(), FrameSize);
+			++NumMergedFrames;
+		}
+	}
+
+	if (FrameInterval > 0 && PreviousFrame + FrameInterval < NumFrames)
+	{
+		UE_LOG(LogShardedCapture, Error, TEXT("MergeVertexStream: %s ends at frame %d of %d, the last shards did not finish."), *StreamFileName, PreviousFrame, NumFrames);
+		return DiscardMerged();
+	}
+
+	if (!MergedFile->Close())
+	{
+		UE_LOG(LogShardedCapture, Error, TEXT("MergeVertexStream: Failed to write %s."), *MergedFilePath);
+		return DiscardMerged();
+	}
+
+	UE_LOG(LogShardedCapture, Display, TEXT("Merged %d frames of %s from %d shards into %s."), NumMergedFrames, *StreamFileName, ShardDirectories.Num(), *MergedFilePath);
+	return true;
+}
+
+bool UShardedCaptureCommandlet::MergeKinematics(const FString& StreamFileName, const TArray<FString>& ShardDirectories, const FString& MergedDirectory) const
+{
+	const FString BaseFileName = FPaths::GetBaseFilename(StreamFileName);
+	ShardedCapture::FDecodedStream PositionStream;
+	if (!ShardedCapture::DecodeStream(FPaths::Combine(MergedDirectory, StreamFileName), PositionStream) || PositionStream.Frames.Num() == 0)
+	{
+		UE_LOG(LogShardedCapture, Error, TEXT("MergeKinematics: The positions of %s were not merged, its kinematics cannot be completed."), *StreamFileName);
+		return false;
+	}
+	const int32 FirstFrame = PositionStream.FrameIndices[0];
+	const int32 NumFrames = PositionStream.Frames.Num();
+
+	// Derivatives of every merged frame per channel; frames no estimator evaluated stay empty
+	constexpr int32 NumChannels = UE_ARRAY_COUNT(ShardedCapture::KinematicsChannels);
+	TArray<TArray<FVector>> ChannelFrames[NumChannels];
+	FKeypointStreamHeader ChannelHeader;
+	bool bHasChannelHeader = false;
+	for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+	{
+		ChannelFrames[Channel].SetNum(NumFrames);
+		const FString ChannelFileName = FString::Printf(TEXT("%s_%s.kps"), *BaseFileName, ShardedCapture::KinematicsChannels[Channel]);
+		for (const FString& ShardDirectory : ShardDirectories)
+		{
+			// Every shard opens all streams, so a missing or truncated file is a failed shard
+			const FString ShardFilePath = FPaths::Combine(ShardDirectory, TEXT("Kinematics"), ChannelFileName);
+			ShardedCapture::FDecodedStream ShardStream;
+			if (!ShardedCapture::DecodeStream(ShardFilePath, ShardStream))
+			{
+				UE_LOG(LogShardedCapture, Error, TEXT("MergeKinematics: %s is missing or truncated."), *ShardFilePath);
+				return false;
+			}
+
+			const FKeypointStreamHeader& Header = ShardStream.Header;
+			if (!bHasChannelHeader)
+			{
+				ChannelHeader = Header;
+				bHasChannelHeader = true;
+			}
+			if (Header.JointNames != PositionStream.Header.JointNames || Header.JointNames != ChannelHeader.JointNames || Header.Encoding != ChannelHeader.Encoding
+				|| Header.QuantizationStep != ChannelHeader.QuantizationStep || Header.KeyframeInterval != ChannelHeader.KeyframeInterval)
+			{
+				UE_LOG(LogShardedCapture, Error, TEXT("MergeKinematics: %s was written with different joints or encoding settings than %s."), *ShardFilePath, *StreamFileName);
+				return false;
+			}
+
+			for (int32 Frame = 0; Frame < ShardStream.Frames.Num(); ++Frame)
+			{
+				const int32 Slot = ShardStream.FrameIndices[Frame] - FirstFrame;
+				if (!ChannelFrames[Channel].IsValidIndex(Slot))
+				{
+					UE_LOG(LogShardedCapture, Error, TEXT("MergeKinematics: %s has frame %d, which %s does not."), *ShardFilePath, ShardStream.FrameIndices[Frame], *StreamFileName);
+					return false;
+				}
+				ChannelFrames[Channel][Slot] = MoveTemp(ShardStream.Frames[Frame]);
+			}
+		}
+	}
+
+	// The shards' derivatives were computed from the unquantized poses and are kept as they are; the merged positions
+	// only fill the frames around the points where a shard or a resumed run restarted its estimator
+	FKinematicsEstimator Estimator(KinematicsFilter, PositionStream.Header.JointNames.Num(), KinematicsHalfWindow);
+	TBitArray<> Evaluated(false, NumFrames);
+	int32 NumFilledFrames = 0;
+	for (int32 Slot = 0; Slot < NumFrames; ++Slot)
+	{
+		if (!Estimator.AddFrame(PositionStream.FrameIndices[Slot], PositionStream.Times[Slot], PositionStream.Frames[Slot]))
+		{
+			continue;
+		}
+
+		const int32 EvaluatedSlot = Estimator.GetFrameIndex() - FirstFrame;
+		Evaluated[EvaluatedSlot] = true;
+		const TArrayView<const FVector> Derivatives[NumChannels] = { Estimator.GetVelocities(), Estimator.GetAccelerations(), Estimator.GetJerks() };
+		bool bFilled = false;
+		for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+		{
+			if (ChannelFrames[Channel][EvaluatedSlot].Num() == 0)
+			{
+				ChannelFrames[Channel][EvaluatedSlot] = TArray<FVector>(Derivatives[Channel].GetData(), Derivatives[Channel].Num());
+				bFilled = true;
+			}
+		}
+		NumFilledFrames += bFilled ? 1 : 0;
+	}
+
+	// A shard frame the estimator never evaluates means the extractors used other settings, so the filled frames would not match
+	for (int32 Slot = 0; Slot < NumFrames; ++Slot)
+	{
+		for (int32 Channel = 0; Channel < NumChannels && !Evaluated[Slot]; ++Channel)
+		{
+			if (ChannelFrames[Channel][Slot].Num() > 0)
+			{
+				UE_LOG(LogShardedCapture, Error, TEXT("MergeKinematics: The shards have %s derivatives at frame %d, which -KinematicsFilter=%s -KinematicsHalfWindow=%d do not produce; pass the extractors' settings."),
+					*BaseFileName, PositionStream.FrameIndices[Slot], *StaticEnum<EKinematicsFilter>()->GetNameStringByValue(static_cast<int64>(KinematicsFilter)), KinematicsHalfWindow);
+				return false;
+			}
+		}
+	}
+
+	for (int32 Channel = 0; Channel < NumChannels; ++Channel)
+	{
+		// Re-encoded with the shards' settings, so the frames are the same as a single process would write
+		FKeypointStreamEncoder Encoder(ChannelHeader.Encoding, ChannelHeader.JointNames, ChannelHeader.QuantizationStep * 0.5f, ChannelHeader.KeyframeInterval);
+		TArray<uint8> Merged;
+		Encoder.WriteHeader(Merged);
+		for (int32 Slot = 0; Slot < NumFrames; ++Slot)
+		{
+			if (ChannelFrames[Channel][Slot].Num() > 0)
+			{
+				Encoder.EncodeFrame(PositionStream.FrameIndices[Slot], PositionStream.Times[Slot], ChannelFrames[Channel][Slot], Merged);
+			}
+		}
+
+		const FString MergedFilePath = FPaths::Combine(MergedDirectory, TEXT("Kinematics"), FString::Printf(TEXT("%s_%s.kps"), *BaseFileName, ShardedCapture::KinematicsChannels[Channel]));
+		if (!FFileHelper::SaveArrayToFile(Merged, *MergedFilePath))
+		{
+			UE_LOG(LogShardedCapture, Error, TEXT("MergeKinematics: Failed to write %s."), *MergedFilePath);
+			return false;
+		}
+	}
+	UE_LOG(LogShardedCapture, Display, TEXT("Merged the kinematics of %s, %d frames recomputed at shard boundaries."), *StreamFileName, NumFilledFrames);
+
+	// The shards only flagged the frames they evaluated, so the report is rebuilt from the merged jerks; shard reports
+	// record the threshold the extractors used
+	const FString JerkFlagsFileName = BaseFileName + TEXT("_JerkFlags.json");
+	double Threshold = JerkFlagThreshold;
+	for (const FString& ShardDirectory : ShardDirectories)
+	{
+		FString ReportContent;
+		TSharedPtr<FJsonObject> ReportObject;
+		if (FFileHelper::LoadFileToString(ReportContent, *FPaths::Combine(ShardDirectory, TEXT("Kinematics"), JerkFlagsFileName)) &&
+			FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(ReportContent), ReportObject) && ReportObject.IsValid() &&
+			ReportObject->TryGetNumberField(TEXT("Threshold"), Threshold))
+		{
+			break;
+		}
+	}
+	if (Threshold <= 0.0)
+	{
+		return true;
+	}
+
+	TArray<TSharedPtr<FJsonValue>> FlagArray;
+	for (int32 Slot = 0; Slot < NumFrames; ++Slot)
+	{
+		const TArray<FVector>& Jerks = ChannelFrames[ShardedCapture::JerkChannel][Slot];
+		int32 MaxJoint = INDEX_NONE;
+		double MaxJerkSquared = Threshold * Threshold;
+		for (int32 JointIndex = 0; JointIndex < Jerks.Num(); ++JointIndex)
+		{
+			if (Jerks[JointIndex].SizeSquared() > MaxJerkSquared)
+			{
+				MaxJerkSquared = Jerks[JointIndex].SizeSquared();
+				MaxJoint = JointIndex;
+			}
+		}
+		if (MaxJoint == INDEX_NONE)
+		{
+			continue;
+		}
+
+		TSharedPtr<FJsonObject> FlagObject = MakeShareable(new FJsonObject);
+		FlagObject->SetNumberField(TEXT("Frame"), PositionStream.FrameIndices[Slot]);
+		FlagObject->SetNumberField(TEXT("Time"), PositionStream.Times[Slot]);
+		FlagObject->SetStringField(TEXT("Joint"), ChannelHeader.JointNames[MaxJoint].ToString());
+		FlagObject->SetNumberField(TEXT("Jerk"), FMath::Sqrt(MaxJerkSquared));
+		FlagArray.Add(MakeShareable(new FJsonValueObject(FlagObject)));
+	}
+	if (FlagArray.Num() == 0)
+	{
+		return true;
+	}
+
+	FString Subject;
+	FString MeshType;
+	ShardedCapture::SplitStreamName(BaseFileName, Subject, MeshType);
+	TSharedRef<FJsonObject> ReportObject = MakeShared<FJsonObject>();
+	ReportObject->SetStringField(TEXT("Actor"), Subject);
+	ReportObject->SetStringField(TEXT("Mesh"), MeshType);
+	ReportObject->SetNumberField(TEXT("Threshold"), Threshold);
+	ReportObject->SetNumberField(TEXT("NumFlaggedFrames"), FlagArray.Num());
+	ReportObject->SetArrayField(TEXT("Flags"), FlagArray);
+
+	const FString ReportPath = FPaths::Combine(MergedDirectory, TEXT("Kinematics"), JerkFlagsFileName);
+	if (!ShardedCapture::SaveJson(ReportObject, ReportPath))
+	{
+		UE_LOG(LogShardedCapture, Error, TEXT("MergeKinematics: Failed to write %s."), *ReportPath);
+		return false;
+	}
+	UE_LOG(LogShardedCapture, Display, TEXT("%d frames of %s exceed the jerk threshold, listed in %s."), FlagArray.Num(), *StreamFileName, *ReportPath);
+	return true;
+}
+
+bool UShardedCaptureCommandlet::MergeBoneLengthReport(const FString& ReportFileName, const TArray<FString>& ShardDirectories, const FString& MergedDirectory) const
+{
+	// Counts and timings add up, per-bone ratios take the extremes and the outlier frames are listed in frame order
+	TSharedPtr<FJsonObject> MergedReport;
+	TMap<FString, TSharedPtr<FJsonObject>> MergedBones;
+	TArray<TSharedPtr<FJsonValue>> BoneArray;
+	TArray<TSharedPtr<FJsonValue>> FrameArray;
+	double FramesChecked = 0.0;
+	double OutlierFrames = 0.0;
+	double CheckSeconds = 0.0;
+	for (const FString& ShardDirectory : ShardDirectories)
+	{
+		// A shard that checked no frame (e.g. an empty trailing shard) writes no report
+		const FString ShardReportPath = FPaths::Combine(ShardDirectory, TEXT("QA"), ReportFileName);
+		if (!IFileManager::Get().FileExists(*ShardReportPath))
+		{
+			continue;
+		}
+
+		FString ReportContent;
+		TSharedPtr<FJsonObject> ReportObject;
+		if (!FFileHelper::LoadFileToString(ReportContent, *ShardReportPath) ||
+			!FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(ReportContent), ReportObject) || !ReportObject.IsValid())
+		{
+			UE_LOG(LogShardedCapture, Error, TEXT("MergeBoneLengthReport: %s is not a valid report."), *ShardReportPath);
+			return false;
+		}
+		if (!MergedReport.IsValid())
+		{
+			MergedReport = ReportObject;
+		}
+
+		FramesChecked += ReportObject->GetNumberField(TEXT("FramesChecked"));
+		OutlierFrames += ReportObject->GetNumberField(TEXT("OutlierFrames"));
+		CheckSeconds += ReportObject->GetNumberField(TEXT("CheckSeconds"));
+
+		const TArray<TSharedPtr<FJsonValue>>* ShardBones = nullptr;
+		if (ReportObject->TryGetArrayField(TEXT("Bones"), ShardBones))
+		{
+			for (const TSharedPtr<FJsonValue>& BoneValue : *ShardBones)
+			{
+				const TSharedPtr<FJsonObject> BoneObject = BoneValue->AsObject();
+				const FString BoneName = BoneObject->GetStringField(TEXT("Bone"));
+				if (TSharedPtr<FJsonObject>* MergedBone = MergedBones.Find(BoneName))
+				{
+					(*MergedBone)->SetNumberField(TEXT("OutlierFrames"), (*MergedBone)->GetNumberField(TEXT("OutlierFrames")) + BoneObject->GetNumberField(TEXT("OutlierFrames")));
+					(*MergedBone)->SetNumberField(TEXT("MinRatio"), FMath::Min((*MergedBone)->GetNumberField(TEXT("MinRatio")), BoneObject->GetNumberField(TEXT("MinRatio"))));
+					(*MergedBone)->SetNumberField(TEXT("MaxRatio"), FMath::Max((*MergedBone)->GetNumberField(TEXT("MaxRatio")), BoneObject->GetNumberField(TEXT("MaxRatio"))));
+				}
+				else
+				{
+					MergedBones.Add(BoneName, BoneObject);
+					BoneArray.Add(BoneValue);
+				}
+			}
+		}
+
+		// Shards are in frame order
+		const TArray<TSharedPtr<FJsonValue>>* ShardFrames = nullptr;
+		if (ReportObject->TryGetArrayField(TEXT("Frames"), ShardFrames))
+		{
+			FrameArray.Append(*ShardFrames);
+		}
+	}
+	if (!MergedReport.IsValid())
+	{
+		return true;
+	}
+
+	MergedReport->SetNumberField(TEXT("FramesChecked"), FramesChecked);
+	MergedReport->SetNumberField(TEXT("OutlierFrames"), OutlierFrames);
+	MergedReport->SetNumberField(TEXT("CheckSeconds"), CheckSeconds);
+	MergedReport->SetNumberField(TEXT("CheckMicrosecondsPerFrame"), FramesChecked > 0.0 ? CheckSeconds * 1.0e6 / FramesChecked : 0.0);
+	MergedReport->SetArrayField(TEXT("Bones"), BoneArray);
+	MergedReport->SetArrayField(TEXT("Frames"), FrameArray);
+
+	const FString ReportPath = FPaths::Combine(MergedDirectory, TEXT("QA"), ReportFileName);
+	if (!ShardedCapture::SaveJson(MergedReport.ToSharedRef(), ReportPath))
+	{
+		UE_LOG(LogShardedCapture, Error, TEXT("MergeBoneLengthReport: Failed to write %s."), *ReportPath);
+		return false;
+	}
+	UE_LOG(LogShardedCapture, Display, TEXT("Merged the bone length QA of %d frames into %s."), static_cast<int32>(FramesChecked), *ReportPath);
+	return true;
+}
@@ -0,0 +1,67 @@
+// ShardedCaptureCommandlet.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "KinematicsEstimator.h"
+#include "ShardedCaptureCommandlet.generated.h"
+
+class FCaptureIndexBuilder;
+
+/**
+ * Splits a render-free skeleton capture (see ASkeletonCaptureDriver) into frame ranges, runs one headless
+ * game process per range and merges their keypoint and dense vertex streams into the output a single process would write.
+ *
+ * UnrealEditor-Cmd Project.uproject -run=ShardedCapture -Map=/Game/Maps/Capture -Frames=216000
+ *   [-Processes=8] [-FPS=60] [-Seed=0] [-ShardRun=SkeletonCapture] [-Resume] [-MergeOnly]
+ *   [-KinematicsFilter=SavitzkyGolay] [-KinematicsHalfWindow=3] [-JerkFlagThreshold=200000]
+ * Shards write to Saved/KeypointStreams/<ShardRun>/Shard_<i>/; the merged streams and their frame index
+ * (KeypointStreams.ejli) go to Saved/KeypointStreams/<ShardRun>/Merged/, with the Kinematics/ and QA/ outputs
+ * merged into Merged/Kinematics/ and Merged/QA/. Every shard (and every resume) restarts the kinematics estimator,
+ * so the derivative frames it could not evaluate at those boundaries are recomputed from the merged positions with
+ * the -Kinematics* settings, which must match the extractors' (the defaults are USkeletalExtractor's); the jerk
+ * flags are then re-evaluated over the merged jerk stream with the threshold recorded in the shards' reports, or
+ * -JerkFlagThreshold if no shard flagged a frame. The run's split is recorded in
+ * Saved/KeypointStreams/<ShardRun>/Shards.json. -MergeOnly skips the capture and merges the shards already on disk;
+ * it fails if a shard of the recorded split or one of its streams is missing. -Resume restarts the shards of an
+ * interrupted run from their checkpoints (see ASkeletonCaptureDriver) instead of deleting them. -Processes defaults
+ * to the number of physical cores.
+ */
+UCLASS()
+class EXTRACTJOINTLOCATION_API UShardedCaptureCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UShardedCaptureCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	// Starts one capture process per shard and waits for all of them
+	bool RunShards(const FString& MapName, int32 NumFrames, int32 NumProcesses, float FrameRate, int32 Seed, bool bResume) const;
+
+	// Records the number of shards and frames of the run, which MergeShards checks the shard folders against
+	bool WriteShardManifest(int32 NumProcesses, int32 NumFrames) const;
+
+	// Concatenates every stream found in the shard folders, checking headers match and frames are contiguous
+	bool MergeShards() const;
+	bool MergeStream(const FString& StreamFileName, const TArray<FString>& ShardDirectories, int32 NumFrames, const FString& MergedDirectory, FCaptureIndexBuilder& IndexBuilder) const;
+
+	// Same for a dense vertex stream (.kdv), whose frames are written every DenseVertexFrameInterval frames
+	bool MergeVertexStream(const FString& StreamFileName, const TArray<FString>& ShardDirectories, int32 NumFrames, const FString& MergedDirectory, FCaptureIndexBuilder& IndexBuilder) const;
+
+	// Merges the velocity, acceleration and jerk streams of a merged keypoint stream, filling the frames missing at
+	// shard and resume boundaries, and writes its jerk flag report
+	bool MergeKinematics(const FString& StreamFileName, const TArray<FString>& ShardDirectories, const FString& MergedDirectory) const;
+
+	// Sums the bone length QA reports of the shards into one report
+	bool MergeBoneLengthReport(const FString& ReportFileName, const TArray<FString>& ShardDirectories, const FString& MergedDirectory) const;
+
+	FString RunName;
+	FString RunDirectory;
+
+	EKinematicsFilter KinematicsFilter;
+	int32 KinematicsHalfWindow;
+	float JerkFlagThreshold;
+};
@@ -0,0 +1,168 @@
+#include "SharedFrameRing.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+
+#if PLATFORM_UNIX || PLATFORM_MAC
+#include <cerrno>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+DEFINE_LOG_CATEGORY_STATIC(LogSharedFrameRing, Log, All);
+
+FSharedFrameRingWriter::~FSharedFrameRingWriter()
+{
+	Close();
+}
+
+bool FSharedFrameRingWriter::Open(const FString& InSegmentName, uint32 SlotCount, uint64 SlotPayloadBytes, SharedFrameRing::EBackPressure BackPressure)
+{
+	Close();
+
+#if PLATFORM_UNIX || PLATFORM_MAC
+	using namespace SharedFrameRing;
+
+	SegmentName = InSegmentName.StartsWith(TEXT("/")) ? InSegmentName : TEXT("/") + InSegmentName;
+	const FTCHARToUTF8 ShmName(*SegmentName);
+	const uint64 SegmentSize = GetSegmentSize(SlotCount, SlotPayloadBytes);
+
+	// A segment left behind by a crashed run would carry its sequences over
+	shm_unlink(ShmName.Get());
+	const int FileDescriptor = shm_open(ShmName.Get(), O_CREAT | O_EXCL | O_RDWR, 0600);
+	if (FileDescriptor < 0)
+	{
+		UE_LOG(LogSharedFrameRing, Error, TEXT("Open: shm_open(%s) failed with errno %d."), *SegmentName, errno);
+		return false;
+	}
+	if (ftruncate(FileDescriptor, static_cast<off_t>(SegmentSize)) != 0)
+	{
+		UE_LOG(LogSharedFrameRing, Error, TEXT("Open: Failed to size %s to %llu bytes, errno %d."), *SegmentName, SegmentSize, errno);
+		close(FileDescriptor);
+		shm_unlink(ShmName.Get());
+		return false;
+	}
+	void* Mapping = mmap(nullptr, SegmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, FileDescriptor, 0);
+	close(FileDescriptor);
+	if (Mapping == MAP_FAILED)
+	{
+		UE_LOG(LogSharedFrameRing, Error, TEXT("Open: mmap of %s failed with errno %d."), *SegmentName, errno);
+		shm_unlink(ShmName.Get());
+		return false;
+	}
+
+	// The segment is zero-filled; the magic is written last so a consumer never sees a half-initialized header
+	Header = new (Mapping) FRingHeader();
+	Header->Version = Version;
+	Header->SlotCount = SlotCount;
+	Header->BackPressure = static_cast<uint32_t>(BackPressure);
+	Header->SlotStride = GetSlotStride(SlotPayloadBytes);
+	Header->SlotPayloadBytes = SlotPayloadBytes;
+	Header->SlotsOffset = AlignUp(sizeof(FRingHeader), Alignment);
+	Header->ProducerPid.store(FPlatformProcess::GetCurrentProcessId(), std::memory_order_relaxed);
+	Header->ConsumerPid.store(0, std::memory_order_relaxed);
+	Header->DroppedFrames.store(0, std::memory_order_relaxed);
+	Header->WriteSequence.store(0, std::memory_order_relaxed);
+	Header->ReadSequence.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	Header->Magic = Magic;
+	MappingSize = SegmentSize;
+
+	UE_LOG(LogSharedFrameRing, Log, TEXT("Open: Created %s with %u slots of %llu bytes (%.1f MB)."), *SegmentName, SlotCount, SlotPayloadBytes, SegmentSize / (1024.0 * 1024.0));
+	return true;
+#else
+	UE_LOG(LogSharedFrameRing, Error, TEXT("Open: Shared memory frame rings need POSIX shared memory, which this platform does not provide."));
+	return false;
+#endif
+}
+
+void FSharedFrameRingWriter::Close()
+{
+#if PLATFORM_UNIX || PLATFORM_MAC
+	if (Header)
+	{
+		UE_LOG(LogSharedFrameRing, Log, TEXT("Close: %s published %llu frames, dropped %llu."),
+			*SegmentName, Header->WriteSequence.load(std::memory_order_relaxed), Header->DroppedFrames.load(std::memory_order_relaxed));
+		Header->ProducerPid.store(0, std::memory_order_release);
+		munmap(Header, MappingSize);
+		shm_unlink(TCHAR_TO_UTF8(*SegmentName));
+	}
+#endif
+	Header = nullptr;
+	MappingSize = 0;
+	bFramePending = false;
+}
+
+SharedFrameRing::FSlotHeader* FSharedFrameRingWriter::BeginFrame(double BlockTimeoutSeconds)
+{
+	using namespace SharedFrameRing;
+	if (!Header)
+	{
+		return nullptr;
+	}
+	check(!bFramePending);
+
+	const uint64 Sequence = Header->WriteSequence.load(std::memory_order_relaxed);
+	auto HasFreeSlot = [this, Sequence]() { return Sequence - Header->ReadSequence.load(std::memory_order_acquire) < Header->SlotCount; };
+	if (!HasFreeSlot())
+	{
+		bool bFreed = false;
+		if (Header->BackPressure == static_cast<uint32_t>(EBackPressure::Block))
+		{
+			const double Deadline = FPlatformTime::Seconds() + BlockTimeoutSeconds;
+			while (IsConsumerAttached() && FPlatformTime::Seconds() < Deadline)
+			{
+				FPlatformProcess::SleepNoStats(0.0002f);
+				if (HasFreeSlot())
+				{
+					bFreed = true;
+					break;
+				}
+			}
+		}
+		if (!bFreed)
+		{
+			Header->DroppedFrames.fetch_add(1, std::memory_order_relaxed);
+			return nullptr;
+		}
+	}
+
+	PendingSequence = Sequence;
+	bFramePending = true;
+	FSlotHeader* Slot = reinterpret_cast<FSlotHeader*>(reinterpret_cast<uint8*>(Header) + Header->SlotsOffset + (Sequence % Header->SlotCount) * Header->SlotStride);
+	Slot->Sequence = Sequence;
+	return Slot;
+}
+
+bool FSharedFrameRingWriter::IsConsumerAttached() const
+{
+	if (!Header)
+	{
+		return false;
+	}
+	uint32_t ConsumerPid = Header->ConsumerPid.load(std::memory_order_relaxed);
+	if (ConsumerPid == 0)
+	{
+		return false;
+	}
+
+#if PLATFORM_UNIX || PLATFORM_MAC
+	// A consumer that crashed never detached; blocking on it would stall every frame until the timeout
+	if (kill(static_cast<pid_t>(ConsumerPid), 0) != 0 && errno == ESRCH)
+	{
+		Header->ConsumerPid.compare_exchange_strong(ConsumerPid, 0, std::memory_order_relaxed);
+		return false;
+	}
+#endif
+	return true;
+}
+
+void FSharedFrameRingWriter::EndFrame()
+{
+	if (Header && bFramePending)
+	{
+		Header->WriteSequence.store(PendingSequence + 1, std::memory_order_release);
+		bFramePending = false;
+	}
+}
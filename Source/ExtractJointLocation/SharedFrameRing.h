@@ -0,0 +1,46 @@
+// SharedFrameRing.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SharedFrameRingProtocol.h"
+
+/**
+ * Producer side of the shared-memory frame ring (see SharedFrameRingProtocol.h), backed by a POSIX shared memory
+ * object /<SegmentName>. Frames are written straight into the mapped slots, so a consumer reads them without a copy.
+ * Only available on Linux and Mac; Open fails elsewhere.
+ */
+class EXTRACTJOINTLOCATION_API FSharedFrameRingWriter
+{
+public:
+	~FSharedFrameRingWriter();
+
+	/** Creates (replacing a stale one) and maps the segment. */
+	bool Open(const FString& InSegmentName, uint32 SlotCount, uint64 SlotPayloadBytes, SharedFrameRing::EBackPressure BackPressure);
+	/** Marks the producer as gone and removes the segment; attached consumers keep their mapping until they detach. */
+	void Close();
+	bool IsOpen() const { return Header != nullptr; }
+
+	/**
+	 * Reserves the next slot. With EBackPressure::Block this waits up to BlockTimeoutSeconds for the consumer to release
+	 * a slot, unless no consumer is attached.
+	 * @return The slot to fill, or null if the frame is dropped.
+	 */
+	SharedFrameRing::FSlotHeader* BeginFrame(double BlockTimeoutSeconds);
+	/** Payload of the slot returned by BeginFrame, GetSlotPayloadBytes() long. */
+	uint8* GetSlotPayload(SharedFrameRing::FSlotHeader* Slot) const { return reinterpret_cast<uint8*>(Slot) + sizeof(SharedFrameRing::FSlotHeader); }
+	uint64 GetSlotPayloadBytes() const { return Header ? Header->SlotPayloadBytes : 0; }
+	/** Publishes the slot returned by BeginFrame to the consumer. */
+	void EndFrame();
+
+	uint64 GetDroppedFrames() const { return Header ? Header->DroppedFrames.load(std::memory_order_relaxed) : 0; }
+	/** True if a consumer registered its PID and that process is still alive; the PID of a dead consumer is cleared. */
+	bool IsConsumerAttached() const;
+
+private:
+	SharedFrameRing::FRingHeader* Header = nullptr;
+	uint64 MappingSize = 0;
+	FString SegmentName;
+	// Sequence of the slot between BeginFrame and EndFrame
+	uint64 PendingSequence = 0;
+	bool bFramePending = false;
+};
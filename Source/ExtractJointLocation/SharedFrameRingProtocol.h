@@ -0,0 +1,118 @@
+// SharedFrameRingProtocol.h
+#pragma once
+
+// Layout of the shared-memory frame ring written by FSharedFrameRingWriter and read by consumers outside the engine
+// (Tools/SharedFrameConsumer). Plain C++ so both sides include the same definitions.
+//
+// Segment: [FRingHeader][slot 0][slot 1]...[slot SlotCount - 1], slot i at SlotsOffset + i * SlotStride.
+// Slot:    [FSlotHeader][BGRA8 pixels][FSubjectEntry x NumSubjects][FKeypoint x NumKeypoints], offsets from the slot start.
+//
+// Single producer, single consumer. Frame N (counting from 0) lives in slot N % SlotCount. The producer writes the slot,
+// then stores WriteSequence = N + 1 (release); the consumer reads slots below WriteSequence in place and stores
+// ReadSequence = N + 1 (release) when it is done with frame N. The producer only reuses a slot once ReadSequence has
+// passed it: with EBackPressure::Block it waits for the consumer, with EBackPressure::Drop it drops the new frame.
+
+#include <atomic>
+#include <cstdint>
+
+namespace SharedFrameRing
+{
+	static constexpr uint32_t Magic = 0x52464B53; // "SKFR"
+	static constexpr uint32_t Version = 1;
+	static constexpr uint32_t NameLength = 64;
+	static constexpr uint64_t Alignment = 64;
+
+	enum class EBackPressure : uint32_t
+	{
+		Block = 0,
+		Drop = 1
+	};
+
+	enum class EPixelFormat : uint32_t
+	{
+		BGRA8 = 0
+	};
+
+	enum EKeypointFlags : uint32_t
+	{
+		KeypointInFront = 1 << 0,
+		KeypointInImage = 1 << 1
+	};
+
+	struct alignas(64) FRingHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t SlotCount;
+		uint32_t BackPressure;
+		uint64_t SlotStride;
+		uint64_t SlotPayloadBytes;
+		uint64_t SlotsOffset;
+		// Process ids of the two sides, 0 when detached; a blocking producer drops frames while no consumer is attached
+		std::atomic<uint32_t> ProducerPid;
+		std::atomic<uint32_t> ConsumerPid;
+		std::atomic<uint64_t> DroppedFrames;
+
+		// On their own cache lines, each is written by one side only
+		alignas(64) std::atomic<uint64_t> WriteSequence;
+		alignas(64) std::atomic<uint64_t> ReadSequence;
+	};
+
+	// A subject's keypoints are Keypoints[FirstKeypoint .. FirstKeypoint + NumKeypoints - 1], in the joint order of its
+	// keypoint stream (see <Segment>_Subjects.json next to the capture output)
+	struct FSubjectEntry
+	{
+		char Name[NameLength];
+		uint32_t FirstKeypoint;
+		uint32_t NumKeypoints;
+	};
+
+	// Ground-truth keypoint in world space (cm) and its pinhole projection into the slot's image (pixels)
+	struct FKeypoint
+	{
+		float X;
+		float Y;
+		float Z;
+		float U;
+		float V;
+		uint32_t Flags;
+	};
+
+	struct alignas(64) FSlotHeader
+	{
+		uint64_t Sequence;
+		char CameraName[NameLength];
+		int32_t FrameIndex;
+		float TimeSeconds;
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t RowPitch;
+		uint32_t PixelFormat;
+		float FocalLengthX;
+		float FocalLengthY;
+		float PrincipalPointX;
+		float PrincipalPointY;
+		uint32_t NumSubjects;
+		uint32_t NumKeypoints;
+		uint64_t ImageOffset;
+		uint64_t SubjectsOffset;
+		uint64_t KeypointsOffset;
+	};
+
+	static_assert(std::atomic<uint64_t>::is_always_lock_free, "Ring sequences must be lock-free to be shared between processes");
+
+	inline uint64_t AlignUp(uint64_t Value, uint64_t To)
+	{
+		return (Value + To - 1) / To * To;
+	}
+
+	inline uint64_t GetSlotStride(uint64_t SlotPayloadBytes)
+	{
+		return AlignUp(sizeof(FSlotHeader) + SlotPayloadBytes, Alignment);
+	}
+
+	inline uint64_t GetSegmentSize(uint32_t SlotCount, uint64_t SlotPayloadBytes)
+	{
+		return AlignUp(sizeof(FRingHeader), Alignment) + SlotCount * GetSlotStride(SlotPayloadBytes);
+	}
+}
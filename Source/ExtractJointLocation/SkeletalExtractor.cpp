@@ -9,6 +9,12 @@
 #include "Misc/FileHelper.h"
 #include "HAL/PlatformFileManager.h"
 #include "Serialization/Archive.h"
+#include "CaptureOutputSubsystem.h"
+#include "JointProximitySubsystem.h"
+#include "SubjectVisibilitySubsystem.h"
+#include "LiveFrameStreamSubsystem.h"
+#include "KeypointNetworkSubsystem.h"
+#include "SubjectCropSubsystem.h"
 
 // Sets default values for this component's properties
 USkeletalExtractor::USkeletalExtractor()
@@ -26,6 +32,41 @@ USkeletalExtractor::USkeletalExtractor()
 	// NEW: Initialize JSON properties
 	bWriteToJsonFile = true;
 	JsonFileNameBase = "BoneLocations.json";
+	bWriteToContainer = false;
+
+	// Streaming is opt-in; the quantized encoding defaults to a 0.1 mm error bound
+	bStreamKeypoints = false;
+	StreamEncoding = EKeypointStreamEncoding::QuantizedDelta;
+	QuantizationMaxError = 0.01f;
+	KeyframeInterval = 120;
+	StreamFrameIndex = 0;
+	bRenderFreeCapture = false;
+	bExplicitFrameClock = false;
+	ExplicitFrameTime = 0.0f;
+	bResumeFailed = false;
+
+	// Savitzky-Golay over 7 frames; at 60 fps quantization noise stays far below the flagging threshold
+	bStreamKinematics = false;
+	KinematicsFilter = EKinematicsFilter::SavitzkyGolay;
+	KinematicsHalfWindow = 3;
+	JerkFlagThreshold = 200000.0f;
+
+	// Opt-in: animation that scales or translates bones on purpose shows up as outliers
+	bCheckBoneLengths = false;
+	BoneLengthTolerance = 0.05f;
+	MinCheckedBoneLength = 0.5f;
+	bCheckFaceBoneLengths = false;
+
+	// A 25k vertex body is ~150 KB per frame, so dense export is opt-in
+	bStreamDenseVertices = false;
+	DenseVertexEncoding = EDenseVertexEncoding::Quantized16;
+	DenseVertexFrameInterval = 1;
+
+	bReportContacts = false;
+	bReportCameraVisibility = false;
+	bPublishLiveKeypoints = false;
+	bExportSubjectCrops = false;
+	bStreamKeypointsToNetwork = false;
 }
 
 // Called when the game starts
@@ -108,6 +149,16 @@ void USkeletalExtractor::BeginPlay()
 			UpperBodyKeypointsToDraw = GetUpperBodyKeypointsToExtract();
 			LowerBodyKeypointsToDraw = GetLowerBodyKeypointsToExtract(); // Assuming you want to draw these
 
+			if (bStreamKeypoints)
+			{
+				OpenKeypointStreams();
+			}
+			else if (bReportContacts || bReportCameraVisibility || bPublishLiveKeypoints || bExportSubjectCrops || bStreamKeypointsToNetwork)
+			{
+				// Submissions piggyback on the streamed frames; a take started later through BeginTake still enables them
+				UE_LOG(LogTemp, Warning, TEXT("SkeletalExtractor: %s reports keypoints to subsystems but does not stream them; nothing is submitted until bStreamKeypoints is set or a take begins."), *OwnerActorName);
+			}
+
 			if (!BodySkeletalMesh && !FaceSkeletalMesh) // Add LowerLimbSkeletalMesh check here if applicable
 			{
 				UE_LOG(LogTemp, Error, TEXT("SkeletalExtractor: Neither 'Body' nor 'Face' USkeletalMeshComponent instances were found on %s."), *OwnerActorName);
@@ -124,6 +175,12 @@ void USkeletalExtractor::BeginPlay()
 	}
 }
 
+void USkeletalExtractor::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	CloseKeypointStreams();
+	Super::EndPlay(EndPlayReason);
+}
+
 // Called every frame - THIS IS WHERE THE DRAWING WILL HAPPEN
 void USkeletalExtractor::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
 {
@@ -138,6 +195,17 @@ void USkeletalExtractor::TickComponent(float DeltaTime, ELevelTick TickType, FAc
 		return;
 	}
 
+	if (KeypointStreams.Num() > 0)
+	{
+		WriteKeypointStreamFrame();
+	}
+
+	// Nothing is drawn in a render-free capture
+	if (bRenderFreeCapture)
+	{
+		return;
+	}
+
 	// Draw Face Keypoints (Red)
 	if (FaceSkeletalMesh && FaceSkeletalMesh->GetSkeletalMeshAsset())
 	{
@@ -217,6 +285,35 @@ FVector USkeletalExtractor::GetBoneLocationForMeshByName(USkeletalMeshComponent*
 	return FVector::ZeroVector;
 }
 
+void USkeletalExtractor::PrepareForRenderFreeCapture()
+{
+	bRenderFreeCapture = true;
+
+	// Bone transforms must be final for the frame before they are extracted
+	SetTickGroup(TG_PostUpdateWork);
+
+	AActor* OwnerActor = GetOwner();
+	if (!OwnerActor)
+	{
+		return;
+	}
+
+	// Every skeletal mesh of the owner is covered, so this also works before BeginPlay has picked the Body/Face meshes
+	TArray<USkeletalMeshComponent*> SkeletalMeshComponents;
+	OwnerActor->GetComponents<USkeletalMeshComponent>(SkeletalMeshComponents);
+	for (USkeletalMeshComponent* SkeletalMesh : SkeletalMeshComponents)
+	{
+		// Without rendering no mesh is ever visible, so visibility-based tick skipping and update rate
+		// optimisations would otherwise freeze or thin out the pose
+		SkeletalMesh->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones;
+		SkeletalMesh->bEnableUpdateRateOptimizations = false;
+		SkeletalMesh->SetComponentTickEnabled(true);
+		AddTickPrerequisiteComponent(SkeletalMesh);
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("SkeletalExtractor: %s prepared %d skeletal meshes for render-free capture."), *OwnerActor->GetName(), SkeletalMeshComponents.Num());
+}
+
 // Implementation of the new member function to extract and save bone data
 void USkeletalExtractor::ExtractAndSaveMeshBones(USkeletalMeshComponent* SkeletalMesh, const FString& MeshType)
 {
@@ -308,7 +405,7 @@ void USkeletalExtractor::ExtractAndSaveMeshBones(USkeletalMeshComponent* Skeleta
 						PlatformFile.CreateDirectoryTree(*DirectoryPath);
 					}
 
-					if (FFileHelper::SaveStringToFile(SubsetFileContent, *AbsoluteSubsetFilePath))
+					if (WriteOutputFile(SubsetFileContent, AbsoluteSubsetFilePath))
 					{
 						UE_LOG(LogTemp, Log, TEXT("SkeletalExtractor: Successfully saved %s YoloPose keypoint data to text file: %s"), *MeshType, *AbsoluteSubsetFilePath);
 					}
@@ -383,7 +480,7 @@ void USkeletalExtractor::ExtractAndSaveMeshBones(USkeletalMeshComponent* Skeleta
 						PlatformFile.CreateDirectoryTree(*DirectoryPath);
 					}
 
-					if (FFileHelper::SaveStringToFile(SubsetFileContent, *AbsoluteSubsetFilePath))
+					if (WriteOutputFile(SubsetFileContent, AbsoluteSubsetFilePath))
 					{
 						UE_LOG(LogTemp, Log, TEXT("SkeletalExtractor: Successfully saved %s YoloPose upper body keypoint data to text file: %s"), *MeshType, *AbsoluteSubsetFilePath);
 					}
@@ -411,7 +508,7 @@ void USkeletalExtractor::ExtractAndSaveMeshBones(USkeletalMeshComponent* Skeleta
 						PlatformFile.CreateDirectoryTree(*FPaths::GetPath(AbsoluteLowerBodySubsetFilePath));
 					}
 
-					if (FFileHelper::SaveStringToFile(LowerBodySubsetFileContent, *AbsoluteLowerBodySubsetFilePath))
+					if (WriteOutputFile(LowerBodySubsetFileContent, AbsoluteLowerBodySubsetFilePath))
 					{
 						UE_LOG(LogTemp, Log, TEXT("SkeletalExtractor: Successfully saved %s YoloPose lower body keypoint data to text file: %s"), *MeshType, *AbsoluteLowerBodySubsetFilePath);
 					}
@@ -453,6 +550,27 @@ void USkeletalExtractor::ExtractAndSaveMeshBones(USkeletalMeshComponent* Skeleta
 	}
 }
 
+bool USkeletalExtractor::WriteOutputFile(const FString& Content, const FString& AbsoluteFilePath)
+{
+	UCaptureOutputSubsystem* CaptureOutput = GetWorld() ? GetWorld()->GetSubsystem<UCaptureOutputSubsystem>() : nullptr;
+	FString ActorName = GetOwner() ? GetOwner()->GetName() : TEXT("UnknownActor");
+
+	if (bWriteToContainer)
+	{
+		return CaptureOutput && CaptureOutput->WriteTextRecord(UCaptureOutputSubsystem::MakeRecordName(AbsoluteFilePath), Content, ECaptureIndexKind::Skeleton, ActorName, FString());
+	}
+
+	if (!FFileHelper::SaveStringToFile(Content, *AbsoluteFilePath))
+	{
+		return false;
+	}
+	if (CaptureOutput)
+	{
+		CaptureOutput->IndexFile(ECaptureIndexKind::Skeleton, ActorName, FString(), AbsoluteFilePath);
+	}
+	return true;
+}
+
 // This function is now specifically for saving a generic set of bone data,
 // with filename control happening in ExtractAndSaveMeshBones for distinct files.
 void USkeletalExtractor::SaveBoneDataToTextFile(const TArray<FName>& BoneNames, const TArray<FVector>& BoneLocations, const FString& MeshType, const FString& SubFolder)
@@ -498,7 +616,7 @@ void USkeletalExtractor::SaveBoneDataToTextFile(const TArray<FName>& BoneNames,
 		PlatformFile.CreateDirectoryTree(*DirectoryPath);
 	}
 
-	if (FFileHelper::SaveStringToFile(FileContent, *AbsoluteFilePath))
+	if (WriteOutputFile(FileContent, AbsoluteFilePath))
 	{
 		UE_LOG(LogTemp, Log, TEXT("SkeletalExtractor: Successfully saved %s bone data to text file: %s"), *MeshType, *AbsoluteFilePath);
 	}
@@ -577,7 +695,7 @@ void USkeletalExtractor::SaveBoneDataToJsonFile(const TArray<FName>& BoneNames,
 		PlatformFile.CreateDirectoryTree(*DirectoryPath);
 	}
 
-	if (FFileHelper::SaveStringToFile(OutputString, *AbsoluteFilePath))
+	if (WriteOutputFile(OutputString, AbsoluteFilePath))
 	{
 		UE_LOG(LogTemp, Log, TEXT("SkeletalExtractor: Successfully saved %s bone data to JSON file: %s"), *MeshType, *AbsoluteFilePath);
 	}
@@ -587,6 +705,586 @@ void USkeletalExtractor::SaveBoneDataToJsonFile(const TArray<FName>& BoneNames,
 	}
 }
 
+void USkeletalExtractor::OpenKeypointStreams()
+{
+	CloseKeypointStreams();
+	StreamFrameIndex = 0;
+
+	StreamMarkers = VirtualMarkers;
+	if (!VirtualMarkerFile.IsEmpty())
+	{
+		FVirtualMarkerSkinner::LoadMarkersFromFile(VirtualMarkerFile, StreamMarkers);
+	}
+
+	if (BodySkeletalMesh)
+	{
+		TArray<FName> BodyKeypoints = GetUpperBodyKeypointsToExtract();
+		BodyKeypoints.Append(GetLowerBodyKeypointsToExtract());
+		OpenKeypointStream(BodySkeletalMesh, TEXT("Body"), BodyKeypoints);
+	}
+	if (FaceSkeletalMesh)
+	{
+		OpenKeypointStream(FaceSkeletalMesh, TEXT("Face"), GetFaceKeypointsToExtract());
+	}
+	OpenJointRegressorStreams();
+}
+
+void USkeletalExtractor::OpenKeypointStream(USkeletalMeshComponent* SkeletalMesh, const FString& MeshType, const TArray<FName>& Keypoints)
+{
+	FMeshKeypointStream Stream;
+	Stream.SkeletalMesh = SkeletalMesh;
+
+	// Resolve bone indices once; unknown bones are dropped so every frame has the same joint layout
+	TArray<FName> StreamedKeypoints;
+	for (const FName& KeypointName : Keypoints)
+	{
+		const int32 BoneIndex = SkeletalMesh->GetBoneIndex(KeypointName);
+		if (BoneIndex == INDEX_NONE)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("SkeletalExtractor: Bone '%s' not found on %s mesh, it will not be streamed."), *KeypointName.ToString(), *MeshType);
+			continue;
+		}
+		StreamedKeypoints.Add(KeypointName);
+		Stream.BoneIndices.Add(BoneIndex);
+	}
+
+	if (StreamedKeypoints.Num() == 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("SkeletalExtractor: No streamable keypoints on %s mesh."), *MeshType);
+		return;
+	}
+
+	FString ActorName = GetOwner() ? GetOwner()->GetName() : TEXT("UnknownActor");
+	FString StreamFileName = FString::Printf(TEXT("%s_%s.kps"), *ActorName, *MeshType);
+	FString AbsoluteFilePath = CurrentTakeName.IsEmpty() ?
+		FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("KeypointStreams"), StreamFileName) :
+		FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("KeypointStreams"), CurrentTakeName, StreamFileName);
+
+	Stream.Writer = MakeUnique<FKeypointStreamWriter>(StreamEncoding, StreamedKeypoints, QuantizationMaxError, KeyframeInterval);
+	if (!OpenStreamWriter(*Stream.Writer, AbsoluteFilePath))
+	{
+		return;
+	}
+	UE_LOG(LogTemp, Log, TEXT("SkeletalExtractor: Streaming %d %s keypoints to %s"), StreamedKeypoints.Num(), *MeshType, *AbsoluteFilePath);
+
+	if (bStreamKinematics)
+	{
+		// Derivatives span a much larger range than positions, so they are stored as raw floats
+		static const TCHAR* ChannelNames[] = { TEXT("Velocity"), TEXT("Acceleration"), TEXT("Jerk") };
+		Stream.Kinematics = MakeUnique<FKinematicsEstimator>(KinematicsFilter, StreamedKeypoints.Num(), KinematicsHalfWindow);
+		for (int32 Channel = 0; Channel < UE_ARRAY_COUNT(ChannelNames); ++Channel)
+		{
+			const FString ChannelFilePath = FPaths::Combine(FPaths::GetPath(AbsoluteFilePath), TEXT("Kinematics"),
+				FString::Printf(TEXT("%s_%s_%s.kps"), *ActorName, *MeshType, ChannelNames[Channel]));
+			Stream.DerivativeWriters[Channel] = MakeUnique<FKeypointStreamWriter>(EKeypointStreamEncoding::RawFloat, StreamedKeypoints, QuantizationMaxError, KeyframeInterval);
+			if (!OpenStreamWriter(*Stream.DerivativeWriters[Channel], ChannelFilePath))
+			{
+				Stream.DerivativeWriters[Channel].Reset();
+			}
+		}
+		UE_LOG(LogTemp, Log, TEXT("SkeletalExtractor: Streaming %s keypoint kinematics with a latency of %d frames."), *MeshType, Stream.Kinematics->GetLatency());
+	}
+
+	if (bCheckBoneLengths && (MeshType != TEXT("Face") || bCheckFaceBoneLengths) && SkeletalMesh->GetSkeletalMeshAsset())
+	{
+		Stream.BoneLengthChecker = MakeUnique<FBoneLengthChecker>(SkeletalMesh->GetSkeletalMeshAsset()->GetRefSkeleton(), Stream.BoneIndices, BoneLengthTolerance, MinCheckedBoneLength);
+	}
+
+	const TArray<FVirtualMarker> MeshMarkers = StreamMarkers.FilterByPredicate([&MeshType](const FVirtualMarker& Marker) { return Marker.Mesh == MeshType; });
+	if (MeshMarkers.Num() > 0)
+	{
+		Stream.MarkerSkinner = MakeUnique<FVirtualMarkerSkinner>();
+		if (Stream.MarkerSkinner->Initialize(SkeletalMesh->GetSkeletalMeshAsset(), MeshMarkers))
+		{
+			const FString MarkerFilePath = FPaths::Combine(FPaths::GetPath(AbsoluteFilePath), FString::Printf(TEXT("%s_%s_Markers.kps"), *ActorName, *MeshType));
+			Stream.MarkerWriter = MakeUnique<FKeypointStreamWriter>(StreamEncoding, Stream.MarkerSkinner->GetMarkerNames(), QuantizationMaxError, KeyframeInterval);
+			if (OpenStreamWriter(*Stream.MarkerWriter, MarkerFilePath))
+			{
+				UE_LOG(LogTemp, Log, TEXT("SkeletalExtractor: Streaming %d %s virtual markers to %s"), Stream.MarkerSkinner->GetMarkerNames().Num(), *MeshType, *MarkerFilePath);
+			}
+			else
+			{
+				Stream.MarkerWriter.Reset();
+			}
+		}
+		if (!Stream.MarkerWriter)
+		{
+			Stream.MarkerSkinner.Reset();
+		}
+	}
+
+	if (bStreamDenseVertices && MeshType == TEXT("Body"))
+	{
+		const FString VertexFilePath = FPaths::Combine(FPaths::GetPath(AbsoluteFilePath), FString::Printf(TEXT("%s_%s_Vertices.kdv"), *ActorName, *MeshType));
+		const int64* ResumeSize = ResumeStreamSizes.Find(FPaths::ConvertRelativePathToFull(VertexFilePath));
+		Stream.DenseVertexWriter = MakeUnique<FDenseVertexStreamWriter>(DenseVertexEncoding);
+		const bool bOpened = ResumeSize ? Stream.DenseVertexWriter->OpenForResume(SkeletalMesh->GetSkeletalMeshAsset(), VertexFilePath, *ResumeSize)
+			: Stream.DenseVertexWriter->Open(SkeletalMesh->GetSkeletalMeshAsset(), VertexFilePath);
+		if (!bOpened)
+		{
+			bResumeFailed |= ResumeSize != nullptr;
+			Stream.DenseVertexWriter.Reset();
+		}
+	}
+
+	Stream.MeshType = MeshType;
+	Stream.JointNames = MoveTemp(StreamedKeypoints);
+	KeypointStreams.Add(MoveTemp(Stream));
+}
+
+bool USkeletalExtractor::OpenStreamWriter(FKeypointStreamWriter& Writer, const FString& FilePath)
+{
+	if (const int64* ResumeSize = ResumeStreamSizes.Find(FPaths::ConvertRelativePathToFull(FilePath)))
+	{
+		if (!Writer.OpenForResume(FilePath, *ResumeSize))
+		{
+			bResumeFailed = true;
+			return false;
+		}
+		return true;
+	}
+	return Writer.Open(FilePath);
+}
+
+void USkeletalExtractor::WriteKeypointStreamFrame()
+{
+	const float TimeSeconds = bExplicitFrameClock ? ExplicitFrameTime : GetWorld()->GetTimeSeconds();
+	UCaptureOutputSubsystem* CaptureOutput = GetWorld()->GetSubsystem<UCaptureOutputSubsystem>();
+	FString ActorName = GetOwner() ? GetOwner()->GetName() : TEXT("UnknownActor");
+
+	for (FMeshKeypointStream& Stream : KeypointStreams)
+	{
+		if (!Stream.SkeletalMesh)
+		{
+			continue;
+		}
+
+		StreamPositionScratch.SetNumUninitialized(Stream.BoneIndices.Num());
+		for (int32 i = 0; i < Stream.BoneIndices.Num(); ++i)
+		{
+			StreamPositionScratch[i] = Stream.SkeletalMesh->GetBoneTransform(Stream.BoneIndices[i]).GetLocation();
+		}
+
+		if (bReportContacts && Stream.MeshType == TEXT("Body"))
+		{
+			if (UJointProximitySubsystem* Proximity = GetWorld()->GetSubsystem<UJointProximitySubsystem>())
+			{
+				Proximity->UpdateSubject(this, ActorName, StreamFrameIndex, TimeSeconds, Stream.JointNames, StreamPositionScratch);
+			}
+		}
+
+		if (bReportCameraVisibility && Stream.MeshType == TEXT("Body"))
+		{
+			if (USubjectVisibilitySubsystem* SubjectVisibility = GetWorld()->GetSubsystem<USubjectVisibilitySubsystem>())
+			{
+				SubjectVisibility->UpdateSubject(this, ActorName, Stream.SkeletalMesh, StreamPositionScratch);
+			}
+		}
+
+		if (bPublishLiveKeypoints && Stream.MeshType == TEXT("Body"))
+		{
+			if (ULiveFrameStreamSubsystem* LiveStream = GetWorld()->GetSubsystem<ULiveFrameStreamSubsystem>())
+			{
+				LiveStream->SubmitSubjectKeypoints(this, ActorName, StreamFrameIndex, Stream.JointNames, StreamPositionScratch);
+			}
+		}
+
+		if (bExportSubjectCrops && Stream.MeshType == TEXT("Body"))
+		{
+			if (USubjectCropSubsystem* SubjectCrops = GetWorld()->GetSubsystem<USubjectCropSubsystem>())
+			{
+				SubjectCrops->SubmitSubjectKeypoints(this, ActorName, StreamFrameIndex, StreamPositionScratch);
+			}
+		}
+
+		if (bStreamKeypointsToNetwork && Stream.MeshType == TEXT("Body"))
+		{
+			if (UKeypointNetworkSubsystem* NetworkStream = GetWorld()->GetSubsystem<UKeypointNetworkSubsystem>())
+			{
+				NetworkStream->SubmitSubjectKeypoints(this, ActorName, StreamFrameIndex, TimeSeconds, Stream.JointNames, StreamPositionScratch);
+			}
+		}
+
+		// Index the frame from its keyframe on so loaders can seek to it and decode it without the rest of the stream
+		if (Stream.Writer->WriteFrame(StreamFrameIndex, TimeSeconds, StreamPositionScratch) && CaptureOutput)
+		{
+			IndexStreamFrame(*CaptureOutput, *Stream.Writer, ActorName, Stream.MeshType);
+		}
+
+		if (Stream.MarkerSkinner && Stream.MarkerSkinner->Evaluate(Stream.SkeletalMesh, Stream.MarkerPositions))
+		{
+			if (Stream.MarkerWriter->WriteFrame(StreamFrameIndex, TimeSeconds, Stream.MarkerPositions) && CaptureOutput)
+			{
+				IndexStreamFrame(*CaptureOutput, *Stream.MarkerWriter, ActorName, Stream.MeshType + TEXT("_Markers"));
+			}
+		}
+
+		// Skinning runs on worker threads; the frame's offset is known up front because all frames have the same size
+		if (Stream.DenseVertexWriter && StreamFrameIndex % FMath::Max(1, DenseVertexFrameInterval) == 0)
+		{
+			const int64 VertexOffset = Stream.DenseVertexWriter->GetNextFrameOffset();
+			if (Stream.DenseVertexWriter->WriteFrame(StreamFrameIndex, TimeSeconds, Stream.SkeletalMesh) && CaptureOutput)
+			{
+				CaptureOutput->IndexStreamFrame(StreamFrameIndex, ECaptureIndexKind::Skeleton, ActorName, Stream.MeshType + TEXT("_Vertices"), Stream.DenseVertexWriter->GetFilePath(),
+					VertexOffset, Stream.DenseVertexWriter->GetHeader().GetFrameSize(), Stream.DenseVertexWriter->GetHeaderSize());
+			}
+		}
+
+		if (Stream.BoneLengthChecker)
+		{
+			Stream.BoneLengthChecker->CheckFrame(StreamFrameIndex, Stream.SkeletalMesh->GetComponentSpaceTransforms());
+		}
+
+		if (Stream.Kinematics && Stream.Kinematics->AddFrame(StreamFrameIndex, TimeSeconds, StreamPositionScratch))
+		{
+			WriteKinematicsFrame(Stream);
+		}
+	}
+
+	WriteJointRegressorFrame(TimeSeconds, CaptureOutput, ActorName);
+	++StreamFrameIndex;
+}
+
+void USkeletalExtractor::OpenJointRegressorStreams()
+{
+	FString ActorName = GetOwner() ? GetOwner()->GetName() : TEXT("UnknownActor");
+	for (const FString& RegressorFile : JointRegressorFiles)
+	{
+		FJointRegressorStream RegressorStream;
+		if (RegressorFile.IsEmpty() || KeypointStreams.Num() == 0 || !RegressorStream.Regressor.LoadFromFile(RegressorFile))
+		{
+			continue;
+		}
+
+		// Bones are looked up on the Body mesh first, markers on whichever mesh they are attached to
+		bool bAllResolved = true;
+		for (const FJointRegressorSource& Source : RegressorStream.Regressor.GetSources())
+		{
+			int32 SourceStream = INDEX_NONE;
+			int32 SourceIndex = INDEX_NONE;
+			for (int32 StreamIndex = 0; StreamIndex < KeypointStreams.Num() && SourceIndex == INDEX_NONE; ++StreamIndex)
+			{
+				const FMeshKeypointStream& Stream = KeypointStreams[StreamIndex];
+				if (Source.bMarker)
+				{
+					SourceIndex = Stream.MarkerSkinner ? Stream.MarkerSkinner->GetMarkerNames().IndexOfByKey(Source.Name) : INDEX_NONE;
+				}
+				else
+				{
+					SourceIndex = Stream.SkeletalMesh ? Stream.SkeletalMesh->GetBoneIndex(Source.Name) : INDEX_NONE;
+				}
+				SourceStream = StreamIndex;
+			}
+			if (SourceIndex == INDEX_NONE)
+			{
+				UE_LOG(LogTemp, Error, TEXT("SkeletalExtractor: %s '%s' of joint regressor %s is not streamed."),
+					Source.bMarker ? TEXT("Marker") : TEXT("Bone"), *Source.Name.ToString(), *RegressorFile);
+				bAllResolved = false;
+				continue;
+			}
+			RegressorStream.SourceStreams.Add(SourceStream);
+			RegressorStream.SourceIndices.Add(SourceIndex);
+		}
+		if (!bAllResolved)
+		{
+			continue;
+		}
+
+		const FString RegressorFilePath = FPaths::Combine(FPaths::GetPath(KeypointStreams[0].Writer->GetFilePath()),
+			FString::Printf(TEXT("%s_%s.kps"), *ActorName, *FPaths::GetBaseFilename(RegressorFile)));
+		RegressorStream.Name = FPaths::GetBaseFilename(RegressorFile);
+		RegressorStream.Writer = MakeUnique<FKeypointStreamWriter>(StreamEncoding, RegressorStream.Regressor.GetJointNames(), QuantizationMaxError, KeyframeInterval);
+		if (!OpenStreamWriter(*RegressorStream.Writer, RegressorFilePath))
+		{
+			continue;
+		}
+		UE_LOG(LogTemp, Log, TEXT("SkeletalExtractor: Streaming %d regressed joints to %s"), RegressorStream.Regressor.GetJointNames().Num(), *RegressorFilePath);
+		RegressorStreams.Add(MoveTemp(RegressorStream));
+	}
+}
+
+void USkeletalExtractor::WriteJointRegressorFrame(float TimeSeconds, UCaptureOutputSubsystem* CaptureOutput, const FString& ActorName)
+{
+	for (FJointRegressorStream& RegressorStream : RegressorStreams)
+	{
+		const TArray<FJointRegressorSource>& Sources = RegressorStream.Regressor.GetSources();
+		RegressorSourceScratch.SetNumUninitialized(Sources.Num());
+		bool bSourcesValid = true;
+		for (int32 SourceIndex = 0; SourceIndex < Sources.Num(); ++SourceIndex)
+		{
+			const FMeshKeypointStream& Stream = KeypointStreams[RegressorStream.SourceStreams[SourceIndex]];
+			const int32 Index = RegressorStream.SourceIndices[SourceIndex];
+			if (Sources[SourceIndex].bMarker)
+			{
+				bSourcesValid &= Stream.MarkerPositions.IsValidIndex(Index);
+				RegressorSourceScratch[SourceIndex] = Stream.MarkerPositions.IsValidIndex(Index) ? Stream.MarkerPositions[Index] : FVector::ZeroVector;
+			}
+			else
+			{
+				RegressorSourceScratch[SourceIndex] = Stream.SkeletalMesh->GetBoneTransform(Index).GetLocation();
+			}
+		}
+		if (!bSourcesValid)
+		{
+			continue;
+		}
+
+		RegressorJointScratch.SetNumUninitialized(RegressorStream.Regressor.GetJointNames().Num());
+		RegressorStream.Regressor.Apply(RegressorSourceScratch, RegressorJointScratch);
+
+		if (RegressorStream.Writer->WriteFrame(StreamFrameIndex, TimeSeconds, RegressorJointScratch) && CaptureOutput)
+		{
+			IndexStreamFrame(*CaptureOutput, *RegressorStream.Writer, ActorName, RegressorStream.Name);
+		}
+	}
+}
+
+void USkeletalExtractor::IndexStreamFrame(UCaptureOutputSubsystem& CaptureOutput, const FKeypointStreamWriter& Writer, const FString& ActorName, const FString& StreamName) const
+{
+	const int64 KeyframeOffset = Writer.GetKeyframeOffset();
+	CaptureOutput.IndexStreamFrame(StreamFrameIndex, ECaptureIndexKind::Skeleton, ActorName, StreamName, Writer.GetFilePath(),
+		KeyframeOffset, Writer.GetBytesWritten() - KeyframeOffset, Writer.GetHeaderSize());
+}
+
+void USkeletalExtractor::WriteKinematicsFrame(FMeshKeypointStream& Stream)
+{
+	const FKinematicsEstimator& Kinematics = *Stream.Kinematics;
+	const TArrayView<const FVector> Channels[] = { Kinematics.GetVelocities(), Kinematics.GetAccelerations(), Kinematics.GetJerks() };
+	for (int32 Channel = 0; Channel < UE_ARRAY_COUNT(Channels); ++Channel)
+	{
+		if (Stream.DerivativeWriters[Channel])
+		{
+			Stream.DerivativeWriters[Channel]->WriteFrame(Kinematics.GetFrameIndex(), Kinematics.GetTimeSeconds(), Channels[Channel]);
+		}
+	}
+
+	if (JerkFlagThreshold <= 0.0f)
+	{
+		return;
+	}
+
+	int32 JointIndex = INDEX_NONE;
+	const double MaxJerk = Kinematics.GetMaxJerk(JointIndex);
+	if (MaxJerk <= JerkFlagThreshold)
+	{
+		return;
+	}
+
+	// Flagged frames are collected and reported once per stream, so glitches can be listed without decoding the streams
+	FMeshKeypointStream::FJerkFlag& Flag = Stream.JerkFlags.AddDefaulted_GetRef();
+	Flag.Frame = Kinematics.GetFrameIndex();
+	Flag.Time = Kinematics.GetTimeSeconds();
+	Flag.JointIndex = JointIndex;
+	Flag.Jerk = MaxJerk;
+}
+
+void USkeletalExtractor::WriteJerkFlagReport(const FMeshKeypointStream& Stream, const FString& ActorName)
+{
+	TSharedPtr<FJsonObject> ReportObject = MakeShareable(new FJsonObject);
+	ReportObject->SetStringField(TEXT("Actor"), ActorName);
+	ReportObject->SetStringField(TEXT("Mesh"), Stream.MeshType);
+	ReportObject->SetNumberField(TEXT("Threshold"), JerkFlagThreshold);
+	ReportObject->SetNumberField(TEXT("NumFlaggedFrames"), Stream.JerkFlags.Num());
+
+	TArray<TSharedPtr<FJsonValue>> FlagArray;
+	FlagArray.Reserve(Stream.JerkFlags.Num());
+	for (const FMeshKeypointStream::FJerkFlag& Flag : Stream.JerkFlags)
+	{
+		TSharedPtr<FJsonObject> FlagObject = MakeShareable(new FJsonObject);
+		FlagObject->SetNumberField(TEXT("Frame"), Flag.Frame);
+		FlagObject->SetNumberField(TEXT("Time"), Flag.Time);
+		FlagObject->SetStringField(TEXT("Joint"), Stream.JointNames[Flag.JointIndex].ToString());
+		FlagObject->SetNumberField(TEXT("Jerk"), Flag.Jerk);
+		FlagArray.Add(MakeShareable(new FJsonValueObject(FlagObject)));
+	}
+	ReportObject->SetArrayField(TEXT("Flags"), FlagArray);
+
+	FString ReportContent;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&ReportContent);
+	FJsonSerializer::Serialize(ReportObject.ToSharedRef(), Writer);
+
+	const FString ReportPath = FPaths::Combine(FPaths::GetPath(Stream.Writer->GetFilePath()), TEXT("Kinematics"),
+		FString::Printf(TEXT("%s_%s_JerkFlags.json"), *ActorName, *Stream.MeshType));
+	if (!WriteOutputFile(ReportContent, ReportPath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("SkeletalExtractor: Failed to write the jerk flags of the %s stream to %s."), *Stream.MeshType, *ReportPath);
+	}
+}
+
+void USkeletalExtractor::BeginTake(const FString& TakeName)
+{
+	CloseKeypointStreams();
+	CurrentTakeName = TakeName;
+
+	// Keypoint lists may not have been set up if BeginPlay found no meshes yet
+	FaceKeypointsToDraw = GetFaceKeypointsToExtract();
+	UpperBodyKeypointsToDraw = GetUpperBodyKeypointsToExtract();
+	LowerBodyKeypointsToDraw = GetLowerBodyKeypointsToExtract();
+
+	OpenKeypointStreams();
+	UE_LOG(LogTemp, Log, TEXT("SkeletalExtractor: Started take '%s' with %d keypoint streams."), *TakeName, KeypointStreams.Num());
+}
+
+void USkeletalExtractor::EndTake()
+{
+	CloseKeypointStreams();
+	CurrentTakeName.Reset();
+}
+
+bool USkeletalExtractor::ResumeTake(const FString& TakeName, const TMap<FString, int64>& StreamSizes)
+{
+	ResumeStreamSizes = StreamSizes;
+	bResumeFailed = false;
+	BeginTake(TakeName);
+	ResumeStreamSizes.Empty();
+	return !bResumeFailed;
+}
+
+bool USkeletalExtractor::SyncKeypointStreams(TMap<FString, int64>& OutStreamSizes)
+{
+	bool bAllSynced = true;
+	for (FMeshKeypointStream& Stream : KeypointStreams)
+	{
+		FKeypointStreamWriter* Writers[] = { Stream.Writer.Get(), Stream.MarkerWriter.Get(), Stream.DerivativeWriters[0].Get(), Stream.DerivativeWriters[1].Get(), Stream.DerivativeWriters[2].Get() };
+		for (FKeypointStreamWriter* Writer : Writers)
+		{
+			if (!Writer)
+			{
+				continue;
+			}
+			if (!Writer->Sync())
+			{
+				UE_LOG(LogTemp, Error, TEXT("SkeletalExtractor: Failed to sync keypoint stream %s"), *Writer->GetFilePath());
+				bAllSynced = false;
+				continue;
+			}
+			OutStreamSizes.Add(FPaths::ConvertRelativePathToFull(Writer->GetFilePath()), Writer->GetBytesWritten());
+		}
+
+		if (Stream.DenseVertexWriter)
+		{
+			if (Stream.DenseVertexWriter->Sync())
+			{
+				OutStreamSizes.Add(FPaths::ConvertRelativePathToFull(Stream.DenseVertexWriter->GetFilePath()), Stream.DenseVertexWriter->GetBytesWritten());
+			}
+			else
+			{
+				UE_LOG(LogTemp, Error, TEXT("SkeletalExtractor: Failed to sync dense vertex stream %s"), *Stream.DenseVertexWriter->GetFilePath());
+				bAllSynced = false;
+			}
+		}
+	}
+	for (FJointRegressorStream& RegressorStream : RegressorStreams)
+	{
+		if (!RegressorStream.Writer->Sync())
+		{
+			UE_LOG(LogTemp, Error, TEXT("SkeletalExtractor: Failed to sync keypoint stream %s"), *RegressorStream.Writer->GetFilePath());
+			bAllSynced = false;
+			continue;
+		}
+		OutStreamSizes.Add(FPaths::ConvertRelativePathToFull(RegressorStream.Writer->GetFilePath()), RegressorStream.Writer->GetBytesWritten());
+	}
+	return bAllSynced;
+}
+
+void USkeletalExtractor::SetCaptureFrame(int32 FrameIndex, float TimeSeconds)
+{
+	bExplicitFrameClock = true;
+	StreamFrameIndex = FrameIndex;
+	ExplicitFrameTime = TimeSeconds;
+}
+
+void USkeletalExtractor::CloseKeypointStreams()
+{
+	for (FMeshKeypointStream& Stream : KeypointStreams)
+	{
+		UE_LOG(LogTemp, Log, TEXT("SkeletalExtractor: Closing keypoint stream %s (%d frames, %lld bytes)."),
+			*Stream.Writer->GetFilePath(), StreamFrameIndex, Stream.Writer->GetBytesWritten());
+		Stream.Writer->Close();
+		if (Stream.MarkerWriter)
+		{
+			Stream.MarkerWriter->Close();
+		}
+		if (Stream.DenseVertexWriter)
+		{
+			Stream.DenseVertexWriter->Close();
+		}
+		for (TUniquePtr<FKeypointStreamWriter>& DerivativeWriter : Stream.DerivativeWriters)
+		{
+			if (DerivativeWriter)
+			{
+				DerivativeWriter->Close();
+			}
+		}
+		if (Stream.BoneLengthChecker && Stream.BoneLengthChecker->GetNumFramesChecked() > 0)
+		{
+			const FString ActorName = GetOwner() ? GetOwner()->GetName() : TEXT("UnknownActor");
+			const FString ReportPath = FPaths::Combine(FPaths::GetPath(Stream.Writer->GetFilePath()), TEXT("QA"),
+				FString::Printf(TEXT("%s_%s_BoneLengths.json"), *ActorName, *Stream.MeshType));
+			Stream.BoneLengthChecker->WriteReport(ReportPath, ActorName, Stream.MeshType);
+			UE_LOG(LogTemp, Log, TEXT("SkeletalExtractor: Bone length QA of %s: %d of %d frames out of tolerance, %.2f us per frame. Report: %s"),
+				*Stream.MeshType, Stream.BoneLengthChecker->GetNumOutlierFrames(), Stream.BoneLengthChecker->GetNumFramesChecked(),
+				Stream.BoneLengthChecker->GetCheckSeconds() * 1.0e6 / Stream.BoneLengthChecker->GetNumFramesChecked(), *ReportPath);
+		}
+		if (Stream.JerkFlags.Num() > 0)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("SkeletalExtractor: %d frames of the %s stream exceeded the jerk threshold of %.0f cm/s^3."),
+				Stream.JerkFlags.Num(), *Stream.MeshType, JerkFlagThreshold);
+			WriteJerkFlagReport(Stream, GetOwner() ? GetOwner()->GetName() : TEXT("UnknownActor"));
+		}
+	}
+	for (FJointRegressorStream& RegressorStream : RegressorStreams)
+	{
+		RegressorStream.Writer->Close();
+	}
+	RegressorStreams.Empty();
+	KeypointStreams.Empty();
+
+	UWorld* World = GetWorld();
+	if (UJointProximitySubsystem* Proximity = World ? World->GetSubsystem<UJointProximitySubsystem>() : nullptr)
+	{
+		Proximity->RemoveSubject(this);
+	}
+	if (USubjectVisibilitySubsystem* SubjectVisibility = World ? World->GetSubsystem<USubjectVisibilitySubsystem>() : nullptr)
+	{
+		SubjectVisibility->RemoveSubject(this);
+	}
+	if (ULiveFrameStreamSubsystem* LiveStream = World ? World->GetSubsystem<ULiveFrameStreamSubsystem>() : nullptr)
+	{
+		LiveStream->RemoveSubject(this);
+	}
+	if (USubjectCropSubsystem* SubjectCrops = World ? World->GetSubsystem<USubjectCropSubsystem>() : nullptr)
+	{
+		SubjectCrops->RemoveSubject(this);
+	}
+	if (UKeypointNetworkSubsystem* NetworkStream = World ? World->GetSubsystem<UKeypointNetworkSubsystem>() : nullptr)
+	{
+		NetworkStream->RemoveSubject(this);
+	}
+}
+
+TArray<FBoneIndexType> USkeletalExtractor::ComputeRequiredBones(const FReferenceSkeleton& RefSkeleton, const TArray<FName>& Keypoints)
+{
+	TBitArray<> IsRequired(false, RefSkeleton.GetNum());
+	for (const FName& KeypointName : Keypoints)
+	{
+		// Walk up to the root, stopping early at a bone another keypoint already pulled in
+		int32 BoneIndex = RefSkeleton.FindBoneIndex(KeypointName);
+		while (BoneIndex != INDEX_NONE && !IsRequired[BoneIndex])
+		{
+			IsRequired[BoneIndex] = true;
+			BoneIndex = RefSkeleton.GetParentIndex(BoneIndex);
+		}
+	}
+
+	// Reference skeleton parents always come before their children, so ascending order is a valid evaluation order
+	TArray<FBoneIndexType> RequiredBones;
+	for (TConstSetBitIterator<> It(IsRequired); It; ++It)
+	{
+		RequiredBones.Add(static_cast<FBoneIndexType>(It.GetIndex()));
+	}
+	return RequiredBones;
+}
 
 // Function to define the specific 17 face keypoints (from previous request)
 TArray<FName> USkeletalExtractor::GetFaceKeypointsToExtract() const
@@ -8,9 +8,17 @@
 #include "Dom/JsonObject.h" // Include for FJsonObject
 #include "Serialization/JsonWriter.h" // Include for TJsonWriter
 #include "Serialization/JsonSerializer.h" // Include for FJsonSerializer
+#include "KeypointStream.h" // For EKeypointStreamEncoding and FKeypointStreamWriter
+#include "KinematicsEstimator.h"
+#include "BoneLengthChecker.h"
+#include "VirtualMarkerSkinner.h"
+#include "DenseVertexStream.h"
+#include "JointRegressor.h"
 
 #include "SkeletalExtractor.generated.h"
 
+class UCaptureOutputSubsystem;
+
 UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
 class EXTRACTJOINTLOCATION_API USkeletalExtractor : public UActorComponent
 {
@@ -24,6 +32,9 @@ protected:
 	// Called when the game starts
 	virtual void BeginPlay() override;
 
+	// Called when the game ends, closes any open keypoint streams
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 public:
 	// Called every frame
 	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
@@ -32,6 +43,59 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Skeletal Extraction")
 	FVector GetBoneLocationForMeshByName(USkeletalMeshComponent* SkeletalMesh, FName BoneName);
 
+	/**
+	 * Prepares the extractor for a render-free capture (see ASkeletonCaptureDriver): the Body and Face meshes
+	 * always evaluate their pose even though nothing is rendered, the extractor ticks after animation has
+	 * finished, and debug drawing is skipped.
+	 */
+	void PrepareForRenderFreeCapture();
+
+	/**
+	 * Starts a new take on a reused actor (see ATakeManager): closes the previous take's streams and opens
+	 * new ones under Saved/KeypointStreams/<TakeName>/, regardless of bStreamKeypoints.
+	 * Call after the meshes' assets have been swapped, bone indices are resolved again.
+	 */
+	void BeginTake(const FString& TakeName);
+
+	bool IsStreamingKeypoints() const { return bStreamKeypoints; }
+
+	/** Closes the current take's keypoint streams. */
+	void EndTake();
+
+	/**
+	 * Continues a take of an interrupted run: streams listed in StreamSizes (file path -> bytes at the last
+	 * checkpoint) are truncated to that size and appended to, others are started from scratch.
+	 * @return False if a listed stream could not be resumed; that stream is not written.
+	 */
+	bool ResumeTake(const FString& TakeName, const TMap<FString, int64>& StreamSizes);
+
+	/** Makes everything streamed so far durable (fsync) and reports each stream's file path and size. */
+	bool SyncKeypointStreams(TMap<FString, int64>& OutStreamSizes);
+
+	/**
+	 * Sets the frame index and timestamp the next streamed frame is written with, instead of counting ticks
+	 * and reading the world clock. Used by ASkeletonCaptureDriver so sharded runs write global frame numbers.
+	 */
+	void SetCaptureFrame(int32 FrameIndex, float TimeSeconds);
+
+	int32 GetKeyframeInterval() const { return KeyframeInterval; }
+
+	// Keypoint sets, also used by the offline sampling commandlet through the class default object
+
+	// Function to define the specific 17 face keypoints
+	TArray<FName> GetFaceKeypointsToExtract() const;
+
+	// Function to define the specific upper body keypoints for subset
+	TArray<FName> GetUpperBodyKeypointsToExtract() const;
+
+	TArray<FName> GetLowerBodyKeypointsToExtract() const;
+
+	/**
+	 * Minimal bone set needed to compute the keypoints' component space transforms: the keypoints plus all of
+	 * their ancestors, as sorted reference skeleton indices (parents before children). Unknown names are ignored.
+	 */
+	static TArray<FBoneIndexType> ComputeRequiredBones(const FReferenceSkeleton& RefSkeleton, const TArray<FName>& Keypoints);
+
 private:
 	// This will hold the pointer to the *specific instance* of the Body skeletal mesh component
 	UPROPERTY()
@@ -62,12 +126,206 @@ private:
 		meta = (Tooltip = "Base name for the JSON file. The actor's name and mesh type will be prepended (e.g., 'BP_MetaHuman_C_0_BoneLocations.json')."))
 	FString JsonFileNameBase;
 
+	// Writes the text/JSON bone files as records of the run's chunked container (Saved/Capture/*.ejlc) instead of separate files
+	UPROPERTY(EditAnywhere, Category = "Skeletal Extraction | Output")
+	bool bWriteToContainer;
+
+	// Streams the keypoint subsets every tick to Saved/KeypointStreams/<Actor>_<MeshType>.kps
+	UPROPERTY(EditAnywhere, Category = "Skeletal Extraction | Streaming")
+	bool bStreamKeypoints;
+
+	UPROPERTY(EditAnywhere, Category = "Skeletal Extraction | Streaming", meta = (EditCondition = "bStreamKeypoints"))
+	EKeypointStreamEncoding StreamEncoding;
+
+	UPROPERTY(EditAnywhere, Category = "Skeletal Extraction | Streaming", meta = (EditCondition = "bStreamKeypoints", ClampMin = "0.0001",
+		Tooltip = "Largest per-axis position error (cm) of the QuantizedDelta encoding, e.g. 0.01 for 0.1 mm."))
+	float QuantizationMaxError;
+
+	UPROPERTY(EditAnywhere, Category = "Skeletal Extraction | Streaming", meta = (EditCondition = "bStreamKeypoints", ClampMin = "1",
+		Tooltip = "Frames between keyframes of the QuantizedDelta encoding. Decoding can only start at a keyframe."))
+	int32 KeyframeInterval;
+
+	// Also streams joint velocity, acceleration and jerk of the keypoints to Kinematics/<Actor>_<MeshType>_<Channel>.kps
+	// next to the keypoint streams, computed while capturing instead of in a second pass over the positions
+	UPROPERTY(EditAnywhere, Category = "Skeletal Extraction | Kinematics")
+	bool bStreamKinematics;
+
+	UPROPERTY(EditAnywhere, Category = "Skeletal Extraction | Kinematics", meta = (EditCondition = "bStreamKinematics"))
+	EKinematicsFilter KinematicsFilter;
+
+	UPROPERTY(EditAnywhere, Category = "Skeletal Extraction | Kinematics", meta = (EditCondition = "bStreamKinematics", ClampMin = "2",
+		Tooltip = "The Savitzky-Golay window spans 2 * HalfWindow + 1 frames; derivatives are written HalfWindow frames late."))
+	int32 KinematicsHalfWindow;
+
+	UPROPERTY(EditAnywhere, Category = "Skeletal Extraction | Kinematics", meta = (EditCondition = "bStreamKinematics", ClampMin = "0.0",
+		Tooltip = "Frames where a keypoint's jerk exceeds this (cm/s^3) are listed in Kinematics/<Actor>_<MeshType>_JerkFlags.json when the stream closes. 0 disables flagging."))
+	float JerkFlagThreshold;
+
+	// Checks every streamed frame for bones on the keypoints' chains whose length differs from the reference pose and
+	// writes QA/<Actor>_<MeshType>_BoneLengths.json next to the streams when they are closed
+	UPROPERTY(EditAnywhere, Category = "Skeletal Extraction | QA")
+	bool bCheckBoneLengths;
+
+	UPROPERTY(EditAnywhere, Category = "Skeletal Extraction | QA", meta = (EditCondition = "bCheckBoneLengths", ClampMin = "0.0",
+		Tooltip = "Allowed relative change of a bone's length, e.g. 0.05 for 5 %."))
+	float BoneLengthTolerance;
+
+	UPROPERTY(EditAnywhere, Category = "Skeletal Extraction | QA", meta = (EditCondition = "bCheckBoneLengths", ClampMin = "0.0",
+		Tooltip = "Bones shorter than this (cm) in the reference pose are not checked."))
+	float MinCheckedBoneLength;
+
+	// Face rigs animate many bones by translation, so the Face mesh is only checked on request
+	UPROPERTY(EditAnywhere, Category = "Skeletal Extraction | QA", meta = (EditCondition = "bCheckBoneLengths"))
+	bool bCheckFaceBoneLengths;
+
+	// Skin-attached markers streamed to <Actor>_<MeshType>_Markers.kps next to the keypoints, evaluated by skinning
+	// only their vertices on the CPU
+	UPROPERTY(EditAnywhere, Category = "Skeletal Extraction | Markers")
+	TArray<FVirtualMarker> VirtualMarkers;
+
+	UPROPERTY(EditAnywhere, Category = "Skeletal Extraction | Markers",
+		meta = (Tooltip = "JSON marker set added to VirtualMarkers, see FVirtualMarkerSkinner::LoadMarkersFromFile. Relative to the project directory."))
+	FString VirtualMarkerFile;
+
+	// Also streams every LOD 0 vertex of the Body mesh to <Actor>_Body_Vertices.kdv next to the keypoints, skinned on
+	// worker threads; the mesh needs CPU access to its vertex data
+	UPROPERTY(EditAnywhere, Category = "Skeletal Extraction | Dense Vertices")
+	bool bStreamDenseVertices;
+
+	UPROPERTY(EditAnywhere, Category = "Skeletal Extraction | Dense Vertices", meta = (EditCondition = "bStreamDenseVertices"))
+	EDenseVertexEncoding DenseVertexEncoding;
+
+	UPROPERTY(EditAnywhere, Category = "Skeletal Extraction | Dense Vertices", meta = (EditCondition = "bStreamDenseVertices", ClampMin = "1",
+		Tooltip = "Only frames whose index is a multiple of this are exported, e.g. 10 for 6 fps of a 60 fps capture."))
+	int32 DenseVertexFrameInterval;
+
+	// Joint regressors (see FJointRegressor::LoadFromFile) applied to the bones and virtual markers of every streamed frame;
+	// each streams its joints to <Actor>_<RegressorFileName>.kps next to the keypoints
+	UPROPERTY(EditAnywhere, Category = "Skeletal Extraction | Joint Regression",
+		meta = (Tooltip = "JSON joint regressors, e.g. to SMPL-X, COCO-17 or Halpe-26 joints. Relative to the project directory."))
+	TArray<FString> JointRegressorFiles;
+
+	// The submissions below share the keypoint streams' per-frame bone reads, so they only run while the keypoints are
+	// streamed (bStreamKeypoints, or a take started with BeginTake)
+
+	// Submits the Body keypoints of every streamed frame to the world's UJointProximitySubsystem, which labels
+	// inter-subject contacts, nearest neighbours and foot-ground contacts across all subjects
+	UPROPERTY(EditAnywhere, Category = "Skeletal Extraction | Contacts", meta = (EditCondition = "bStreamKeypoints"))
+	bool bReportContacts;
+
+	// Submits the Body mesh's bounds of every streamed frame to the world's USubjectVisibilitySubsystem, which culls it
+	// against all camera frustums before per-camera work
+	UPROPERTY(EditAnywhere, Category = "Skeletal Extraction | Cameras", meta = (EditCondition = "bStreamKeypoints"))
+	bool bReportCameraVisibility;
+
+	// Submits the Body keypoints of every streamed frame to the world's ULiveFrameStreamSubsystem, which publishes
+	// them with each captured camera frame to a local consumer through shared memory
+	UPROPERTY(EditAnywhere, Category = "Skeletal Extraction | Cameras", meta = (EditCondition = "bStreamKeypoints"))
+	bool bPublishLiveKeypoints;
+
+	// Submits the Body keypoints of every streamed frame to the world's USubjectCropSubsystem, which cuts a crop
+	// around the subject out of every captured camera frame
+	UPROPERTY(EditAnywhere, Category = "Skeletal Extraction | Cameras", meta = (EditCondition = "bStreamKeypoints"))
+	bool bExportSubjectCrops;
+
+	// Submits the Body keypoints of every streamed frame to the world's UKeypointNetworkSubsystem, which sends all
+	// subjects' keypoints of each frame over UDP to live clients
+	UPROPERTY(EditAnywhere, Category = "Skeletal Extraction | Network", meta = (EditCondition = "bStreamKeypoints"))
+	bool bStreamKeypointsToNetwork;
+
+	// One open stream per mesh, with the bone indices of its keypoints resolved once at open time
+	struct FMeshKeypointStream
+	{
+		USkeletalMeshComponent* SkeletalMesh = nullptr;
+		FString MeshType;
+		TArray<FName> JointNames;
+		TArray<int32> BoneIndices;
+		TUniquePtr<FKeypointStreamWriter> Writer;
+
+		// Set when bStreamKinematics: the estimator and its velocity, acceleration and jerk streams
+		TUniquePtr<FKinematicsEstimator> Kinematics;
+		TUniquePtr<FKeypointStreamWriter> DerivativeWriters[3];
+		// Frames whose largest joint jerk exceeded JerkFlagThreshold, written as one report when the stream closes
+		struct FJerkFlag
+		{
+			int32 Frame = 0;
+			float Time = 0.0f;
+			int32 JointIndex = INDEX_NONE;
+			double Jerk = 0.0;
+		};
+		TArray<FJerkFlag> JerkFlags;
+
+		// Set when bCheckBoneLengths
+		TUniquePtr<FBoneLengthChecker> BoneLengthChecker;
+
+		// Set when markers are attached to this mesh
+		TUniquePtr<FVirtualMarkerSkinner> MarkerSkinner;
+		TUniquePtr<FKeypointStreamWriter> MarkerWriter;
+		// Marker positions of the current frame, also read by the joint regressors
+		TArray<FVector> MarkerPositions;
+
+		// Set when bStreamDenseVertices, Body mesh only
+		TUniquePtr<FDenseVertexStreamWriter> DenseVertexWriter;
+	};
+	TArray<FMeshKeypointStream> KeypointStreams;
+	TArray<FVector> StreamPositionScratch;
+	// VirtualMarkers plus the markers of VirtualMarkerFile, gathered when the streams are opened
+	TArray<FVirtualMarker> StreamMarkers;
+
+	// One open stream per joint regressor, with its sources resolved to a keypoint stream's bone or marker
+	struct FJointRegressorStream
+	{
+		// Regressor file's base name, the stream's name in the capture index
+		FString Name;
+		FJointRegressor Regressor;
+		TArray<int32> SourceStreams;
+		TArray<int32> SourceIndices;
+		TUniquePtr<FKeypointStreamWriter> Writer;
+	};
+	TArray<FJointRegressorStream> RegressorStreams;
+	TArray<FVector> RegressorSourceScratch;
+	TArray<FVector> RegressorJointScratch;
+	int32 StreamFrameIndex;
+
+	// Set by PrepareForRenderFreeCapture, skips the debug drawing in TickComponent
+	bool bRenderFreeCapture;
+
+	// Set by SetCaptureFrame, overrides the world clock for streamed frames
+	bool bExplicitFrameClock;
+	float ExplicitFrameTime;
+
+	// Take started by BeginTake, streams are written to a subfolder of this name; empty outside takes
+	FString CurrentTakeName;
+
+	// Set by ResumeTake while the streams are opened: sizes to truncate existing stream files to
+	TMap<FString, int64> ResumeStreamSizes;
+	bool bResumeFailed;
+
+	// Opens one stream for the Body (upper + lower body keypoints) and one for the Face keypoints
+	void OpenKeypointStreams();
+	void OpenKeypointStream(USkeletalMeshComponent* SkeletalMesh, const FString& MeshType, const TArray<FName>& Keypoints);
+	void WriteKeypointStreamFrame();
+	void WriteKinematicsFrame(FMeshKeypointStream& Stream);
+	// Writes Kinematics/<Actor>_<MeshType>_JerkFlags.json with every flagged frame of the stream
+	void WriteJerkFlagReport(const FMeshKeypointStream& Stream, const FString& ActorName);
+	// Opens a stream per joint regressor file once the mesh streams are open
+	void OpenJointRegressorStreams();
+	void WriteJointRegressorFrame(float TimeSeconds, UCaptureOutputSubsystem* CaptureOutput, const FString& ActorName);
+	// Indexes the frame just written to a keypoint stream under the actor and stream name
+	void IndexStreamFrame(UCaptureOutputSubsystem& CaptureOutput, const FKeypointStreamWriter& Writer, const FString& ActorName, const FString& StreamName) const;
+	void CloseKeypointStreams();
+	// Opens a stream file, or reopens it at its checkpointed size during ResumeTake
+	bool OpenStreamWriter(FKeypointStreamWriter& Writer, const FString& FilePath);
+
 	// --- NEW: Arrays to store bone names for drawing ---
 	TArray<FName> FaceKeypointsToDraw;
 	TArray<FName> UpperBodyKeypointsToDraw;
 	TArray<FName> LowerBodyKeypointsToDraw;
 	// --- END NEW ---
 
+	// Saves Content to AbsoluteFilePath, or to the capture container if bWriteToContainer is set
+	bool WriteOutputFile(const FString& Content, const FString& AbsoluteFilePath);
+
 	// New private function for text file saving, now takes a mesh type string
 	void SaveBoneDataToTextFile(const TArray<FName>& BoneNames, const TArray<FVector>& BoneLocations, const FString& MeshType, const FString& SubFolder);
 
@@ -77,12 +335,4 @@ private:
 	// Modified: Member function to extract and save bone data for a given skeletal mesh,
 	// now accepts an optional list of specific bone names to extract.
 	void ExtractAndSaveMeshBones(USkeletalMeshComponent* SkeletalMesh, const FString& MeshType);
-
-	// Function to define the specific 17 face keypoints
-	TArray<FName> GetFaceKeypointsToExtract() const;
-
-	// Function to define the specific upper body keypoints for subset
-	TArray<FName> GetUpperBodyKeypointsToExtract() const;
-
-	TArray<FName> GetLowerBodyKeypointsToExtract() const;
 };
\ No newline at end of file
@@ -0,0 +1,420 @@
+#include "SkeletonCaptureDriver.h"
+#include "SkeletalExtractor.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Kismet/GameplayStatics.h"
+#include "Engine/Engine.h"
+#include "Engine/GameViewportClient.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/PlatformTime.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogSkeletonCapture, Log, All);
+
+// Sets default values for this actor's properties
+ASkeletonCaptureDriver::ASkeletonCaptureDriver()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	// Set the frame clock before any mesh evaluates its animation
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+}
+
+// Called when the game starts or when spawned
+void ASkeletonCaptureDriver::BeginPlay()
+{
+	Super::BeginPlay();
+
+	FParse::Value(FCommandLine::Get(), TEXT("SkeletonCaptureFPS="), CaptureFrameRate);
+	FParse::Value(FCommandLine::Get(), TEXT("SkeletonCaptureFrames="), CaptureFrameCount);
+	FParse::Value(FCommandLine::Get(), TEXT("ShardIndex="), ShardIndex);
+	FParse::Value(FCommandLine::Get(), TEXT("ShardCount="), ShardCount);
+	FParse::Value(FCommandLine::Get(), TEXT("ShardRun="), ShardRunName);
+	FParse::Value(FCommandLine::Get(), TEXT("CaptureSeed="), RandomSeed);
+	bResumeCapture |= FParse::Param(FCommandLine::Get(), TEXT("ResumeCapture"));
+	CaptureFrameRate = FMath::Max(CaptureFrameRate, 1.0f);
+	if (ShardCount > 1 && CaptureFrameCount <= 0)
+	{
+		UE_LOG(LogSkeletonCapture, Error, TEXT("BeginPlay: Sharding needs a frame count (-SkeletonCaptureFrames=), capturing unsharded."));
+		ShardCount = 1;
+		ShardIndex = 0;
+	}
+
+	FMath::RandInit(RandomSeed);
+	FMath::SRandInit(RandomSeed);
+
+	// A fixed timestep makes the engine advance simulated time by exactly FixedDeltaTime per frame
+	// without waiting for wall-clock time, so frames are produced as fast as they can be computed
+	bSavedUseFixedTimeStep = FApp::UseFixedTimeStep();
+	SavedFixedDeltaTime = FApp::GetFixedDeltaTime();
+	FApp::SetUseFixedTimeStep(true);
+	FApp::SetFixedDeltaTime(1.0 / CaptureFrameRate);
+
+	if (GEngine)
+	{
+		bSavedSmoothFrameRate = GEngine->bSmoothFrameRate;
+		GEngine->bSmoothFrameRate = false;
+		GEngine->SetMaxFPS(0.0f);
+	}
+
+	const bool bCanRender = FApp::CanEverRender();
+	UGameViewportClient* GameViewport = GetWorld()->GetGameViewport();
+	if (bCanRender && bDisableWorldRendering && GameViewport)
+	{
+		bSavedDisableWorldRendering = GameViewport->bDisableWorldRendering;
+		GameViewport->bDisableWorldRendering = true;
+	}
+
+	// Resuming from a checkpoint advances CapturedFrames. The extractors are prepared on the first tick, once every
+	// actor's BeginPlay has run and their meshes are resolved.
+	CapturedFrames = 0;
+	bCaptureFinished = false;
+	bExtractorsPrepared = false;
+}
+
+void ASkeletonCaptureDriver::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (!bCaptureFinished && CapturedFrames > 0)
+	{
+		FinishCapture();
+	}
+
+	FApp::SetUseFixedTimeStep(bSavedUseFixedTimeStep);
+	FApp::SetFixedDeltaTime(SavedFixedDeltaTime);
+	if (GEngine)
+	{
+		GEngine->bSmoothFrameRate = bSavedSmoothFrameRate;
+	}
+	if (UGameViewportClient* GameViewport = GetWorld()->GetGameViewport())
+	{
+		GameViewport->bDisableWorldRendering = bSavedDisableWorldRendering;
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+// Called every frame
+void ASkeletonCaptureDriver::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!bExtractorsPrepared)
+	{
+		bExtractorsPrepared = true;
+		PrepareExtractors();
+
+		CaptureStartTime = FPlatformTime::Seconds();
+		LastCheckpointTime = CaptureStartTime;
+		UE_LOG(LogSkeletonCapture, Log, TEXT("Render-free skeleton capture started: %.2f fps fixed timestep, shard %d/%d frames [%d, %d) of %d (%s)."),
+			CaptureFrameRate, ShardIndex, ShardCount, FirstFrame, FirstFrame + NumShardFrames, CaptureFrameCount, FApp::CanEverRender() ? TEXT("rendering disabled") : TEXT("null RHI"));
+	}
+
+	if (bCaptureFinished)
+	{
+		return;
+	}
+
+	if (CaptureFrameCount > 0 && CapturedFrames >= NumShardFrames)
+	{
+		FinishCapture();
+		if (bQuitWhenDone)
+		{
+			FPlatformMisc::RequestExit(false);
+		}
+		return;
+	}
+
+	const int32 FrameIndex = FirstFrame + CapturedFrames;
+	if (FrameIndex % FrameAlignment == 0)
+	{
+		// Every stream starts a keyframe here, so the frames written so far can be resumed from without
+		// changing a byte of the output
+		if (CapturedFrames > 0 && CheckpointInterval > 0.0f && FPlatformTime::Seconds() - LastCheckpointTime >= CheckpointInterval)
+		{
+			WriteCheckpoint(false);
+		}
+
+		// Random state depends only on the seed and the frame, not on where this process started
+		const int32 FrameSeed = static_cast<int32>(HashCombine(GetTypeHash(RandomSeed), GetTypeHash(FrameIndex)));
+		FMath::RandInit(FrameSeed);
+		FMath::SRandInit(FrameSeed);
+	}
+
+	// The time is computed from the frame index, never accumulated, so every shard sees bit-identical
+	// times for the same frame
+	const float FrameTime = static_cast<float>(static_cast<double>(FrameIndex) / CaptureFrameRate);
+	for (USkeletalMeshComponent* SkeletalMesh : SeekableMeshes)
+	{
+		if (SkeletalMesh)
+		{
+			SkeletalMesh->SetPosition(FrameTime, false);
+		}
+	}
+	for (USkeletalExtractor* Extractor : Extractors)
+	{
+		if (Extractor)
+		{
+			Extractor->SetCaptureFrame(FrameIndex, FrameTime);
+		}
+	}
+	++CapturedFrames;
+}
+
+bool ASkeletonCaptureDriver::ComputeShardRange(int32 TotalFrames, int32 InShardCount, int32 InShardIndex, int32 Alignment, int32& OutFirstFrame, int32& OutNumFrames)
+{
+	Alignment = FMath::Max(Alignment, 1);
+	InShardCount = FMath::Max(InShardCount, 1);
+
+	// Shard size rounded up to whole keyframe intervals; trailing shards may end up empty
+	const int32 FramesPerShard = FMath::DivideAndRoundUp(FMath::DivideAndRoundUp(TotalFrames, InShardCount), Alignment) * Alignment;
+	OutFirstFrame = FMath::Min(InShardIndex * FramesPerShard, TotalFrames);
+	OutNumFrames = FMath::Min(OutFirstFrame + FramesPerShard, TotalFrames) - OutFirstFrame;
+	return OutNumFrames > 0;
+}
+
+void ASkeletonCaptureDriver::PrepareExtractors()
+{
+	TArray<AActor*> AllActors;
+	UGameplayStatics::GetAllActorsOfClass(GetWorld(), AActor::StaticClass(), AllActors);
+
+	Extractors.Reset();
+	SeekableMeshes.Reset();
+	for (AActor* Actor : AllActors)
+	{
+		TArray<USkeletalExtractor*> ActorExtractors;
+		Actor->GetComponents<USkeletalExtractor>(ActorExtractors);
+		if (ActorExtractors.Num() == 0)
+		{
+			continue;
+		}
+		Extractors.Append(ActorExtractors);
+
+		TArray<USkeletalMeshComponent*> SkeletalMeshComponents;
+		Actor->GetComponents<USkeletalMeshComponent>(SkeletalMeshComponents);
+		for (USkeletalMeshComponent* SkeletalMesh : SkeletalMeshComponents)
+		{
+			// Only meshes playing an animation asset can be seeked; animation blueprints advance on their own
+			// and make the capture depend on where it started
+			if (SkeletalMesh->GetAnimationMode() == EAnimationMode::AnimationSingleNode)
+			{
+				SkeletalMesh->bPauseAnims = true;
+				SkeletalMesh->PrimaryComponentTick.AddPrerequisite(this, PrimaryActorTick);
+				SeekableMeshes.Add(SkeletalMesh);
+			}
+			else if (ShardCount > 1)
+			{
+				UE_LOG(LogSkeletonCapture, Warning, TEXT("PrepareExtractors: %s.%s is driven by an animation blueprint, its sharded output will not match a single-process run."),
+					*Actor->GetName(), *SkeletalMesh->GetName());
+			}
+		}
+	}
+
+	if (Extractors.Num() == 0)
+	{
+		UE_LOG(LogSkeletonCapture, Warning, TEXT("PrepareExtractors: No SkeletalExtractor components found in the level."));
+	}
+
+	// Shards and checkpoints must start on a keyframe of every extractor's stream
+	FrameAlignment = 1;
+	for (USkeletalExtractor* Extractor : Extractors)
+	{
+		const int32 Interval = FMath::Max(Extractor->GetKeyframeInterval(), 1);
+		int32 A = FrameAlignment;
+		int32 B = Interval;
+		while (B != 0)
+		{
+			const int32 Remainder = A % B;
+			A = B;
+			B = Remainder;
+		}
+		FrameAlignment = FrameAlignment / A * Interval;
+	}
+
+	if (CaptureFrameCount > 0)
+	{
+		ComputeShardRange(CaptureFrameCount, ShardCount, ShardIndex, FrameAlignment, FirstFrame, NumShardFrames);
+	}
+	else
+	{
+		FirstFrame = 0;
+		NumShardFrames = 0;
+	}
+
+	int32 NextFrame = FirstFrame;
+	TMap<FString, int64> StreamSizes;
+	bool bCheckpointComplete = false;
+	const bool bResuming = bResumeCapture && LoadCheckpoint(NextFrame, StreamSizes, bCheckpointComplete);
+
+	const FString TakeName = FString::Printf(TEXT("%s/Shard_%03d"), *ShardRunName, ShardIndex);
+	bool bResumed = true;
+	for (USkeletalExtractor* Extractor : Extractors)
+	{
+		Extractor->PrepareForRenderFreeCapture();
+		if (bResuming)
+		{
+			bResumed &= Extractor->ResumeTake(TakeName, StreamSizes);
+		}
+		else
+		{
+			Extractor->BeginTake(TakeName);
+		}
+	}
+
+	if (!bResumed)
+	{
+		// Continuing would leave holes in the streams
+		UE_LOG(LogSkeletonCapture, Error, TEXT("PrepareExtractors: Failed to resume the streams of %s, restart without -ResumeCapture."), *GetCheckpointPath());
+		for (USkeletalExtractor* Extractor : Extractors)
+		{
+			Extractor->EndTake();
+		}
+		bCaptureFinished = true;
+		FPlatformMisc::RequestExitWithStatus(false, 1);
+	}
+	else if (bResuming)
+	{
+		CapturedFrames = bCheckpointComplete ? NumShardFrames : NextFrame - FirstFrame;
+		UE_LOG(LogSkeletonCapture, Log, TEXT("PrepareExtractors: Resuming capture at frame %d from %s."), FirstFrame + CapturedFrames, *GetCheckpointPath());
+	}
+}
+
+void ASkeletonCaptureDriver::FinishCapture()
+{
+	bCaptureFinished = true;
+
+	// A run that stopped early keeps its last periodic checkpoint, which ends on a keyframe boundary
+	if (CheckpointInterval > 0.0f && NumShardFrames > 0 && CapturedFrames >= NumShardFrames)
+	{
+		WriteCheckpoint(true);
+	}
+
+	// Close the streams now, so extractors ticking later in this frame do not write past the shard's range
+	for (USkeletalExtractor* Extractor : Extractors)
+	{
+		if (Extractor)
+		{
+			Extractor->EndTake();
+		}
+	}
+
+	const double WallSeconds = FMath::Max(FPlatformTime::Seconds() - CaptureStartTime, UE_SMALL_NUMBER);
+	const double SimulatedSeconds = CapturedFrames / CaptureFrameRate;
+	UE_LOG(LogSkeletonCapture, Log, TEXT("Skeleton capture finished: %d frames (%.1f s simulated) in %.1f s wall time, %.1f frames/s, %.1fx real time."),
+		CapturedFrames, SimulatedSeconds, WallSeconds, CapturedFrames / WallSeconds, SimulatedSeconds / WallSeconds);
+}
+
+bool ASkeletonCaptureDriver::WriteCheckpoint(bool bComplete)
+{
+	const double StartTime = FPlatformTime::Seconds();
+	LastCheckpointTime = StartTime;
+
+	// The checkpoint may only point at bytes that are already on disk
+	TMap<FString, int64> StreamSizes;
+	bool bAllSynced = true;
+	for (USkeletalExtractor* Extractor : Extractors)
+	{
+		if (Extractor)
+		{
+			bAllSynced &= Extractor->SyncKeypointStreams(StreamSizes);
+		}
+	}
+	if (!bAllSynced)
+	{
+		UE_LOG(LogSkeletonCapture, Warning, TEXT("WriteCheckpoint: Not all streams could be synced, keeping the previous checkpoint."));
+		return false;
+	}
+
+	TSharedPtr<FJsonObject> CheckpointObject = MakeShareable(new FJsonObject);
+	CheckpointObject->SetNumberField(TEXT("FirstFrame"), FirstFrame);
+	CheckpointObject->SetNumberField(TEXT("NumFrames"), NumShardFrames);
+	CheckpointObject->SetNumberField(TEXT("FrameRate"), CaptureFrameRate);
+	CheckpointObject->SetNumberField(TEXT("RandomSeed"), RandomSeed);
+	CheckpointObject->SetNumberField(TEXT("NextFrame"), FirstFrame + CapturedFrames);
+	CheckpointObject->SetBoolField(TEXT("Complete"), bComplete);
+
+	TArray<TSharedPtr<FJsonValue>> StreamArray;
+	for (const TPair<FString, int64>& Stream : StreamSizes)
+	{
+		TSharedPtr<FJsonObject> StreamObject = MakeShareable(new FJsonObject);
+		StreamObject->SetStringField(TEXT("File"), Stream.Key);
+		StreamObject->SetNumberField(TEXT("Bytes"), static_cast<double>(Stream.Value));
+		StreamArray.Add(MakeShareable(new FJsonValueObject(StreamObject)));
+	}
+	CheckpointObject->SetArrayField(TEXT("Streams"), StreamArray);
+
+	FString CheckpointContent;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&CheckpointContent);
+	FJsonSerializer::Serialize(CheckpointObject.ToSharedRef(), Writer);
+
+	// Write, sync and rename, so a crash leaves either the old or the new checkpoint
+	const FString CheckpointPath = GetCheckpointPath();
+	const FString TempPath = CheckpointPath + TEXT(".tmp");
+	const FTCHARToUTF8 Utf8Content(*CheckpointContent);
+	{
+		IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+		PlatformFile.CreateDirectoryTree(*FPaths::GetPath(CheckpointPath));
+		TUniquePtr<IFileHandle> FileHandle(PlatformFile.OpenWrite(*TempPath));
+		if (!FileHandle.IsValid() || !FileHandle->Write(reinterpret_cast<const uint8*>(Utf8Content.Get()), Utf8Content.Length()) || !FileHandle->Flush(true))
+		{
+			UE_LOG(LogSkeletonCapture, Warning, TEXT("WriteCheckpoint: Failed to write %s"), *TempPath);
+			return false;
+		}
+	}
+	if (!IFileManager::Get().Move(*CheckpointPath, *TempPath, true, true))
+	{
+		UE_LOG(LogSkeletonCapture, Warning, TEXT("WriteCheckpoint: Failed to replace %s"), *CheckpointPath);
+		return false;
+	}
+
+	UE_LOG(LogSkeletonCapture, Log, TEXT("Checkpoint at frame %d (%d streams) written in %.1f ms."),
+		FirstFrame + CapturedFrames, StreamSizes.Num(), (FPlatformTime::Seconds() - StartTime) * 1000.0);
+	return true;
+}
+
+bool ASkeletonCaptureDriver::LoadCheckpoint(int32& OutNextFrame, TMap<FString, int64>& OutStreamSizes, bool& bOutComplete) const
+{
+	const FString CheckpointPath = GetCheckpointPath();
+	FString CheckpointContent;
+	if (!FFileHelper::LoadFileToString(CheckpointContent, *CheckpointPath))
+	{
+		UE_LOG(LogSkeletonCapture, Log, TEXT("LoadCheckpoint: No checkpoint at %s, starting from the beginning."), *CheckpointPath);
+		return false;
+	}
+
+	TSharedPtr<FJsonObject> CheckpointObject;
+	TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(CheckpointContent);
+	if (!FJsonSerializer::Deserialize(Reader, CheckpointObject) || !CheckpointObject.IsValid())
+	{
+		UE_LOG(LogSkeletonCapture, Error, TEXT("LoadCheckpoint: %s is not valid JSON, starting from the beginning."), *CheckpointPath);
+		return false;
+	}
+
+	// Resuming with a different split, rate or seed would not continue the same output
+	if (CheckpointObject->GetIntegerField(TEXT("FirstFrame")) != FirstFrame || CheckpointObject->GetIntegerField(TEXT("NumFrames")) != NumShardFrames
+		|| CheckpointObject->GetNumberField(TEXT("FrameRate")) != CaptureFrameRate || CheckpointObject->GetIntegerField(TEXT("RandomSeed")) != RandomSeed)
+	{
+		UE_LOG(LogSkeletonCapture, Error, TEXT("LoadCheckpoint: %s was written with different capture settings, starting from the beginning."), *CheckpointPath);
+		return false;
+	}
+
+	OutNextFrame = CheckpointObject->GetIntegerField(TEXT("NextFrame"));
+	bOutComplete = CheckpointObject->GetBoolField(TEXT("Complete"));
+	for (const TSharedPtr<FJsonValue>& StreamValue : CheckpointObject->GetArrayField(TEXT("Streams")))
+	{
+		const TSharedPtr<FJsonObject>& StreamObject = StreamValue->AsObject();
+		OutStreamSizes.Add(StreamObject->GetStringField(TEXT("File")), static_cast<int64>(StreamObject->GetNumberField(TEXT("Bytes"))));
+	}
+	return true;
+}
+
+FString ASkeletonCaptureDriver::GetCheckpointPath() const
+{
+	return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("KeypointStreams"), ShardRunName, FString::Printf(TEXT("Shard_%03d"), ShardIndex), TEXT("Checkpoint.json"));
+}
@@ -0,0 +1,137 @@
+// SkeletonCaptureDriver.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "SkeletonCaptureDriver.generated.h"
+
+class USkeletalExtractor;
+class USkeletalMeshComponent;
+
+/**
+ * Drives a render-free skeleton capture: the simulation advances by a fixed timestep decoupled from
+ * wall-clock time and steps as fast as the CPU allows, every USkeletalExtractor in the level is switched to
+ * always evaluate its meshes' animation (nothing is visible without rendering), and the game exits after
+ * CaptureFrameCount frames.
+ *
+ * Intended to run in a headless game process, e.g.
+ *   UnrealEditor-Cmd Project.uproject CaptureMap -game -nullrhi -nosound -unattended -SkeletonCaptureFPS=60 -SkeletonCaptureFrames=216000
+ * The -SkeletonCaptureFPS and -SkeletonCaptureFrames switches override the actor's properties.
+ * Without -nullrhi world rendering is switched off instead, which still saves most of the frame cost.
+ *
+ * Frames are clocked by index: every frame, animation-asset driven meshes are seeked to FrameIndex / FrameRate
+ * and extractors stream with that index and time. A run can therefore be split into frame ranges
+ * (-ShardIndex=i -ShardCount=N, see UShardedCaptureCommandlet) whose streams, written to
+ * Saved/KeypointStreams/<ShardRun>/Shard_<i>/, concatenate to exactly the output of a single process.
+ *
+ * Long runs are checkpointed: every CheckpointInterval seconds, at the next keyframe boundary, the streams are
+ * synced to disk and Checkpoint.json in the shard folder records the next frame and each stream's size.
+ * A process started with -ResumeCapture continues from there; bytes written after the checkpoint are discarded.
+ * The random streams are reseeded from RandomSeed and the frame index at every keyframe boundary, so a resumed
+ * or sharded run sees the same random numbers as an uninterrupted one.
+ */
+UCLASS()
+class EXTRACTJOINTLOCATION_API ASkeletonCaptureDriver : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	// Sets default values for this actor's properties
+	ASkeletonCaptureDriver();
+
+protected:
+	// Called when the game starts or when spawned
+	virtual void BeginPlay() override;
+
+	// Restores the engine's timestep settings
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+public:
+	// Called every frame
+	virtual void Tick(float DeltaTime) override;
+
+	/** Number of simulated frames captured so far. */
+	UFUNCTION(BlueprintPure, Category = "Skeleton Capture")
+	int32 GetCapturedFrameCount() const { return CapturedFrames; }
+
+	/**
+	 * Frame range of one shard. Ranges start on multiples of Alignment (the extractors' keyframe interval),
+	 * so each shard's keypoint streams begin with the same keyframe a single process would write there.
+	 * @return False if the shard has no frames.
+	 */
+	static bool ComputeShardRange(int32 TotalFrames, int32 ShardCount, int32 ShardIndex, int32 Alignment, int32& OutFirstFrame, int32& OutNumFrames);
+
+protected:
+	/** Simulation rate; every frame advances the world by exactly 1 / CaptureFrameRate seconds. */
+	UPROPERTY(EditAnywhere, Category = "Skeleton Capture", meta = (ClampMin = "1.0"))
+	float CaptureFrameRate = 60.0f;
+
+	/** Frames to simulate before the capture ends, 0 to run until the game is closed. */
+	UPROPERTY(EditAnywhere, Category = "Skeleton Capture", meta = (ClampMin = "0"))
+	int32 CaptureFrameCount = 0;
+
+	/** Quits the game once CaptureFrameCount frames have been captured. */
+	UPROPERTY(EditAnywhere, Category = "Skeleton Capture")
+	bool bQuitWhenDone = true;
+
+	/** Switches off world rendering when the process was not started with -nullrhi. */
+	UPROPERTY(EditAnywhere, Category = "Skeleton Capture")
+	bool bDisableWorldRendering = true;
+
+	/** This process's shard and the number of shards CaptureFrameCount is split into (-ShardIndex=, -ShardCount=). */
+	UPROPERTY(EditAnywhere, Category = "Skeleton Capture|Sharding", meta = (ClampMin = "0"))
+	int32 ShardIndex = 0;
+	UPROPERTY(EditAnywhere, Category = "Skeleton Capture|Sharding", meta = (ClampMin = "1"))
+	int32 ShardCount = 1;
+
+	/** Output folder name under Saved/KeypointStreams (-ShardRun=). */
+	UPROPERTY(EditAnywhere, Category = "Skeleton Capture|Sharding")
+	FString ShardRunName = TEXT("SkeletonCapture");
+
+	/** Seed for the engine's global random streams, identical in every shard (-CaptureSeed=). */
+	UPROPERTY(EditAnywhere, Category = "Skeleton Capture|Sharding")
+	int32 RandomSeed = 0;
+
+	/** Wall-clock seconds between checkpoints, which bounds the work lost in a crash; 0 disables checkpoints. */
+	UPROPERTY(EditAnywhere, Category = "Skeleton Capture|Checkpoints", meta = (ClampMin = "0.0"))
+	float CheckpointInterval = 60.0f;
+
+	/** Continues from the shard's last checkpoint instead of starting over (-ResumeCapture). */
+	UPROPERTY(EditAnywhere, Category = "Skeleton Capture|Checkpoints")
+	bool bResumeCapture = false;
+
+private:
+	// Forces every extractor's meshes to evaluate animation regardless of visibility and starts their streams
+	void PrepareExtractors();
+	void FinishCapture();
+
+	// Syncs every stream and atomically replaces the shard's checkpoint file
+	bool WriteCheckpoint(bool bComplete);
+	bool LoadCheckpoint(int32& OutNextFrame, TMap<FString, int64>& OutStreamSizes, bool& bOutComplete) const;
+	FString GetCheckpointPath() const;
+
+	UPROPERTY()
+	TArray<USkeletalExtractor*> Extractors;
+
+	// Meshes playing an animation asset, seeked to the frame time every frame
+	UPROPERTY()
+	TArray<USkeletalMeshComponent*> SeekableMeshes;
+
+	int32 FirstFrame = 0;
+	// Frames this process captures, 0 for unlimited
+	int32 NumShardFrames = 0;
+	// Least common multiple of the extractors' keyframe intervals; shards and checkpoints start on multiples of it
+	int32 FrameAlignment = 1;
+	double LastCheckpointTime = 0.0;
+
+	bool bSavedUseFixedTimeStep = false;
+	double SavedFixedDeltaTime = 0.0;
+	bool bSavedSmoothFrameRate = false;
+	bool bSavedDisableWorldRendering = false;
+
+	int32 CapturedFrames = 0;
+	double CaptureStartTime = 0.0;
+	bool bCaptureFinished = false;
+	// Set on the first tick, when PrepareExtractors has run
+	bool bExtractorsPrepared = false;
+};
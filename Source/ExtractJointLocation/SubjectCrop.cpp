@@ -0,0 +1,151 @@
+#include "SubjectCrop.h"
+
+namespace SubjectCrop
+{
+	// Samples per axis and output pixel when shrinking; more only blur what 4x4 already averages
+	static constexpr int32 MaxSamplesPerAxis = 4;
+
+	// Bilinear taps of one sample position along an axis, pixels outside the image weighted 0
+	struct FTaps
+	{
+		int32 Index0 = 0;
+		int32 Index1 = 0;
+		float Weight0 = 0.0f;
+		float Weight1 = 0.0f;
+	};
+
+	static FTaps MakeTaps(double Coordinate, int32 ImageExtent)
+	{
+		// Pixel centres are at i + 0.5
+		const double Position = Coordinate - 0.5;
+		const int32 Index0 = FMath::FloorToInt32(Position);
+		const float Fraction = static_cast<float>(Position - Index0);
+
+		FTaps Taps;
+		Taps.Index0 = FMath::Clamp(Index0, 0, ImageExtent - 1);
+		Taps.Index1 = FMath::Clamp(Index0 + 1, 0, ImageExtent - 1);
+		Taps.Weight0 = Index0 >= 0 && Index0 < ImageExtent ? 1.0f - Fraction : 0.0f;
+		Taps.Weight1 = Index0 + 1 >= 0 && Index0 + 1 < ImageExtent ? Fraction : 0.0f;
+		return Taps;
+	}
+}
+
+void FSubjectCrop::ProjectKeypoints(const FTransform& Extrinsics, const FCameraIntrinsics& Intrinsics, TArrayView<const FVector> Positions, TArray<FVector2D>& OutPoints)
+{
+	OutPoints.Reset(Positions.Num());
+	for (const FVector& Position : Positions)
+	{
+		const FVector Local = Extrinsics.InverseTransformPositionNoScale(Position);
+		if (Local.X > UE_KINDA_SMALL_NUMBER)
+		{
+			OutPoints.Emplace(Intrinsics.PrincipalPointX + Intrinsics.FocalLengthX * Local.Y / Local.X,
+				Intrinsics.PrincipalPointY - Intrinsics.FocalLengthY * Local.Z / Local.X);
+		}
+	}
+}
+
+bool FSubjectCrop::FromKeypoints(TArrayView<const FVector2D> Points, const FIntPoint& ImageSize, const FSubjectCropSettings& Settings, FSubjectCrop& OutCrop)
+{
+	FBox2D Box(ForceInit);
+	for (const FVector2D& Point : Points)
+	{
+		Box += Point;
+	}
+
+	// Clipping first keeps subjects walking out of frame from growing crops that are mostly black
+	const FBox2D ImageBox(FVector2D::ZeroVector, FVector2D(ImageSize));
+	if (!Box.bIsValid || !Box.Intersect(ImageBox))
+	{
+		return false;
+	}
+	Box = Box.Overlap(ImageBox);
+
+	const double SubjectSize = Box.GetSize().GetMax();
+	if (SubjectSize < Settings.MinSubjectSize || Settings.OutputSize <= 0)
+	{
+		return false;
+	}
+
+	OutCrop.Size = SubjectSize * (1.0 + 2.0 * Settings.Padding);
+	OutCrop.Min = Box.GetCenter() - FVector2D(OutCrop.Size * 0.5);
+	OutCrop.OutputSize = Settings.OutputSize;
+	return true;
+}
+
+FCameraIntrinsics FSubjectCrop::GetCropIntrinsics(const FCameraIntrinsics& ImageIntrinsics) const
+{
+	const double Scale = GetScale();
+
+	FCameraIntrinsics CropIntrinsics = ImageIntrinsics;
+	CropIntrinsics.FocalLengthX = static_cast<float>(ImageIntrinsics.FocalLengthX * Scale);
+	CropIntrinsics.FocalLengthY = static_cast<float>(ImageIntrinsics.FocalLengthY * Scale);
+	CropIntrinsics.PrincipalPointX = static_cast<float>((ImageIntrinsics.PrincipalPointX - Min.X) * Scale);
+	CropIntrinsics.PrincipalPointY = static_cast<float>((ImageIntrinsics.PrincipalPointY - Min.Y) * Scale);
+	CropIntrinsics.ImageWidth = OutputSize;
+	CropIntrinsics.ImageHeight = OutputSize;
+	return CropIntrinsics;
+}
+
+void FSubjectCrop::Resample(const FColor* Image, const FIntPoint& ImageSize, TArray<FColor>& OutPixels, bool bForceOpaque) const
+{
+	using namespace SubjectCrop;
+	OutPixels.SetNumZeroed(OutputSize * OutputSize);
+	if (!Image || ImageSize.X <= 0 || ImageSize.Y <= 0 || OutputSize <= 0)
+	{
+		return;
+	}
+
+	const double ImagePixelsPerOutput = Size / OutputSize;
+	const int32 Samples = FMath::Clamp(FMath::CeilToInt32(ImagePixelsPerOutput), 1, MaxSamplesPerAxis);
+	const float SampleWeight = 1.0f / (Samples * Samples);
+
+	// Rows and columns share their taps, so compute them once per axis
+	TArray<FTaps> ColumnTaps;
+	TArray<FTaps> RowTaps;
+	ColumnTaps.SetNumUninitialized(OutputSize * Samples);
+	RowTaps.SetNumUninitialized(OutputSize * Samples);
+	for (int32 Output = 0; Output < OutputSize; ++Output)
+	{
+		for (int32 Sample = 0; Sample < Samples; ++Sample)
+		{
+			const double Offset = (Output + (Sample + 0.5) / Samples) * ImagePixelsPerOutput;
+			ColumnTaps[Output * Samples + Sample] = MakeTaps(Min.X + Offset, ImageSize.X);
+			RowTaps[Output * Samples + Sample] = MakeTaps(Min.Y + Offset, ImageSize.Y);
+		}
+	}
+
+	for (int32 OutputY = 0; OutputY < OutputSize; ++OutputY)
+	{
+		for (int32 OutputX = 0; OutputX < OutputSize; ++OutputX)
+		{
+			FLinearColor Sum(0.0f, 0.0f, 0.0f, 0.0f);
+			for (int32 SampleY = 0; SampleY < Samples; ++SampleY)
+			{
+				const FTaps& Row = RowTaps[OutputY * Samples + SampleY];
+				const FColor* Row0 = Image + static_cast<int64>(Row.Index0) * ImageSize.X;
+				const FColor* Row1 = Image + static_cast<int64>(Row.Index1) * ImageSize.X;
+				for (int32 SampleX = 0; SampleX < Samples; ++SampleX)
+				{
+					const FTaps& Column = ColumnTaps[OutputX * Samples + SampleX];
+					const float Weights[4] = {
+						Row.Weight0 * Column.Weight0, Row.Weight0 * Column.Weight1,
+						Row.Weight1 * Column.Weight0, Row.Weight1 * Column.Weight1 };
+					const FColor* Taps[4] = { &Row0[Column.Index0], &Row0[Column.Index1], &Row1[Column.Index0], &Row1[Column.Index1] };
+					for (int32 Tap = 0; Tap < 4; ++Tap)
+					{
+						Sum.R += Weights[Tap] * Taps[Tap]->R;
+						Sum.G += Weights[Tap] * Taps[Tap]->G;
+						Sum.B += Weights[Tap] * Taps[Tap]->B;
+						Sum.A += Weights[Tap] * Taps[Tap]->A;
+					}
+				}
+			}
+
+			FColor& Pixel = OutPixels[OutputY * OutputSize + OutputX];
+			Pixel.R = static_cast<uint8>(FMath::Clamp(FMath::RoundToInt32(Sum.R * SampleWeight), 0, 255));
+			Pixel.G = static_cast<uint8>(FMath::Clamp(FMath::RoundToInt32(Sum.G * SampleWeight), 0, 255));
+			Pixel.B = static_cast<uint8>(FMath::Clamp(FMath::RoundToInt32(Sum.B * SampleWeight), 0, 255));
+			Pixel.A = bForceOpaque ? 255 : static_cast<uint8>(FMath::Clamp(FMath::RoundToInt32(Sum.A * SampleWeight), 0, 255));
+		}
+	}
+}
@@ -0,0 +1,57 @@
+// SubjectCrop.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CameraDataComponent.h"
+
+struct FSubjectCropSettings
+{
+	// Output crops are OutputSize x OutputSize pixels
+	int32 OutputSize = 256;
+	// Margin added on every side of the keypoint box, as a fraction of the box's longer side
+	float Padding = 0.2f;
+	// Keypoint boxes smaller than this (pixels, longer side) are not cropped
+	float MinSubjectSize = 24.0f;
+};
+
+/**
+ * Square region of a camera image around one subject's projected keypoints, resampled to a fixed size.
+ * Pure CPU logic so cropping can be exercised with synthetic frames (no GPU needed).
+ * Image coordinates follow the exported calibration: pixel (i, j) covers [i, i + 1) x [j, j + 1).
+ */
+struct EXTRACTJOINTLOCATION_API FSubjectCrop
+{
+	// Top-left corner and side length of the region in image pixels; it may extend past the image
+	FVector2D Min = FVector2D::ZeroVector;
+	double Size = 0.0;
+	int32 OutputSize = 0;
+
+	/**
+	 * Projects world positions with a camera's pinhole model (X forward, Y right, Z up in the camera frame).
+	 * @param OutPoints Image coordinates of the positions in front of the camera.
+	 */
+	static void ProjectKeypoints(const FTransform& Extrinsics, const FCameraIntrinsics& Intrinsics, TArrayView<const FVector> Positions, TArray<FVector2D>& OutPoints);
+
+	/**
+	 * Builds the padded square crop around the keypoints' bounding box, clipped to the image first.
+	 * @return False if no keypoint lies in the image or the subject is smaller than Settings.MinSubjectSize.
+	 */
+	static bool FromKeypoints(TArrayView<const FVector2D> Points, const FIntPoint& ImageSize, const FSubjectCropSettings& Settings, FSubjectCrop& OutCrop);
+
+	/** Output pixels per image pixel. */
+	double GetScale() const { return Size > 0.0 ? OutputSize / Size : 0.0; }
+
+	/** Image coordinates in crop coordinates. */
+	FVector2D ImageToCrop(const FVector2D& ImagePoint) const { return (ImagePoint - Min) * GetScale(); }
+
+	/** Intrinsics of the crop: the camera's intrinsics scaled and shifted to the cropped region. */
+	FCameraIntrinsics GetCropIntrinsics(const FCameraIntrinsics& ImageIntrinsics) const;
+
+	/**
+	 * Resamples the region into an OutputSize x OutputSize image, averaging up to 4x4 samples per output pixel when
+	 * shrinking. Parts of the region outside the image are black.
+	 * @param Image Row-major ImageSize.X * ImageSize.Y pixels.
+	 * @param bForceOpaque Scene captures leave inverse opacity in alpha; set to write A = 255 instead.
+	 */
+	void Resample(const FColor* Image, const FIntPoint& ImageSize, TArray<FColor>& OutPixels, bool bForceOpaque = true) const;
+};
@@ -0,0 +1,229 @@
+#include "SubjectCropSubsystem.h"
+#include "CameraRegistrySubsystem.h"
+#include "CaptureOutputSubsystem.h"
+#include "SubjectVisibilitySubsystem.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogSubjectCrop, Log, All);
+
+USubjectCropSubsystem::USubjectCropSubsystem()
+{
+	// 256 px crops with 20 % margin are the usual input of top-down pose models
+	bEnableSubjectCrops = false;
+	CropSize = 256;
+	CropPadding = 0.2f;
+	MinSubjectSize = 24.0f;
+}
+
+void USubjectCropSubsystem::Deinitialize()
+{
+	if (NumExportedCrops > 0)
+	{
+		UE_LOG(LogSubjectCrop, Log, TEXT("Exported %d subject crops, %.1f %% of the cropped frames' pixels."),
+			NumExportedCrops, NumSourcePixels > 0 ? 100.0 * NumExportedPixels / NumSourcePixels : 0.0);
+	}
+	Super::Deinitialize();
+}
+
+void USubjectCropSubsystem::SubmitSubjectKeypoints(const UObject* Owner, const FString& SubjectName, int32 FrameIndex, TArrayView<const FVector> Positions)
+{
+	if (!bEnableSubjectCrops || !Owner)
+	{
+		return;
+	}
+
+	FSubject* Subject = Subjects.FindByPredicate([Owner](const FSubject& Candidate) { return Candidate.Owner.Get() == Owner; });
+	if (!Subject)
+	{
+		Subject = &Subjects.AddDefaulted_GetRef();
+		Subject->Owner = Owner;
+	}
+	Subject->Name = SubjectName;
+	Subject->Positions.Reset();
+	Subject->Positions.Append(Positions.GetData(), Positions.Num());
+	Subject->FrameIndex = FrameIndex;
+}
+
+void USubjectCropSubsystem::RemoveSubject(const UObject* Owner)
+{
+	Subjects.RemoveAll([Owner](const FSubject& Subject) { return Subject.Owner.Get() == Owner || !Subject.Owner.IsValid(); });
+}
+
+int32 USubjectCropSubsystem::ExportCrops(TArrayView<const FSubjectCropFrame> Frames, const FSubjectCropOutput& Output)
+{
+	if (!bEnableSubjectCrops || Subjects.Num() == 0)
+	{
+		return 0;
+	}
+	UCaptureOutputSubsystem* CaptureOutput = GetWorld() ? GetWorld()->GetSubsystem<UCaptureOutputSubsystem>() : nullptr;
+	if (Output.bWriteToContainer ? !CaptureOutput : !Output.EncoderPool)
+	{
+		UE_LOG(LogSubjectCrop, Warning, TEXT("ExportCrops: No %s to write the crops to."), Output.bWriteToContainer ? TEXT("capture output") : TEXT("encoder pool"));
+		return 0;
+	}
+
+	FSubjectCropSettings Settings;
+	Settings.OutputSize = FMath::Max(CropSize, 16);
+	Settings.Padding = FMath::Max(CropPadding, 0.0f);
+	Settings.MinSubjectSize = MinSubjectSize;
+
+	// Crop regions are found on this thread, pixels are cut and encoded on workers
+	struct FCropJob
+	{
+		int32 FrameIndex = 0;
+		int32 SubjectIndex = 0;
+		FSubjectCrop Crop;
+		// Without extension
+		FString BasePath;
+		FString FilePath;
+		TArray<FColor> Pixels;
+		TArray64<uint8> Encoded;
+		bool bSaved = false;
+	};
+	TArray<FCropJob> Jobs;
+	TArray<FVector2D> Points;
+	USubjectVisibilitySubsystem* SubjectVisibility = GetWorld() ? GetWorld()->GetSubsystem<USubjectVisibilitySubsystem>() : nullptr;
+	for (int32 FrameIndex = 0; FrameIndex < Frames.Num(); ++FrameIndex)
+	{
+		const FSubjectCropFrame& Frame = Frames[FrameIndex];
+		if (!Frame.Camera || !Frame.Pixels)
+		{
+			continue;
+		}
+		// Subjects culled for this camera are not projected
+		const int32 VisibilityCamera = SubjectVisibility ? SubjectVisibility->GetVisibility().FindCamera(Frame.Camera->Component.Get()) : INDEX_NONE;
+		for (int32 SubjectIndex = 0; SubjectIndex < Subjects.Num(); ++SubjectIndex)
+		{
+			if (SubjectVisibility && !SubjectVisibility->GetVisibility().IsVisible(VisibilityCamera, Subjects[SubjectIndex].Name))
+			{
+				continue;
+			}
+			FSubjectCrop::ProjectKeypoints(Frame.Camera->Extrinsics, Frame.Camera->Intrinsics, Subjects[SubjectIndex].Positions, Points);
+			FCropJob Job;
+			if (FSubjectCrop::FromKeypoints(Points, FIntPoint(Frame.Width, Frame.Height), Settings, Job.Crop))
+			{
+				Job.FrameIndex = FrameIndex;
+				Job.SubjectIndex = SubjectIndex;
+				Job.BasePath = FString::Printf(TEXT("%s%s_%s_%06d_Crop"), *Frame.OutputDirectory, *Frame.Camera->Name, *Subjects[SubjectIndex].Name, Subjects[SubjectIndex].FrameIndex);
+				Job.FilePath = Job.BasePath + TEXT(".") + Output.Encoding.GetExtension();
+				Jobs.Add(MoveTemp(Job));
+			}
+		}
+	}
+
+	// Container records are encoded here, files by the encoder pool while the next capture is rendered
+	ParallelFor(Jobs.Num(), [&](int32 JobIndex)
+	{
+		FCropJob& Job = Jobs[JobIndex];
+		const FSubjectCropFrame& Frame = Frames[Job.FrameIndex];
+		Job.Crop.Resample(Frame.Pixels, FIntPoint(Frame.Width, Frame.Height), Job.Pixels);
+		if (Output.bWriteToContainer)
+		{
+			Job.bSaved = FImageEncoderPool::Encode(Job.Pixels.GetData(), Job.Crop.OutputSize, Job.Crop.OutputSize, Output.Encoding, Job.Encoded, true);
+			if (!Job.bSaved)
+			{
+				UE_LOG(LogSubjectCrop, Error, TEXT("Failed to encode subject crop: %s"), *Job.FilePath);
+			}
+		}
+	});
+	for (FCropJob& Job : Jobs)
+	{
+		const FString& CameraName = Frames[Job.FrameIndex].Camera->Name;
+		const FString& SubjectName = Subjects[Job.SubjectIndex].Name;
+		if (Output.bWriteToContainer)
+		{
+			Job.bSaved = Job.bSaved && CaptureOutput->WriteRecord(UCaptureOutputSubsystem::MakeRecordName(Job.FilePath),
+				TArray<uint8>(Job.Encoded.GetData(), Job.Encoded.Num()), ECaptureIndexKind::Image, SubjectName, CameraName);
+		}
+		else
+		{
+			Job.FilePath = Output.EncoderPool->EncodeToFile(MoveTemp(Job.Pixels), Job.Crop.OutputSize, Job.Crop.OutputSize, Output.Encoding, Job.BasePath, true);
+			Job.bSaved = true;
+			if (CaptureOutput)
+			{
+				CaptureOutput->IndexFile(ECaptureIndexKind::Image, SubjectName, CameraName, Job.FilePath);
+			}
+		}
+	}
+
+	// One manifest per camera and frame with every crop's region in the frame and its intrinsics
+	int32 NumSaved = 0;
+	for (int32 FrameIndex = 0; FrameIndex < Frames.Num(); ++FrameIndex)
+	{
+		const FSubjectCropFrame& Frame = Frames[FrameIndex];
+		if (!Frame.Camera || !Frame.Pixels)
+		{
+			continue;
+		}
+
+		TArray<TSharedPtr<FJsonValue>> CropArray;
+		int32 ManifestFrame = INDEX_NONE;
+		for (const FCropJob& Job : Jobs)
+		{
+			if (Job.FrameIndex != FrameIndex || !Job.bSaved)
+			{
+				continue;
+			}
+			const FSubject& Subject = Subjects[Job.SubjectIndex];
+			const FCameraIntrinsics CropIntrinsics = Job.Crop.GetCropIntrinsics(Frame.Camera->Intrinsics);
+
+			TSharedPtr<FJsonObject> CropObj = MakeShareable(new FJsonObject());
+			CropObj->SetStringField(TEXT("Subject"), Subject.Name);
+			CropObj->SetNumberField(TEXT("Frame"), Subject.FrameIndex);
+			CropObj->SetStringField(TEXT("File"), FPaths::GetCleanFilename(Job.FilePath));
+			CropObj->SetNumberField(TEXT("X"), Job.Crop.Min.X);
+			CropObj->SetNumberField(TEXT("Y"), Job.Crop.Min.Y);
+			CropObj->SetNumberField(TEXT("Size"), Job.Crop.Size);
+			CropObj->SetNumberField(TEXT("Scale"), Job.Crop.GetScale());
+			CropObj->SetNumberField(TEXT("fx"), CropIntrinsics.FocalLengthX);
+			CropObj->SetNumberField(TEXT("fy"), CropIntrinsics.FocalLengthY);
+			CropObj->SetNumberField(TEXT("cx"), CropIntrinsics.PrincipalPointX);
+			CropObj->SetNumberField(TEXT("cy"), CropIntrinsics.PrincipalPointY);
+			CropObj->SetNumberField(TEXT("Width"), CropIntrinsics.ImageWidth);
+			CropObj->SetNumberField(TEXT("Height"), CropIntrinsics.ImageHeight);
+			CropArray.Add(MakeShareable(new FJsonValueObject(CropObj)));
+
+			ManifestFrame = FMath::Max(ManifestFrame, Subject.FrameIndex);
+			NumExportedPixels += static_cast<int64>(Job.Crop.OutputSize) * Job.Crop.OutputSize;
+			++NumSaved;
+		}
+
+		NumSourcePixels += static_cast<int64>(Frame.Width) * Frame.Height;
+		if (CropArray.Num() == 0)
+		{
+			continue;
+		}
+
+		TSharedPtr<FJsonObject> RootObj = MakeShareable(new FJsonObject());
+		RootObj->SetStringField(TEXT("CameraName"), Frame.Camera->Name);
+		RootObj->SetNumberField(TEXT("ImageWidth"), Frame.Width);
+		RootObj->SetNumberField(TEXT("ImageHeight"), Frame.Height);
+		RootObj->SetArrayField(TEXT("Crops"), CropArray);
+
+		FString OutputString;
+		TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&OutputString);
+		FJsonSerializer::Serialize(RootObj.ToSharedRef(), Writer);
+		const FString ManifestPath = FString::Printf(TEXT("%s%s_Crops_%06d.json"), *Frame.OutputDirectory, *Frame.Camera->Name, ManifestFrame);
+		if (Output.bWriteToContainer)
+		{
+			CaptureOutput->WriteTextRecord(UCaptureOutputSubsystem::MakeRecordName(ManifestPath), OutputString, ECaptureIndexKind::Calibration, FString(), Frame.Camera->Name);
+		}
+		else if (!FFileHelper::SaveStringToFile(OutputString, *ManifestPath))
+		{
+			UE_LOG(LogSubjectCrop, Warning, TEXT("ExportCrops: Failed to write %s"), *ManifestPath);
+		}
+		else if (CaptureOutput)
+		{
+			CaptureOutput->IndexFile(ECaptureIndexKind::Calibration, FString(), Frame.Camera->Name, ManifestPath);
+		}
+	}
+
+	NumExportedCrops += NumSaved;
+	return NumSaved;
+}
@@ -0,0 +1,99 @@
+// SubjectCropSubsystem.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SubjectCrop.h"
+#include "ImageEncoderPool.h"
+#include "SubjectCropSubsystem.generated.h"
+
+struct FRegisteredCamera;
+
+/** One captured camera frame handed to USubjectCropSubsystem::ExportCrops. */
+struct FSubjectCropFrame
+{
+	const FRegisteredCamera* Camera = nullptr;
+	// Width x Height BGRA pixels, tightly packed
+	const FColor* Pixels = nullptr;
+	int32 Width = 0;
+	int32 Height = 0;
+	// Directory the camera's crops and manifests are written to (or named after in the container)
+	FString OutputDirectory;
+};
+
+/** How USubjectCropSubsystem::ExportCrops writes the crops, set by the capturing ACameraDataManager. */
+struct FSubjectCropOutput
+{
+	FCaptureImageEncoding Encoding;
+	// Writes crops and manifests as records of the run's container instead of files
+	bool bWriteToContainer = false;
+	// Encodes and writes the crop files on worker threads
+	FImageEncoderPool* EncoderPool = nullptr;
+};
+
+/**
+ * Exports per-subject crops of every captured camera frame instead of (or next to) the full frames, since pose models
+ * train on person crops and most of a full frame is background. Subjects (see USkeletalExtractor::bExportSubjectCrops)
+ * submit their Body keypoints every streamed frame; each camera frame is cut into padded square crops around the
+ * projected keypoints of every subject the USubjectVisibilitySubsystem did not cull for its camera, resampled to
+ * CropSize on worker threads and written with the manager's FrameEncoding to <Camera>_<Subject>_<Frame>_Crop in the
+ * camera's SubjectCrops/ output directory (see UCameraDataComponent::OutputSubdirectory), or to the run's container if
+ * ACameraDataManager::bWriteToContainer is set. <Camera>_Crops_<Frame>.json next to them holds every crop's region and
+ * its crop-adjusted intrinsics. Set ACameraDataManager::bSaveFullFrames to false to write only the crops.
+ */
+UCLASS(config = Game)
+class EXTRACTJOINTLOCATION_API USubjectCropSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	USubjectCropSubsystem();
+
+	virtual void Deinitialize() override;
+
+	/** True if crops are exported, i.e. callers should read back pixels for ExportCrops. */
+	bool IsEnabled() const { return bEnableSubjectCrops; }
+
+	/** Updates a subject's keypoints for the frames cropped next, adding the subject on first use. */
+	void SubmitSubjectKeypoints(const UObject* Owner, const FString& SubjectName, int32 FrameIndex, TArrayView<const FVector> Positions);
+
+	/** Removes a subject from the exported crops. */
+	void RemoveSubject(const UObject* Owner);
+
+	/**
+	 * Crops every subject out of every frame and writes the crops and their manifests. Crop files are written by
+	 * Output.EncoderPool in the background, container records before this returns.
+	 * @return Number of crops written.
+	 */
+	int32 ExportCrops(TArrayView<const FSubjectCropFrame> Frames, const FSubjectCropOutput& Output);
+
+	/** Exports subject crops of captured frames. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Subject Crops")
+	bool bEnableSubjectCrops;
+
+	/** Side length (pixels) of the square crops. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Subject Crops", meta = (ClampMin = "16"))
+	int32 CropSize;
+
+	/** Margin around the keypoint box on every side, as a fraction of the box's longer side. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Subject Crops", meta = (ClampMin = "0.0"))
+	float CropPadding;
+
+	/** Subjects whose keypoint box is smaller than this (pixels) in a camera are not cropped from it. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Subject Crops")
+	float MinSubjectSize;
+
+private:
+	struct FSubject
+	{
+		TWeakObjectPtr<const UObject> Owner;
+		FString Name;
+		TArray<FVector> Positions;
+		int32 FrameIndex = INDEX_NONE;
+	};
+
+	TArray<FSubject> Subjects;
+	int32 NumExportedCrops = 0;
+	int64 NumExportedPixels = 0;
+	int64 NumSourcePixels = 0;
+};
@@ -0,0 +1,205 @@
+#include "SubjectCropValidationCommandlet.h"
+#include "HAL/PlatformTime.h"
+#include "ImageCore.h"
+#include "ImageUtils.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogSubjectCropValidation, Log, All);
+
+namespace SubjectCropValidation
+{
+	static const FIntPoint ImageSize(1920, 1080);
+	// Keypoint grid of a roughly person sized subject (cm), dots far enough apart not to touch in the frame
+	static constexpr int32 GridColumns = 5;
+	static constexpr int32 GridRows = 12;
+	static constexpr double ColumnSpacing = 12.0;
+	static constexpr double RowSpacing = 16.0;
+	static constexpr double DotRadius = 8.0;
+	// Per channel difference allowed between a dot and the crop pixel at its keypoint
+	static constexpr int32 ColorTolerance = 12;
+	static constexpr int32 ResampleRepeats = 20;
+
+	static FColor GetDotColor(int32 KeypointIndex)
+	{
+		return FColor(64 + (KeypointIndex * 53) % 192, 64 + (KeypointIndex * 97) % 192, 64 + (KeypointIndex * 29) % 192, 255);
+	}
+
+	static FCameraIntrinsics MakeIntrinsics()
+	{
+		FCameraIntrinsics Intrinsics;
+		Intrinsics.FocalLengthX = 1000.0f;
+		Intrinsics.FocalLengthY = 1000.0f;
+		Intrinsics.PrincipalPointX = ImageSize.X / 2.0f;
+		Intrinsics.PrincipalPointY = ImageSize.Y / 2.0f;
+		Intrinsics.ImageWidth = ImageSize.X;
+		Intrinsics.ImageHeight = ImageSize.Y;
+		return Intrinsics;
+	}
+
+	static bool IsInImage(const FVector2D& Point, const FIntPoint& Size)
+	{
+		return Point.X >= 0.0 && Point.Y >= 0.0 && Point.X < Size.X && Point.Y < Size.Y;
+	}
+}
+
+USubjectCropValidationCommandlet::USubjectCropValidationCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 USubjectCropValidationCommandlet::Main(const FString& Params)
+{
+	TArray<FString> Tokens;
+	TArray<FString> Switches;
+	TMap<FString, FString> ParamsMap;
+	ParseCommandLine(*Params, Tokens, Switches, ParamsMap);
+
+	FSubjectCropSettings Settings;
+	Settings.OutputSize = ParamsMap.Contains(TEXT("CropSize")) ? FCString::Atoi(*ParamsMap[TEXT("CropSize")]) : Settings.OutputSize;
+	Settings.Padding = ParamsMap.Contains(TEXT("Padding")) ? FCString::Atof(*ParamsMap[TEXT("Padding")]) : Settings.Padding;
+	const bool bWriteImages = Switches.Contains(TEXT("WriteImages"));
+	if (Settings.OutputSize < 16)
+	{
+		UE_LOG(LogSubjectCropValidation, Error, TEXT("Usage: -run=SubjectCropValidation [-CropSize=256] [-Padding=0.2] [-WriteImages]"));
+		return 1;
+	}
+
+	const FCase Cases[] = {
+		{ TEXT("Centered"), FVector(400.0, 0.0, 0.0), true },
+		{ TEXT("LeavingFrame"), FVector(400.0, 370.0, 0.0), true },
+		{ TEXT("BehindCamera"), FVector(-400.0, 0.0, 0.0), false },
+		{ TEXT("TooSmall"), FVector(40000.0, 0.0, 0.0), false } };
+
+	const int32 NumCases = UE_ARRAY_COUNT(Cases);
+	int32 NumFailed = 0;
+	double ResampleMilliseconds = 0.0;
+	for (const FCase& Case : Cases)
+	{
+		double CaseMilliseconds = 0.0;
+		if (!RunCase(Case, Settings, bWriteImages, CaseMilliseconds))
+		{
+			++NumFailed;
+		}
+		ResampleMilliseconds = FMath::Max(ResampleMilliseconds, CaseMilliseconds);
+	}
+
+	const double CropBytes = static_cast<double>(Settings.OutputSize) * Settings.OutputSize;
+	const double FrameBytes = static_cast<double>(SubjectCropValidation::ImageSize.X) * SubjectCropValidation::ImageSize.Y;
+	UE_LOG(LogSubjectCropValidation, Display, TEXT("%d of %d cases passed. A %dx%d crop takes %.2f ms to resample and holds %.1f %% of a %dx%d frame's pixels."),
+		NumCases - NumFailed, NumCases, Settings.OutputSize, Settings.OutputSize, ResampleMilliseconds,
+		100.0 * CropBytes / FrameBytes, SubjectCropValidation::ImageSize.X, SubjectCropValidation::ImageSize.Y);
+	return NumFailed > 0 ? 1 : 0;
+}
+
+bool USubjectCropValidationCommandlet::RunCase(const FCase& Case, const FSubjectCropSettings& Settings, bool bWriteImages, double& OutResampleMilliseconds)
+{
+	using namespace SubjectCropValidation;
+	const FCameraIntrinsics Intrinsics = MakeIntrinsics();
+	const FTransform Extrinsics = FTransform::Identity;
+
+	TArray<FVector> Positions;
+	for (int32 Row = 0; Row < GridRows; ++Row)
+	{
+		for (int32 Column = 0; Column < GridColumns; ++Column)
+		{
+			Positions.Add(Case.Center + FVector(0.0, (Column - (GridColumns - 1) * 0.5) * ColumnSpacing, (Row - (GridRows - 1) * 0.5) * RowSpacing));
+		}
+	}
+
+	// Synthetic frame: black, with every keypoint in the image drawn as a dot of its own colour
+	TArray<FVector2D> Points;
+	FSubjectCrop::ProjectKeypoints(Extrinsics, Intrinsics, Positions, Points);
+	const bool bAllInFront = Points.Num() == Positions.Num();
+	TArray<FColor> Frame;
+	Frame.SetNumZeroed(ImageSize.X * ImageSize.Y);
+	for (int32 KeypointIndex = 0; bAllInFront && KeypointIndex < Points.Num(); ++KeypointIndex)
+	{
+		const FVector2D& Point = Points[KeypointIndex];
+		const int32 MinX = FMath::Max(FMath::FloorToInt32(Point.X - DotRadius), 0);
+		const int32 MaxX = FMath::Min(FMath::CeilToInt32(Point.X + DotRadius), ImageSize.X - 1);
+		const int32 MinY = FMath::Max(FMath::FloorToInt32(Point.Y - DotRadius), 0);
+		const int32 MaxY = FMath::Min(FMath::CeilToInt32(Point.Y + DotRadius), ImageSize.Y - 1);
+		for (int32 Y = MinY; Y <= MaxY; ++Y)
+		{
+			for (int32 X = MinX; X <= MaxX; ++X)
+			{
+				if (FVector2D::DistSquared(FVector2D(X + 0.5, Y + 0.5), Point) <= DotRadius * DotRadius)
+				{
+					Frame[Y * ImageSize.X + X] = GetDotColor(KeypointIndex);
+				}
+			}
+		}
+	}
+
+	FSubjectCrop Crop;
+	const bool bCropped = FSubjectCrop::FromKeypoints(Points, ImageSize, Settings, Crop);
+	if (bCropped != Case.bExpectCrop)
+	{
+		UE_LOG(LogSubjectCropValidation, Error, TEXT("%s: expected %s crop."), Case.Name, Case.bExpectCrop ? TEXT("a") : TEXT("no"));
+		return false;
+	}
+	if (!bCropped)
+	{
+		UE_LOG(LogSubjectCropValidation, Display, TEXT("%s: not cropped, as expected."), Case.Name);
+		return true;
+	}
+
+	TArray<FColor> CropPixels;
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 Repeat = 0; Repeat < ResampleRepeats; ++Repeat)
+	{
+		Crop.Resample(Frame.GetData(), ImageSize, CropPixels);
+	}
+	OutResampleMilliseconds = (FPlatformTime::Seconds() - StartTime) * 1000.0 / ResampleRepeats;
+
+	// Every keypoint in the frame must project with the crop's intrinsics onto its dot
+	const FCameraIntrinsics CropIntrinsics = Crop.GetCropIntrinsics(Intrinsics);
+	int32 NumChecked = 0;
+	int32 NumMismatched = 0;
+	for (int32 KeypointIndex = 0; KeypointIndex < Positions.Num(); ++KeypointIndex)
+	{
+		const FVector Local = Extrinsics.InverseTransformPositionNoScale(Positions[KeypointIndex]);
+		const FVector2D CropPoint(CropIntrinsics.PrincipalPointX + CropIntrinsics.FocalLengthX * Local.Y / Local.X,
+			CropIntrinsics.PrincipalPointY - CropIntrinsics.FocalLengthY * Local.Z / Local.X);
+		if (!IsInImage(Points[KeypointIndex], ImageSize) || !IsInImage(CropPoint, FIntPoint(Crop.OutputSize)))
+		{
+			continue;
+		}
+		++NumChecked;
+
+		const FVector2D Expected = Crop.ImageToCrop(Points[KeypointIndex]);
+		const FColor& Pixel = CropPixels[FMath::FloorToInt32(CropPoint.Y) * Crop.OutputSize + FMath::FloorToInt32(CropPoint.X)];
+		const FColor Dot = GetDotColor(KeypointIndex);
+		const bool bColorMatches = FMath::Abs(Pixel.R - Dot.R) <= ColorTolerance && FMath::Abs(Pixel.G - Dot.G) <= ColorTolerance && FMath::Abs(Pixel.B - Dot.B) <= ColorTolerance;
+		if (!Expected.Equals(CropPoint, 1e-2) || !bColorMatches)
+		{
+			UE_LOG(LogSubjectCropValidation, Error, TEXT("%s: keypoint %d at crop (%.2f, %.2f), expected (%.2f, %.2f), pixel %s, dot %s."), Case.Name, KeypointIndex,
+				CropPoint.X, CropPoint.Y, Expected.X, Expected.Y, *Pixel.ToString(), *Dot.ToString());
+			++NumMismatched;
+		}
+	}
+
+	// The crop stays centred on the subject, so the part past the frame's edge must be black
+	bool bOutsideBlack = true;
+	const FVector2D PastEdge = Crop.ImageToCrop(FVector2D(ImageSize.X + DotRadius, Crop.Min.Y + Crop.Size * 0.5));
+	if (IsInImage(PastEdge, FIntPoint(Crop.OutputSize)))
+	{
+		const FColor& Pixel = CropPixels[FMath::FloorToInt32(PastEdge.Y) * Crop.OutputSize + FMath::FloorToInt32(PastEdge.X)];
+		bOutsideBlack = Pixel.R == 0 && Pixel.G == 0 && Pixel.B == 0;
+	}
+
+	if (bWriteImages)
+	{
+		const FString Directory = FPaths::ProjectSavedDir() + TEXT("SubjectCropValidation/");
+		FImageUtils::SaveImageByExtension(*(Directory + Case.Name + TEXT("_Frame.png")), FImageView(Frame.GetData(), ImageSize.X, ImageSize.Y));
+		FImageUtils::SaveImageByExtension(*(Directory + Case.Name + TEXT("_Crop.png")), FImageView(CropPixels.GetData(), Crop.OutputSize, Crop.OutputSize));
+	}
+
+	const bool bPassed = NumChecked > 0 && NumMismatched == 0 && bOutsideBlack;
+	UE_LOG(LogSubjectCropValidation, Display, TEXT("%s: crop at (%.1f, %.1f) size %.1f, %d keypoints checked, %d mismatched%s."), Case.Name,
+		Crop.Min.X, Crop.Min.Y, Crop.Size, NumChecked, NumMismatched, bOutsideBlack ? TEXT("") : TEXT(", region past the frame is not black"));
+	return bPassed;
+}
@@ -0,0 +1,38 @@
+// SubjectCropValidationCommandlet.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "SubjectCrop.h"
+#include "SubjectCropValidationCommandlet.generated.h"
+
+/**
+ * Checks FSubjectCrop on synthetic frames, without rendering, so it runs under -nullrhi.
+ * Every case draws a grid of keypoints as coloured dots into a black 1920x1080 frame, crops the subject and checks
+ * that each keypoint projected with the crop-adjusted intrinsics lands on its dot in the crop. Cases cover a subject
+ * in the middle of the frame, one leaving the frame, one behind the camera and one too small to crop.
+ *
+ * UnrealEditor-Cmd Project.uproject -run=SubjectCropValidation -nullrhi [-CropSize=256] [-Padding=0.2] [-WriteImages]
+ * -WriteImages saves every case's frame and crop to Saved/SubjectCropValidation/. Returns 1 if any check fails.
+ */
+UCLASS()
+class EXTRACTJOINTLOCATION_API USubjectCropValidationCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	USubjectCropValidationCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	struct FCase
+	{
+		const TCHAR* Name;
+		// Centre of the keypoint grid in the camera's frame (X forward, Y right, Z up)
+		FVector Center;
+		bool bExpectCrop;
+	};
+
+	static bool RunCase(const FCase& Case, const FSubjectCropSettings& Settings, bool bWriteImages, double& OutResampleMilliseconds);
+};
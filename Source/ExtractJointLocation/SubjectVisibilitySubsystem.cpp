@@ -0,0 +1,326 @@
+#include "SubjectVisibilitySubsystem.h"
+#include "CameraRegistrySubsystem.h"
+#include "Components/SkinnedMeshComponent.h"
+#include "Engine/World.h"
+#include "HAL/PlatformTime.h"
+#include "Stats/Stats.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogSubjectVisibility, Log, All);
+
+DECLARE_STATS_GROUP(TEXT("SubjectVisibility"), STATGROUP_SubjectVisibility, STATCAT_Advanced);
+DECLARE_CYCLE_STAT(TEXT("Cull Subjects"), STAT_SubjectVisibilityCull, STATGROUP_SubjectVisibility);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Culled Ratio"), STAT_SubjectVisibilityCulledRatio, STATGROUP_SubjectVisibility);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Tested Pairs"), STAT_SubjectVisibilityTestedPairs, STATGROUP_SubjectVisibility);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Visible Pairs"), STAT_SubjectVisibilityVisiblePairs, STATGROUP_SubjectVisibility);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Box Tests"), STAT_SubjectVisibilityBoxTests, STATGROUP_SubjectVisibility);
+
+USubjectVisibilitySubsystem::USubjectVisibilitySubsystem()
+{
+	// Joints sit inside the body, 15 cm covers the torso and head around them
+	JointBoundsPadding = 15.0f;
+	NearClipDistance = 10.0f;
+	MaxCameraDistance = 0.0f;
+}
+
+void USubjectVisibilitySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &USubjectVisibilitySubsystem::OnWorldPostActorTick);
+}
+
+void USubjectVisibilitySubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+	if (NumEvaluatedFrames > 0 && NumTestedPairs > 0)
+	{
+		UE_LOG(LogSubjectVisibility, Log, TEXT("Culled %.1f%% of %lld subject/camera pairs over %d frames, %.3f ms per frame."),
+			100.0 * (1.0 - static_cast<double>(NumVisiblePairs) / NumTestedPairs), NumTestedPairs, NumEvaluatedFrames,
+			FPlatformTime::ToMilliseconds64(EvaluateCycles) / NumEvaluatedFrames);
+	}
+	Super::Deinitialize();
+}
+
+void USubjectVisibilitySubsystem::UpdateSubject(const UObject* Owner, const FString& SubjectName, const USkinnedMeshComponent* Mesh, TArrayView<const FVector> JointPositions)
+{
+	if (!Owner)
+	{
+		return;
+	}
+
+	FBox Box(ForceInit);
+	if (Mesh && Mesh->GetPhysicsAsset())
+	{
+		// Skinned mesh bounds are computed from the physics asset bodies when the mesh has one
+		Box = Mesh->Bounds.GetBox();
+	}
+	else if (JointPositions.Num() > 0)
+	{
+		Box = FBox(JointPositions.GetData(), JointPositions.Num()).ExpandBy(JointBoundsPadding);
+	}
+	if (!Box.IsValid)
+	{
+		return;
+	}
+
+	// Subjects not updated in this frame are left out of its culling
+	if (UpdateFrame != GFrameCounter)
+	{
+		UpdateFrame = GFrameCounter;
+		for (FSubject& Subject : Subjects)
+		{
+			Subject.bUpdated = false;
+		}
+	}
+
+	int32 SubjectIndex = INDEX_NONE;
+	if (const int32* ExistingSubject = SubjectsByOwner.Find(Owner))
+	{
+		SubjectIndex = *ExistingSubject;
+	}
+	else
+	{
+		SubjectIndex = Subjects.AddDefaulted();
+		Subjects[SubjectIndex].Owner = Owner;
+		SubjectsByOwner.Add(Owner, SubjectIndex);
+	}
+
+	FSubject& Subject = Subjects[SubjectIndex];
+	Subject.Name = SubjectName;
+	Box.GetCenterAndExtents(Subject.Center, Subject.Extent);
+	Subject.Radius = Subject.Extent.Size();
+	Subject.bUpdated = true;
+	bVisibilityStale = true;
+}
+
+void USubjectVisibilitySubsystem::RemoveSubject(const UObject* Owner)
+{
+	int32 SubjectIndex = INDEX_NONE;
+	if (!SubjectsByOwner.RemoveAndCopyValue(Owner, SubjectIndex))
+	{
+		return;
+	}
+
+	Subjects.RemoveAtSwap(SubjectIndex);
+	if (Subjects.IsValidIndex(SubjectIndex))
+	{
+		SubjectsByOwner.Add(Subjects[SubjectIndex].Owner.Get(), SubjectIndex);
+	}
+	bVisibilityStale = true;
+}
+
+const FSubjectVisibilityList& USubjectVisibilitySubsystem::GetVisibility()
+{
+	// Captures read the visibility before OnWorldPostActorTick, after the subjects have submitted the frame
+	if (bVisibilityStale)
+	{
+		EvaluateFrame();
+	}
+	return Visibility;
+}
+
+void USubjectVisibilitySubsystem::GetVisibleSubjects(const UCameraDataComponent* Camera, TArray<FString>& OutSubjectNames)
+{
+	OutSubjectNames.Reset();
+	const FSubjectVisibilityList& CurrentVisibility = GetVisibility();
+	const int32 CameraIndex = CurrentVisibility.FindCamera(Camera);
+	if (CameraIndex != INDEX_NONE)
+	{
+		for (const int32 SubjectIndex : CurrentVisibility.GetVisibleSubjects(CameraIndex))
+		{
+			OutSubjectNames.Add(CurrentVisibility.SubjectNames[SubjectIndex]);
+		}
+	}
+}
+
+void USubjectVisibilitySubsystem::OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
+{
+	// All subjects have submitted the frame once every actor has ticked; subjects updated after a capture read it are culled again
+	if (World == GetWorld() && bVisibilityStale)
+	{
+		EvaluateFrame();
+	}
+}
+
+void USubjectVisibilitySubsystem::BuildFrustums()
+{
+	Visibility.Cameras.Reset();
+	FrustumGroups.Reset();
+
+	UCameraRegistrySubsystem* CameraRegistry = GetWorld()->GetSubsystem<UCameraRegistrySubsystem>();
+	if (!CameraRegistry)
+	{
+		return;
+	}
+	BuiltCameraRevision = CameraRegistry->GetRevision();
+
+	TArray<FPlane, TInlineAllocator<NumFrustumPlanes * 4>> GroupPlanes;
+	for (const FRegisteredCamera& Camera : CameraRegistry->GetCameras())
+	{
+		const FCameraIntrinsics* Intrinsics = &Camera.Intrinsics;
+		if (!Camera.Component.IsValid() || !Camera.bHasIntrinsics || Intrinsics->ImageWidth <= 0 || Intrinsics->ImageHeight <= 0
+			|| Intrinsics->FocalLengthX <= 0.0f || Intrinsics->FocalLengthY <= 0.0f)
+		{
+			continue;
+		}
+
+		// Inward planes in camera space (X forward, Y right, Z up), through the image edges u = 0, u = W, v = 0, v = H
+		// of the pinhole projection u = cx + fx * Y / X, v = cy - fy * Z / X
+		const double Fx = Intrinsics->FocalLengthX;
+		const double Fy = Intrinsics->FocalLengthY;
+		const double Cx = Intrinsics->PrincipalPointX;
+		const double Cy = Intrinsics->PrincipalPointY;
+		const FVector LocalNormals[NumFrustumPlanes] =
+		{
+			FVector(Cx, Fx, 0.0).GetUnsafeNormal(),
+			FVector(Intrinsics->ImageWidth - Cx, -Fx, 0.0).GetUnsafeNormal(),
+			FVector(Cy, 0.0, -Fy).GetUnsafeNormal(),
+			FVector(Intrinsics->ImageHeight - Cy, 0.0, Fy).GetUnsafeNormal(),
+			FVector::ForwardVector,
+			FVector::BackwardVector
+		};
+		const double LocalDistances[NumFrustumPlanes] =
+		{
+			0.0, 0.0, 0.0, 0.0, -NearClipDistance, MaxCameraDistance > 0.0f ? MaxCameraDistance : UE_BIG_NUMBER
+		};
+
+		const FTransform& Extrinsics = Camera.Extrinsics;
+		for (int32 Plane = 0; Plane < NumFrustumPlanes; ++Plane)
+		{
+			const FVector Normal = Extrinsics.GetRotation().RotateVector(LocalNormals[Plane]);
+			GroupPlanes.Add(FPlane(Normal.X, Normal.Y, Normal.Z, LocalDistances[Plane] - FVector::DotProduct(Normal, Extrinsics.GetLocation())));
+		}
+		Visibility.Cameras.Add(Camera.Component);
+
+		if (GroupPlanes.Num() == NumFrustumPlanes)
+		{
+			FrustumGroups.AddDefaulted();
+		}
+
+		// Rewrite the last group from all its cameras' planes; unused lanes get planes nothing is inside of
+		FFrustumGroup& Group = FrustumGroups.Last();
+		const int32 NumLanes = GroupPlanes.Num() / NumFrustumPlanes;
+		Group.LaneMask = (1 << NumLanes) - 1;
+		for (int32 Plane = 0; Plane < NumFrustumPlanes; ++Plane)
+		{
+			auto LanePlane = [&GroupPlanes, NumLanes, Plane](int32 Lane) { return Lane < NumLanes ? GroupPlanes[Lane * NumFrustumPlanes + Plane] : FPlane(0.0, 0.0, 0.0, -UE_BIG_NUMBER); };
+			const FPlane P0 = LanePlane(0), P1 = LanePlane(1), P2 = LanePlane(2), P3 = LanePlane(3);
+			Group.NormalX[Plane] = MakeVectorRegisterFloat(float(P0.X), float(P1.X), float(P2.X), float(P3.X));
+			Group.NormalY[Plane] = MakeVectorRegisterFloat(float(P0.Y), float(P1.Y), float(P2.Y), float(P3.Y));
+			Group.NormalZ[Plane] = MakeVectorRegisterFloat(float(P0.Z), float(P1.Z), float(P2.Z), float(P3.Z));
+			Group.Distance[Plane] = MakeVectorRegisterFloat(float(P0.W), float(P1.W), float(P2.W), float(P3.W));
+		}
+		if (NumLanes == 4)
+		{
+			GroupPlanes.Reset();
+		}
+	}
+}
+
+void USubjectVisibilitySubsystem::EvaluateFrame()
+{
+	SCOPE_CYCLE_COUNTER(STAT_SubjectVisibilityCull);
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
+	// Frustums are only rebuilt when a camera was added, removed, moved or changed its lens
+	UCameraRegistrySubsystem* CameraRegistry = GetWorld()->GetSubsystem<UCameraRegistrySubsystem>();
+	if (CameraRegistry && (CameraRegistry->RefreshCalibration() > 0 || CameraRegistry->GetRevision() != BuiltCameraRevision))
+	{
+		BuildFrustums();
+	}
+
+	Visibility.SubjectNames.Reset();
+	TArray<const FSubject*, TInlineAllocator<64>> FrameSubjects;
+	for (const FSubject& Subject : Subjects)
+	{
+		if (Subject.bUpdated)
+		{
+			FrameSubjects.Add(&Subject);
+			Visibility.SubjectNames.Add(Subject.Name);
+		}
+	}
+	bVisibilityStale = false;
+
+	// Level 1: bounding spheres against four frustums at once. Pairs whose sphere straddles a plane go to
+	// level 2, the box against the same planes with its extent projected onto each plane normal.
+	const int32 NumSubjects = FrameSubjects.Num();
+	VisibleLanes.SetNumUninitialized(FrustumGroups.Num() * NumSubjects);
+	int32 NumBoxTests = 0;
+	const VectorRegister4Float Zero = VectorZeroFloat();
+	for (int32 GroupIndex = 0; GroupIndex < FrustumGroups.Num(); ++GroupIndex)
+	{
+		const FFrustumGroup& Group = FrustumGroups[GroupIndex];
+		for (int32 SubjectIndex = 0; SubjectIndex < NumSubjects; ++SubjectIndex)
+		{
+			const FSubject& Subject = *FrameSubjects[SubjectIndex];
+			const VectorRegister4Float CenterX = VectorSetFloat1(float(Subject.Center.X));
+			const VectorRegister4Float CenterY = VectorSetFloat1(float(Subject.Center.Y));
+			const VectorRegister4Float CenterZ = VectorSetFloat1(float(Subject.Center.Z));
+			const VectorRegister4Float Radius = VectorSetFloat1(float(Subject.Radius));
+
+			VectorRegister4Float MinDistance = VectorSetFloat1(UE_BIG_NUMBER);
+			for (int32 Plane = 0; Plane < NumFrustumPlanes; ++Plane)
+			{
+				const VectorRegister4Float Distance = VectorMultiplyAdd(Group.NormalX[Plane], CenterX,
+					VectorMultiplyAdd(Group.NormalY[Plane], CenterY, VectorMultiplyAdd(Group.NormalZ[Plane], CenterZ, Group.Distance[Plane])));
+				MinDistance = VectorMin(MinDistance, Distance);
+			}
+
+			const int32 Outside = VectorMaskBits(VectorCompareLT(MinDistance, VectorNegate(Radius)));
+			const int32 Inside = VectorMaskBits(VectorCompareGE(MinDistance, Radius));
+			const int32 Straddling = Group.LaneMask & ~Outside & ~Inside;
+			int32 Visible = Group.LaneMask & Inside;
+
+			if (Straddling != 0)
+			{
+				const VectorRegister4Float ExtentX = VectorSetFloat1(float(Subject.Extent.X));
+				const VectorRegister4Float ExtentY = VectorSetFloat1(float(Subject.Extent.Y));
+				const VectorRegister4Float ExtentZ = VectorSetFloat1(float(Subject.Extent.Z));
+				VectorRegister4Float MinBoxDistance = VectorSetFloat1(UE_BIG_NUMBER);
+				for (int32 Plane = 0; Plane < NumFrustumPlanes; ++Plane)
+				{
+					// Signed distance of the box corner furthest along the plane normal
+					const VectorRegister4Float Center = VectorMultiplyAdd(Group.NormalX[Plane], CenterX,
+						VectorMultiplyAdd(Group.NormalY[Plane], CenterY, VectorMultiplyAdd(Group.NormalZ[Plane], CenterZ, Group.Distance[Plane])));
+					const VectorRegister4Float Reach = VectorMultiplyAdd(VectorAbs(Group.NormalX[Plane]), ExtentX,
+						VectorMultiplyAdd(VectorAbs(Group.NormalY[Plane]), ExtentY, VectorMultiply(VectorAbs(Group.NormalZ[Plane]), ExtentZ)));
+					MinBoxDistance = VectorMin(MinBoxDistance, VectorAdd(Center, Reach));
+				}
+				Visible |= Straddling & ~VectorMaskBits(VectorCompareLT(MinBoxDistance, Zero));
+				NumBoxTests += FMath::CountBits(Straddling);
+			}
+
+			VisibleLanes[GroupIndex * NumSubjects + SubjectIndex] = static_cast<uint8>(Visible);
+		}
+	}
+
+	// Compact camera-major list for the per-camera stages
+	const int32 NumCameras = Visibility.Cameras.Num();
+	Visibility.CameraStarts.Reset(NumCameras + 1);
+	Visibility.VisibleSubjects.Reset();
+	Visibility.CameraStarts.Add(0);
+	for (int32 CameraIndex = 0; CameraIndex < NumCameras; ++CameraIndex)
+	{
+		const uint8* GroupLanes = VisibleLanes.GetData() + (CameraIndex / 4) * NumSubjects;
+		const uint8 LaneBit = static_cast<uint8>(1 << (CameraIndex % 4));
+		for (int32 SubjectIndex = 0; SubjectIndex < NumSubjects; ++SubjectIndex)
+		{
+			if (GroupLanes[SubjectIndex] & LaneBit)
+			{
+				Visibility.VisibleSubjects.Add(SubjectIndex);
+			}
+		}
+		Visibility.CameraStarts.Add(Visibility.VisibleSubjects.Num());
+	}
+
+	const int32 NumPairs = NumCameras * NumSubjects;
+	CulledRatio = NumPairs > 0 ? 1.0f - static_cast<float>(Visibility.VisibleSubjects.Num()) / NumPairs : 0.0f;
+	SET_FLOAT_STAT(STAT_SubjectVisibilityCulledRatio, CulledRatio);
+	SET_DWORD_STAT(STAT_SubjectVisibilityTestedPairs, NumPairs);
+	SET_DWORD_STAT(STAT_SubjectVisibilityVisiblePairs, Visibility.VisibleSubjects.Num());
+	SET_DWORD_STAT(STAT_SubjectVisibilityBoxTests, NumBoxTests);
+
+	NumTestedPairs += NumPairs;
+	NumVisiblePairs += Visibility.VisibleSubjects.Num();
+	EvaluateCycles += FPlatformTime::Cycles64() - StartCycles;
+	++NumEvaluatedFrames;
+}
@@ -0,0 +1,154 @@
+// SubjectVisibilitySubsystem.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CameraDataComponent.h"
+#include "SubjectVisibilitySubsystem.generated.h"
+
+class USkinnedMeshComponent;
+
+/**
+ * Subject/camera pairs that survived culling in the current frame, camera-major: the subjects seen by
+ * Cameras[C] are SubjectNames[VisibleSubjects[CameraStarts[C]]] .. SubjectNames[VisibleSubjects[CameraStarts[C + 1] - 1]].
+ */
+struct FSubjectVisibilityList
+{
+	TArray<TWeakObjectPtr<UCameraDataComponent>> Cameras;
+	TArray<FString> SubjectNames;
+	TArray<int32> CameraStarts;
+	TArray<int32> VisibleSubjects;
+
+	TArrayView<const int32> GetVisibleSubjects(int32 CameraIndex) const
+	{
+		return TArrayView<const int32>(VisibleSubjects).Slice(CameraStarts[CameraIndex], CameraStarts[CameraIndex + 1] - CameraStarts[CameraIndex]);
+	}
+
+	int32 FindCamera(const UCameraDataComponent* Camera) const
+	{
+		return Camera ? Cameras.IndexOfByPredicate([Camera](const TWeakObjectPtr<UCameraDataComponent>& Candidate) { return Candidate.Get() == Camera; }) : INDEX_NONE;
+	}
+
+	/** False only if the subject was culled for the camera; subjects and cameras that were not evaluated count as visible. */
+	bool IsVisible(int32 CameraIndex, const FString& SubjectName) const
+	{
+		if (CameraIndex == INDEX_NONE || !SubjectNames.Contains(SubjectName))
+		{
+			return true;
+		}
+		return GetVisibleSubjects(CameraIndex).ContainsByPredicate([this, &SubjectName](int32 SubjectIndex) { return SubjectNames[SubjectIndex] == SubjectName; });
+	}
+};
+
+/**
+ * Culls subject/camera pairs before any per-camera projection or labelling, so work scales with the pairs that can
+ * actually see each other instead of subjects x cameras.
+ * Subjects (see USkeletalExtractor::bReportCameraVisibility) submit their bounds every captured frame: the mesh's
+ * physics asset bounds where it has one, otherwise the AABB of its joints padded by JointBoundsPadding. The frame is
+ * culled the first time its visibility is read after a subject was updated (e.g. by ACameraDataManager's capture timer,
+ * which runs before the end of the frame), or once all actors have ticked if nothing read it. The frustums of the
+ * UCameraRegistrySubsystem cameras, rebuilt only when a camera changed, are tested four cameras at a time with SIMD:
+ * every subject's bounding sphere first, and its box only for the cameras whose frustum the sphere straddles.
+ * The culled ratio is published in "stat SubjectVisibility".
+ */
+UCLASS(config = Game)
+class EXTRACTJOINTLOCATION_API USubjectVisibilitySubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	USubjectVisibilitySubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/**
+	 * Updates a subject's bounds for the current frame, adding the subject on first use.
+	 * @param Owner Identifies the subject, e.g. its extractor.
+	 * @param Mesh Its physics asset bounds are used when present.
+	 * @param JointPositions World-space joints bounding the subject when the mesh has no physics asset.
+	 */
+	void UpdateSubject(const UObject* Owner, const FString& SubjectName, const USkinnedMeshComponent* Mesh, TArrayView<const FVector> JointPositions);
+
+	/** Removes a subject from culling. */
+	void RemoveSubject(const UObject* Owner);
+
+	/** Visible subject/camera pairs of the current frame, culling the subjects updated since the last call first. */
+	const FSubjectVisibilityList& GetVisibility();
+
+	/** Names of the subjects visible to Camera in the current frame. */
+	UFUNCTION(BlueprintCallable, Category = "Subject Visibility")
+	void GetVisibleSubjects(const UCameraDataComponent* Camera, TArray<FString>& OutSubjectNames);
+
+	/** Fraction of the subject/camera pairs culled in the last evaluated frame. */
+	UFUNCTION(BlueprintPure, Category = "Subject Visibility")
+	float GetCulledRatio() const { return CulledRatio; }
+
+	/** Padding (cm) added around the joints of subjects without a physics asset, covering the body around them. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Subject Visibility")
+	float JointBoundsPadding;
+
+	/** Distance (cm) of every camera's near plane. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Subject Visibility")
+	float NearClipDistance;
+
+	/** Subjects further than this (cm) in front of a camera are culled for it; 0 disables the far plane. */
+	UPROPERTY(Config, BlueprintReadWrite, Category = "Subject Visibility")
+	float MaxCameraDistance;
+
+private:
+	struct FSubject
+	{
+		TWeakObjectPtr<const UObject> Owner;
+		FString Name;
+		FVector Center = FVector::ZeroVector;
+		FVector Extent = FVector::ZeroVector;
+		double Radius = 0.0;
+		// Set when the subject was updated in UpdateFrame
+		bool bUpdated = false;
+	};
+
+	// Left, right, top, bottom, near and far
+	static constexpr int32 NumFrustumPlanes = 6;
+
+	// Inward frustum planes of four cameras, one lane per camera: a point P is inside plane i of lane L when
+	// NormalX[i][L] * P.X + NormalY[i][L] * P.Y + NormalZ[i][L] * P.Z + Distance[i][L] >= 0
+	struct FFrustumGroup
+	{
+		VectorRegister4Float NormalX[NumFrustumPlanes];
+		VectorRegister4Float NormalY[NumFrustumPlanes];
+		VectorRegister4Float NormalZ[NumFrustumPlanes];
+		VectorRegister4Float Distance[NumFrustumPlanes];
+		// Bit L is set when lane L holds a camera
+		int32 LaneMask = 0;
+	};
+
+	void OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+	// Collects the registered cameras into Visibility.Cameras and their frustums into FrustumGroups
+	void BuildFrustums();
+	// Culls the subjects updated this frame against all frustums and rebuilds Visibility
+	void EvaluateFrame();
+
+	// GFrameCounter of the subjects' bUpdated flags; the first update of a new frame clears them
+	uint64 UpdateFrame = 0;
+	// A subject was updated since Visibility was built
+	bool bVisibilityStale = false;
+
+	TArray<FSubject> Subjects;
+	TMap<const UObject*, int32> SubjectsByOwner;
+
+	// Frustums of the registry's cameras as of BuiltCameraRevision (see UCameraRegistrySubsystem::GetRevision)
+	TArray<FFrustumGroup> FrustumGroups;
+	uint32 BuiltCameraRevision = 0;
+
+	FSubjectVisibilityList Visibility;
+	// Per frustum group and updated subject: bit L is set when lane L's camera sees the subject
+	TArray<uint8> VisibleLanes;
+	float CulledRatio = 0.0f;
+
+	FDelegateHandle PostActorTickHandle;
+	int32 NumEvaluatedFrames = 0;
+	int64 NumTestedPairs = 0;
+	int64 NumVisiblePairs = 0;
+	uint64 EvaluateCycles = 0;
+};
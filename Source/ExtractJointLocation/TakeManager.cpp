@@ -0,0 +1,319 @@
+#include "TakeManager.h"
+#include "SkeletalExtractor.h"
+#include "CameraDataComponent.h"
+#include "CameraRegistrySubsystem.h"
+#include "DomeRigBuilder.h"
+#include "Animation/AnimationAsset.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/SceneCapture2D.h"
+#include "Engine/SkeletalMesh.h"
+#include "Engine/World.h"
+#include "Misc/DateTime.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogTakeManager, Log, All);
+
+// Sets default values for this actor's properties
+ATakeManager::ATakeManager()
+{
+	PrimaryActorTick.bCanEverTick = true;
+}
+
+// Called when the game starts or when spawned
+void ATakeManager::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (!SubjectClass)
+	{
+		UE_LOG(LogTakeManager, Error, TEXT("BeginPlay: No SubjectClass set, takes cannot run."));
+		return;
+	}
+
+	// Spawn the pool up front so loading and warm-up happen once, before the first take
+	for (int32 i = 0; i < InitialPoolSize; ++i)
+	{
+		if (AActor* Subject = AcquireSubject())
+		{
+			ReleaseSubject(Subject);
+		}
+	}
+
+	QueueTakes(Takes);
+}
+
+void ATakeManager::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (bTakeRunning)
+	{
+		EndCurrentTake();
+	}
+	PendingTakes.Empty();
+
+	for (AActor* Subject : FreeSubjects)
+	{
+		if (IsValid(Subject))
+		{
+			Subject->Destroy();
+		}
+	}
+	FreeSubjects.Empty();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+// Called every frame
+void ATakeManager::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!bTakeRunning)
+	{
+		return;
+	}
+
+	CurrentTakeElapsed += DeltaTime;
+	if (CurrentTakeElapsed >= CurrentTakeDuration)
+	{
+		EndCurrentTake();
+		StartNextTake();
+	}
+}
+
+void ATakeManager::QueueTakes(const TArray<FCaptureTake>& NewTakes)
+{
+	PendingTakes.Append(NewTakes);
+	if (!bTakeRunning && SubjectClass)
+	{
+		StartNextTake();
+	}
+}
+
+void ATakeManager::SkipTake()
+{
+	if (bTakeRunning)
+	{
+		EndCurrentTake();
+		StartNextTake();
+	}
+}
+
+float ATakeManager::GetTakeProgress() const
+{
+	return bTakeRunning && CurrentTakeDuration > 0.0f ? FMath::Clamp(CurrentTakeElapsed / CurrentTakeDuration, 0.0f, 1.0f) : 0.0f;
+}
+
+void ATakeManager::StartNextTake()
+{
+	if (PendingTakes.Num() == 0)
+	{
+		UE_LOG(LogTakeManager, Log, TEXT("All takes completed."));
+		OnAllTakesCompleted.Broadcast();
+		return;
+	}
+
+	CurrentTake = PendingTakes[0];
+	PendingTakes.RemoveAt(0);
+	if (CurrentTake.TakeName.IsEmpty())
+	{
+		// Takes shorter than a second would otherwise share a name and overwrite each other's output
+		CurrentTake.TakeName = FString::Printf(TEXT("Take_%s_%03d"), *FDateTime::Now().ToString(TEXT("%Y%m%d_%H%M%S")), NumTakesStarted);
+	}
+	++NumTakesStarted;
+
+	ApplyRig(CurrentTake);
+
+	float LongestAnimation = 0.0f;
+	for (const FCaptureTakeSubject& TakeSubject : CurrentTake.Subjects)
+	{
+		AActor* Subject = AcquireSubject();
+		if (!Subject)
+		{
+			continue;
+		}
+		ApplySubject(Subject, TakeSubject);
+		ActiveSubjects.Add(Subject);
+
+		if (TakeSubject.BodyAnimation)
+		{
+			LongestAnimation = FMath::Max(LongestAnimation, TakeSubject.BodyAnimation->GetPlayLength());
+		}
+	}
+
+	CurrentTakeDuration = CurrentTake.Duration > 0.0f ? CurrentTake.Duration : FMath::Max(LongestAnimation - CurrentTake.StartTime, 0.0f);
+	CurrentTakeElapsed = 0.0f;
+	bTakeRunning = true;
+
+	UE_LOG(LogTakeManager, Log, TEXT("Started take '%s': %d subjects, %.2f s, %d takes queued."),
+		*CurrentTake.TakeName, ActiveSubjects.Num(), CurrentTakeDuration, PendingTakes.Num());
+}
+
+void ATakeManager::EndCurrentTake()
+{
+	for (AActor* Subject : ActiveSubjects)
+	{
+		if (IsValid(Subject))
+		{
+			ReleaseSubject(Subject);
+		}
+	}
+	ActiveSubjects.Reset();
+	bTakeRunning = false;
+
+	UE_LOG(LogTakeManager, Log, TEXT("Finished take '%s' after %.2f s."), *CurrentTake.TakeName, CurrentTakeElapsed);
+	OnTakeFinished.Broadcast(CurrentTake.TakeName);
+}
+
+AActor* ATakeManager::AcquireSubject()
+{
+	AActor* Subject = nullptr;
+	while (!Subject && FreeSubjects.Num() > 0)
+	{
+		Subject = FreeSubjects.Pop();
+		if (!IsValid(Subject))
+		{
+			Subject = nullptr;
+		}
+	}
+
+	if (!Subject)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		Subject = GetWorld()->SpawnActor<AActor>(SubjectClass, GetActorTransform(), SpawnParams);
+		if (!Subject)
+		{
+			UE_LOG(LogTakeManager, Error, TEXT("AcquireSubject: Failed to spawn %s."), *SubjectClass->GetName());
+			return nullptr;
+		}
+		const USkeletalExtractor* Extractor = Subject->FindComponentByClass<USkeletalExtractor>();
+		if (!Extractor || !Extractor->IsStreamingKeypoints())
+		{
+			UE_LOG(LogTakeManager, Warning, TEXT("AcquireSubject: %s has no SkeletalExtractor streaming keypoints, its takes will not be recorded."), *Subject->GetName());
+		}
+	}
+
+	Subject->SetActorHiddenInGame(false);
+	Subject->SetActorTickEnabled(true);
+	return Subject;
+}
+
+void ATakeManager::ReleaseSubject(AActor* Subject)
+{
+	// Close the take's streams before the actor stops ticking, so the last frame is not lost
+	if (USkeletalExtractor* Extractor = Subject->FindComponentByClass<USkeletalExtractor>())
+	{
+		Extractor->EndTake();
+		Extractor->SetComponentTickEnabled(false);
+	}
+
+	TArray<USkeletalMeshComponent*> SkeletalMeshComponents;
+	Subject->GetComponents<USkeletalMeshComponent>(SkeletalMeshComponents);
+	for (USkeletalMeshComponent* SkeletalMesh : SkeletalMeshComponents)
+	{
+		SkeletalMesh->Stop();
+	}
+
+	Subject->SetActorHiddenInGame(true);
+	Subject->SetActorTickEnabled(false);
+	FreeSubjects.Add(Subject);
+}
+
+void ATakeManager::ApplySubject(AActor* Subject, const FCaptureTakeSubject& TakeSubject)
+{
+	Subject->SetActorTransform(TakeSubject.Transform, false, nullptr, ETeleportType::ResetPhysics);
+
+	USkeletalMeshComponent* Body = FindMeshComponent(Subject, TEXT("Body"));
+	USkeletalMeshComponent* Face = FindMeshComponent(Subject, TEXT("Face"));
+
+	if (Body && TakeSubject.BodyMesh)
+	{
+		Body->SetSkeletalMeshAsset(TakeSubject.BodyMesh);
+	}
+	if (Face && TakeSubject.FaceMesh)
+	{
+		Face->SetSkeletalMeshAsset(TakeSubject.FaceMesh);
+	}
+
+	// Animations restart from the take's start time
+	if (Body && TakeSubject.BodyAnimation)
+	{
+		Body->PlayAnimation(TakeSubject.BodyAnimation, false);
+		Body->SetPosition(CurrentTake.StartTime, false);
+	}
+	if (Face && TakeSubject.FaceAnimation)
+	{
+		Face->PlayAnimation(TakeSubject.FaceAnimation, false);
+		Face->SetPosition(CurrentTake.StartTime, false);
+	}
+
+	// Streams are opened after the swap so bone indices match the new meshes; BeginTake would open them even if streaming is off
+	if (USkeletalExtractor* Extractor = Subject->FindComponentByClass<USkeletalExtractor>())
+	{
+		Extractor->SetComponentTickEnabled(true);
+		if (Extractor->IsStreamingKeypoints())
+		{
+			Extractor->BeginTake(CurrentTake.TakeName);
+		}
+	}
+}
+
+void ATakeManager::ApplyRig(const FCaptureTake& Take)
+{
+	if (!RigBuilder)
+	{
+		return;
+	}
+
+	if (!Take.RigFilePath.IsEmpty())
+	{
+		TArray<FDomeCameraPlacement> Placements;
+		if (RigBuilder->LoadPlacementsFromFile(Take.RigFilePath, Placements))
+		{
+			RigBuilder->BuildRigFromPlacements(Placements);
+		}
+		else
+		{
+			UE_LOG(LogTakeManager, Error, TEXT("ApplyRig: Failed to load rig '%s' for take '%s', keeping the current rig."), *Take.RigFilePath, *Take.TakeName);
+		}
+	}
+
+	// Calibration is written per take, since the rig may have changed; the registry exports each camera once
+	UCameraRegistrySubsystem* CameraRegistry = GetWorld()->GetSubsystem<UCameraRegistrySubsystem>();
+	for (ASceneCapture2D* Camera : RigBuilder->GetSpawnedCameras())
+	{
+		if (UCameraDataComponent* CameraData = Camera ? Camera->FindComponentByClass<UCameraDataComponent>() : nullptr)
+		{
+			// Matrices, JSON calibration and frames all go to the take's folders, e.g. Saved/CameraData/<TakeName>/;
+			// only the calibration is written here, frames are saved by ACameraDataManager
+			CameraData->CameraDataFilename.Reset();
+			CameraData->OutputSubdirectory = Take.TakeName;
+			if (CameraRegistry && CameraRegistry->FindCamera(CameraData))
+			{
+				CameraRegistry->MarkCameraDirty(CameraData);
+			}
+			else
+			{
+				CameraData->ExportCalibration();
+			}
+		}
+	}
+	if (CameraRegistry)
+	{
+		CameraRegistry->ExportChangedCalibration();
+	}
+}
+
+USkeletalMeshComponent* ATakeManager::FindMeshComponent(AActor* Subject, FName ComponentName)
+{
+	TArray<USkeletalMeshComponent*> SkeletalMeshComponents;
+	Subject->GetComponents<USkeletalMeshComponent>(SkeletalMeshComponents);
+	for (USkeletalMeshComponent* SkeletalMesh : SkeletalMeshComponents)
+	{
+		if (SkeletalMesh->GetFName() == ComponentName)
+		{
+			return SkeletalMesh;
+		}
+	}
+	return nullptr;
+}
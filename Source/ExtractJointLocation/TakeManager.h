@@ -0,0 +1,166 @@
+// TakeManager.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "TakeManager.generated.h"
+
+class ADomeRigBuilder;
+class UAnimationAsset;
+class USkeletalMesh;
+class USkeletalMeshComponent;
+
+// One subject of a take: what to put on a pooled actor and where
+USTRUCT(BlueprintType)
+struct FCaptureTakeSubject
+{
+	GENERATED_BODY()
+
+	/** Mesh for the actor's "Body" component, none to keep the current one. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Take")
+	USkeletalMesh* BodyMesh = nullptr;
+
+	/** Mesh for the actor's "Face" component, none to keep the current one. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Take")
+	USkeletalMesh* FaceMesh = nullptr;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Take")
+	UAnimationAsset* BodyAnimation = nullptr;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Take")
+	UAnimationAsset* FaceAnimation = nullptr;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Take")
+	FTransform Transform;
+};
+
+USTRUCT(BlueprintType)
+struct FCaptureTake
+{
+	GENERATED_BODY()
+
+	/**
+	 * Name of the take's output folders: Saved/KeypointStreams/<TakeName>/, Saved/CameraData/<TakeName>/ and
+	 * Saved/CameraFrames/<TakeName>/. Empty for Take_<Timestamp>_<Counter>.
+	 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Take")
+	FString TakeName;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Take")
+	TArray<FCaptureTakeSubject> Subjects;
+
+	/** JSON rig file (see ADomeRigBuilder::LoadPlacementsFromFile) to switch to for this take, empty to keep the current rig. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Take")
+	FString RigFilePath;
+
+	/** Animation time (seconds) the take starts at, e.g. the first frame of a frame range. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Take", meta = (ClampMin = "0.0"))
+	float StartTime = 0.0f;
+
+	/** Simulated length of the take in seconds, 0 to run to the end of the longest body animation. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Take")
+	float Duration = 0.0f;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnCaptureTakeFinished, const FString&, TakeName);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnCaptureTakesCompleted);
+
+/**
+ * Runs takes back to back in one world. Subject actors are kept in a pool and only hidden between takes;
+ * for every take their meshes and animations are swapped, the camera rig is rebuilt if requested (the rig
+ * builder reuses its cameras and render targets), and each USkeletalExtractor is restarted with new output
+ * streams. This avoids reloading the level, and with it asset loading and shader warm-up, for every take.
+ */
+UCLASS()
+class EXTRACTJOINTLOCATION_API ATakeManager : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	// Sets default values for this actor's properties
+	ATakeManager();
+
+protected:
+	// Called when the game starts or when spawned
+	virtual void BeginPlay() override;
+
+	// Ends the running take and destroys the pooled actors
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+public:
+	// Called every frame
+	virtual void Tick(float DeltaTime) override;
+
+	/** Appends takes to the queue; they start right away if no take is running. */
+	UFUNCTION(BlueprintCallable, Category = "Take Manager")
+	void QueueTakes(const TArray<FCaptureTake>& NewTakes);
+
+	/** Ends the running take early and starts the next one. */
+	UFUNCTION(BlueprintCallable, Category = "Take Manager")
+	void SkipTake();
+
+	UFUNCTION(BlueprintPure, Category = "Take Manager")
+	bool IsTakeRunning() const { return bTakeRunning; }
+
+	UFUNCTION(BlueprintPure, Category = "Take Manager")
+	int32 GetNumQueuedTakes() const { return PendingTakes.Num(); }
+
+	/** Fraction of the running take's duration simulated so far. */
+	UFUNCTION(BlueprintPure, Category = "Take Manager")
+	float GetTakeProgress() const;
+
+	UPROPERTY(BlueprintAssignable, Category = "Take Manager")
+	FOnCaptureTakeFinished OnTakeFinished;
+
+	/** Broadcast when the queue has run empty. */
+	UPROPERTY(BlueprintAssignable, Category = "Take Manager")
+	FOnCaptureTakesCompleted OnAllTakesCompleted;
+
+protected:
+	/** Subject actor (e.g. a MetaHuman blueprint) with "Body"/"Face" skeletal meshes and a USkeletalExtractor. */
+	UPROPERTY(EditAnywhere, Category = "Take Manager")
+	TSubclassOf<AActor> SubjectClass;
+
+	/** Subjects spawned (and warmed up) in BeginPlay; more are spawned on demand. */
+	UPROPERTY(EditAnywhere, Category = "Take Manager", meta = (ClampMin = "0"))
+	int32 InitialPoolSize = 1;
+
+	/** Rig that takes with a RigFilePath are applied to. */
+	UPROPERTY(EditAnywhere, Category = "Take Manager")
+	ADomeRigBuilder* RigBuilder = nullptr;
+
+	/** Takes queued at BeginPlay. */
+	UPROPERTY(EditAnywhere, Category = "Take Manager")
+	TArray<FCaptureTake> Takes;
+
+private:
+	void StartNextTake();
+	void EndCurrentTake();
+
+	AActor* AcquireSubject();
+	void ReleaseSubject(AActor* Subject);
+	void ApplySubject(AActor* Subject, const FCaptureTakeSubject& TakeSubject);
+	void ApplyRig(const FCaptureTake& Take);
+
+	static USkeletalMeshComponent* FindMeshComponent(AActor* Subject, FName ComponentName);
+
+	// Actors ready for the next take, hidden and not ticking
+	UPROPERTY()
+	TArray<AActor*> FreeSubjects;
+
+	// Actors used by the running take
+	UPROPERTY()
+	TArray<AActor*> ActiveSubjects;
+
+	UPROPERTY()
+	TArray<FCaptureTake> PendingTakes;
+
+	UPROPERTY()
+	FCaptureTake CurrentTake;
+
+	bool bTakeRunning = false;
+	// Makes default take names unique within the session
+	int32 NumTakesStarted = 0;
+	float CurrentTakeDuration = 0.0f;
+	float CurrentTakeElapsed = 0.0f;
+};
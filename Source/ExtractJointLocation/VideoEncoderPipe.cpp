@@ -0,0 +1,442 @@
+#include "VideoEncoderPipe.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+
+#if PLATFORM_UNIX || PLATFORM_MAC
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+DEFINE_LOG_CATEGORY_STATIC(LogVideoEncoderPipe, Log, All);
+
+namespace VideoEncoderPipe
+{
+	// Poll interval of the writer while the encoder's input is full
+	static constexpr int32 PollMilliseconds = 100;
+	// Time a terminated encoder gets to exit before it is killed
+	static constexpr double TerminateTimeout = 2.0;
+}
+
+int32 FVideoFramePacer::Advance(double TimeSeconds)
+{
+	const double Rate = FMath::Max(FrameRate, 1.0f);
+	if (!bStarted || TimeSeconds < StartTime)
+	{
+		// First capture, or time went back (e.g. a new world): the timeline continues after the last video frame
+		bStarted = true;
+		StartTime = TimeSeconds;
+		StartVideoFrame = NextVideoFrame;
+		++NextVideoFrame;
+		return 0;
+	}
+
+	int64 VideoFrame = StartVideoFrame + FMath::FloorToInt64((TimeSeconds - StartTime) * Rate + 0.5);
+	if (VideoFrame < NextVideoFrame)
+	{
+		return INDEX_NONE;
+	}
+
+	int64 NumMissed = VideoFrame - NextVideoFrame;
+	if (NumMissed > MaxGap * Rate)
+	{
+		StartTime = TimeSeconds;
+		StartVideoFrame = NextVideoFrame;
+		VideoFrame = NextVideoFrame;
+		NumMissed = 0;
+	}
+	NextVideoFrame = VideoFrame + 1;
+	return static_cast<int32>(NumMissed);
+}
+
+FVideoEncoderPipe::~FVideoEncoderPipe()
+{
+	Shutdown();
+}
+
+bool FVideoEncoderPipe::Start(const FVideoEncoderPipeSettings& InSettings)
+{
+	Shutdown();
+	Settings = InSettings;
+	if (Settings.Width <= 0 || Settings.Height <= 0 || Settings.Executable.IsEmpty())
+	{
+		UE_LOG(LogVideoEncoderPipe, Warning, TEXT("Start: Invalid settings for %s (%dx%d, encoder '%s')."), *Settings.OutputPath, Settings.Width, Settings.Height, *Settings.Executable);
+		return false;
+	}
+	if (!LaunchEncoder())
+	{
+		return false;
+	}
+
+	bStopping = false;
+	bEncoderFailed = false;
+	WrittenFrames = 0;
+	DroppedFrames = 0;
+	WakeEvent = FPlatformProcess::GetSynchEventFromPool(false);
+	FrameWrittenEvent = FPlatformProcess::GetSynchEventFromPool(false);
+	Thread = FRunnableThread::Create(this, TEXT("VideoEncoderPipe"), 0, TPri_AboveNormal);
+	if (!Thread)
+	{
+		Shutdown();
+		return false;
+	}
+
+	UE_LOG(LogVideoEncoderPipe, Log, TEXT("Encoding %dx%d at %.2f fps to %s with %s."), Settings.Width, Settings.Height, Settings.FrameRate, *Settings.OutputPath, *Settings.Executable);
+	return true;
+}
+
+int32 FVideoEncoderPipe::Shutdown()
+{
+	if (!Thread && ProcessId < 0)
+	{
+		return -1;
+	}
+
+	if (Thread)
+	{
+		// Kill calls Stop and waits for Run to write what is queued
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+	}
+	for (FEvent** Event : { &WakeEvent, &FrameWrittenEvent })
+	{
+		if (*Event)
+		{
+			FPlatformProcess::ReturnSynchEventToPool(*Event);
+			*Event = nullptr;
+		}
+	}
+
+	// End of input tells the encoder to finish the video
+#if PLATFORM_UNIX || PLATFORM_MAC
+	if (InputDescriptor >= 0)
+	{
+		close(InputDescriptor);
+	}
+#endif
+	InputDescriptor = -1;
+	const int32 ExitCode = WaitForEncoder();
+
+	UE_LOG(LogVideoEncoderPipe, Log, TEXT("%s: %llu frames written, %llu dropped, encoder exited with %d."), *Settings.OutputPath, GetWrittenFrames(), GetDroppedFrames(), ExitCode);
+	if (ExitCode != 0)
+	{
+		UE_LOG(LogVideoEncoderPipe, Warning, TEXT("The encoder of %s failed%s%s."), *Settings.OutputPath,
+			Settings.LogPath.IsEmpty() ? TEXT("") : TEXT(", see "), *Settings.LogPath);
+	}
+
+	PendingFrames.Empty();
+	FreeFrames.Empty();
+	PreviousFrame.Reset();
+	NumPendingFrames = 0;
+	return bEncoderFailed ? -1 : ExitCode;
+}
+
+bool FVideoEncoderPipe::WriteFrame(const FColor* Pixels, int32 NumPreviousRepeats)
+{
+	if (!Thread || !Pixels || bEncoderFailed.load(std::memory_order_relaxed))
+	{
+		DroppedFrames.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	// Back-pressure: wait a bounded time for the writer, so a stalled encoder neither grows memory nor stops capture
+	const int32 MaxQueuedFrames = FMath::Max(Settings.MaxQueuedFrames, 1);
+	const double Deadline = FPlatformTime::Seconds() + Settings.MaxQueueWait;
+	while (NumPendingFrames.load(std::memory_order_acquire) >= MaxQueuedFrames)
+	{
+		const double Remaining = Deadline - FPlatformTime::Seconds();
+		if (Remaining <= 0.0 || bEncoderFailed.load(std::memory_order_relaxed))
+		{
+			DroppedFrames.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		FrameWrittenEvent->Wait(FMath::Max(FMath::CeilToInt32(Remaining * 1000.0), 1));
+	}
+
+	// At most MaxQueuedFrames + 1 buffers exist: the queued ones and the writer's previous frame
+	TUniquePtr<FFrame> Frame;
+	if (!FreeFrames.Dequeue(Frame) || !Frame)
+	{
+		Frame = MakeUnique<FFrame>();
+	}
+	Frame->Pixels.SetNumUninitialized(Settings.Width * Settings.Height, EAllowShrinking::No);
+	FMemory::Memcpy(Frame->Pixels.GetData(), Pixels, Frame->Pixels.Num() * sizeof(FColor));
+	Frame->NumPreviousRepeats = FMath::Max(NumPreviousRepeats, 0);
+
+	NumPendingFrames.fetch_add(1, std::memory_order_release);
+	PendingFrames.Enqueue(MoveTemp(Frame));
+	WakeEvent->Trigger();
+	return true;
+}
+
+TArray<FString> FVideoEncoderPipe::BuildArguments(const FVideoEncoderPipeSettings& Settings)
+{
+	TArray<FString> Arguments;
+	FString Current;
+	bool bInQuotes = false;
+	bool bInArgument = false;
+	for (const TCHAR Character : Settings.Arguments)
+	{
+		if (Character == TEXT('"'))
+		{
+			bInQuotes = !bInQuotes;
+			bInArgument = true;
+		}
+		else if (FChar::IsWhitespace(Character) && !bInQuotes)
+		{
+			if (bInArgument)
+			{
+				Arguments.Add(MoveTemp(Current));
+				Current.Reset();
+				bInArgument = false;
+			}
+		}
+		else
+		{
+			Current.AppendChar(Character);
+			bInArgument = true;
+		}
+	}
+	if (bInArgument)
+	{
+		Arguments.Add(MoveTemp(Current));
+	}
+
+	// Placeholders are replaced after splitting, so an output path with spaces stays one argument
+	for (FString& Argument : Arguments)
+	{
+		Argument.ReplaceInline(TEXT("{Width}"), *FString::FromInt(Settings.Width));
+		Argument.ReplaceInline(TEXT("{Height}"), *FString::FromInt(Settings.Height));
+		Argument.ReplaceInline(TEXT("{FrameRate}"), *FString::SanitizeFloat(Settings.FrameRate));
+		Argument.ReplaceInline(TEXT("{Output}"), *Settings.OutputPath);
+	}
+	return Arguments;
+}
+
+uint32 FVideoEncoderPipe::Run()
+{
+#if PLATFORM_UNIX || PLATFORM_MAC
+	// An encoder that exits early must fail our writes with EPIPE rather than end the engine with SIGPIPE
+	sigset_t PipeSignal;
+	sigemptyset(&PipeSignal);
+	sigaddset(&PipeSignal, SIGPIPE);
+	pthread_sigmask(SIG_BLOCK, &PipeSignal, nullptr);
+#endif
+
+	const int64 FrameBytes = static_cast<int64>(Settings.Width) * Settings.Height * sizeof(FColor);
+	bool bRunning = true;
+	while (bRunning)
+	{
+		// Writes the queue once more after Stop
+		bRunning = !bStopping.load(std::memory_order_acquire);
+		if (bRunning)
+		{
+			WakeEvent->Wait(VideoEncoderPipe::PollMilliseconds);
+		}
+
+		TUniquePtr<FFrame> Frame;
+		while (PendingFrames.Dequeue(Frame))
+		{
+			bool bWritten = !bEncoderFailed.load(std::memory_order_relaxed);
+			for (int32 Repeat = 0; bWritten && PreviousFrame && Repeat < Frame->NumPreviousRepeats; ++Repeat)
+			{
+				bWritten = WriteToEncoder(reinterpret_cast<const uint8*>(PreviousFrame->Pixels.GetData()), FrameBytes);
+				WrittenFrames.fetch_add(bWritten ? 1 : 0, std::memory_order_relaxed);
+			}
+			bWritten = bWritten && WriteToEncoder(reinterpret_cast<const uint8*>(Frame->Pixels.GetData()), FrameBytes);
+			if (bWritten)
+			{
+				WrittenFrames.fetch_add(1, std::memory_order_relaxed);
+			}
+			else
+			{
+				DroppedFrames.fetch_add(1, std::memory_order_relaxed);
+				if (!bEncoderFailed.exchange(true))
+				{
+					UE_LOG(LogVideoEncoderPipe, Error, TEXT("The encoder of %s stopped reading frames; the remaining frames are dropped."), *Settings.OutputPath);
+				}
+			}
+
+			Swap(PreviousFrame, Frame);
+			if (Frame)
+			{
+				FreeFrames.Enqueue(MoveTemp(Frame));
+			}
+			NumPendingFrames.fetch_sub(1, std::memory_order_release);
+			FrameWrittenEvent->Trigger();
+		}
+	}
+	return 0;
+}
+
+void FVideoEncoderPipe::Stop()
+{
+	bStopping.store(true, std::memory_order_release);
+	if (WakeEvent)
+	{
+		WakeEvent->Trigger();
+	}
+}
+
+bool FVideoEncoderPipe::LaunchEncoder()
+{
+#if PLATFORM_UNIX || PLATFORM_MAC
+	// UTF-8 copies of the command line that outlive the spawn call
+	auto ToUtf8 = [](const FString& String)
+	{
+		const FTCHARToUTF8 Converted(*String);
+		TArray<ANSICHAR> Utf8(Converted.Get(), Converted.Length());
+		Utf8.Add('\0');
+		return Utf8;
+	};
+	TArray<TArray<ANSICHAR>> CommandLine;
+	CommandLine.Add(ToUtf8(Settings.Executable));
+	for (const FString& Argument : BuildArguments(Settings))
+	{
+		CommandLine.Add(ToUtf8(Argument));
+	}
+	TArray<char*> Argv;
+	for (TArray<ANSICHAR>& Argument : CommandLine)
+	{
+		Argv.Add(Argument.GetData());
+	}
+	Argv.Add(nullptr);
+
+	// Close-on-exec, so no other child process keeps the encoder's input open after we close it
+	int PipeDescriptors[2];
+#if PLATFORM_LINUX
+	const bool bPipeCreated = pipe2(PipeDescriptors, O_CLOEXEC) == 0;
+#else
+	const bool bPipeCreated = pipe(PipeDescriptors) == 0;
+	if (bPipeCreated)
+	{
+		fcntl(PipeDescriptors[0], F_SETFD, FD_CLOEXEC);
+		fcntl(PipeDescriptors[1], F_SETFD, FD_CLOEXEC);
+	}
+#endif
+	if (!bPipeCreated)
+	{
+		UE_LOG(LogVideoEncoderPipe, Error, TEXT("LaunchEncoder: Failed to create a pipe, errno %d."), errno);
+		return false;
+	}
+
+	posix_spawn_file_actions_t FileActions;
+	posix_spawn_file_actions_init(&FileActions);
+	posix_spawn_file_actions_adddup2(&FileActions, PipeDescriptors[0], STDIN_FILENO);
+	TArray<ANSICHAR> LogPath;
+	if (!Settings.LogPath.IsEmpty())
+	{
+		LogPath = ToUtf8(Settings.LogPath);
+		posix_spawn_file_actions_addopen(&FileActions, STDOUT_FILENO, LogPath.GetData(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		posix_spawn_file_actions_adddup2(&FileActions, STDOUT_FILENO, STDERR_FILENO);
+	}
+
+	pid_t Pid = -1;
+	const int SpawnResult = posix_spawnp(&Pid, Argv[0], &FileActions, nullptr, Argv.GetData(), environ);
+	posix_spawn_file_actions_destroy(&FileActions);
+	close(PipeDescriptors[0]);
+	if (SpawnResult != 0)
+	{
+		UE_LOG(LogVideoEncoderPipe, Error, TEXT("LaunchEncoder: Failed to start '%s', error %d."), *Settings.Executable, SpawnResult);
+		close(PipeDescriptors[1]);
+		return false;
+	}
+
+	// Non-blocking, so a hung encoder cannot hold the writer thread past shutdown
+	fcntl(PipeDescriptors[1], F_SETFL, fcntl(PipeDescriptors[1], F_GETFL) | O_NONBLOCK);
+#ifdef F_SETPIPE_SZ
+	// A 1 MB pipe buffer instead of 64 KB means fewer wake-ups per frame; the call fails harmlessly above the system limit
+	fcntl(PipeDescriptors[1], F_SETPIPE_SZ, 1 << 20);
+#endif
+	ProcessId = Pid;
+	InputDescriptor = PipeDescriptors[1];
+	return true;
+#else
+	UE_LOG(LogVideoEncoderPipe, Error, TEXT("LaunchEncoder: Encoder pipes need POSIX processes, which this platform does not provide."));
+	return false;
+#endif
+}
+
+int32 FVideoEncoderPipe::WaitForEncoder()
+{
+#if PLATFORM_UNIX || PLATFORM_MAC
+	if (ProcessId < 0)
+	{
+		return -1;
+	}
+	const pid_t Pid = ProcessId;
+	ProcessId = -1;
+
+	auto WaitUntil = [Pid](double Deadline, int& OutStatus)
+	{
+		pid_t Result = 0;
+		while ((Result = waitpid(Pid, &OutStatus, WNOHANG)) == 0 && FPlatformTime::Seconds() < Deadline)
+		{
+			FPlatformProcess::SleepNoStats(0.01f);
+		}
+		return Result;
+	};
+
+	int Status = 0;
+	pid_t Result = WaitUntil(FPlatformTime::Seconds() + Settings.ShutdownTimeout, Status);
+	if (Result == 0)
+	{
+		UE_LOG(LogVideoEncoderPipe, Warning, TEXT("The encoder of %s did not finish within %.1f s and is terminated."), *Settings.OutputPath, Settings.ShutdownTimeout);
+		kill(Pid, SIGTERM);
+		Result = WaitUntil(FPlatformTime::Seconds() + VideoEncoderPipe::TerminateTimeout, Status);
+		if (Result == 0)
+		{
+			kill(Pid, SIGKILL);
+			Result = waitpid(Pid, &Status, 0);
+		}
+	}
+	return Result == Pid && WIFEXITED(Status) ? WEXITSTATUS(Status) : -1;
+#else
+	return -1;
+#endif
+}
+
+bool FVideoEncoderPipe::WriteToEncoder(const uint8* Data, int64 Size)
+{
+#if PLATFORM_UNIX || PLATFORM_MAC
+	// While stopping, an encoder that accepts nothing for ShutdownTimeout is given up on
+	double StalledSince = 0.0;
+	while (Size > 0)
+	{
+		const ssize_t Written = write(InputDescriptor, Data, static_cast<size_t>(FMath::Min<int64>(Size, 1 << 20)));
+		if (Written > 0)
+		{
+			Data += Written;
+			Size -= Written;
+			StalledSince = 0.0;
+			continue;
+		}
+		if (Written < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+		{
+			return false;
+		}
+
+		pollfd PollDescriptor = { InputDescriptor, POLLOUT, 0 };
+		poll(&PollDescriptor, 1, VideoEncoderPipe::PollMilliseconds);
+		if (bStopping.load(std::memory_order_relaxed))
+		{
+			const double Now = FPlatformTime::Seconds();
+			StalledSince = StalledSince > 0.0 ? StalledSince : Now;
+			if (Now - StalledSince > Settings.ShutdownTimeout)
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,128 @@
+// VideoEncoderPipe.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "Containers/Queue.h"
+
+class FRunnableThread;
+
+struct FVideoEncoderPipeSettings
+{
+	// Program to run, looked up on PATH unless it is a path
+	FString Executable;
+	// Arguments; {Width}, {Height}, {FrameRate} and {Output} are replaced in every argument, double quotes group words
+	FString Arguments;
+	FString OutputPath;
+	// Encoder output (stdout and stderr) goes here; empty = inherited from the engine
+	FString LogPath;
+	int32 Width = 0;
+	int32 Height = 0;
+	float FrameRate = 30.0f;
+	// Frames waiting for the writer thread; WriteFrame waits up to MaxQueueWait (s) for one of them, then drops the frame
+	int32 MaxQueuedFrames = 4;
+	float MaxQueueWait = 0.5f;
+	// Time (s) the encoder gets to finish the video after its input is closed, before it is terminated
+	float ShutdownTimeout = 10.0f;
+};
+
+/**
+ * Places captured frames on a constant frame rate timeline. Two captures within one video frame keep only the first;
+ * a capture after a gap holds the previous frame over the missed video frames. Gaps longer than MaxGap seconds are
+ * a pause in the capture and restart the timeline, rather than filling the video with a still frame.
+ */
+struct EXTRACTJOINTLOCATION_API FVideoFramePacer
+{
+	float FrameRate = 30.0f;
+	float MaxGap = 1.0f;
+
+	/**
+	 * @return Video frames the previous frame is repeated for before this one, or INDEX_NONE if this capture falls in
+	 *         a video frame that already has one.
+	 */
+	int32 Advance(double TimeSeconds);
+
+	/** Video frame the last accepted capture was placed at. */
+	int64 GetLastVideoFrame() const { return NextVideoFrame - 1; }
+
+private:
+	bool bStarted = false;
+	double StartTime = 0.0;
+	// Video frame index of StartTime
+	int64 StartVideoFrame = 0;
+	int64 NextVideoFrame = 0;
+};
+
+/**
+ * Streams raw BGRA frames into the standard input of an external encoder process (e.g. ffmpeg) from its own thread,
+ * so one video per camera is written without per-frame image files. The game thread only copies a frame into a
+ * pooled buffer; at most MaxQueuedFrames buffers are in flight, so a slow encoder holds capture back for at most
+ * MaxQueueWait per frame and drops frames after that. Needs POSIX processes and pipes (Linux, Mac).
+ */
+class EXTRACTJOINTLOCATION_API FVideoEncoderPipe : public FRunnable
+{
+public:
+	~FVideoEncoderPipe();
+
+	/** Launches the encoder and starts the writer thread. */
+	bool Start(const FVideoEncoderPipeSettings& InSettings);
+	/**
+	 * Writes the frames still queued, closes the encoder's input and waits for it to finish the video.
+	 * @return The encoder's exit code, or -1 if it failed to start, was terminated or lost frames to a write error.
+	 */
+	int32 Shutdown();
+	bool IsRunning() const { return Thread != nullptr; }
+
+	/**
+	 * Queues a copy of a frame, preceded by NumPreviousRepeats more copies of the frame queued before it.
+	 * @param Pixels Width x Height BGRA pixels, tightly packed.
+	 * @return False if the frame was dropped because the queue stayed full or the encoder is gone.
+	 */
+	bool WriteFrame(const FColor* Pixels, int32 NumPreviousRepeats = 0);
+
+	const FVideoEncoderPipeSettings& GetSettings() const { return Settings; }
+	/** Frames sent to the encoder, repeats included. */
+	uint64 GetWrittenFrames() const { return WrittenFrames.load(std::memory_order_relaxed); }
+	uint64 GetDroppedFrames() const { return DroppedFrames.load(std::memory_order_relaxed); }
+
+	/** Splits Arguments at whitespace outside double quotes and replaces the placeholders. */
+	static TArray<FString> BuildArguments(const FVideoEncoderPipeSettings& Settings);
+
+	// FRunnable
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+private:
+	struct FFrame
+	{
+		TArray<FColor> Pixels;
+		int32 NumPreviousRepeats = 0;
+	};
+
+	bool LaunchEncoder();
+	// Waits up to ShutdownTimeout for the encoder to exit, then terminates it; returns its exit code or -1
+	int32 WaitForEncoder();
+	// Writes all of Data to the encoder's input; false once the encoder stopped reading
+	bool WriteToEncoder(const uint8* Data, int64 Size);
+
+	FVideoEncoderPipeSettings Settings;
+	FRunnableThread* Thread = nullptr;
+	FEvent* WakeEvent = nullptr;
+	// Triggered by the writer thread whenever a buffer is free again
+	FEvent* FrameWrittenEvent = nullptr;
+	std::atomic<bool> bStopping{ false };
+	std::atomic<bool> bEncoderFailed{ false };
+
+	int32 ProcessId = -1;
+	int32 InputDescriptor = -1;
+
+	TQueue<TUniquePtr<FFrame>, EQueueMode::Spsc> PendingFrames;
+	TQueue<TUniquePtr<FFrame>, EQueueMode::Spsc> FreeFrames;
+	std::atomic<int32> NumPendingFrames{ 0 };
+
+	// Writer thread only: the last frame written, kept for repeats
+	TUniquePtr<FFrame> PreviousFrame;
+
+	std::atomic<uint64> WrittenFrames{ 0 };
+	std::atomic<uint64> DroppedFrames{ 0 };
+};
@@ -0,0 +1,264 @@
+#include "VideoEncoderPipeValidationCommandlet.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/PlatformTime.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogVideoEncoderPipeValidation, Log, All);
+
+namespace VideoEncoderPipeValidation
+{
+	// Matches Tools/VideoEncoderStub
+	static constexpr uint64 FnvOffsetBasis = 14695981039346656037ull;
+	static constexpr uint64 FnvPrime = 1099511628211ull;
+	static constexpr int32 SlowEncoderDelayMilliseconds = 20;
+	static constexpr int32 EncoderExitFrames = 3;
+	static constexpr int32 NumCases = 5;
+
+	// Capture times of the paced case (in video frames at 30 fps) and the repeats FVideoFramePacer must return for them
+	struct FPacedCapture
+	{
+		double VideoFrameTime;
+		int32 ExpectedRepeats;
+	};
+	static const FPacedCapture PacedCaptures[] = {
+		{ 0.0, 0 },
+		{ 1.0, 0 },
+		// Same video frame as the one before
+		{ 1.2, INDEX_NONE },
+		{ 2.0, 0 },
+		// Frames 3 and 4 hold frame 2
+		{ 5.0, 2 },
+		{ 6.1, 0 },
+		{ 6.4, INDEX_NONE },
+		{ 7.0, 0 },
+		// A 2 s pause restarts the timeline instead of holding the frame for 60 video frames
+		{ 67.0, 0 },
+		{ 68.0, 0 } };
+	static constexpr int32 NumPacedCaptures = UE_ARRAY_COUNT(PacedCaptures);
+}
+
+UVideoEncoderPipeValidationCommandlet::UVideoEncoderPipeValidationCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UVideoEncoderPipeValidationCommandlet::Main(const FString& Params)
+{
+	using namespace VideoEncoderPipeValidation;
+	TArray<FString> Tokens;
+	TArray<FString> Switches;
+	TMap<FString, FString> ParamsMap;
+	ParseCommandLine(*Params, Tokens, Switches, ParamsMap);
+
+	const FString Encoder = ParamsMap.Contains(TEXT("Encoder")) ? ParamsMap[TEXT("Encoder")] : FString();
+	const int32 Width = ParamsMap.Contains(TEXT("Width")) ? FCString::Atoi(*ParamsMap[TEXT("Width")]) : 320;
+	const int32 Height = ParamsMap.Contains(TEXT("Height")) ? FCString::Atoi(*ParamsMap[TEXT("Height")]) : 180;
+	const int32 NumFrames = ParamsMap.Contains(TEXT("Frames")) ? FCString::Atoi(*ParamsMap[TEXT("Frames")]) : 30;
+	if (Encoder.IsEmpty() || Width <= 0 || Height <= 0 || NumFrames <= EncoderExitFrames)
+	{
+		UE_LOG(LogVideoEncoderPipeValidation, Error, TEXT("Usage: -run=VideoEncoderPipeValidation -Encoder=/path/to/VideoEncoderStub [-Width=320] [-Height=180] [-Frames=30]"));
+		return 1;
+	}
+
+	const FString Directory = FPaths::ConvertRelativePathToFull(FPaths::ProjectSavedDir() + TEXT("VideoEncoderPipeValidation/"));
+	FPlatformFileManager::Get().GetPlatformFile().CreateDirectoryTree(*Directory);
+
+	TArray<TArray<FColor>> Frames;
+	TArray<FString> Checksums;
+	Frames.SetNum(NumFrames);
+	for (int32 FrameIndex = 0; FrameIndex < NumFrames; ++FrameIndex)
+	{
+		MakeFrame(Width, Height, FrameIndex, Frames[FrameIndex]);
+		Checksums.Add(GetChecksum(Frames[FrameIndex]));
+	}
+
+	auto MakeSettings = [&](const TCHAR* CaseName, const FString& ExtraArguments)
+	{
+		FVideoEncoderPipeSettings Settings;
+		Settings.Executable = Encoder;
+		Settings.Arguments = TEXT("-width {Width} -height {Height} -output \"{Output}\" ") + ExtraArguments;
+		Settings.OutputPath = Directory + CaseName + TEXT(".json");
+		Settings.LogPath = Directory + CaseName + TEXT("_Encoder.log");
+		Settings.Width = Width;
+		Settings.Height = Height;
+		Settings.ShutdownTimeout = 5.0f;
+		return Settings;
+	};
+	auto Check = [](bool bCondition, const TCHAR* CaseName, const FString& Message)
+	{
+		UE_CLOG(!bCondition, LogVideoEncoderPipeValidation, Error, TEXT("%s: %s"), CaseName, *Message);
+		return bCondition;
+	};
+
+	int32 NumFailed = 0;
+	FStubResult Result;
+
+	// Every frame arrives once, intact and in order, and the encoder exits cleanly on end of input
+	{
+		const TCHAR* CaseName = TEXT("Sequential");
+		const bool bRan = RunStub(MakeSettings(CaseName, FString()), [&](FVideoEncoderPipe& Pipe)
+		{
+			for (const TArray<FColor>& Frame : Frames)
+			{
+				Pipe.WriteFrame(Frame.GetData());
+			}
+		}, Result);
+		const bool bPassed = Check(bRan, CaseName, TEXT("the encoder did not start"))
+			&& Check(Result.ExitCode == 0, CaseName, FString::Printf(TEXT("encoder exited with %d"), Result.ExitCode))
+			&& Check(Result.DroppedFrames == 0, CaseName, FString::Printf(TEXT("%llu frames dropped"), Result.DroppedFrames))
+			&& Check(Result.FrameChecksums == Checksums, CaseName, FString::Printf(TEXT("%d of %d frames arrived, or their checksums differ"), Result.FrameChecksums.Num(), NumFrames));
+		NumFailed += bPassed ? 0 : 1;
+		UE_LOG(LogVideoEncoderPipeValidation, Display, TEXT("%s: %s, %d frames."), CaseName, bPassed ? TEXT("passed") : TEXT("FAILED"), Result.FrameChecksums.Num());
+	}
+
+	// The pacer skips, holds and restarts as expected and the encoder receives exactly that timeline
+	{
+		const TCHAR* CaseName = TEXT("Paced");
+		FVideoFramePacer Pacer;
+		Pacer.FrameRate = 30.0f;
+		Pacer.MaxGap = 1.0f;
+		TArray<FString> ExpectedChecksums;
+		bool bPacerMatches = true;
+		const bool bRan = RunStub(MakeSettings(CaseName, FString()), [&](FVideoEncoderPipe& Pipe)
+		{
+			int32 CaptureIndex = 0;
+			for (const FPacedCapture& Capture : PacedCaptures)
+			{
+				const int32 NumRepeats = Pacer.Advance(Capture.VideoFrameTime / Pacer.FrameRate);
+				bPacerMatches &= NumRepeats == Capture.ExpectedRepeats;
+				const int32 FrameIndex = CaptureIndex++ % NumFrames;
+				if (NumRepeats != INDEX_NONE)
+				{
+					for (int32 Repeat = 0; Repeat < NumRepeats; ++Repeat)
+					{
+						ExpectedChecksums.Add(ExpectedChecksums.Last());
+					}
+					ExpectedChecksums.Add(Checksums[FrameIndex]);
+					Pipe.WriteFrame(Frames[FrameIndex].GetData(), NumRepeats);
+				}
+			}
+		}, Result);
+		const bool bPassed = Check(bRan, CaseName, TEXT("the encoder did not start"))
+			&& Check(bPacerMatches, CaseName, TEXT("the pacer returned unexpected repeats"))
+			&& Check(Result.ExitCode == 0, CaseName, FString::Printf(TEXT("encoder exited with %d"), Result.ExitCode))
+			&& Check(Result.FrameChecksums == ExpectedChecksums, CaseName, FString::Printf(TEXT("%d video frames arrived, expected %d"), Result.FrameChecksums.Num(), ExpectedChecksums.Num()));
+		NumFailed += bPassed ? 0 : 1;
+		UE_LOG(LogVideoEncoderPipeValidation, Display, TEXT("%s: %s, %d video frames from %d captures."), CaseName, bPassed ? TEXT("passed") : TEXT("FAILED"),
+			Result.FrameChecksums.Num(), NumPacedCaptures);
+	}
+
+	// A slow encoder with a short queue and no wait drops frames instead of holding capture, and loses none it accepted
+	{
+		const TCHAR* CaseName = TEXT("BackPressure");
+		FVideoEncoderPipeSettings Settings = MakeSettings(CaseName, FString::Printf(TEXT("-delay-ms %d"), SlowEncoderDelayMilliseconds));
+		Settings.MaxQueuedFrames = 2;
+		Settings.MaxQueueWait = 0.0f;
+		int32 NumAccepted = 0;
+		const double StartTime = FPlatformTime::Seconds();
+		const bool bRan = RunStub(Settings, [&](FVideoEncoderPipe& Pipe)
+		{
+			for (const TArray<FColor>& Frame : Frames)
+			{
+				NumAccepted += Pipe.WriteFrame(Frame.GetData()) ? 1 : 0;
+			}
+		}, Result);
+		const double Seconds = FPlatformTime::Seconds() - StartTime;
+		const bool bPassed = Check(bRan, CaseName, TEXT("the encoder did not start"))
+			&& Check(Result.DroppedFrames > 0, CaseName, TEXT("no frame was dropped"))
+			&& Check(Result.WrittenFrames + Result.DroppedFrames == static_cast<uint64>(NumFrames), CaseName, TEXT("written and dropped frames do not add up"))
+			&& Check(Result.FrameChecksums.Num() == NumAccepted, CaseName, FString::Printf(TEXT("%d of %d accepted frames arrived"), Result.FrameChecksums.Num(), NumAccepted));
+		NumFailed += bPassed ? 0 : 1;
+		UE_LOG(LogVideoEncoderPipeValidation, Display, TEXT("%s: %s, %d of %d frames accepted in %.2f s."), CaseName, bPassed ? TEXT("passed") : TEXT("FAILED"), NumAccepted, NumFrames, Seconds);
+	}
+
+	// An encoder that exits early fails the pipe without taking the process down or hanging shutdown
+	{
+		const TCHAR* CaseName = TEXT("EncoderExit");
+		FVideoEncoderPipeSettings Settings = MakeSettings(CaseName, FString::Printf(TEXT("-exit-after-frames %d"), EncoderExitFrames));
+		Settings.MaxQueueWait = 5.0f;
+		const bool bRan = RunStub(Settings, [&](FVideoEncoderPipe& Pipe)
+		{
+			for (const TArray<FColor>& Frame : Frames)
+			{
+				Pipe.WriteFrame(Frame.GetData());
+			}
+		}, Result);
+		const bool bPassed = Check(bRan, CaseName, TEXT("the encoder did not start"))
+			&& Check(Result.ExitCode != 0, CaseName, TEXT("shutdown reported success"))
+			&& Check(Result.FrameChecksums.Num() == EncoderExitFrames, CaseName, FString::Printf(TEXT("encoder read %d frames, expected %d"), Result.FrameChecksums.Num(), EncoderExitFrames))
+			&& Check(Result.DroppedFrames > 0, CaseName, TEXT("no frame was dropped"));
+		NumFailed += bPassed ? 0 : 1;
+		UE_LOG(LogVideoEncoderPipeValidation, Display, TEXT("%s: %s, %llu frames dropped."), CaseName, bPassed ? TEXT("passed") : TEXT("FAILED"), Result.DroppedFrames);
+	}
+
+	// A missing encoder fails to start instead of failing on the first frame
+	{
+		const TCHAR* CaseName = TEXT("MissingEncoder");
+		FVideoEncoderPipeSettings Settings = MakeSettings(CaseName, FString());
+		Settings.Executable = Directory + TEXT("NoSuchEncoder");
+		FVideoEncoderPipe Pipe;
+		const bool bPassed = Check(!Pipe.Start(Settings), CaseName, TEXT("the pipe started"));
+		NumFailed += bPassed ? 0 : 1;
+		UE_LOG(LogVideoEncoderPipeValidation, Display, TEXT("%s: %s."), CaseName, bPassed ? TEXT("passed") : TEXT("FAILED"));
+	}
+
+	UE_LOG(LogVideoEncoderPipeValidation, Display, TEXT("%d of %d cases passed."), NumCases - NumFailed, NumCases);
+	return NumFailed > 0 ? 1 : 0;
+}
+
+bool UVideoEncoderPipeValidationCommandlet::RunStub(const FVideoEncoderPipeSettings& Settings, TFunctionRef<void(FVideoEncoderPipe&)> SubmitFrames, FStubResult& OutResult)
+{
+	OutResult = FStubResult();
+	IFileManager::Get().Delete(*Settings.OutputPath, false, true, true);
+
+	FVideoEncoderPipe Pipe;
+	if (!Pipe.Start(Settings))
+	{
+		return false;
+	}
+	SubmitFrames(Pipe);
+	OutResult.ExitCode = Pipe.Shutdown();
+	OutResult.WrittenFrames = Pipe.GetWrittenFrames();
+	OutResult.DroppedFrames = Pipe.GetDroppedFrames();
+
+	FString SummaryString;
+	TSharedPtr<FJsonObject> Summary;
+	if (FFileHelper::LoadFileToString(SummaryString, *Settings.OutputPath)
+		&& FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(SummaryString), Summary) && Summary.IsValid())
+	{
+		Summary->TryGetStringArrayField(TEXT("FrameChecksums"), OutResult.FrameChecksums);
+	}
+	return true;
+}
+
+void UVideoEncoderPipeValidationCommandlet::MakeFrame(int32 Width, int32 Height, int32 Index, TArray<FColor>& OutPixels)
+{
+	OutPixels.SetNumUninitialized(Width * Height);
+	for (int32 Y = 0; Y < Height; ++Y)
+	{
+		for (int32 X = 0; X < Width; ++X)
+		{
+			OutPixels[Y * Width + X] = FColor((X + Index * 31) & 255, (Y + Index * 17) & 255, (X ^ Y ^ Index) & 255, 255);
+		}
+	}
+}
+
+FString UVideoEncoderPipeValidationCommandlet::GetChecksum(const TArray<FColor>& Pixels)
+{
+	using namespace VideoEncoderPipeValidation;
+	uint64 Hash = FnvOffsetBasis;
+	const uint8* Bytes = reinterpret_cast<const uint8*>(Pixels.GetData());
+	for (int64 Index = 0; Index < Pixels.Num() * static_cast<int64>(sizeof(FColor)); ++Index)
+	{
+		Hash = (Hash ^ Bytes[Index]) * FnvPrime;
+	}
+	return FString::Printf(TEXT("%016llx"), Hash);
+}
@@ -0,0 +1,43 @@
+// VideoEncoderPipeValidationCommandlet.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "VideoEncoderPipe.h"
+#include "VideoEncoderPipeValidationCommandlet.generated.h"
+
+/**
+ * Checks FVideoEncoderPipe and FVideoFramePacer against Tools/VideoEncoderStub, which checksums every frame it
+ * receives instead of encoding it, without rendering, so it runs under -nullrhi. Cases cover frames arriving intact
+ * and in order, paced frames (skipped, held and restarted on a pause), back-pressure from a slow encoder, an encoder
+ * that exits early and one that does not exist.
+ *
+ * UnrealEditor-Cmd Project.uproject -run=VideoEncoderPipeValidation -nullrhi -Encoder=/path/to/VideoEncoderStub
+ *     [-Width=320] [-Height=180] [-Frames=30]
+ * The stub's summaries go to Saved/VideoEncoderPipeValidation/. Returns 1 if any check fails.
+ */
+UCLASS()
+class EXTRACTJOINTLOCATION_API UVideoEncoderPipeValidationCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UVideoEncoderPipeValidationCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	struct FStubResult
+	{
+		int32 ExitCode = -1;
+		uint64 WrittenFrames = 0;
+		uint64 DroppedFrames = 0;
+		// Per frame checksums reported by the stub
+		TArray<FString> FrameChecksums;
+	};
+
+	// Submits frames through a pipe to the stub and reads back its summary; false if the pipe did not start
+	static bool RunStub(const FVideoEncoderPipeSettings& Settings, TFunctionRef<void(FVideoEncoderPipe&)> SubmitFrames, FStubResult& OutResult);
+	static void MakeFrame(int32 Width, int32 Height, int32 Index, TArray<FColor>& OutPixels);
+	static FString GetChecksum(const TArray<FColor>& Pixels);
+};
@@ -0,0 +1,140 @@
+#include "VirtualMarkerSkinner.h"
+#include "Components/SkinnedMeshComponent.h"
+#include "Engine/SkeletalMesh.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogVirtualMarkers, Log, All);
+
+bool FVirtualMarkerSkinner::Initialize(const USkeletalMesh* SkeletalMesh, TArrayView<const FVirtualMarker> Markers)
+{
+	MarkerNames.Reset();
+	MarkerStarts.Reset();
+	MarkerVertices.Reset();
+	MarkerWeights.Reset();
+
+	if (!Binding.Begin(SkeletalMesh))
+	{
+		return false;
+	}
+
+	const int32 NumVertices = Binding.GetNumMeshVertices();
+	for (const FVirtualMarker& Marker : Markers)
+	{
+		const bool bValidVertices = Marker.Vertices.Num() >= 1 && Marker.Vertices.Num() <= 3
+			&& !Marker.Vertices.ContainsByPredicate([NumVertices](int32 VertexIndex) { return VertexIndex < 0 || VertexIndex >= NumVertices; });
+		if (!bValidVertices || (Marker.Weights.Num() != 0 && Marker.Weights.Num() != Marker.Vertices.Num()))
+		{
+			UE_LOG(LogVirtualMarkers, Warning, TEXT("Initialize: Skipping marker '%s', it needs 1 to 3 vertices of %s (0 to %d) and a weight per vertex."),
+				*Marker.Name.ToString(), *SkeletalMesh->GetName(), NumVertices - 1);
+			continue;
+		}
+
+		float TotalWeight = 0.0f;
+		for (int32 i = 0; i < Marker.Vertices.Num(); ++i)
+		{
+			TotalWeight += Marker.Weights.Num() > 0 ? Marker.Weights[i] : 1.0f;
+		}
+		// Weights are normalized by their sum, which would put a zero weight marker at NaN
+		if (FMath::Abs(TotalWeight) < UE_KINDA_SMALL_NUMBER)
+		{
+			UE_LOG(LogVirtualMarkers, Warning, TEXT("Initialize: Skipping marker '%s', its weights add up to zero."), *Marker.Name.ToString());
+			continue;
+		}
+
+		MarkerNames.Add(Marker.Name);
+		MarkerStarts.Add(MarkerVertices.Num());
+		for (int32 i = 0; i < Marker.Vertices.Num(); ++i)
+		{
+			MarkerVertices.Add(Binding.AddVertex(Marker.Vertices[i]));
+			MarkerWeights.Add((Marker.Weights.Num() > 0 ? Marker.Weights[i] : 1.0f) / TotalWeight);
+		}
+	}
+	MarkerStarts.Add(MarkerVertices.Num());
+	Binding.End();
+
+	UE_LOG(LogVirtualMarkers, Log, TEXT("Initialize: %d markers on %s skin %d vertices with %d bones."),
+		MarkerNames.Num(), *SkeletalMesh->GetName(), Binding.GetNumVertices(), Binding.GetNumBones());
+	return MarkerNames.Num() > 0;
+}
+
+bool FVirtualMarkerSkinner::Evaluate(const USkinnedMeshComponent* MeshComponent, TArray<FVector>& OutPositions)
+{
+	// Skin in component space and move the few markers to world space in double precision
+	if (MarkerNames.Num() == 0 || !Binding.ComputeSkinningMatrices(MeshComponent, SkinningMatrices))
+	{
+		return false;
+	}
+
+	SkinnedPositions.SetNumUninitialized(Binding.GetNumVertices());
+	Binding.SkinVertices(SkinningMatrices, 0, Binding.GetNumVertices(), SkinnedPositions.GetData());
+
+	const FTransform& ComponentToWorld = MeshComponent->GetComponentTransform();
+	OutPositions.SetNumUninitialized(MarkerNames.Num());
+	for (int32 MarkerIndex = 0; MarkerIndex < MarkerNames.Num(); ++MarkerIndex)
+	{
+		FVector3f Position = FVector3f::ZeroVector;
+		for (int32 i = MarkerStarts[MarkerIndex]; i < MarkerStarts[MarkerIndex + 1]; ++i)
+		{
+			const FVector4f& Vertex = SkinnedPositions[MarkerVertices[i]];
+			Position += FVector3f(Vertex.X, Vertex.Y, Vertex.Z) * MarkerWeights[i];
+		}
+		OutPositions[MarkerIndex] = ComponentToWorld.TransformPosition(FVector(Position));
+	}
+	return true;
+}
+
+bool FVirtualMarkerSkinner::LoadMarkersFromFile(const FString& FilePath, TArray<FVirtualMarker>& OutMarkers)
+{
+	const FString AbsoluteFilePath = FPaths::IsRelative(FilePath) ? FPaths::Combine(FPaths::ProjectDir(), FilePath) : FilePath;
+
+	FString FileContent;
+	if (!FFileHelper::LoadFileToString(FileContent, *AbsoluteFilePath))
+	{
+		UE_LOG(LogVirtualMarkers, Error, TEXT("LoadMarkersFromFile: Failed to read marker file: %s"), *AbsoluteFilePath);
+		return false;
+	}
+
+	TSharedPtr<FJsonObject> RootObject;
+	TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(FileContent);
+	const TArray<TSharedPtr<FJsonValue>>* MarkerArray = nullptr;
+	if (!FJsonSerializer::Deserialize(Reader, RootObject) || !RootObject.IsValid() || !RootObject->TryGetArrayField(TEXT("Markers"), MarkerArray))
+	{
+		UE_LOG(LogVirtualMarkers, Error, TEXT("LoadMarkersFromFile: Marker file is not valid JSON or has no 'Markers' array: %s"), *AbsoluteFilePath);
+		return false;
+	}
+
+	for (const TSharedPtr<FJsonValue>& MarkerValue : *MarkerArray)
+	{
+		const TSharedPtr<FJsonObject> MarkerObject = MarkerValue.IsValid() ? MarkerValue->AsObject() : nullptr;
+		FString MarkerName;
+		const TArray<TSharedPtr<FJsonValue>>* VertexValues = nullptr;
+		if (!MarkerObject.IsValid() || !MarkerObject->TryGetStringField(TEXT("Name"), MarkerName) || !MarkerObject->TryGetArrayField(TEXT("Vertices"), VertexValues))
+		{
+			UE_LOG(LogVirtualMarkers, Warning, TEXT("LoadMarkersFromFile: Skipping marker %d without 'Name' and 'Vertices'."), OutMarkers.Num());
+			continue;
+		}
+
+		FVirtualMarker& Marker = OutMarkers.AddDefaulted_GetRef();
+		Marker.Name = FName(*MarkerName);
+		MarkerObject->TryGetStringField(TEXT("Mesh"), Marker.Mesh);
+		for (const TSharedPtr<FJsonValue>& VertexValue : *VertexValues)
+		{
+			Marker.Vertices.Add(static_cast<int32>(VertexValue->AsNumber()));
+		}
+		const TArray<TSharedPtr<FJsonValue>>* WeightValues = nullptr;
+		if (MarkerObject->TryGetArrayField(TEXT("Weights"), WeightValues))
+		{
+			for (const TSharedPtr<FJsonValue>& WeightValue : *WeightValues)
+			{
+				Marker.Weights.Add(static_cast<float>(WeightValue->AsNumber()));
+			}
+		}
+	}
+
+	UE_LOG(LogVirtualMarkers, Log, TEXT("LoadMarkersFromFile: Read %d markers from %s"), OutMarkers.Num(), *AbsoluteFilePath);
+	return OutMarkers.Num() > 0;
+}
@@ -0,0 +1,71 @@
+// VirtualMarkerSkinner.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CpuSkinning.h"
+#include "VirtualMarkerSkinner.generated.h"
+
+class USkeletalMesh;
+class USkinnedMeshComponent;
+
+// A marker attached to the skin: one mesh vertex, or a weighted (barycentric) combination of up to three
+USTRUCT(BlueprintType)
+struct FVirtualMarker
+{
+	GENERATED_BODY()
+
+	/** Marker label, e.g. the name used in the C3D marker set. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Virtual Marker")
+	FName Name;
+
+	/** Mesh component the vertices belong to: "Body" or "Face". */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Virtual Marker")
+	FString Mesh = TEXT("Body");
+
+	/** LOD 0 vertex indices, one to three. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Virtual Marker")
+	TArray<int32> Vertices;
+
+	/** Weight per vertex, e.g. barycentric coordinates on a triangle; empty for equal weights. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Virtual Marker")
+	TArray<float> Weights;
+};
+
+/** Evaluates virtual markers by skinning only the vertices they are attached to on the CPU (see FCpuSkinningBinding). */
+class EXTRACTJOINTLOCATION_API FVirtualMarkerSkinner
+{
+public:
+	/**
+	 * Resolves the markers' vertices and influences on SkeletalMesh.
+	 * @return False if no marker could be resolved.
+	 */
+	bool Initialize(const USkeletalMesh* SkeletalMesh, TArrayView<const FVirtualMarker> Markers);
+
+	/**
+	 * Skins the marker vertices with the component's current pose (or its leader pose component's).
+	 * @param OutPositions World-space marker positions in GetMarkerNames() order.
+	 */
+	bool Evaluate(const USkinnedMeshComponent* MeshComponent, TArray<FVector>& OutPositions);
+
+	const TArray<FName>& GetMarkerNames() const { return MarkerNames; }
+
+	/**
+	 * Reads markers from a JSON file: { "Markers": [ { "Name": "LASI", "Mesh": "Body", "Vertices": [1021, 1022, 1050],
+	 * "Weights": [0.2, 0.3, 0.5] } ] }. Relative paths are resolved against the project directory.
+	 */
+	static bool LoadMarkersFromFile(const FString& FilePath, TArray<FVirtualMarker>& OutMarkers);
+
+private:
+	TArray<FName> MarkerNames;
+	// Per marker: first entry in MarkerVertices/MarkerWeights and count
+	TArray<int32> MarkerStarts;
+	TArray<int32> MarkerVertices;
+	TArray<float> MarkerWeights;
+
+	// Unique skinned vertices of all markers
+	FCpuSkinningBinding Binding;
+
+	// Per-frame scratch
+	TArray<FMatrix44f> SkinningMatrices;
+	TArray<FVector4f> SkinnedPositions;
+};
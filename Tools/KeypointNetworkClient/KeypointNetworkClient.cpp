@@ -0,0 +1,290 @@
+#include "KeypointNetworkClient.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace
+{
+	void SetError(std::string* OutError, const std::string& Message)
+	{
+		if (OutError)
+		{
+			*OutError = Message;
+		}
+	}
+
+	// Values are little-endian and unaligned, as written by the sender
+	template <typename T>
+	bool Read(const uint8_t*& Data, const uint8_t* End, T& OutValue)
+	{
+		if (static_cast<size_t>(End - Data) < sizeof(T))
+		{
+			return false;
+		}
+		std::memcpy(&OutValue, Data, sizeof(T));
+		Data += sizeof(T);
+		return true;
+	}
+
+	bool ReadName(const uint8_t*& Data, const uint8_t* End, std::string& OutName)
+	{
+		uint8_t Length = 0;
+		if (!Read(Data, End, Length) || static_cast<size_t>(End - Data) < Length)
+		{
+			return false;
+		}
+		OutName.assign(reinterpret_cast<const char*>(Data), Length);
+		Data += Length;
+		return true;
+	}
+
+	// Datagrams this many frames late are taken as a restart of the sender rather than reordering
+	constexpr int32_t MaxReorderedFrames = 1024;
+
+	uint64_t GetUtcMicros()
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+	}
+}
+
+FKeypointNetworkClient::~FKeypointNetworkClient()
+{
+	Close();
+}
+
+bool FKeypointNetworkClient::Bind(uint16_t Port, const std::string& MulticastGroup, std::string* OutError)
+{
+	Close();
+
+	Socket = socket(AF_INET, SOCK_DGRAM, 0);
+	if (Socket < 0)
+	{
+		SetError(OutError, std::string("socket failed: ") + std::strerror(errno));
+		return false;
+	}
+
+	// Several clients on one machine may listen to a broadcast or multicast stream
+	const int Enable = 1;
+	setsockopt(Socket, SOL_SOCKET, SO_REUSEADDR, &Enable, sizeof(Enable));
+	const int ReceiveBufferSize = 4 << 20;
+	setsockopt(Socket, SOL_SOCKET, SO_RCVBUF, &ReceiveBufferSize, sizeof(ReceiveBufferSize));
+
+	sockaddr_in Address = {};
+	Address.sin_family = AF_INET;
+	Address.sin_port = htons(Port);
+	Address.sin_addr.s_addr = htonl(INADDR_ANY);
+	if (bind(Socket, reinterpret_cast<const sockaddr*>(&Address), sizeof(Address)) != 0)
+	{
+		SetError(OutError, "bind to port " + std::to_string(Port) + " failed: " + std::strerror(errno));
+		Close();
+		return false;
+	}
+
+	if (!MulticastGroup.empty())
+	{
+		ip_mreq Request = {};
+		Request.imr_interface.s_addr = htonl(INADDR_ANY);
+		if (inet_pton(AF_INET, MulticastGroup.c_str(), &Request.imr_multiaddr) != 1
+			|| setsockopt(Socket, IPPROTO_IP, IP_ADD_MEMBERSHIP, &Request, sizeof(Request)) != 0)
+		{
+			SetError(OutError, "joining multicast group " + MulticastGroup + " failed: " + std::strerror(errno));
+			Close();
+			return false;
+		}
+	}
+	return true;
+}
+
+void FKeypointNetworkClient::Close()
+{
+	if (Socket >= 0)
+	{
+		close(Socket);
+		Socket = -1;
+	}
+	bAssembling = false;
+	Ready.clear();
+}
+
+bool FKeypointNetworkClient::Receive(FKeypointNetworkFrame& OutFrame, int TimeoutMilliseconds)
+{
+	if (Socket < 0)
+	{
+		return false;
+	}
+
+	const auto Deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(TimeoutMilliseconds);
+	uint8_t Datagram[65536];
+	while (Ready.empty())
+	{
+		const int RemainingMilliseconds = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(Deadline - std::chrono::steady_clock::now()).count());
+		pollfd PollFd = { Socket, POLLIN, 0 };
+		if (RemainingMilliseconds <= 0 || poll(&PollFd, 1, RemainingMilliseconds) <= 0)
+		{
+			return false;
+		}
+
+		const ssize_t Size = recv(Socket, Datagram, sizeof(Datagram), 0);
+		if (Size > 0 && !ReadDatagram(Datagram, static_cast<size_t>(Size)))
+		{
+			++InvalidDatagrams;
+		}
+	}
+
+	OutFrame = std::move(Ready.front());
+	Ready.pop_front();
+	return true;
+}
+
+const FKeypointNetworkSubjectSchema* FKeypointNetworkClient::FindSubject(uint16_t SubjectId) const
+{
+	const auto Found = Schemas.find(SubjectId);
+	return Found != Schemas.end() ? &Found->second : nullptr;
+}
+
+bool FKeypointNetworkClient::ReadDatagram(const uint8_t* Data, size_t Size)
+{
+	using namespace KeypointNetwork;
+	const uint8_t* End = Data + Size;
+	FPacketHeader Header;
+	if (!Read(Data, End, Header) || Header.Magic != Magic || Header.Version != Version || Header.PartIndex >= Header.PartCount)
+	{
+		return false;
+	}
+
+	switch (static_cast<EPacketType>(Header.Type))
+	{
+	case EPacketType::Frame:
+		return ReadFrame(Header, Data, End);
+	case EPacketType::Schema:
+		return ReadSchema(Header, Data, End);
+	default:
+		return false;
+	}
+}
+
+bool FKeypointNetworkClient::ReadFrame(const KeypointNetwork::FPacketHeader& Header, const uint8_t* Data, const uint8_t* End)
+{
+	using namespace KeypointNetwork;
+
+	// Sequences wrap, so compare their difference; a large step back is a restarted sender
+	const int32_t SequenceStep = static_cast<int32_t>(Header.Sequence - LastFinishedSequence);
+	if (bHasFinished && SequenceStep <= 0)
+	{
+		if (SequenceStep > -MaxReorderedFrames)
+		{
+			return true;
+		}
+		bHasFinished = false;
+		bAssembling = false;
+	}
+	if (bAssembling && Header.Sequence != Assembling.Sequence)
+	{
+		if (static_cast<int32_t>(Header.Sequence - Assembling.Sequence) < 0)
+		{
+			return true;
+		}
+		FinishFrame();
+	}
+	if (!bAssembling)
+	{
+		Assembling = FKeypointNetworkFrame();
+		Assembling.Sequence = Header.Sequence;
+		Assembling.FrameIndex = Header.FrameIndex;
+		Assembling.TimeSeconds = Header.TimeSeconds;
+		Assembling.CaptureTimeMicros = Header.CaptureTimeMicros;
+		AssemblingParts.reset();
+		AssemblingPartCount = Header.PartCount;
+		bAssembling = true;
+	}
+	if (AssemblingParts.test(Header.PartIndex))
+	{
+		return true;
+	}
+
+	const bool bQuantized = (Header.Flags & PacketFlagQuantized) != 0;
+	for (uint16_t SubjectIndex = 0; SubjectIndex < Header.NumSubjects; ++SubjectIndex)
+	{
+		FFrameSubject SubjectHeader;
+		const size_t JointBytes = bQuantized ? 3 * sizeof(int16_t) : 3 * sizeof(float);
+		if (!Read(Data, End, SubjectHeader) || static_cast<size_t>(End - Data) < SubjectHeader.NumJoints * JointBytes)
+		{
+			return false;
+		}
+
+		FKeypointNetworkSubjectFrame& Subject = Assembling.Subjects.emplace_back();
+		Subject.SubjectId = SubjectHeader.SubjectId;
+		Subject.Positions.resize(static_cast<size_t>(SubjectHeader.NumJoints) * 3);
+		if (!bQuantized)
+		{
+			std::memcpy(Subject.Positions.data(), Data, Subject.Positions.size() * sizeof(float));
+		}
+		else
+		{
+			for (size_t i = 0; i < Subject.Positions.size(); ++i)
+			{
+				int16_t Value;
+				std::memcpy(&Value, Data + i * sizeof(int16_t), sizeof(Value));
+				Subject.Positions[i] = SubjectHeader.Origin[i % 3] + Value * SubjectHeader.Step;
+			}
+		}
+		Data += SubjectHeader.NumJoints * JointBytes;
+	}
+
+	AssemblingParts.set(Header.PartIndex);
+	Assembling.ReceiveTimeMicros = GetUtcMicros();
+	if (AssemblingParts.count() >= AssemblingPartCount)
+	{
+		FinishFrame();
+	}
+	return true;
+}
+
+bool FKeypointNetworkClient::ReadSchema(const KeypointNetwork::FPacketHeader& Header, const uint8_t* Data, const uint8_t* End)
+{
+	for (uint16_t SubjectIndex = 0; SubjectIndex < Header.NumSubjects; ++SubjectIndex)
+	{
+		uint16_t SubjectId = 0;
+		uint16_t NumJoints = 0;
+		FKeypointNetworkSubjectSchema Schema;
+		if (!Read(Data, End, SubjectId) || !ReadName(Data, End, Schema.Name) || !Read(Data, End, NumJoints))
+		{
+			return false;
+		}
+		Schema.JointNames.resize(NumJoints);
+		for (std::string& JointName : Schema.JointNames)
+		{
+			if (!ReadName(Data, End, JointName))
+			{
+				return false;
+			}
+		}
+		Schemas[SubjectId] = std::move(Schema);
+	}
+	return true;
+}
+
+void FKeypointNetworkClient::FinishFrame()
+{
+	if (bHasFinished)
+	{
+		LostFrames += static_cast<uint32_t>(Assembling.Sequence - LastFinishedSequence - 1);
+	}
+	bHasFinished = true;
+	LastFinishedSequence = Assembling.Sequence;
+
+	Assembling.bComplete = AssemblingParts.count() >= AssemblingPartCount;
+	for (FKeypointNetworkSubjectFrame& Subject : Assembling.Subjects)
+	{
+		Subject.Schema = FindSubject(Subject.SubjectId);
+	}
+	Ready.push_back(std::move(Assembling));
+	bAssembling = false;
+}
@@ -0,0 +1,90 @@
+// KeypointNetworkClient.h
+#pragma once
+
+#include "KeypointNetworkProtocol.h"
+
+#include <bitset>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+struct FKeypointNetworkSubjectSchema
+{
+	std::string Name;
+	std::vector<std::string> JointNames;
+};
+
+struct FKeypointNetworkSubjectFrame
+{
+	uint16_t SubjectId = 0;
+	// Null until the subject's schema has been received
+	const FKeypointNetworkSubjectSchema* Schema = nullptr;
+	// x, y, z per joint in world space (cm)
+	std::vector<float> Positions;
+};
+
+/** One frame of all subjects, reassembled from its datagrams. */
+struct FKeypointNetworkFrame
+{
+	uint32_t Sequence = 0;
+	int32_t FrameIndex = -1;
+	double TimeSeconds = 0.0;
+	// Sender's UTC clock at capture and ours when its last datagram arrived, microseconds since 1970
+	uint64_t CaptureTimeMicros = 0;
+	uint64_t ReceiveTimeMicros = 0;
+	// False if some of its datagrams were lost; Subjects then holds the ones that arrived
+	bool bComplete = false;
+	std::vector<FKeypointNetworkSubjectFrame> Subjects;
+};
+
+/**
+ * Receives the keypoint stream sent by the engine's UKeypointNetworkSubsystem (see KeypointNetworkProtocol.h) on a
+ * UDP port. Frames are returned in order once all their datagrams arrived, or as incomplete frames once a later frame
+ * starts; datagrams arriving after their frame was returned are ignored.
+ */
+class FKeypointNetworkClient
+{
+public:
+	~FKeypointNetworkClient();
+
+	/** Binds the port, joining MulticastGroup (an IPv4 address) when given. */
+	bool Bind(uint16_t Port, const std::string& MulticastGroup = std::string(), std::string* OutError = nullptr);
+	void Close();
+	bool IsBound() const { return Socket >= 0; }
+
+	/**
+	 * Waits up to TimeoutMilliseconds for the next frame.
+	 * @return False on timeout.
+	 */
+	bool Receive(FKeypointNetworkFrame& OutFrame, int TimeoutMilliseconds);
+
+	const FKeypointNetworkSubjectSchema* FindSubject(uint16_t SubjectId) const;
+
+	/** Frames none of whose datagrams arrived. */
+	uint64_t GetLostFrames() const { return LostFrames; }
+	/** Datagrams that were not a version 1 keypoint stream or were truncated. */
+	uint64_t GetInvalidDatagrams() const { return InvalidDatagrams; }
+
+private:
+	bool ReadDatagram(const uint8_t* Data, size_t Size);
+	bool ReadFrame(const KeypointNetwork::FPacketHeader& Header, const uint8_t* Data, const uint8_t* End);
+	bool ReadSchema(const KeypointNetwork::FPacketHeader& Header, const uint8_t* Data, const uint8_t* End);
+	void FinishFrame();
+
+	int Socket = -1;
+	std::map<uint16_t, FKeypointNetworkSubjectSchema> Schemas;
+
+	// Frame being reassembled, and frames ready to be returned
+	FKeypointNetworkFrame Assembling;
+	std::bitset<256> AssemblingParts;
+	uint32_t AssemblingPartCount = 0;
+	bool bAssembling = false;
+	std::deque<FKeypointNetworkFrame> Ready;
+	bool bHasFinished = false;
+	uint32_t LastFinishedSequence = 0;
+
+	uint64_t LostFrames = 0;
+	uint64_t InvalidDatagrams = 0;
+};
@@ -0,0 +1,105 @@
+// Listens to the engine's keypoint network stream and reports what arrives, to check a capture's stream without a
+// consuming application.
+//
+//   KeypointNetworkPrintClient [-port 7777] [-group 239.0.0.1] [-frames N] [-joints]
+//
+// -group joins a multicast group the engine streams to. -joints prints every subject's joint positions, otherwise
+// only its first joint.
+
+#include "KeypointNetworkClient.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+int main(int Argc, char** Argv)
+{
+	uint16_t Port = KeypointNetwork::DefaultPort;
+	std::string MulticastGroup;
+	long MaxFrames = 0;
+	bool bPrintJoints = false;
+	for (int i = 1; i < Argc; ++i)
+	{
+		const bool bHasValue = i + 1 < Argc;
+		if (std::strcmp(Argv[i], "-port") == 0 && bHasValue)
+		{
+			Port = static_cast<uint16_t>(std::atoi(Argv[++i]));
+		}
+		else if (std::strcmp(Argv[i], "-group") == 0 && bHasValue)
+		{
+			MulticastGroup = Argv[++i];
+		}
+		else if (std::strcmp(Argv[i], "-frames") == 0 && bHasValue)
+		{
+			MaxFrames = std::atol(Argv[++i]);
+		}
+		else if (std::strcmp(Argv[i], "-joints") == 0)
+		{
+			bPrintJoints = true;
+		}
+		else
+		{
+			std::fprintf(stderr, "Usage: %s [-port PORT] [-group ADDRESS] [-frames N] [-joints]\n", Argv[0]);
+			return 2;
+		}
+	}
+
+	FKeypointNetworkClient Client;
+	std::string Error;
+	if (!Client.Bind(Port, MulticastGroup, &Error))
+	{
+		std::fprintf(stderr, "%s\n", Error.c_str());
+		return 1;
+	}
+	std::printf("Listening on port %u\n", Port);
+
+	long NumFrames = 0;
+	long NumIncomplete = 0;
+	double LatencySum = 0.0;
+	std::chrono::steady_clock::time_point StartTime;
+	FKeypointNetworkFrame Frame;
+	while (MaxFrames == 0 || NumFrames < MaxFrames)
+	{
+		if (!Client.Receive(Frame, 5000))
+		{
+			if (NumFrames > 0)
+			{
+				std::printf("No frame for 5 s, stopping.\n");
+				break;
+			}
+			continue;
+		}
+		if (NumFrames++ == 0)
+		{
+			StartTime = std::chrono::steady_clock::now();
+		}
+		NumIncomplete += Frame.bComplete ? 0 : 1;
+
+		// Only meaningful with the sender's and our clock in sync
+		const double LatencyMilliseconds = (static_cast<double>(Frame.ReceiveTimeMicros) - static_cast<double>(Frame.CaptureTimeMicros)) / 1000.0;
+		LatencySum += LatencyMilliseconds;
+		std::printf("#%u frame %d t=%.3f %zu subjects%s, latency %.2f ms\n", Frame.Sequence, Frame.FrameIndex, Frame.TimeSeconds,
+			Frame.Subjects.size(), Frame.bComplete ? "" : " (incomplete)", LatencyMilliseconds);
+
+		for (const FKeypointNetworkSubjectFrame& Subject : Frame.Subjects)
+		{
+			const size_t NumJoints = Subject.Positions.size() / 3;
+			std::printf("  %s (%u): %zu joints\n", Subject.Schema ? Subject.Schema->Name.c_str() : "<no schema yet>", Subject.SubjectId, NumJoints);
+			for (size_t Joint = 0; Joint < (bPrintJoints ? NumJoints : (NumJoints > 0 ? 1 : 0)); ++Joint)
+			{
+				const bool bNamed = Subject.Schema && Joint < Subject.Schema->JointNames.size();
+				std::printf("    %-16s %9.2f %9.2f %9.2f\n", bNamed ? Subject.Schema->JointNames[Joint].c_str() : "?",
+					Subject.Positions[Joint * 3], Subject.Positions[Joint * 3 + 1], Subject.Positions[Joint * 3 + 2]);
+			}
+		}
+	}
+
+	const double Seconds = NumFrames > 1 ? std::chrono::duration<double>(std::chrono::steady_clock::now() - StartTime).count() : 0.0;
+	std::printf("Received %ld frames in %.2f s (%.1f fps), %ld incomplete, %llu lost, %llu invalid datagrams, mean latency %.2f ms.\n",
+		NumFrames, Seconds, Seconds > 0.0 ? (NumFrames - 1) / Seconds : 0.0, NumIncomplete,
+		static_cast<unsigned long long>(Client.GetLostFrames()), static_cast<unsigned long long>(Client.GetInvalidDatagrams()),
+		NumFrames > 0 ? LatencySum / NumFrames : 0.0);
+	return 0;
+}
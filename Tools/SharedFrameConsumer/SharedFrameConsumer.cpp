@@ -0,0 +1,154 @@
+#include "SharedFrameConsumer.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+	void SetError(std::string* OutError, const std::string& Message)
+	{
+		if (OutError)
+		{
+			*OutError = Message;
+		}
+	}
+}
+
+FSharedFrameConsumer::~FSharedFrameConsumer()
+{
+	Detach();
+}
+
+bool FSharedFrameConsumer::Attach(const std::string& SegmentName, std::string* OutError)
+{
+	using namespace SharedFrameRing;
+	Detach();
+
+	const std::string ShmName = SegmentName.empty() || SegmentName[0] != '/' ? "/" + SegmentName : SegmentName;
+	const int FileDescriptor = shm_open(ShmName.c_str(), O_RDWR, 0);
+	if (FileDescriptor < 0)
+	{
+		SetError(OutError, "shm_open(" + ShmName + ") failed: " + std::strerror(errno));
+		return false;
+	}
+
+	struct stat Stat = {};
+	if (fstat(FileDescriptor, &Stat) != 0 || static_cast<size_t>(Stat.st_size) < sizeof(FRingHeader))
+	{
+		SetError(OutError, ShmName + " is too small to hold a frame ring");
+		close(FileDescriptor);
+		return false;
+	}
+
+	void* Mapping = mmap(nullptr, static_cast<size_t>(Stat.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, FileDescriptor, 0);
+	close(FileDescriptor);
+	if (Mapping == MAP_FAILED)
+	{
+		SetError(OutError, "mmap of " + ShmName + " failed: " + std::strerror(errno));
+		return false;
+	}
+
+	FRingHeader* RingHeader = static_cast<FRingHeader*>(Mapping);
+	const bool bValid = RingHeader->Magic == Magic && RingHeader->Version == Version && RingHeader->SlotCount > 0
+		&& GetSegmentSize(RingHeader->SlotCount, RingHeader->SlotPayloadBytes) <= static_cast<uint64_t>(Stat.st_size);
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (!bValid)
+	{
+		SetError(OutError, ShmName + " is not a version " + std::to_string(Version) + " frame ring");
+		munmap(Mapping, static_cast<size_t>(Stat.st_size));
+		return false;
+	}
+
+	// A consumer that died without detaching leaves its pid behind
+	uint32_t PreviousConsumer = RingHeader->ConsumerPid.load(std::memory_order_relaxed);
+	if (PreviousConsumer != 0 && kill(static_cast<pid_t>(PreviousConsumer), 0) == 0 && PreviousConsumer != static_cast<uint32_t>(getpid()))
+	{
+		SetError(OutError, ShmName + " already has a consumer (pid " + std::to_string(PreviousConsumer) + ")");
+		munmap(Mapping, static_cast<size_t>(Stat.st_size));
+		return false;
+	}
+	RingHeader->ConsumerPid.store(static_cast<uint32_t>(getpid()), std::memory_order_release);
+
+	Header = RingHeader;
+	MappingSize = static_cast<size_t>(Stat.st_size);
+	bAcquired = false;
+	return true;
+}
+
+void FSharedFrameConsumer::Detach()
+{
+	if (!Header)
+	{
+		return;
+	}
+	Release();
+	Header->ConsumerPid.store(0, std::memory_order_release);
+	munmap(Header, MappingSize);
+	Header = nullptr;
+	MappingSize = 0;
+}
+
+bool FSharedFrameConsumer::Acquire(FSharedFrameView& OutFrame, int TimeoutMilliseconds)
+{
+	using namespace SharedFrameRing;
+	if (!Header)
+	{
+		return false;
+	}
+	Release();
+
+	const uint64_t Sequence = Header->ReadSequence.load(std::memory_order_relaxed);
+	const auto Deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(TimeoutMilliseconds);
+	while (Header->WriteSequence.load(std::memory_order_acquire) <= Sequence)
+	{
+		if (!IsProducerAlive() || std::chrono::steady_clock::now() >= Deadline)
+		{
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::microseconds(200));
+	}
+
+	const uint8_t* Slot = reinterpret_cast<const uint8_t*>(Header) + Header->SlotsOffset + (Sequence % Header->SlotCount) * Header->SlotStride;
+	OutFrame.Header = reinterpret_cast<const FSlotHeader*>(Slot);
+	OutFrame.Pixels = Slot + OutFrame.Header->ImageOffset;
+	OutFrame.Subjects = reinterpret_cast<const FSubjectEntry*>(Slot + OutFrame.Header->SubjectsOffset);
+	OutFrame.Keypoints = reinterpret_cast<const FKeypoint*>(Slot + OutFrame.Header->KeypointsOffset);
+	OutFrame.Sequence = Sequence;
+	AcquiredSequence = Sequence;
+	bAcquired = true;
+	return true;
+}
+
+void FSharedFrameConsumer::Release()
+{
+	if (Header && bAcquired)
+	{
+		Header->ReadSequence.store(AcquiredSequence + 1, std::memory_order_release);
+		bAcquired = false;
+	}
+}
+
+bool FSharedFrameConsumer::IsProducerAlive() const
+{
+	// A producer that crashed never clears its PID; EPERM means the process exists under another user
+	const uint32_t ProducerPid = Header ? Header->ProducerPid.load(std::memory_order_acquire) : 0;
+	return ProducerPid != 0 && (kill(static_cast<pid_t>(ProducerPid), 0) == 0 || errno == EPERM);
+}
+
+uint64_t FSharedFrameConsumer::GetDroppedFrames() const
+{
+	return Header ? Header->DroppedFrames.load(std::memory_order_relaxed) : 0;
+}
+
+SharedFrameRing::EBackPressure FSharedFrameConsumer::GetBackPressure() const
+{
+	return Header ? static_cast<SharedFrameRing::EBackPressure>(Header->BackPressure) : SharedFrameRing::EBackPressure::Drop;
+}
@@ -0,0 +1,56 @@
+// SharedFrameConsumer.h
+#pragma once
+
+#include "SharedFrameRingProtocol.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// One published frame, pointing into the shared memory segment; valid until FSharedFrameConsumer::Release
+struct FSharedFrameView
+{
+	const SharedFrameRing::FSlotHeader* Header = nullptr;
+	// Header->Height rows of Header->RowPitch bytes, BGRA8
+	const uint8_t* Pixels = nullptr;
+	const SharedFrameRing::FSubjectEntry* Subjects = nullptr;
+	const SharedFrameRing::FKeypoint* Keypoints = nullptr;
+	// Position of the frame in the stream; dropped frames are never published and take no sequence number
+	uint64_t Sequence = 0;
+};
+
+/**
+ * Consumer side of the shared-memory frame ring written by the engine's ULiveFrameStreamSubsystem.
+ * Frames are read in place; call Release once done with each acquired frame so the producer can reuse its slot.
+ * Only one consumer may be attached to a segment at a time.
+ */
+class FSharedFrameConsumer
+{
+public:
+	~FSharedFrameConsumer();
+
+	/** Maps /<SegmentName> and registers as its consumer. */
+	bool Attach(const std::string& SegmentName, std::string* OutError = nullptr);
+	void Detach();
+	bool IsAttached() const { return Header != nullptr; }
+
+	/**
+	 * Waits up to TimeoutMilliseconds for the next frame.
+	 * @return False on timeout, or once the producer has closed and every frame has been consumed.
+	 */
+	bool Acquire(FSharedFrameView& OutFrame, int TimeoutMilliseconds);
+	/** Returns the acquired frame's slot to the producer. */
+	void Release();
+
+	/** False once the producer closed the ring or its process is gone. */
+	bool IsProducerAlive() const;
+	uint64_t GetDroppedFrames() const;
+	uint32_t GetSlotCount() const { return Header ? Header->SlotCount : 0; }
+	SharedFrameRing::EBackPressure GetBackPressure() const;
+
+private:
+	SharedFrameRing::FRingHeader* Header = nullptr;
+	size_t MappingSize = 0;
+	uint64_t AcquiredSequence = 0;
+	bool bAcquired = false;
+};
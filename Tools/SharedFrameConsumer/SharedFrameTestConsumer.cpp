@@ -0,0 +1,161 @@
+// Attaches to a live frame ring and reports what arrives, to check a capture's live stream without an inference stack.
+//
+//   SharedFrameTestConsumer [-segment ExtractJointLocationFrames] [-frames N] [-hold-ms M] [-dump DIR]
+//
+// -hold-ms keeps every frame for M ms before releasing it, to exercise the producer's back-pressure policy.
+// -dump writes the first frame of every camera as DIR/<Camera>.ppm with its in-image keypoints marked.
+
+#include "SharedFrameConsumer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	void WritePpm(const std::string& FilePath, const FSharedFrameView& Frame)
+	{
+		const SharedFrameRing::FSlotHeader& Header = *Frame.Header;
+		std::vector<uint8_t> Rgb(static_cast<size_t>(Header.Width) * Header.Height * 3);
+		for (uint32_t Y = 0; Y < Header.Height; ++Y)
+		{
+			const uint8_t* Row = Frame.Pixels + static_cast<size_t>(Y) * Header.RowPitch;
+			for (uint32_t X = 0; X < Header.Width; ++X)
+			{
+				uint8_t* Out = &Rgb[(static_cast<size_t>(Y) * Header.Width + X) * 3];
+				Out[0] = Row[X * 4 + 2];
+				Out[1] = Row[X * 4 + 1];
+				Out[2] = Row[X * 4 + 0];
+			}
+		}
+
+		// 5x5 magenta marker per visible keypoint
+		for (uint32_t i = 0; i < Header.NumKeypoints; ++i)
+		{
+			const SharedFrameRing::FKeypoint& Keypoint = Frame.Keypoints[i];
+			if (!(Keypoint.Flags & SharedFrameRing::KeypointInImage))
+			{
+				continue;
+			}
+			for (int Dy = -2; Dy <= 2; ++Dy)
+			{
+				for (int Dx = -2; Dx <= 2; ++Dx)
+				{
+					const int X = static_cast<int>(Keypoint.U) + Dx;
+					const int Y = static_cast<int>(Keypoint.V) + Dy;
+					if (X >= 0 && Y >= 0 && X < static_cast<int>(Header.Width) && Y < static_cast<int>(Header.Height))
+					{
+						uint8_t* Out = &Rgb[(static_cast<size_t>(Y) * Header.Width + X) * 3];
+						Out[0] = 255;
+						Out[1] = 0;
+						Out[2] = 255;
+					}
+				}
+			}
+		}
+
+		if (FILE* File = std::fopen(FilePath.c_str(), "wb"))
+		{
+			std::fprintf(File, "P6\n%u %u\n255\n", Header.Width, Header.Height);
+			std::fwrite(Rgb.data(), 1, Rgb.size(), File);
+			std::fclose(File);
+		}
+	}
+}
+
+int main(int Argc, char** Argv)
+{
+	std::string SegmentName = "ExtractJointLocationFrames";
+	std::string DumpDirectory;
+	long MaxFrames = 0;
+	int HoldMilliseconds = 0;
+	for (int i = 1; i + 1 < Argc; i += 2)
+	{
+		if (std::strcmp(Argv[i], "-segment") == 0)
+		{
+			SegmentName = Argv[i + 1];
+		}
+		else if (std::strcmp(Argv[i], "-frames") == 0)
+		{
+			MaxFrames = std::atol(Argv[i + 1]);
+		}
+		else if (std::strcmp(Argv[i], "-hold-ms") == 0)
+		{
+			HoldMilliseconds = std::atoi(Argv[i + 1]);
+		}
+		else if (std::strcmp(Argv[i], "-dump") == 0)
+		{
+			DumpDirectory = Argv[i + 1];
+		}
+		else
+		{
+			std::fprintf(stderr, "Usage: %s [-segment NAME] [-frames N] [-hold-ms M] [-dump DIR]\n", Argv[0]);
+			return 2;
+		}
+	}
+
+	// The producer creates the segment when it publishes its first frame
+	FSharedFrameConsumer Consumer;
+	std::string Error;
+	for (int Attempt = 0; !Consumer.Attach(SegmentName, &Error); ++Attempt)
+	{
+		if (Attempt == 0)
+		{
+			std::printf("Waiting for /%s (%s)\n", SegmentName.c_str(), Error.c_str());
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(250));
+	}
+	std::printf("Attached to /%s: %u slots, %s back-pressure\n", SegmentName.c_str(), Consumer.GetSlotCount(),
+		Consumer.GetBackPressure() == SharedFrameRing::EBackPressure::Block ? "block" : "drop");
+
+	std::map<std::string, long> FramesPerCamera;
+	long NumFrames = 0;
+	const auto StartTime = std::chrono::steady_clock::now();
+	FSharedFrameView Frame;
+	while (MaxFrames == 0 || NumFrames < MaxFrames)
+	{
+		if (!Consumer.Acquire(Frame, 1000))
+		{
+			if (!Consumer.IsProducerAlive())
+			{
+				std::printf("Producer closed the stream.\n");
+				break;
+			}
+			continue;
+		}
+
+		const SharedFrameRing::FSlotHeader& Header = *Frame.Header;
+		uint32_t NumInImage = 0;
+		for (uint32_t i = 0; i < Header.NumKeypoints; ++i)
+		{
+			NumInImage += (Frame.Keypoints[i].Flags & SharedFrameRing::KeypointInImage) ? 1 : 0;
+		}
+		std::printf("#%llu frame %d t=%.3f %s %ux%u, %u subjects, %u/%u keypoints in image\n",
+			static_cast<unsigned long long>(Frame.Sequence), Header.FrameIndex, Header.TimeSeconds, Header.CameraName,
+			Header.Width, Header.Height, Header.NumSubjects, NumInImage, Header.NumKeypoints);
+
+		long& CameraFrames = FramesPerCamera[Header.CameraName];
+		if (CameraFrames++ == 0 && !DumpDirectory.empty())
+		{
+			WritePpm(DumpDirectory + "/" + Header.CameraName + ".ppm", Frame);
+		}
+
+		if (HoldMilliseconds > 0)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(HoldMilliseconds));
+		}
+		Consumer.Release();
+		++NumFrames;
+	}
+
+	const double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - StartTime).count();
+	std::printf("Received %ld frames from %zu cameras in %.2f s (%.1f fps), producer dropped %llu.\n",
+		NumFrames, FramesPerCamera.size(), Seconds, Seconds > 0.0 ? NumFrames / Seconds : 0.0,
+		static_cast<unsigned long long>(Consumer.GetDroppedFrames()));
+	return 0;
+}
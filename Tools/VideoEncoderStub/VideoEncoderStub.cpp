@@ -0,0 +1,131 @@
+// Stands in for ffmpeg behind FVideoEncoderPipe: reads raw BGRA frames from stdin until EOF and writes, instead of a
+// video, a JSON summary with the frame count and an FNV-1a 64 checksum of every frame and of the whole input.
+//
+//   VideoEncoderStub -width W -height H -output FILE [-delay-ms M] [-exit-after-frames N]
+//
+// -delay-ms sleeps M ms after every frame, like an encoder slower than the capture, to exercise back-pressure.
+// -exit-after-frames stops reading after N frames with exit code 3, like an encoder that crashed.
+// Exits with 1 if the input ends inside a frame.
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	constexpr uint64_t FnvOffsetBasis = 14695981039346656037ull;
+	constexpr uint64_t FnvPrime = 1099511628211ull;
+
+	uint64_t HashBytes(uint64_t Hash, const uint8_t* Data, size_t Size)
+	{
+		for (size_t Index = 0; Index < Size; ++Index)
+		{
+			Hash = (Hash ^ Data[Index]) * FnvPrime;
+		}
+		return Hash;
+	}
+
+	bool WriteSummary(const std::string& FilePath, long Width, long Height, const std::vector<uint64_t>& FrameChecksums, uint64_t TotalBytes, uint64_t Checksum, size_t PartialBytes)
+	{
+		std::FILE* File = std::fopen(FilePath.c_str(), "w");
+		if (!File)
+		{
+			return false;
+		}
+		std::fprintf(File, "{\"Width\":%ld,\"Height\":%ld,\"Frames\":%zu,\"Bytes\":%" PRIu64 ",\"PartialBytes\":%zu,\"Checksum\":\"%016" PRIx64 "\",\"FrameChecksums\":[",
+			Width, Height, FrameChecksums.size(), TotalBytes, PartialBytes, Checksum);
+		for (size_t Index = 0; Index < FrameChecksums.size(); ++Index)
+		{
+			std::fprintf(File, "%s\"%016" PRIx64 "\"", Index > 0 ? "," : "", FrameChecksums[Index]);
+		}
+		std::fprintf(File, "]}\n");
+		return std::fclose(File) == 0;
+	}
+}
+
+int main(int Argc, char** Argv)
+{
+	long Width = 0;
+	long Height = 0;
+	std::string OutputPath;
+	int DelayMilliseconds = 0;
+	long ExitAfterFrames = -1;
+	bool bValidArguments = Argc % 2 == 1;
+	for (int i = 1; bValidArguments && i + 1 < Argc; i += 2)
+	{
+		if (std::strcmp(Argv[i], "-width") == 0)
+		{
+			Width = std::atol(Argv[i + 1]);
+		}
+		else if (std::strcmp(Argv[i], "-height") == 0)
+		{
+			Height = std::atol(Argv[i + 1]);
+		}
+		else if (std::strcmp(Argv[i], "-output") == 0)
+		{
+			OutputPath = Argv[i + 1];
+		}
+		else if (std::strcmp(Argv[i], "-delay-ms") == 0)
+		{
+			DelayMilliseconds = std::atoi(Argv[i + 1]);
+		}
+		else if (std::strcmp(Argv[i], "-exit-after-frames") == 0)
+		{
+			ExitAfterFrames = std::atol(Argv[i + 1]);
+		}
+		else
+		{
+			bValidArguments = false;
+		}
+	}
+	if (!bValidArguments || Width <= 0 || Height <= 0 || OutputPath.empty())
+	{
+		std::fprintf(stderr, "Usage: %s -width W -height H -output FILE [-delay-ms M] [-exit-after-frames N]\n", Argv[0]);
+		return 2;
+	}
+
+	const size_t FrameBytes = static_cast<size_t>(Width) * Height * 4;
+	std::vector<uint8_t> Frame(FrameBytes);
+	std::vector<uint64_t> FrameChecksums;
+	uint64_t Checksum = FnvOffsetBasis;
+	uint64_t TotalBytes = 0;
+	size_t Filled = 0;
+	for (;;)
+	{
+		const size_t Read = std::fread(Frame.data() + Filled, 1, FrameBytes - Filled, stdin);
+		Checksum = HashBytes(Checksum, Frame.data() + Filled, Read);
+		TotalBytes += Read;
+		Filled += Read;
+		if (Filled < FrameBytes)
+		{
+			break;
+		}
+
+		FrameChecksums.push_back(HashBytes(FnvOffsetBasis, Frame.data(), FrameBytes));
+		Filled = 0;
+		if (DelayMilliseconds > 0)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(DelayMilliseconds));
+		}
+		if (ExitAfterFrames >= 0 && static_cast<long>(FrameChecksums.size()) >= ExitAfterFrames)
+		{
+			WriteSummary(OutputPath, Width, Height, FrameChecksums, TotalBytes, Checksum, 0);
+			std::fprintf(stderr, "Exiting after %zu frames as requested.\n", FrameChecksums.size());
+			return 3;
+		}
+	}
+
+	if (!WriteSummary(OutputPath, Width, Height, FrameChecksums, TotalBytes, Checksum, Filled))
+	{
+		std::fprintf(stderr, "Failed to write %s\n", OutputPath.c_str());
+		return 2;
+	}
+	std::printf("%zu frames of %ldx%ld, %" PRIu64 " bytes, checksum %016" PRIx64 "\n", FrameChecksums.size(), Width, Height, TotalBytes, Checksum);
+	return Filled > 0 ? 1 : 0;
+}
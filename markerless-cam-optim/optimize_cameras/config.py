@@ -13,6 +13,9 @@ BLENDER_EXE = Path(os.getenv("BLENDER_EXE", r"C:\Program Files\Blender Foundatio
 # Default render output (Relative to ROOT_DIR)
 RENDER_OUTPUT = ROOT_DIR / "renders"
 
+# Job queue directory of the persistent Unreal capture worker (ACaptureWorker), should be in .env if used
+UNREAL_CAPTURE_QUEUE = Path(os.getenv("UNREAL_CAPTURE_QUEUE", ROOT_DIR / "unreal_capture_queue"))
+
 # Internal assets relative to ROOT_DIR
 BLENDER_SCRIPTS_DIR = ROOT_DIR / "blender_scripts"
 TEMPLATES_DIR = ROOT_DIR / "templates"
@@ -1,4 +1,8 @@
 import os
+import json
+import time
+import uuid
+from datetime import datetime
 import subprocess
 from pathlib import Path
 from .ml_inference import pose
@@ -174,4 +178,45 @@ def run_stitch_videos(root_dir: Path, output_name: str = "videos"):
 
    
     print(f"[+] Video stitching completed. Results in: {video_output_dir}\n")
-    return True
\ No newline at end of file
+    return True
+
+
+def submit_unreal_capture_job(job: dict, queue_dir: Path = config.UNREAL_CAPTURE_QUEUE):
+    """
+    Queues a capture job for a running Unreal capture worker (ACaptureWorker).
+    The spec is written under a temporary name and renamed, so the worker never reads a partial file.
+    """
+    pending_dir = queue_dir / "pending"
+    pending_dir.mkdir(parents=True, exist_ok=True)
+
+    # Microseconds keep submission order (the worker runs specs in file name order), the suffix keeps ids unique
+    job_id = job.setdefault("JobId", f"{datetime.now().strftime('%Y%m%d_%H%M%S_%f')}_{uuid.uuid4().hex[:8]}")
+    tmp_path = pending_dir / f"{job_id}.json.tmp"
+    tmp_path.write_text(json.dumps(job, indent=2))
+    tmp_path.replace(pending_dir / f"{job_id}.json")
+    print(f"[+] Queued Unreal capture job {job_id} in {pending_dir}")
+    return job_id
+
+def wait_for_unreal_capture_job(job_id: str, queue_dir: Path = config.UNREAL_CAPTURE_QUEUE, timeout: float = None, poll_interval: float = 1.0):
+    """
+    Waits for a queued capture job to finish and returns its final status (progress and per-stage timings),
+    or None on timeout.
+    """
+    status_path = queue_dir / "status" / f"{job_id}.json"
+    start = time.monotonic()
+    while timeout is None or time.monotonic() - start < timeout:
+        if status_path.exists():
+            try:
+                status = json.loads(status_path.read_text())
+            except json.JSONDecodeError:
+                status = None
+            if status and status.get("State") in ("done", "failed"):
+                if status["State"] == "failed":
+                    print(f"[!] ERROR: Unreal capture job {job_id} failed: {status.get('Error', 'unknown error')}")
+                else:
+                    print(f"[+] Unreal capture job {job_id} completed in {status.get('ElapsedSeconds', 0):.1f}s.")
+                return status
+        time.sleep(poll_interval)
+
+    print(f"[!] ERROR: Timed out waiting for Unreal capture job {job_id}")
+    return None